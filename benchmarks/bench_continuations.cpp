@@ -0,0 +1,135 @@
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "wasm_builder.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+/**
+ * Stack switching benchmark.
+ * Compares a guest call to an empty function with a suspend/resume round
+ * trip through a continuation (two context switches) and with creating a
+ * continuation, running it to completion and recycling its stack.
+ *
+ * Usage: ./bench_continuations [iterations]
+ */
+
+namespace {
+
+using B = WasmBuilder;
+using Clock = std::chrono::steady_clock;
+
+// (tag $tick)
+// (func $empty)
+// (func $ticker (loop (suspend $tick) (br 0)))
+// (func (export "calls") (param $n i32) (result i32)      ;; $n calls of $empty
+// (func (export "switches") (param $n i32) (result i32)   ;; resume $ticker $n times
+// (func (export "lifecycle") (param $n i32) (result i32)  ;; $n of cont.new $empty + resume
+WasmBuilder::Bytes buildModule() {
+    WasmBuilder builder;
+    uint32_t ft_unit = builder.addType({}, {});
+    uint32_t ct_unit = builder.addCont(ft_unit);
+    uint32_t ft_loop = builder.addType({B::I32}, {B::I32});
+    uint32_t on_tick = builder.addType({}, {B::CONTREF});
+    uint32_t tick = builder.addTag(ft_unit);
+    const uint32_t empty = 0, ticker = 1;
+
+    Code empty_body;
+    builder.addFunction(ft_unit, {}, empty_body.bytes());
+
+    Code ticker_body;
+    ticker_body.loop().suspend(tick).br(0).end();
+    builder.addFunction(ft_unit, {}, ticker_body.bytes());
+
+    // Runs step $n times with local 1 as the counter and returns it
+    auto counted = [](const Code& step) {
+        Code body;
+        body.block().loop()
+                .localGet(1).localGet(0).op(0x4E /* i32.ge_s */).brIf(1);
+        WasmBuilder::Bytes bytes = body.bytes();
+        bytes.insert(bytes.end(), step.bytes().begin(), step.bytes().end());
+        Code tail;
+        tail.localGet(1).i32Const(1).op(0x6A /* i32.add */).localSet(1)
+                .br(0)
+            .end().end()
+            .localGet(1);
+        bytes.insert(bytes.end(), tail.bytes().begin(), tail.bytes().end());
+        return bytes;
+    };
+
+    Code call_step;
+    call_step.call(empty);
+    builder.addFunction(ft_loop, {{1, B::I32}}, counted(call_step), "calls");
+
+    // Local 2 holds the ticker between resumes
+    Code switch_step;
+    switch_step.typedBlock(on_tick)
+                   .localGet(2).resume(ct_unit, {{tick, 0}})
+                   .op(0x00 /* unreachable: the ticker never returns */)
+               .end()
+               .localSet(2);
+    WasmBuilder::Bytes switches;
+    Code start;
+    start.refFunc(ticker).contNew(ct_unit).localSet(2);
+    switches = start.bytes();
+    WasmBuilder::Bytes loop = counted(switch_step);
+    switches.insert(switches.end(), loop.begin(), loop.end());
+    builder.addFunction(ft_loop, {{1, B::I32}, {1, B::CONTREF}}, switches, "switches");
+
+    Code lifecycle_step;
+    lifecycle_step.refFunc(empty).contNew(ct_unit).resume(ct_unit);
+    builder.addFunction(ft_loop, {{1, B::I32}}, counted(lifecycle_step), "lifecycle");
+    return builder.build();
+}
+
+double run(wasm::Interpreter& interpreter, const std::string& name, int32_t iterations) {
+    auto start = Clock::now();
+    int32_t done = interpreter.call(name, {wasm::TypedValue::makeI32(iterations)})[0].value.i32;
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    if (done != iterations) {
+        std::cerr << name << ": ran " << done << " of " << iterations << " iterations\n";
+        std::exit(1);
+    }
+    return ns / iterations;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    int32_t iterations = argc > 1 ? std::atoi(argv[1]) : 1000000;
+
+    std::cout << "=== Stack Switching Benchmark ===\n";
+    if (!wasm::Fiber::supported()) {
+        std::cout << "Fibers are not supported on this platform\n";
+        return 0;
+    }
+    std::cout << iterations << " iterations each\n\n";
+
+    wasm::Decoder decoder;
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(decoder.parseBytes(buildModule()));
+
+    // Warm up stacks, label vectors and the recycled continuation stack
+    for (const char* name : {"calls", "switches", "lifecycle"}) {
+        run(interpreter, name, 1000);
+    }
+
+    double call = run(interpreter, "calls", iterations);
+    double round_trip = run(interpreter, "switches", iterations);
+    double lifecycle = run(interpreter, "lifecycle", iterations);
+
+    std::cout << std::left << std::setw(34) << "operation" << std::right << std::setw(10) << "ns/op"
+              << std::setw(12) << "x call" << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(34) << "call + return" << std::right << std::setw(10) << call
+              << std::setw(12) << 1.0 << "\n";
+    std::cout << std::left << std::setw(34) << "resume + suspend (2 switches)" << std::right << std::setw(10)
+              << round_trip << std::setw(12) << round_trip / call << "\n";
+    std::cout << std::left << std::setw(34) << "cont.new + resume to completion" << std::right << std::setw(10)
+              << lifecycle << std::setw(12) << lifecycle / call << "\n";
+    std::cout << "\nLive continuations at exit: " << interpreter.liveContinuations()
+              << " (suspended tickers are dropped, not finished)\n";
+    return 0;
+}
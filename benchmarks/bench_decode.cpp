@@ -0,0 +1,202 @@
+#include "../include/decoder.h"
+#include "../include/instructions.h"
+#include "../include/leb128.h"
+#include "wasm_builder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Decode benchmark.
+ * Decodes a buffer of LEB128 values with the byte-at-a-time, bounds-checked
+ * loop the decoder used before and with the word-at-a-time path, then
+ * times parsing a large generated module and scanning its function bodies
+ * with the opcode table's immediate skipper.
+ *
+ * Usage: ./bench_decode [functions]
+ */
+
+namespace {
+
+using B = WasmBuilder;
+using Clock = std::chrono::steady_clock;
+
+// Best of several runs, in seconds
+template<typename F>
+double bestOf(int runs, F&& run) {
+    double best = 1e30;
+    for (int i = 0; i < runs; i++) {
+        auto start = Clock::now();
+        run();
+        best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+// Mostly one- and two-byte values, as in real index and size fields
+std::vector<uint8_t> makeVarints(size_t count) {
+    std::mt19937 rng(42);
+    std::vector<uint8_t> bytes;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t roll = rng() % 100;
+        uint32_t value = roll < 60 ? rng() % 0x80 : roll < 85 ? rng() % 0x4000 : roll < 95 ? rng() % 0x200000 : rng();
+        B::writeU32(bytes, value);
+    }
+    return bytes;
+}
+
+// The decoder's loop before the word path: a bounds check per byte
+uint64_t sumBytewise(const std::vector<uint8_t>& bytes) {
+    uint64_t sum = 0;
+    size_t pos = 0;
+    while (pos < bytes.size()) {
+        uint32_t result = 0;
+        int shift = 0;
+        while (true) {
+            if (pos >= bytes.size()) {
+                throw std::runtime_error("Unexpected end of file");
+            }
+            uint8_t byte = bytes[pos++];
+            result |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+            shift += 7;
+            if (shift >= 35) {
+                throw std::runtime_error("Invalid LEB128");
+            }
+        }
+        sum += result;
+    }
+    return sum;
+}
+
+uint64_t sumWordwise(const std::vector<uint8_t>& bytes) {
+    uint64_t sum = 0;
+    size_t pos = 0;
+    while (bytes.size() - pos >= wasm::LEB128_WORD) {
+        uint64_t word = wasm::loadLeb128Word(bytes.data() + pos);
+        unsigned length = wasm::leb128Length(word);
+        if (length == 0 || length > 5) {
+            throw std::runtime_error("Invalid LEB128");
+        }
+        sum += static_cast<uint32_t>(wasm::leb128Payload(word, length));
+        pos += length;
+    }
+    while (pos < bytes.size()) {
+        uint32_t result = 0;
+        int shift = 0;
+        uint8_t byte;
+        do {
+            byte = bytes[pos++];
+            result |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            shift += 7;
+        } while ((byte & 0x80) && pos < bytes.size());
+        sum += result;
+    }
+    return sum;
+}
+
+// Functions calling each other by multi-byte index, with wide constants,
+// memory offsets, nested blocks and a br_table, plus a large global section
+WasmBuilder::Bytes buildModule(uint32_t functions) {
+    WasmBuilder builder;
+    std::vector<uint32_t> types;
+    for (int i = 0; i < 64; i++) {
+        std::vector<uint8_t> params(static_cast<size_t>(i % 4), B::I32);
+        types.push_back(builder.addType(params, {B::I32}));
+    }
+    builder.setMemory(1);
+    for (int i = 0; i < 2000; i++) {
+        builder.addGlobal(B::I32, true, i * 7919);
+    }
+
+    std::mt19937 rng(7);
+    for (uint32_t f = 0; f < functions; f++) {
+        uint32_t type = types[f % types.size()];
+        Code body;
+        body.block(B::I32).block();
+        for (int i = 0; i < 6; i++) {
+            body.i32Const(static_cast<int32_t>(rng())).localGet(0)
+                .op(0x6A /* i32.add */).load(0x28 /* i32.load */, rng() % 60000).globalSet(rng() % 2000);
+        }
+        body.localGet(0).brTable({0, 0, 0}, 0).end()
+            .i32Const(static_cast<int32_t>(f)).end()
+            .op(0x1A /* drop */);
+        for (uint32_t p = 0; p < f % 4; p++) {
+            body.localGet(0);
+        }
+        // A callee of the same type
+        uint32_t callee = static_cast<uint32_t>(rng() % (functions / types.size())) *
+                          static_cast<uint32_t>(types.size()) + f % types.size();
+        body.call(std::min(callee, f));
+        builder.addFunction(type, {{3, B::I32}, {1, B::I64}}, body.bytes(),
+                            f % 8 == 0 ? "f" + std::to_string(f) : "");
+    }
+    return builder.build();
+}
+
+void row(const std::string& what, double value, const std::string& unit) {
+    std::cout << std::left << std::setw(34) << what << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << value << " " << unit << "\n";
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    uint32_t functions = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 50000;
+
+    std::cout << "=== Decode Benchmark ===\n\n";
+
+    const size_t count = 4000000;
+    std::vector<uint8_t> varints = makeVarints(count);
+    volatile uint64_t sink = 0;
+    double bytewise = bestOf(5, [&] { sink = sink + sumBytewise(varints); });
+    double wordwise = bestOf(5, [&] { sink = sink + sumWordwise(varints); });
+    if (sumBytewise(varints) != sumWordwise(varints)) {
+        std::cerr << "LEB128 paths disagree\n";
+        return 1;
+    }
+    std::cout << count / 1000000 << "M LEB128 u32 values, " << varints.size() / 1024 << " KiB\n";
+    row("byte at a time", count / bytewise / 1e6, "M values/s");
+    row("word at a time", count / wordwise / 1e6, "M values/s");
+    row("speedup", bytewise / wordwise, "x");
+
+    WasmBuilder::Bytes bytes = buildModule(functions);
+    wasm::Decoder decoder;
+    size_t instructions = 0;
+    size_t body_bytes = 0;
+    double parse = bestOf(60, [&] {
+        wasm::Module module = decoder.parseBytes(bytes);
+        sink = sink + module.functions.size();
+    });
+
+    wasm::Module module = decoder.parseBytes(bytes);
+    double scan = bestOf(60, [&] {
+        instructions = 0;
+        body_bytes = 0;
+        for (size_t i = 0; i < module.functions.size(); i++) {
+            wasm::ArrayView<uint8_t> body = module.functions.body(i);
+            size_t pc = 0;
+            while (pc < body.size()) {
+                uint8_t opcode = body[pc++];
+                wasm::skipImmediates(opcode, body.data(), body.size(), pc);
+                instructions++;
+            }
+            body_bytes += body.size();
+        }
+    });
+
+    std::cout << "\nModule: " << functions << " functions, " << bytes.size() / 1024 << " KiB\n";
+    row("parse", parse * 1e3, "ms");
+    row("parse throughput", bytes.size() / parse / 1e6, "MB/s");
+    row("scan bodies", body_bytes / scan / 1e6, "MB/s");
+    row("scan instructions", instructions / scan / 1e6, "M instructions/s");
+    return 0;
+}
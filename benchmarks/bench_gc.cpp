@@ -0,0 +1,148 @@
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "wasm_builder.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * GC heap benchmark.
+ * Runs two allocation-heavy guests under several nursery sizes: binary
+ * trees (a long-lived tree plus many short-lived ones, walked after they
+ * are built) and churn (short-lived arrays that die at once). Reports
+ * the time, allocation rate, minor and major collections, the bytes
+ * promoted out of the nursery and the total and longest pause.
+ *
+ * Usage: ./bench_gc [long_lived_depth]
+ */
+
+namespace {
+
+using B = WasmBuilder;
+using Clock = std::chrono::steady_clock;
+
+// GC instruction sub-opcodes (after 0xFB)
+constexpr uint32_t STRUCT_NEW = 0x00;
+constexpr uint32_t STRUCT_GET = 0x02;
+constexpr uint32_t ARRAY_NEW_DEFAULT = 0x07;
+
+// (type $tree (struct (field anyref) (field anyref)))
+// (type $ints (array (mut i32)))
+// (func $make (param $depth i32) (result anyref))    ;; complete tree
+// (func $check (param anyref) (result i32))          ;; count its nodes
+// (func (export "trees") (param $depth i32) (param $count i32) (result i32)
+//   keep one tree of $depth alive while building and checking $count
+//   trees of depth 4, then check the long-lived one)
+// (func (export "churn") (param $count i32) (result i32)
+//   allocate $count arrays of 16 i32 and drop them)
+WasmBuilder::Bytes buildModule() {
+    WasmBuilder builder;
+    uint32_t tree = builder.addStruct({{B::ANYREF, false}, {B::ANYREF, false}});
+    uint32_t ints = builder.addArray(B::I32, true);
+    uint32_t make_type = builder.addType({B::I32}, {B::ANYREF});
+    uint32_t check_type = builder.addType({B::ANYREF}, {B::I32});
+    uint32_t trees_type = builder.addType({B::I32, B::I32}, {B::I32});
+    uint32_t churn_type = builder.addType({B::I32}, {B::I32});
+    const uint32_t make = 0, check = 1;
+
+    Code make_body;
+    make_body.localGet(0).op(0x45 /* i32.eqz */).ifBlock(B::ANYREF)
+                 .refNull().refNull().gc(STRUCT_NEW).u32(tree)
+             .elseBlock()
+                 .localGet(0).i32Const(1).op(0x6B /* i32.sub */).call(make)
+                 .localGet(0).i32Const(1).op(0x6B).call(make)
+                 .gc(STRUCT_NEW).u32(tree)
+             .end();
+    builder.addFunction(make_type, {}, make_body.bytes());
+
+    Code check_body;
+    check_body.localGet(0).gc(STRUCT_GET).u32(tree).u32(0).op(0xD1 /* ref.is_null */).ifBlock(B::I32)
+                  .i32Const(1)
+              .elseBlock()
+                  .localGet(0).gc(STRUCT_GET).u32(tree).u32(0).call(check)
+                  .localGet(0).gc(STRUCT_GET).u32(tree).u32(1).call(check)
+                  .op(0x6A /* i32.add */).i32Const(1).op(0x6A)
+              .end();
+    builder.addFunction(check_type, {}, check_body.bytes());
+
+    // Locals: 2 i, 3 sum, 4 long-lived tree
+    Code trees_body;
+    trees_body.localGet(0).call(make).localSet(4)
+              .block().loop()
+                  .localGet(2).localGet(1).op(0x4E /* i32.ge_s */).brIf(1)
+                  .localGet(3).i32Const(4).call(make).call(check).op(0x6A).localSet(3)
+                  .localGet(2).i32Const(1).op(0x6A).localSet(2)
+                  .br(0)
+              .end().end()
+              .localGet(3).localGet(4).call(check).op(0x6A);
+    builder.addFunction(trees_type, {{2, B::I32}, {1, B::ANYREF}}, trees_body.bytes(), "trees");
+
+    // Locals: 1 i
+    Code churn_body;
+    churn_body.block().loop()
+                  .localGet(1).localGet(0).op(0x4E).brIf(1)
+                  .i32Const(16).gc(ARRAY_NEW_DEFAULT).u32(ints).op(0x1A /* drop */)
+                  .localGet(1).i32Const(1).op(0x6A).localSet(1)
+                  .br(0)
+              .end().end()
+              .localGet(1);
+    builder.addFunction(churn_type, {{1, B::I32}}, churn_body.bytes(), "churn");
+    return builder.build();
+}
+
+void report(const std::string& workload, size_t nursery_bytes, double millis, const wasm::GcStats& stats) {
+    std::cout << std::left << std::setw(8) << workload << std::right << std::setw(10) << (nursery_bytes >> 10)
+              << std::fixed << std::setprecision(1) << std::setw(10) << millis
+              << std::setw(14) << stats.allocations / (millis * 1000.0)
+              << std::setw(8) << stats.minor_collections << std::setw(8) << stats.major_collections
+              << std::setw(16) << static_cast<double>(stats.promoted_bytes) / 1024.0
+              << std::setw(12) << stats.total_pause_ns / 1e6
+              << std::setw(14) << stats.max_pause_ns / 1e3 << "\n";
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    int32_t depth = argc > 1 ? std::atoi(argv[1]) : 16;
+    const int32_t short_lived = 20000;      // Depth-4 trees: 31 nodes each
+    const int32_t arrays = 500000;
+
+    std::cout << "=== GC Heap Benchmark ===\n";
+    std::cout << "trees: one depth-" << depth << " tree kept alive, " << short_lived
+              << " depth-4 trees built and dropped; churn: " << arrays << " arrays of 16 i32\n\n";
+
+    WasmBuilder::Bytes bytes = buildModule();
+    wasm::Decoder decoder;
+
+    std::cout << std::left << std::setw(8) << "guest" << std::right << std::setw(10) << "nursery K"
+              << std::setw(10) << "ms" << std::setw(14) << "allocs/us" << std::setw(8) << "minor"
+              << std::setw(8) << "major" << std::setw(16) << "promoted KiB" << std::setw(12) << "pause ms"
+              << std::setw(14) << "max pause us" << "\n";
+    for (size_t nursery_bytes : {size_t(64) << 10, size_t(256) << 10, size_t(1) << 20, size_t(4) << 20}) {
+        wasm::GcOptions options;
+        options.nursery_bytes = nursery_bytes;
+
+        wasm::Interpreter interpreter;
+        interpreter.setGcOptions(options);
+        interpreter.instantiate(decoder.parseBytes(bytes));
+        auto start = Clock::now();
+        int32_t nodes = interpreter.call("trees", {wasm::TypedValue::makeI32(depth),
+                                                   wasm::TypedValue::makeI32(short_lived)})[0].value.i32;
+        double millis = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (nodes != short_lived * 31 + (1 << (depth + 1)) - 1) {
+            std::cerr << "trees: wrong node count " << nodes << "\n";
+            return 1;
+        }
+        report("trees", nursery_bytes, millis, interpreter.gcHeap()->stats());
+
+        interpreter.instantiate(decoder.parseBytes(bytes));
+        start = Clock::now();
+        interpreter.call("churn", {wasm::TypedValue::makeI32(arrays)});
+        millis = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        report("churn", nursery_bytes, millis, interpreter.gcHeap()->stats());
+    }
+    return 0;
+}
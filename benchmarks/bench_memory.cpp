@@ -0,0 +1,391 @@
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "../include/memory.h"
+#include "../include/perf_counters.h"
+#include "wasm_builder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+/**
+ * Linear memory backend benchmark.
+ * Instantiates a module with a large initial memory on each backend and
+ * reports instantiation latency and the resident set before and after a
+ * short request that touches a few pages, and the cost of resetting the
+ * memory after such a request by full copy and by rewriting only dirty
+ * pages. Then fills the memory and runs
+ * random reads across it, in the guest and as a host loop over data(),
+ * reporting time and data TLB misses per backend. Finally instantiates a
+ * module with a large data segment several times, copying the segment or
+ * mapping it from the module file, and reports the memory each instance
+ * costs (PSS, which splits shared pages between their users). Also runs
+ * the random reads on LAZY memory under each bounds check policy, in the
+ * guest and as host calls to Memory::loadAt().
+ *
+ * Usage: ./bench_memory [pages]
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+size_t residentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t total = 0, resident = 0;
+    if (!(statm >> total >> resident)) {
+        return 0;
+    }
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+// (memory pages)
+// (func (export "touch") (param i32) (result i32)  ;; write and sum one word per page
+// (func (export "gather") (param i32 i32) (result i32)  ;; sum n words at random
+//   addresses masked by the second argument
+WasmBuilder::Bytes buildModule(uint32_t pages) {
+    using B = WasmBuilder;
+    WasmBuilder builder;
+    uint32_t i32_to_i32 = builder.addType({B::I32}, {B::I32});
+    uint32_t i32_i32_to_i32 = builder.addType({B::I32, B::I32}, {B::I32});
+
+    Code touch;
+    touch.block().loop()
+             .localGet(1).localGet(0).op(0x4F /* i32.ge_u */).brIf(1)
+             .localGet(1).i32Const(16).op(0x74 /* i32.shl */).localGet(1).store(0x36 /* i32.store */)
+             .localGet(2).localGet(1).i32Const(16).op(0x74 /* i32.shl */).load(0x28 /* i32.load */)
+             .op(0x6A /* i32.add */).localSet(2)
+             .localGet(1).i32Const(1).op(0x6A).localSet(1)
+             .br(0)
+         .end().end()
+         .localGet(2);
+    builder.addFunction(i32_to_i32, {{2, B::I32}}, touch.bytes(), "touch");
+
+    // locals: 2 = state, 3 = sum
+    Code gather;
+    gather.block().loop()
+              .localGet(0).op(0x45 /* i32.eqz */).brIf(1)
+              .localGet(2).i32Const(1103515245).op(0x6C /* i32.mul */).i32Const(12345).op(0x6A /* i32.add */)
+              .localTee(2).localGet(1).op(0x71 /* i32.and */).load(0x28 /* i32.load */)
+              .localGet(3).op(0x6A).localSet(3)
+              .localGet(0).i32Const(1).op(0x6B /* i32.sub */).localSet(0)
+              .br(0)
+          .end().end()
+          .localGet(3);
+    builder.addFunction(i32_i32_to_i32, {{2, B::I32}}, gather.bytes(), "gather");
+    builder.setMemory(pages);
+    return builder.build();
+}
+
+// Proportional set size from /proc, or 0 where it is not available
+size_t proportionalBytes() {
+    std::ifstream rollup("/proc/self/smaps_rollup");
+    std::string line;
+    while (std::getline(rollup, line)) {
+        if (line.compare(0, 4, "Pss:") == 0) {
+            std::istringstream fields(line.substr(4));
+            size_t kib = 0;
+            fields >> kib;
+            return kib * 1024;
+        }
+    }
+    return 0;
+}
+
+double kibibytes(size_t bytes) {
+    return static_cast<double>(bytes) / 1024.0;
+}
+
+// Same walk as the guest's gather, straight over the host mapping
+uint32_t hostGather(const uint8_t* data, uint32_t count, uint32_t mask) {
+    uint32_t state = 0, sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        state = state * 1103515245u + 12345u;
+        uint32_t word;
+        std::memcpy(&word, data + (state & mask), sizeof(word));
+        sum += word;
+    }
+    return sum;
+}
+
+struct Measurement {
+    double millis = 0;
+    uint64_t dtlb_misses = 0;
+};
+
+template <typename Fn>
+Measurement measure(const wasm::PerfCounters& counters, Fn&& fn) {
+    wasm::CounterValues before = counters.read();
+    auto start = Clock::now();
+    fn();
+    Measurement result;
+    result.millis = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    result.dtlb_misses = counters.read()[wasm::Counter::DTLB_MISSES] - before[wasm::Counter::DTLB_MISSES];
+    return result;
+}
+
+double median(std::vector<double>& samples) {
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+void runReset(uint32_t pages, uint32_t touched_pages) {
+    const int requests = 20;
+    std::cout << "\nReset after a request writing one word in each of " << touched_pages << " pages\n";
+    std::cout << std::left << std::setw(8) << "backend" << std::right << std::setw(20) << "full copy (us)"
+              << std::setw(20) << "dirty pages (us)" << std::setw(16) << "pages reset" << "\n";
+    for (wasm::MemoryBackend backend :
+         {wasm::MemoryBackend::HEAP, wasm::MemoryBackend::LAZY, wasm::MemoryBackend::HUGE_PAGES}) {
+        wasm::Memory memory(wasm::Limits(pages), backend);
+        memory.storeU32(1024, 1);
+        wasm::Memory pristine(memory);
+
+        auto request = [&] {
+            for (uint32_t page = 0; page < std::min(touched_pages, pages); page++) {
+                memory.storeU32(page * wasm::Memory::PAGE_SIZE, page);
+            }
+        };
+        std::vector<double> full, dirty;
+        size_t reset_pages = 0;
+        for (int i = 0; i < requests; i++) {
+            request();
+            auto start = Clock::now();
+            memory = pristine;
+            full.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        }
+        memory.trackDirtyPages(true);
+        for (int i = 0; i < requests; i++) {
+            request();
+            auto start = Clock::now();
+            reset_pages = memory.resetTo(pristine);
+            dirty.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        }
+        std::cout << std::left << std::setw(8) << wasm::memoryBackendName(memory.backend()) << std::right
+                  << std::fixed << std::setprecision(1) << std::setw(20) << median(full) << std::setw(20)
+                  << median(dirty) << std::setw(16) << reset_pages << "\n";
+    }
+}
+
+void runDataSegments() {
+    const size_t segment_size = 64u << 20;
+    const int instances = 8;
+    WasmBuilder::Bytes payload(segment_size);
+    for (size_t i = 0; i < payload.size(); i++) {
+        payload[i] = static_cast<uint8_t>(i >> 12 | 1);
+    }
+    // Line the payload up with a page in memory, as a linker aligning the
+    // data section would; offsets 2^17 to 2^17 + 4095 encode alike
+    auto build = [&](uint32_t offset) {
+        WasmBuilder builder;
+        builder.setMemory(static_cast<uint32_t>(segment_size / wasm::Memory::PAGE_SIZE) + 4);
+        builder.addData(offset, payload);
+        return builder.build();
+    };
+    WasmBuilder::Bytes bytes = build(1 << 17);
+    size_t position = static_cast<size_t>(
+        std::search(bytes.begin(), bytes.end(), payload.begin(), payload.begin() + 4096) - bytes.begin());
+    uint32_t offset = (1u << 17) + static_cast<uint32_t>(position % 4096);
+    bytes = build(offset);
+    std::string path = "/tmp/bench-memory-" + std::to_string(getpid()) + ".wasm";
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(bytes.data()),
+                                                 static_cast<std::streamsize>(bytes.size()));
+
+    std::cout << "\n" << instances << " instances of a module with a " << segment_size / (1 << 20)
+              << " MiB data segment (PSS per instance)\n";
+    std::cout << std::left << std::setw(16) << "segment" << std::right << std::setw(20) << "instantiate (ms)"
+              << std::setw(20) << "created (KiB)" << std::setw(20) << "after read (KiB)" << "\n";
+    struct Mode {
+        const char* name;
+        wasm::MemoryBackend backend;
+        bool from_file;
+    };
+    for (const Mode& mode : {Mode{"copied (heap)", wasm::MemoryBackend::HEAP, false},
+                             Mode{"copied (lazy)", wasm::MemoryBackend::LAZY, false},
+                             Mode{"mapped (lazy)", wasm::MemoryBackend::LAZY, true}}) {
+        wasm::Decoder decoder;
+        std::vector<std::unique_ptr<wasm::Interpreter>> live;
+        std::vector<double> millis;
+        size_t before = proportionalBytes();
+        for (int i = 0; i < instances; i++) {
+            auto start = Clock::now();
+            auto interpreter = std::make_unique<wasm::Interpreter>();
+            interpreter->setMemoryBackend(mode.backend);
+            interpreter->instantiate(mode.from_file ? decoder.parse(path) : decoder.parseBytes(bytes));
+            millis.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            live.push_back(std::move(interpreter));
+        }
+        size_t created = proportionalBytes();
+        volatile uint8_t sink = 0;
+        for (const auto& interpreter : live) {
+            const uint8_t* data = interpreter->memory()->data() + offset;
+            for (size_t i = 0; i < segment_size; i += 4096) {
+                sink = sink + data[i];
+            }
+        }
+        size_t read = proportionalBytes();
+        std::cout << std::left << std::setw(16) << mode.name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(20) << median(millis) << std::setw(20)
+                  << kibibytes((created - before) / instances) << std::setw(20)
+                  << kibibytes((read - before) / instances) << "\n";
+    }
+    std::remove(path.c_str());
+}
+
+void runThroughput(const WasmBuilder::Bytes& bytes, uint32_t pages) {
+    const uint32_t guest_reads = 2000000;
+    const uint32_t host_reads = 20000000;
+    // Word-aligned addresses within the largest power of two that fits
+    uint32_t span = 1;
+    while (span <= pages / 2) {
+        span *= 2;
+    }
+    uint32_t mask = static_cast<uint32_t>(uint64_t(span) * wasm::Memory::PAGE_SIZE - 1) & ~3u;
+
+    wasm::PerfCounters counters;
+    bool tlb = counters.available(wasm::Counter::DTLB_MISSES);
+    std::cout << "\nRandom reads over " << uint64_t(span) * wasm::Memory::PAGE_SIZE / (1 << 20) << " MiB: "
+              << guest_reads << " in the guest, " << host_reads << " from the host\n";
+    if (!tlb) {
+        std::cout << "(dTLB counter unavailable: " << counters.error() << ")\n";
+    }
+    std::cout << std::left << std::setw(8) << "backend" << std::setw(13) << "huge pages" << std::right
+              << std::setw(14) << "guest (ms)" << std::setw(16) << "guest dTLB" << std::setw(14) << "host (ms)"
+              << std::setw(16) << "host dTLB" << "\n";
+
+    wasm::Decoder decoder;
+    for (wasm::MemoryBackend backend :
+         {wasm::MemoryBackend::HEAP, wasm::MemoryBackend::LAZY, wasm::MemoryBackend::HUGE_PAGES}) {
+        wasm::Interpreter interpreter;
+        interpreter.setMemoryBackend(backend);
+        interpreter.instantiate(decoder.parseBytes(bytes));
+        wasm::Memory* memory = interpreter.memory();
+        std::memset(memory->data(), 1, memory->sizeInBytes());
+
+        Measurement guest = measure(counters, [&] {
+            interpreter.call("gather", {wasm::TypedValue::makeI32(static_cast<int32_t>(guest_reads)),
+                                        wasm::TypedValue::makeI32(static_cast<int32_t>(mask))});
+        });
+        volatile uint32_t sink = 0;
+        Measurement host = measure(counters, [&] { sink = hostGather(memory->data(), host_reads, mask); });
+        (void)sink;
+
+        auto misses = [&](uint64_t count) { return tlb ? std::to_string(count) : std::string("-"); };
+        std::string source = memory->hugePageSource();
+        std::cout << std::left << std::setw(8) << wasm::memoryBackendName(memory->backend()) << std::setw(13)
+                  << (source.empty() ? "-" : source) << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(14) << guest.millis << std::setw(16) << misses(guest.dtlb_misses) << std::setw(14)
+                  << host.millis << std::setw(16) << misses(host.dtlb_misses) << "\n";
+    }
+}
+
+template<wasm::BoundsCheck B>
+uint32_t hostGatherChecked(const wasm::Memory& memory, uint32_t count, uint32_t mask) {
+    uint32_t state = 0, sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        state = state * 1103515245u + 12345u;
+        sum += static_cast<uint32_t>(memory.loadAt<B, int32_t>(state & mask, 0));
+    }
+    return sum;
+}
+
+void runBoundsChecks(const WasmBuilder::Bytes& bytes, uint32_t pages) {
+    const uint32_t guest_reads = 2000000;
+    const uint32_t host_reads = 20000000;
+    uint32_t mask = static_cast<uint32_t>(uint64_t(pages) * wasm::Memory::PAGE_SIZE - 1) & ~3u;
+
+    std::cout << "\nBounds checks, random reads on lazy memory: " << guest_reads << " in the guest, "
+              << host_reads << " through loadAt()\n";
+    std::cout << std::left << std::setw(10) << "requested" << std::setw(10) << "in effect" << std::right
+              << std::setw(14) << "guest (ms)" << std::setw(16) << "loadAt (ms)" << std::setw(14) << "sum" << "\n";
+
+    wasm::Decoder decoder;
+    wasm::PerfCounters counters;
+    for (wasm::BoundsCheck bounds :
+         {wasm::BoundsCheck::EXPLICIT, wasm::BoundsCheck::MASKED, wasm::BoundsCheck::GUARD}) {
+        wasm::Interpreter interpreter;
+        interpreter.setMemoryBackend(wasm::MemoryBackend::LAZY);
+        interpreter.setBoundsCheck(bounds);
+        interpreter.instantiate(decoder.parseBytes(bytes));
+        wasm::Memory* memory = interpreter.memory();
+        std::memset(memory->data(), 1, memory->sizeInBytes());
+
+        int32_t sum = 0;
+        Measurement guest = measure(counters, [&] {
+            sum = interpreter.call("gather", {wasm::TypedValue::makeI32(static_cast<int32_t>(guest_reads)),
+                                              wasm::TypedValue::makeI32(static_cast<int32_t>(mask))})[0].value.i32;
+        });
+        volatile uint32_t sink = 0;
+        Measurement host = measure(counters, [&] {
+            switch (memory->boundsCheck()) {
+                case wasm::BoundsCheck::MASKED:
+                    sink = hostGatherChecked<wasm::BoundsCheck::MASKED>(*memory, host_reads, mask);
+                    break;
+                case wasm::BoundsCheck::GUARD:
+                    sink = hostGatherChecked<wasm::BoundsCheck::GUARD>(*memory, host_reads, mask);
+                    break;
+                default:
+                    sink = hostGatherChecked<wasm::BoundsCheck::EXPLICIT>(*memory, host_reads, mask);
+                    break;
+            }
+        });
+        (void)sink;
+
+        std::cout << std::left << std::setw(10) << wasm::boundsCheckName(bounds) << std::setw(10)
+                  << wasm::boundsCheckName(memory->boundsCheck()) << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(14) << guest.millis << std::setw(16) << host.millis
+                  << std::setw(14) << sum << "\n";
+    }
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    uint32_t pages = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 4096;
+    const uint32_t touched_pages = 16;
+    const int instances = 20;
+
+    std::cout << "=== Linear Memory Backend Benchmark ===\n";
+    std::cout << "Initial memory " << pages << " pages (" << size_t(pages) * wasm::Memory::PAGE_SIZE / (1 << 20)
+              << " MiB), request touches " << touched_pages << " pages\n\n";
+
+    WasmBuilder::Bytes bytes = buildModule(pages);
+    wasm::Decoder decoder;
+
+    std::cout << std::left << std::setw(8) << "backend" << std::right << std::setw(20) << "instantiate (us)"
+              << std::setw(20) << "RSS created (KiB)" << std::setw(24) << "RSS after call (KiB)" << "\n";
+    for (wasm::MemoryBackend backend :
+         {wasm::MemoryBackend::HEAP, wasm::MemoryBackend::LAZY, wasm::MemoryBackend::HUGE_PAGES}) {
+        std::vector<double> micros;
+        size_t created = 0, after_call = 0;
+        for (int i = 0; i < instances; i++) {
+            wasm::Module module = decoder.parseBytes(bytes);
+            size_t before = residentBytes();
+            auto start = Clock::now();
+            wasm::Interpreter interpreter;
+            interpreter.setMemoryBackend(backend);
+            interpreter.instantiate(std::move(module));
+            micros.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+            created += residentBytes() - before;
+            interpreter.call("touch", {wasm::TypedValue::makeI32(static_cast<int32_t>(std::min(touched_pages, pages)))});
+            after_call += residentBytes() - before;
+        }
+        std::cout << std::left << std::setw(8) << wasm::memoryBackendName(backend) << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(20) << median(micros) << std::setw(20)
+                  << kibibytes(created / instances) << std::setw(24) << kibibytes(after_call / instances) << "\n";
+    }
+
+    runReset(pages, touched_pages);
+    runThroughput(bytes, pages);
+    runBoundsChecks(bytes, pages);
+    runDataSegments();
+    return 0;
+}
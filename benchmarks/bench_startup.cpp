@@ -0,0 +1,214 @@
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "module_generator.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Startup scaling benchmark.
+ * Generates modules of growing size (up to 100k functions, and up to 1 GB
+ * of data) and reports the time and peak memory of Decoder::parse and
+ * Interpreter::instantiate for each. The interpreter has no separate
+ * validation pass; the checks it makes run inside these two phases.
+ *
+ * For each sweep the scaling exponent of every phase is fitted between
+ * the smallest measurable and the largest size: 1.0 is linear. An
+ * exponent above 1.25 is reported as super-linear and the benchmark
+ * exits with status 1.
+ *
+ * Peak memory is the high-water mark of resident memory during a phase,
+ * relative to the resident size before it (Linux only; reset through
+ * /proc/self/clear_refs).
+ *
+ * Usage: ./bench_startup [--max-functions n] [--max-data MiB]
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int RUNS = 3;
+constexpr double SUPER_LINEAR = 1.25;
+constexpr double MIN_MS = 2.0;          // Shorter phases are too noisy to fit
+constexpr double MIN_MIB = 1.0;
+
+// VmRSS or VmHWM from /proc/self/status, in MiB; -1 if unavailable
+double statusMiB(const std::string& field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, field.size(), field) == 0 && line[field.size()] == ':') {
+            return std::atof(line.c_str() + field.size() + 1) / 1024.0;
+        }
+    }
+    return -1;
+}
+
+struct Phase {
+    double ms = 0;
+    double peak_mib = -1;
+};
+
+// Time fn and its resident-memory high-water mark above the current size
+template<typename F>
+Phase measure(F&& fn) {
+    std::ofstream("/proc/self/clear_refs") << "5";
+    double before = statusMiB("VmRSS");
+    auto start = Clock::now();
+    fn();
+    Phase phase;
+    phase.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    double peak = statusMiB("VmHWM");
+    if (before >= 0 && peak >= 0) {
+        phase.peak_mib = peak - before;
+    }
+    return phase;
+}
+
+struct Point {
+    double units;           // Functions or data MiB, the swept quantity
+    double file_mib;
+    Phase parse;
+    Phase instantiate;
+};
+
+Point run(const ModuleShape& shape, double units) {
+    std::string path = "/tmp/bench_startup_" + std::to_string(getpid()) + ".wasm";
+    Point point;
+    point.units = units;
+    {
+        std::ofstream out(path, std::ios::binary);
+        point.file_mib = static_cast<double>(writeModule(shape, out)) / (1 << 20);
+    }
+
+    // Best of RUNS; the first run also pays for reading the file into the page cache
+    point.parse.ms = point.instantiate.ms = 1e30;
+    for (int i = 0; i < RUNS; i++) {
+        wasm::Decoder decoder;
+        wasm::Module module;
+        Phase parse = measure([&] { module = decoder.parse(path); });
+        wasm::Interpreter instance;
+        Phase instantiate = measure([&] { instance.instantiate(std::move(module)); });
+        point.parse = parse.ms < point.parse.ms ? parse : point.parse;
+        point.instantiate = instantiate.ms < point.instantiate.ms ? instantiate : point.instantiate;
+    }
+    std::remove(path.c_str());
+    return point;
+}
+
+void printHeader(const std::string& unit) {
+    std::cout << std::right << std::setw(12) << unit << std::setw(10) << "file MiB" << std::setw(11) << "parse ms"
+              << std::setw(11) << "parse MiB" << std::setw(10) << "inst ms" << std::setw(10) << "inst MiB" << "\n";
+}
+
+void printPoint(const Point& point) {
+    std::cout << std::fixed << std::setprecision(0) << std::setw(12) << point.units << std::setprecision(1)
+              << std::setw(10) << point.file_mib << std::setw(11) << point.parse.ms << std::setw(11)
+              << point.parse.peak_mib << std::setw(10) << point.instantiate.ms << std::setw(10)
+              << point.instantiate.peak_mib << std::endl;
+}
+
+// Slope of log(value) against log(units) between the first point where
+// the value is measurable and the last; NaN if there is no such pair
+template<typename Get>
+double exponent(const std::vector<Point>& points, Get get, double floor) {
+    for (size_t i = 0; i + 1 < points.size(); i++) {
+        double first = get(points[i]);
+        double last = get(points.back());
+        if (first >= floor && last >= floor) {
+            return std::log(last / first) / std::log(points.back().units / points[i].units);
+        }
+    }
+    return std::nan("");
+}
+
+// Prints the fitted exponents; false if any is super-linear
+bool report(const std::vector<Point>& points) {
+    struct Fit {
+        const char* what;
+        double value;
+    };
+    const Fit fits[] = {
+        {"parse time", exponent(points, [](const Point& p) { return p.parse.ms; }, MIN_MS)},
+        {"parse memory", exponent(points, [](const Point& p) { return p.parse.peak_mib; }, MIN_MIB)},
+        {"instantiate time", exponent(points, [](const Point& p) { return p.instantiate.ms; }, MIN_MS)},
+        {"instantiate memory", exponent(points, [](const Point& p) { return p.instantiate.peak_mib; }, MIN_MIB)},
+    };
+    bool linear = true;
+    std::cout << "scaling exponents:";
+    for (const Fit& fit : fits) {
+        std::cout << (&fit == fits ? " " : ", ") << fit.what << " ";
+        if (std::isnan(fit.value)) {
+            std::cout << "n/a";
+        } else {
+            std::cout << std::setprecision(2) << fit.value;
+        }
+        if (fit.value > SUPER_LINEAR) {
+            std::cout << " (SUPER-LINEAR)";
+            linear = false;
+        }
+    }
+    std::cout << "\n\n";
+    return linear;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    uint32_t max_functions = 100000;
+    uint64_t max_data_mib = 1024;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--max-functions") {
+            max_functions = static_cast<uint32_t>(std::atol(argv[i + 1]));
+        } else if (arg == "--max-data") {
+            max_data_mib = static_cast<uint64_t>(std::atol(argv[i + 1]));
+        }
+    }
+
+    std::cout << "=== Startup Scaling Benchmark ===\n\n";
+    bool linear = true;
+
+    std::cout << "Functions (4-64 statements each, 10% exported, 100 imports, 1000-entry table, 1 MiB data)\n";
+    printHeader("functions");
+    std::vector<Point> points;
+    for (uint32_t functions = 1000; functions <= max_functions; functions *= 10) {
+        for (uint32_t step : {1u, 3u}) {
+            if (functions * step > max_functions) {
+                break;
+            }
+            ModuleShape shape;
+            shape.functions = functions * step;
+            shape.exports = shape.functions / 10;
+            shape.imports = 100;
+            shape.table_size = 1000;
+            shape.data_bytes = 1 << 20;
+            points.push_back(run(shape, shape.functions));
+            printPoint(points.back());
+        }
+    }
+    linear = report(points) && linear;
+
+    std::cout << "Data (100 functions, 1 MiB segments)\n";
+    printHeader("data MiB");
+    points.clear();
+    for (uint64_t mib = 1; mib <= max_data_mib; mib *= 4) {
+        ModuleShape shape;
+        shape.functions = 100;
+        shape.data_bytes = mib << 20;
+        points.push_back(run(shape, static_cast<double>(mib)));
+        printPoint(points.back());
+    }
+    linear = report(points) && linear;
+
+    std::cout << (linear ? "Startup scales linearly" : "Super-linear startup scaling") << "\n";
+    return linear ? 0 : 1;
+}
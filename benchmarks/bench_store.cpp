@@ -0,0 +1,96 @@
+#include "../include/decoder.h"
+#include "../include/store.h"
+#include "wasm_builder.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+/**
+ * Cross-instance call benchmark.
+ * Compares a guest call to a function of the same instance with a call to
+ * the same function imported from another instance in a Store. Both
+ * loops run the same instructions; the difference is the cost of linking.
+ *
+ * Usage: ./bench_store [iterations]
+ */
+
+namespace {
+
+using B = WasmBuilder;
+using Clock = std::chrono::steady_clock;
+
+// Calls callee(counter, counter) $n times, keeping its result in local 1 as the counter
+WasmBuilder::Bytes counted(uint32_t callee) {
+    Code body;
+    body.block().loop()
+            .localGet(1).localGet(0).op(0x4E /* i32.ge_s */).brIf(1)
+            .localGet(1).localGet(1).call(callee).localSet(1)
+            .br(0)
+        .end().end()
+        .localGet(1);
+    return body.bytes();
+}
+
+// (func $step (export "step") (param i32 i32) (result i32)  ;; a + 1
+WasmBuilder::Bytes buildLib() {
+    WasmBuilder builder;
+    uint32_t ft_step = builder.addType({B::I32, B::I32}, {B::I32});
+    uint32_t ft_loop = builder.addType({B::I32}, {B::I32});
+    Code step;
+    step.localGet(0).i32Const(1).op(0x6A /* i32.add */);
+    uint32_t local = builder.addFunction(ft_step, {}, step.bytes(), "step");
+    builder.addFunction(ft_loop, {{1, B::I32}}, counted(local), "local");
+    return builder.build();
+}
+
+// (import "lib" "step") and a loop calling it
+WasmBuilder::Bytes buildApp() {
+    WasmBuilder builder;
+    uint32_t ft_step = builder.addType({B::I32, B::I32}, {B::I32});
+    uint32_t ft_loop = builder.addType({B::I32}, {B::I32});
+    uint32_t imported = builder.importFunction("lib", "step", ft_step);
+    builder.addFunction(ft_loop, {{1, B::I32}}, counted(imported), "linked");
+    return builder.build();
+}
+
+double run(wasm::Interpreter& instance, const std::string& name, int32_t iterations) {
+    auto start = Clock::now();
+    int32_t done = instance.call(name, {wasm::TypedValue::makeI32(iterations)})[0].value.i32;
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    if (done != iterations) {
+        std::cerr << name << ": ran " << done << " of " << iterations << " iterations\n";
+        std::exit(1);
+    }
+    return ns / iterations;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    int32_t iterations = argc > 1 ? std::atoi(argv[1]) : 1000000;
+
+    std::cout << "=== Cross-Instance Call Benchmark ===\n";
+    std::cout << iterations << " iterations each\n\n";
+
+    wasm::Decoder decoder;
+    wasm::Store store;
+    wasm::Interpreter& lib = store.instantiate("lib", decoder.parseBytes(buildLib()));
+    wasm::Interpreter& app = store.instantiate("app", decoder.parseBytes(buildApp()));
+
+    run(lib, "local", 1000);
+    run(app, "linked", 1000);
+
+    double local = run(lib, "local", iterations);
+    double linked = run(app, "linked", iterations);
+
+    std::cout << std::left << std::setw(34) << "call" << std::right << std::setw(10) << "ns/op"
+              << std::setw(12) << "x local" << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(34) << "same instance" << std::right << std::setw(10) << local
+              << std::setw(12) << 1.0 << "\n";
+    std::cout << std::left << std::setw(34) << "imported from another instance" << std::right << std::setw(10)
+              << linked << std::setw(12) << linked / local << "\n";
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include "../include/alloc_counter.h"
+#include "../include/aot.h"
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "../include/perf_counters.h"
+#include "../include/tier_up.h"
+#include "kernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+/**
+ * Execution tier benchmark.
+ * Runs arithmetic, memory and call-heavy kernels in the interpreter, the
+ * baseline AOT translation, the optimizing tier (ahead of time and via
+ * background tier-up) and as native C++, and reports each tier relative
+ * to native. Finally it reports the host heap allocations of one warm
+ * call per kernel and tier, and hardware counters per interpreted call.
+ *
+ * Usage: ./bench_tiers [scale]
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// ===== Native reference versions =====
+
+__attribute__((noinline)) uint32_t nativeArithI32(uint32_t n) {
+    uint32_t x = 12345, acc = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        x = x * 1103515245u + 12345u;
+        acc ^= x >> 16;
+    }
+    return acc;
+}
+
+__attribute__((noinline)) double nativeArithF64(uint32_t n) {
+    double acc = 0.0;
+    for (uint32_t i = 0; i < n; i++) {
+        double x = static_cast<double>(i) * 0.001;
+        acc += ((x * 1.5 + 2.0) * x - 3.0) * x;
+    }
+    return acc;
+}
+
+std::vector<uint32_t> native_memory(16 * 65536 / 4);
+
+__attribute__((noinline)) uint32_t nativeMemSum(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        native_memory[i] = i * 3;
+    }
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        acc += native_memory[i];
+    }
+    return acc;
+}
+
+__attribute__((noinline)) uint32_t nativeFib(int32_t n) {
+    return n < 2 ? static_cast<uint32_t>(n) : nativeFib(n - 1) + nativeFib(n - 2);
+}
+
+// ===== Harness =====
+
+struct Kernel {
+    std::string name;
+    uint32_t argument;
+    std::function<void()> native;
+};
+
+double bestMillis(const std::function<void()>& body, int repetitions) {
+    double best = 1e30;
+    for (int r = 0; r < repetitions; r++) {
+        auto start = Clock::now();
+        body();
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        best = ms < best ? ms : best;
+    }
+    return best;
+}
+
+void report(const std::string& kernel, const std::string& tier, double ms, double native_ms) {
+    std::cout << "  " << std::left << std::setw(10) << kernel << std::setw(20) << tier
+              << std::right << std::setw(10) << std::fixed << std::setprecision(2) << ms << " ms"
+              << std::setw(10) << std::setprecision(1) << (native_ms > 0 ? ms / native_ms : 0) << "x\n";
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    uint32_t scale = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 1;
+    if (scale == 0) {
+        scale = 1;
+    }
+
+    WasmBuilder::Bytes bytes = buildKernels();
+    volatile uint32_t sink = 0;
+    volatile double fsink = 0;
+
+    std::vector<Kernel> kernels = {
+        {"arith_i32", 1000000 * scale, [&] { sink = nativeArithI32(1000000 * scale); }},
+        {"arith_f64", 1000000 * scale, [&] { fsink = nativeArithF64(1000000 * scale); }},
+        {"mem_sum", 200000, [&] { sink = nativeMemSum(200000); }},
+        {"fib", 20 + scale, [&] { sink = nativeFib(static_cast<int32_t>(20 + scale)); }},
+    };
+
+    // Interpreter, compiled tiers and tier-up all run the same module
+    std::string baseline_so = "/tmp/bench_tiers_baseline_" + std::to_string(getpid()) + ".so";
+    std::string optimized_so = "/tmp/bench_tiers_optimized_" + std::to_string(getpid()) + ".so";
+    wasm::Decoder decoder;
+    {
+        wasm::Module module = decoder.parseBytes(bytes);
+        wasm::AotCompiler().compile(module, baseline_so);
+        wasm::AotOptions options;
+        options.optimize = true;
+        wasm::AotCompiler(options).compile(module, optimized_so);
+    }
+
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(decoder.parseBytes(bytes));
+    wasm::Interpreter baseline;
+    baseline.instantiate(decoder.parseBytes(bytes));
+    baseline.loadNative(baseline_so);
+    wasm::Interpreter optimized;
+    optimized.instantiate(decoder.parseBytes(bytes));
+    optimized.loadNative(optimized_so);
+    wasm::Interpreter tiered;
+    tiered.instantiate(decoder.parseBytes(bytes));
+    wasm::TierUpOptions tier_options;
+    tier_options.hot_threshold = 2;
+    tiered.enableTierUp(tier_options);
+
+    std::cout << "=== Execution Tier Benchmark ===\n\n";
+    std::cout << "  " << std::left << std::setw(10) << "kernel" << std::setw(20) << "tier"
+              << std::right << std::setw(13) << "best" << std::setw(11) << "vs native" << "\n";
+
+    for (const auto& kernel : kernels) {
+        std::vector<wasm::TypedValue> args = {wasm::TypedValue::makeI32(static_cast<int32_t>(kernel.argument))};
+        double native_ms = bestMillis(kernel.native, 5);
+
+        // Warm up tier-up: the second call marks the kernel hot
+        tiered.call(kernel.name, args);
+        tiered.call(kernel.name, args);
+        tiered.waitForTierUp();
+
+        report(kernel.name, "native C++", native_ms, native_ms);
+        report(kernel.name, "interpreter",
+               bestMillis([&] { interpreter.call(kernel.name, args); }, 1), native_ms);
+        report(kernel.name, "aot baseline",
+               bestMillis([&] { baseline.call(kernel.name, args); }, 5), native_ms);
+        report(kernel.name, "aot optimized",
+               bestMillis([&] { optimized.call(kernel.name, args); }, 5), native_ms);
+        report(kernel.name, "tier-up (hot)",
+               bestMillis([&] { tiered.call(kernel.name, args); }, 5), native_ms);
+        std::cout << "\n";
+    }
+
+    std::cout << "Host allocations per warm call:\n";
+    std::vector<wasm::TypedValue> results;
+    for (const auto& kernel : kernels) {
+        uint32_t argument = std::min<uint32_t>(kernel.argument, 1000);
+        std::vector<wasm::TypedValue> args = {wasm::TypedValue::makeI32(static_cast<int32_t>(argument))};
+        std::cout << "  " << std::left << std::setw(10) << kernel.name;
+        for (wasm::Interpreter* tier : {&interpreter, &baseline, &tiered}) {
+            tier->call(kernel.name, args, results);
+            wasm::AllocationScope scope;
+            tier->call(kernel.name, args, results);
+            std::cout << std::setw(8) << scope.stats().count;
+        }
+        std::cout << "(interpreter, aot baseline, tier-up)\n";
+    }
+
+    // Hardware counters show what the dispatch loop costs per call
+    std::cout << "\nInterpreter counters per call:\n";
+    auto counters = std::make_shared<wasm::CounterProfile>();
+    interpreter.setCounterProfile(counters);
+    if (!counters->counters().available()) {
+        std::cout << "  unavailable (" << counters->counters().error() << ")\n";
+    } else {
+        for (const auto& kernel : kernels) {
+            uint32_t argument = std::min<uint32_t>(kernel.argument, 100000);
+            interpreter.call(kernel.name, {wasm::TypedValue::makeI32(static_cast<int32_t>(argument))}, results);
+            const wasm::CounterValues& values = counters->lastCall();
+            std::cout << "  " << std::left << std::setw(10) << kernel.name << std::right;
+            for (size_t i = 0; i < wasm::COUNTER_COUNT; i++) {
+                wasm::Counter counter = static_cast<wasm::Counter>(i);
+                if (counters->counters().available(counter)) {
+                    std::cout << "  " << wasm::counterName(counter) << "=" << values[counter];
+                }
+            }
+            std::cout << "\n";
+        }
+    }
+    interpreter.setCounterProfile(nullptr);
+
+    std::remove(baseline_so.c_str());
+    std::remove(optimized_so.c_str());
+    (void)sink;
+    (void)fsink;
+    return 0;
+}
@@ -0,0 +1,82 @@
+#ifndef WASM_BENCH_KERNELS_H
+#define WASM_BENCH_KERNELS_H
+
+#include "wasm_builder.h"
+
+/**
+ * Benchmark kernels, exported by name and all taking an i32 size:
+ *   arith_i32(n)  LCG mixed into an accumulator
+ *   arith_f64(n)  polynomial evaluated at n points
+ *   mem_sum(n)    write n words, then sum them (16 pages of memory)
+ *   fib(n)        recursive calls
+ * Shared by the tier benchmark and the allocation regression test.
+ */
+inline WasmBuilder::Bytes buildKernels() {
+    using B = WasmBuilder;
+    WasmBuilder builder;
+    uint32_t i32_to_i32 = builder.addType({B::I32}, {B::I32});
+    uint32_t i32_to_f64 = builder.addType({B::I32}, {B::F64});
+
+    // arith_i32(n): LCG mixed into an accumulator
+    Code arith;
+    arith.i32Const(12345).localSet(2)
+         .block().loop()
+             .localGet(1).localGet(0).op(0x4F /* i32.ge_u */).brIf(1)
+             .localGet(2).i32Const(1103515245).op(0x6C /* i32.mul */).i32Const(12345).op(0x6A /* i32.add */)
+             .localTee(2).i32Const(16).op(0x76 /* i32.shr_u */).localGet(3).op(0x73 /* i32.xor */).localSet(3)
+             .localGet(1).i32Const(1).op(0x6A).localSet(1)
+             .br(0)
+         .end().end()
+         .localGet(3);
+    builder.addFunction(i32_to_i32, {{3, B::I32}}, arith.bytes(), "arith_i32");
+
+    // arith_f64(n): polynomial evaluated at n points
+    Code poly;
+    poly.block().loop()
+            .localGet(1).localGet(0).op(0x4F).brIf(1)
+            .localGet(1).op(0xB8 /* f64.convert_i32_u */).f64Const(0.001).op(0xA2 /* f64.mul */).localSet(2)
+            .localGet(2).f64Const(1.5).op(0xA2).f64Const(2.0).op(0xA0 /* f64.add */)
+            .localGet(2).op(0xA2).f64Const(3.0).op(0xA1 /* f64.sub */)
+            .localGet(2).op(0xA2).localGet(3).op(0xA0).localSet(3)
+            .localGet(1).i32Const(1).op(0x6A).localSet(1)
+            .br(0)
+        .end().end()
+        .localGet(3);
+    builder.addFunction(i32_to_f64, {{1, B::I32}, {2, B::F64}}, poly.bytes(), "arith_f64");
+
+    // mem_sum(n): write n words, then sum them
+    Code mem;
+    mem.block().loop()
+           .localGet(1).localGet(0).op(0x4F).brIf(1)
+           .localGet(1).i32Const(2).op(0x74 /* i32.shl */)
+           .localGet(1).i32Const(3).op(0x6C).store(0x36 /* i32.store */)
+           .localGet(1).i32Const(1).op(0x6A).localSet(1)
+           .br(0)
+       .end().end()
+       .i32Const(0).localSet(1)
+       .block().loop()
+           .localGet(1).localGet(0).op(0x4F).brIf(1)
+           .localGet(2).localGet(1).i32Const(2).op(0x74).load(0x28 /* i32.load */).op(0x6A).localSet(2)
+           .localGet(1).i32Const(1).op(0x6A).localSet(1)
+           .br(0)
+       .end().end()
+       .localGet(2);
+    builder.addFunction(i32_to_i32, {{2, B::I32}}, mem.bytes(), "mem_sum");
+
+    // fib(n): recursive calls
+    Code fib;
+    fib.localGet(0).i32Const(2).op(0x48 /* i32.lt_s */)
+       .ifBlock(B::I32)
+           .localGet(0)
+       .elseBlock()
+           .localGet(0).i32Const(1).op(0x6B /* i32.sub */).call(3)
+           .localGet(0).i32Const(2).op(0x6B).call(3)
+           .op(0x6A)
+       .end();
+    builder.addFunction(i32_to_i32, {}, fib.bytes(), "fib");
+
+    builder.setMemory(16);
+    return builder.build();
+}
+
+#endif // WASM_BENCH_KERNELS_H
@@ -0,0 +1,161 @@
+#ifndef WASM_BENCH_MODULE_GENERATOR_H
+#define WASM_BENCH_MODULE_GENERATOR_H
+
+#include "wasm_builder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Shape of a synthetic module. Every function has type (i32) -> i32, two
+ * extra i32 locals, and a body of straight-line statements mixing
+ * arithmetic, loads, stores, calls and ifs. So every generated module
+ * validates and can be instantiated. Imports are functions of the same
+ * type from "env". Instantiation leaves them unresolved until called.
+ */
+struct ModuleShape {
+    uint32_t functions = 1000;
+    uint32_t min_statements = 4;    // Body sizes are log-uniform between these
+    uint32_t max_statements = 64;
+    uint32_t imports = 0;
+    uint32_t exports = 0;           // Spread evenly over the functions
+    uint64_t data_bytes = 0;        // Split into active segments of 1 MiB
+    uint32_t table_size = 0;        // Filled with the functions, cycling
+    uint32_t seed = 1;
+};
+
+namespace module_generator {
+
+constexpr uint32_t SEGMENT_SIZE = 1 << 20;
+constexpr uint32_t PAGE_SIZE = 65536;
+
+// Five statement kinds over locals 0-2; each leaves the stack empty
+inline void addStatement(Code& body, std::mt19937& rng, uint32_t callable) {
+    uint32_t a = rng() % 3;
+    uint32_t b = rng() % 3;
+    switch (rng() % 5) {
+        case 0:
+            body.localGet(a).i32Const(static_cast<int32_t>(rng() % 100000)).op(0x6A /* i32.add */).localSet(b);
+            break;
+        case 1:
+            body.localGet(a).load(0x28 /* i32.load */, rng() % 4096).localSet(b);
+            break;
+        case 2:
+            body.localGet(a).localGet(b).store(0x36 /* i32.store */, rng() % 4096);
+            break;
+        case 3:
+            body.localGet(a).call(rng() % callable).localSet(b);
+            break;
+        default:
+            body.localGet(a).ifBlock()
+                .localGet(b).i32Const(1).op(0x6B /* i32.sub */).localSet(b)
+                .end();
+            break;
+    }
+}
+
+/**
+ * Everything but the data section, which is streamed by writeModule so
+ * that a 1 GB module is never held in memory twice.
+ */
+inline WasmBuilder::Bytes buildCode(const ModuleShape& shape) {
+    WasmBuilder builder;
+    std::mt19937 rng(shape.seed);
+    uint32_t type = builder.addType({WasmBuilder::I32}, {WasmBuilder::I32});
+    for (uint32_t i = 0; i < shape.imports; i++) {
+        builder.importFunction("env", "i" + std::to_string(i), type);
+    }
+    uint64_t pages = (shape.data_bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+    builder.setMemory(static_cast<uint32_t>(std::max<uint64_t>(pages, 1)));
+    if (shape.table_size > 0) {
+        builder.setTable(shape.table_size);
+    }
+
+    std::vector<uint8_t> exported(shape.functions, 0);
+    uint32_t exports = std::min(shape.exports, shape.functions);
+    for (uint32_t i = 0; i < exports; i++) {
+        exported[static_cast<uint64_t>(i) * shape.functions / exports] = 1;
+    }
+
+    double low = std::log(std::max(shape.min_statements, 1u));
+    double high = std::log(std::max(shape.max_statements, shape.min_statements) + 1.0);
+    std::uniform_real_distribution<double> size(low, high);
+    uint32_t callable = std::max(shape.imports + shape.functions, 1u);
+    for (uint32_t f = 0; f < shape.functions; f++) {
+        Code body;
+        auto statements = static_cast<uint32_t>(std::exp(size(rng)));
+        for (uint32_t s = 0; s < statements; s++) {
+            addStatement(body, rng, callable);
+        }
+        body.localGet(1);
+        uint32_t index = shape.imports + f;
+        builder.addFunction(type, {{2, WasmBuilder::I32}}, body.bytes(),
+                            exported[f] ? "f" + std::to_string(index) : "");
+    }
+
+    if (shape.table_size > 0 && shape.functions > 0) {
+        std::vector<uint32_t> elements(shape.table_size);
+        for (uint32_t i = 0; i < shape.table_size; i++) {
+            elements[i] = shape.imports + i % shape.functions;
+        }
+        builder.addElements(0, std::move(elements));
+    }
+    return builder.build();
+}
+
+} // namespace module_generator
+
+/**
+ * Write a module of the given shape. Data segments are filled with
+ * pseudo-random bytes and written one at a time.
+ * @return Bytes written
+ */
+inline uint64_t writeModule(const ModuleShape& shape, std::ostream& out) {
+    using module_generator::SEGMENT_SIZE;
+    WasmBuilder::Bytes code = module_generator::buildCode(shape);
+    out.write(reinterpret_cast<const char*>(code.data()), static_cast<std::streamsize>(code.size()));
+    uint64_t written = code.size();
+    if (shape.data_bytes == 0) {
+        return written;
+    }
+
+    // Segment headers first, so the section size is known before the bytes
+    std::vector<WasmBuilder::Bytes> headers;
+    uint64_t section_size = 0;
+    for (uint64_t offset = 0; offset < shape.data_bytes; offset += SEGMENT_SIZE) {
+        auto length = static_cast<uint32_t>(std::min<uint64_t>(SEGMENT_SIZE, shape.data_bytes - offset));
+        WasmBuilder::Bytes header{0x00, 0x41};   // Memory 0, i32.const offset
+        WasmBuilder::writeS64(header, static_cast<int32_t>(offset));
+        header.push_back(0x0B);
+        WasmBuilder::writeU32(header, length);
+        section_size += header.size() + length;
+        headers.push_back(std::move(header));
+    }
+    WasmBuilder::Bytes prefix{11};
+    WasmBuilder::Bytes count;
+    WasmBuilder::writeU32(count, static_cast<uint32_t>(headers.size()));
+    WasmBuilder::writeU32(prefix, static_cast<uint32_t>(section_size + count.size()));
+    prefix.insert(prefix.end(), count.begin(), count.end());
+    out.write(reinterpret_cast<const char*>(prefix.data()), static_cast<std::streamsize>(prefix.size()));
+    written += prefix.size();
+
+    std::mt19937 rng(shape.seed);
+    std::vector<uint8_t> segment(SEGMENT_SIZE);
+    std::generate(segment.begin(), segment.end(), [&] { return static_cast<uint8_t>(rng()); });
+    uint64_t remaining = shape.data_bytes;
+    for (const auto& header : headers) {
+        auto length = static_cast<uint32_t>(std::min<uint64_t>(SEGMENT_SIZE, remaining));
+        out.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+        out.write(reinterpret_cast<const char*>(segment.data()), length);
+        written += header.size() + length;
+        remaining -= length;
+        segment[remaining % SEGMENT_SIZE] ^= 0x5A;  // Segments differ
+    }
+    return written;
+}
+
+#endif // WASM_BENCH_MODULE_GENERATOR_H
@@ -0,0 +1,411 @@
+#ifndef WASM_BENCH_BUILDER_H
+#define WASM_BENCH_BUILDER_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Minimal WebAssembly binary writer for benchmark kernels and tests.
+ * Supports imports, one memory and one table, function, struct, array and
+ * continuation types, tags, integer globals, functions with locals,
+ * exports, element and data segments and custom sections, which is all
+ * the kernels and tests need. Imports must be added before the
+ * functions and globals they precede in the index spaces. Bodies are
+ * written with the opcode helpers below.
+ */
+class WasmBuilder {
+public:
+    using Bytes = std::vector<uint8_t>;
+
+    static constexpr uint8_t I32 = 0x7F;
+    static constexpr uint8_t I64 = 0x7E;
+    static constexpr uint8_t F32 = 0x7D;
+    static constexpr uint8_t F64 = 0x7C;
+    static constexpr uint8_t VOID = 0x40;
+    static constexpr uint8_t ANYREF = 0x6E;     // Nullable reference to any GC value
+    static constexpr uint8_t FUNCREF = 0x70;
+    static constexpr uint8_t CONTREF = 0x68;    // Nullable reference to any continuation
+    static constexpr uint8_t I8 = 0x78;         // Packed field storage types
+    static constexpr uint8_t I16 = 0x77;
+
+    // External kinds of imports and exports
+    static constexpr uint8_t EXTERN_FUNC = 0x00;
+    static constexpr uint8_t EXTERN_TABLE = 0x01;
+    static constexpr uint8_t EXTERN_MEMORY = 0x02;
+    static constexpr uint8_t EXTERN_GLOBAL = 0x03;
+
+    uint32_t addType(const std::vector<uint8_t>& params, const std::vector<uint8_t>& results) {
+        Bytes type{0x60};
+        appendVector(type, params);
+        appendVector(type, results);
+        types_.push_back(type);
+        return static_cast<uint32_t>(types_.size() - 1);
+    }
+
+    /**
+     * Add a GC struct type. fields are (storage type, mutable) pairs.
+     * A supertype makes it a subtype of that struct type.
+     * @return Type index
+     */
+    uint32_t addStruct(const std::vector<std::pair<uint8_t, bool>>& fields, int64_t supertype = -1) {
+        Bytes type;
+        if (supertype >= 0) {
+            type.push_back(0x50);   // sub, with one supertype
+            type.push_back(0x01);
+            writeU32(type, static_cast<uint32_t>(supertype));
+        }
+        type.push_back(0x5F);
+        writeU32(type, static_cast<uint32_t>(fields.size()));
+        for (const auto& field : fields) {
+            type.push_back(field.first);
+            type.push_back(field.second ? 0x01 : 0x00);
+        }
+        types_.push_back(type);
+        return static_cast<uint32_t>(types_.size() - 1);
+    }
+
+    // GC array type of one storage type
+    uint32_t addArray(uint8_t element, bool is_mutable) {
+        types_.push_back({0x5E, element, static_cast<uint8_t>(is_mutable ? 0x01 : 0x00)});
+        return static_cast<uint32_t>(types_.size() - 1);
+    }
+
+    // Continuation type over a function type (stack switching)
+    uint32_t addCont(uint32_t func_type) {
+        Bytes type{0x5D};
+        writeU32(type, func_type);
+        types_.push_back(type);
+        return static_cast<uint32_t>(types_.size() - 1);
+    }
+
+    // Tag whose parameters a suspend passes out and whose results it gets back
+    uint32_t addTag(uint32_t func_type) {
+        tags_.push_back(func_type);
+        return static_cast<uint32_t>(tags_.size() - 1);
+    }
+
+    // @return Function index of the import
+    uint32_t importFunction(const std::string& module, const std::string& field, uint32_t type_index) {
+        Bytes desc{EXTERN_FUNC};
+        writeU32(desc, type_index);
+        addImport(module, field, desc);
+        return imported_functions_++;
+    }
+
+    void importMemory(const std::string& module, const std::string& field, uint32_t min_pages) {
+        Bytes desc{EXTERN_MEMORY, 0x00};
+        writeU32(desc, min_pages);
+        addImport(module, field, desc);
+    }
+
+    void importTable(const std::string& module, const std::string& field, uint32_t min_elements) {
+        Bytes desc{EXTERN_TABLE, FUNCREF, 0x00};
+        writeU32(desc, min_elements);
+        addImport(module, field, desc);
+    }
+
+    // @return Global index of the import
+    uint32_t importGlobal(const std::string& module, const std::string& field, uint8_t type, bool is_mutable = false) {
+        addImport(module, field, {EXTERN_GLOBAL, type, static_cast<uint8_t>(is_mutable ? 0x01 : 0x00)});
+        return imported_globals_++;
+    }
+
+    /**
+     * Add a function. locals are (count, type) runs after the parameters.
+     * @return Function index
+     */
+    uint32_t addFunction(uint32_t type_index, const std::vector<std::pair<uint32_t, uint8_t>>& locals,
+                         const Bytes& body, const std::string& export_name = "") {
+        Bytes code;
+        writeU32(code, static_cast<uint32_t>(locals.size()));
+        for (const auto& run : locals) {
+            writeU32(code, run.first);
+            code.push_back(run.second);
+        }
+        code.insert(code.end(), body.begin(), body.end());
+        code.push_back(0x0B);
+
+        function_types_.push_back(type_index);
+        bodies_.push_back(code);
+        uint32_t index = imported_functions_ + static_cast<uint32_t>(bodies_.size() - 1);
+        if (!export_name.empty()) {
+            addExport(export_name, EXTERN_FUNC, index);
+        }
+        return index;
+    }
+
+    void addExport(const std::string& name, uint8_t kind, uint32_t index) { exports_.push_back({name, kind, index}); }
+
+    void setMemory(uint32_t min_pages) { memory_pages_ = static_cast<int32_t>(min_pages); }
+    void setTable(uint32_t min_elements) { table_elements_ = static_cast<int32_t>(min_elements); }
+
+    /**
+     * Add an i32 or i64 global initialized to a constant.
+     * @return Global index
+     */
+    uint32_t addGlobal(uint8_t type, bool is_mutable, int64_t init) {
+        Bytes global{type, static_cast<uint8_t>(is_mutable ? 0x01 : 0x00), static_cast<uint8_t>(type == I64 ? 0x42 : 0x41)};
+        writeS64(global, init);
+        global.push_back(0x0B);
+        globals_.push_back(global);
+        return imported_globals_ + static_cast<uint32_t>(globals_.size() - 1);
+    }
+
+    // Active element segment at a constant offset in table 0
+    void addElements(uint32_t offset, std::vector<uint32_t> functions) { elements_.push_back({offset, std::move(functions)}); }
+
+    // Active data segment at a constant offset in memory 0
+    void addData(uint32_t offset, Bytes bytes) { data_.push_back({offset, std::move(bytes)}); }
+
+    // Custom section, written after all the others
+    void addCustomSection(const std::string& name, Bytes payload) { custom_.push_back({name, std::move(payload)}); }
+
+    Bytes build() const {
+        Bytes module{0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00};
+
+        Bytes types;
+        writeU32(types, static_cast<uint32_t>(types_.size()));
+        for (const auto& type : types_) {
+            types.insert(types.end(), type.begin(), type.end());
+        }
+        appendSection(module, 1, types);
+
+        if (!imports_.empty()) {
+            Bytes imports;
+            writeU32(imports, static_cast<uint32_t>(imports_.size()));
+            for (const auto& import : imports_) {
+                imports.insert(imports.end(), import.begin(), import.end());
+            }
+            appendSection(module, 2, imports);
+        }
+
+        Bytes functions;
+        writeU32(functions, static_cast<uint32_t>(function_types_.size()));
+        for (uint32_t type : function_types_) {
+            writeU32(functions, type);
+        }
+        appendSection(module, 3, functions);
+
+        if (table_elements_ >= 0) {
+            Bytes table{0x01, FUNCREF, 0x00};
+            writeU32(table, static_cast<uint32_t>(table_elements_));
+            appendSection(module, 4, table);
+        }
+
+        if (memory_pages_ >= 0) {
+            Bytes memory{0x01, 0x00};
+            writeU32(memory, static_cast<uint32_t>(memory_pages_));
+            appendSection(module, 5, memory);
+        }
+
+        if (!tags_.empty()) {
+            Bytes tags;
+            writeU32(tags, static_cast<uint32_t>(tags_.size()));
+            for (uint32_t type : tags_) {
+                tags.push_back(0x00);   // Exception attribute
+                writeU32(tags, type);
+            }
+            appendSection(module, 13, tags);
+        }
+
+        if (!globals_.empty()) {
+            Bytes globals;
+            writeU32(globals, static_cast<uint32_t>(globals_.size()));
+            for (const auto& global : globals_) {
+                globals.insert(globals.end(), global.begin(), global.end());
+            }
+            appendSection(module, 6, globals);
+        }
+
+        Bytes exports;
+        writeU32(exports, static_cast<uint32_t>(exports_.size()));
+        for (const auto& exp : exports_) {
+            writeU32(exports, static_cast<uint32_t>(exp.name.size()));
+            exports.insert(exports.end(), exp.name.begin(), exp.name.end());
+            exports.push_back(exp.kind);
+            writeU32(exports, exp.index);
+        }
+        appendSection(module, 7, exports);
+
+        if (!elements_.empty()) {
+            Bytes elements;
+            writeU32(elements, static_cast<uint32_t>(elements_.size()));
+            for (const auto& segment : elements_) {
+                elements.push_back(0x00);
+                elements.push_back(0x41);   // i32.const
+                writeS64(elements, static_cast<int32_t>(segment.first));
+                elements.push_back(0x0B);
+                writeU32(elements, static_cast<uint32_t>(segment.second.size()));
+                for (uint32_t function : segment.second) {
+                    writeU32(elements, function);
+                }
+            }
+            appendSection(module, 9, elements);
+        }
+
+        Bytes code;
+        writeU32(code, static_cast<uint32_t>(bodies_.size()));
+        for (const auto& body : bodies_) {
+            writeU32(code, static_cast<uint32_t>(body.size()));
+            code.insert(code.end(), body.begin(), body.end());
+        }
+        appendSection(module, 10, code);
+
+        if (!data_.empty()) {
+            Bytes data;
+            writeU32(data, static_cast<uint32_t>(data_.size()));
+            for (const auto& segment : data_) {
+                data.push_back(0x00);
+                data.push_back(0x41);   // i32.const
+                writeS64(data, static_cast<int32_t>(segment.first));
+                data.push_back(0x0B);
+                appendVector(data, segment.second);
+            }
+            appendSection(module, 11, data);
+        }
+
+        for (const auto& custom : custom_) {
+            Bytes section;
+            appendVector(section, Bytes(custom.first.begin(), custom.first.end()));
+            section.insert(section.end(), custom.second.begin(), custom.second.end());
+            appendSection(module, 0, section);
+        }
+        return module;
+    }
+
+    // ===== Encoding helpers =====
+
+    static void writeU32(Bytes& out, uint32_t value) {
+        do {
+            uint8_t byte = value & 0x7F;
+            value >>= 7;
+            out.push_back(value ? (byte | 0x80) : byte);
+        } while (value);
+    }
+
+    static void writeS64(Bytes& out, int64_t value) {
+        while (true) {
+            uint8_t byte = value & 0x7F;
+            value >>= 7;
+            bool done = (value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40));
+            out.push_back(done ? byte : (byte | 0x80));
+            if (done) {
+                return;
+            }
+        }
+    }
+
+private:
+    struct Export {
+        std::string name;
+        uint8_t kind;
+        uint32_t index;
+    };
+
+    std::vector<Bytes> types_;
+    std::vector<Bytes> imports_;
+    uint32_t imported_functions_ = 0;
+    uint32_t imported_globals_ = 0;
+    std::vector<uint32_t> function_types_;
+    std::vector<Bytes> bodies_;
+    std::vector<Export> exports_;
+    int32_t memory_pages_ = -1;
+    int32_t table_elements_ = -1;
+    std::vector<Bytes> globals_;
+    std::vector<std::pair<uint32_t, std::vector<uint32_t>>> elements_;
+    std::vector<std::pair<uint32_t, Bytes>> data_;
+    std::vector<uint32_t> tags_;
+    std::vector<std::pair<std::string, Bytes>> custom_;
+
+    void addImport(const std::string& module, const std::string& field, const Bytes& desc) {
+        Bytes import;
+        writeU32(import, static_cast<uint32_t>(module.size()));
+        import.insert(import.end(), module.begin(), module.end());
+        writeU32(import, static_cast<uint32_t>(field.size()));
+        import.insert(import.end(), field.begin(), field.end());
+        import.insert(import.end(), desc.begin(), desc.end());
+        imports_.push_back(import);
+    }
+
+    static void appendVector(Bytes& out, const std::vector<uint8_t>& items) {
+        writeU32(out, static_cast<uint32_t>(items.size()));
+        out.insert(out.end(), items.begin(), items.end());
+    }
+
+    static void appendSection(Bytes& out, uint8_t id, const Bytes& payload) {
+        out.push_back(id);
+        writeU32(out, static_cast<uint32_t>(payload.size()));
+        out.insert(out.end(), payload.begin(), payload.end());
+    }
+};
+
+/**
+ * Instruction stream helper: Code() << op(...) << op(...)
+ */
+class Code {
+public:
+    Code& op(uint8_t opcode) { bytes_.push_back(opcode); return *this; }
+    Code& u32(uint32_t value) { WasmBuilder::writeU32(bytes_, value); return *this; }
+
+    Code& i32Const(int32_t value) { op(0x41); WasmBuilder::writeS64(bytes_, value); return *this; }
+    Code& i64Const(int64_t value) { op(0x42); WasmBuilder::writeS64(bytes_, value); return *this; }
+    Code& f64Const(double value) {
+        op(0x44);
+        uint8_t raw[8];
+        std::memcpy(raw, &value, 8);
+        bytes_.insert(bytes_.end(), raw, raw + 8);
+        return *this;
+    }
+
+    Code& localGet(uint32_t index) { return op(0x20).u32(index); }
+    Code& localSet(uint32_t index) { return op(0x21).u32(index); }
+    Code& localTee(uint32_t index) { return op(0x22).u32(index); }
+    Code& block(uint8_t type = WasmBuilder::VOID) { return op(0x02).op(type); }
+    Code& loop(uint8_t type = WasmBuilder::VOID) { return op(0x03).op(type); }
+    Code& ifBlock(uint8_t type = WasmBuilder::VOID) { return op(0x04).op(type); }
+    // Block whose parameters and results are those of a function type
+    Code& typedBlock(uint32_t type_index) { op(0x02); WasmBuilder::writeS64(bytes_, type_index); return *this; }
+    Code& elseBlock() { return op(0x05); }
+    Code& end() { return op(0x0B); }
+    Code& br(uint32_t depth) { return op(0x0C).u32(depth); }
+    Code& brIf(uint32_t depth) { return op(0x0D).u32(depth); }
+    Code& brTable(const std::vector<uint32_t>& depths, uint32_t default_depth) {
+        op(0x0E).u32(static_cast<uint32_t>(depths.size()));
+        for (uint32_t depth : depths) {
+            u32(depth);
+        }
+        return u32(default_depth);
+    }
+    Code& call(uint32_t func_index) { return op(0x10).u32(func_index); }
+    Code& callIndirect(uint32_t type_index) { return op(0x11).u32(type_index).u32(0); }
+    Code& globalGet(uint32_t index) { return op(0x23).u32(index); }
+    Code& globalSet(uint32_t index) { return op(0x24).u32(index); }
+    Code& load(uint8_t opcode, uint32_t offset = 0) { return op(opcode).u32(2).u32(offset); }
+    Code& store(uint8_t opcode, uint32_t offset = 0) { return op(opcode).u32(2).u32(offset); }
+    Code& gc(uint32_t sub_opcode) { return op(0xFB).u32(sub_opcode); }
+    Code& refNull(uint8_t heap_type = WasmBuilder::ANYREF) { return op(0xD0).op(heap_type); }
+    Code& refFunc(uint32_t func_index) { return op(0xD2).u32(func_index); }
+
+    // Stack switching
+    Code& contNew(uint32_t cont_type) { return op(0xE0).u32(cont_type); }
+    Code& contBind(uint32_t from_type, uint32_t to_type) { return op(0xE1).u32(from_type).u32(to_type); }
+    Code& suspend(uint32_t tag) { return op(0xE2).u32(tag); }
+    // resume with (on tag label) handlers, given as (tag, label depth) pairs
+    Code& resume(uint32_t cont_type, const std::vector<std::pair<uint32_t, uint32_t>>& handlers = {}) {
+        op(0xE3).u32(cont_type).u32(static_cast<uint32_t>(handlers.size()));
+        for (const auto& handler : handlers) {
+            op(0x00).u32(handler.first).u32(handler.second);
+        }
+        return *this;
+    }
+
+    const WasmBuilder::Bytes& bytes() const { return bytes_; }
+
+private:
+    WasmBuilder::Bytes bytes_;
+};
+
+#endif // WASM_BENCH_BUILDER_H
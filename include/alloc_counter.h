@@ -0,0 +1,47 @@
+#ifndef WASM_ALLOC_COUNTER_H
+#define WASM_ALLOC_COUNTER_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace wasm {
+
+/**
+ * Host heap allocations made through operator new.
+ */
+struct AllocationStats {
+    uint64_t count;
+    uint64_t bytes;
+};
+
+/**
+ * Allocations made by the calling thread since it started.
+ * Counting replaces the global operator new and delete, so it is only
+ * active in binaries that link src/alloc_counter.cpp (tests and
+ * benchmarks); the interpreter itself never does.
+ */
+AllocationStats threadAllocations();
+
+/**
+ * Counts the calling thread's allocations from construction on.
+ *
+ *     AllocationScope scope;
+ *     interpreter.callFunction(index, args, results);
+ *     assert(scope.stats().count == 0);
+ */
+class AllocationScope {
+public:
+    AllocationScope() : start_(threadAllocations()) {}
+
+    AllocationStats stats() const {
+        AllocationStats now = threadAllocations();
+        return {now.count - start_.count, now.bytes - start_.bytes};
+    }
+
+private:
+    AllocationStats start_;
+};
+
+} // namespace wasm
+
+#endif // WASM_ALLOC_COUNTER_H
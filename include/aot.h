@@ -0,0 +1,137 @@
+#ifndef WASM_AOT_H
+#define WASM_AOT_H
+
+#include "module.h"
+#include "wasm_rt.h"
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace wasm {
+
+/**
+ * Exception thrown when a module cannot be compiled or a compiled module
+ * cannot be loaded.
+ */
+class AotError : public std::runtime_error {
+public:
+    explicit AotError(const std::string& message)
+        : std::runtime_error("AOT error: " + message) {}
+};
+
+/**
+ * Options for building a shared object from generated C.
+ */
+struct AotOptions {
+    std::string compiler;               // C compiler driver ($CC, or "cc")
+    std::string optimization;           // Optimization flag passed to the compiler
+    std::string runtime_include_dir;    // Directory containing wasm_rt.h
+    bool keep_source;                   // Keep the generated .c next to the output
+    bool optimize;                      // Optimizing tier (see AotCompiler)
+
+    AotOptions();
+};
+
+/**
+ * Ahead-of-time compiler.
+ * Translates a decoded Module into portable C against wasm_rt.h and
+ * builds it into a shared object with the system C compiler. Every
+ * defined function becomes a C function over typed locals; the operand
+ * stack is resolved at translation time into local variables, control
+ * flow becomes labels and gotos, and every memory access is bounds
+ * checked explicitly against the instance's current memory size.
+ *
+ * With AotOptions::optimize the memory base and size are cached in
+ * locals and refreshed only after calls and memory.grow, so the C
+ * compiler's value numbering and loop-invariant code motion can merge
+ * and hoist bounds checks; accesses at constant addresses inside the
+ * initial memory are emitted without a check.
+ */
+class AotCompiler {
+public:
+    explicit AotCompiler(AotOptions options = AotOptions());
+
+    /**
+     * Translate a module into a self-contained C translation unit.
+     * @param selected Function indices to compile (all if empty); the
+     *        others are called back into the host through call_host
+     */
+    std::string translate(const Module& module, const std::vector<bool>& selected = {}) const;
+
+    /**
+     * Translate a module and build it into a shared object. The source and
+     * object are built in a private directory created next to output_path
+     * and the object is then renamed to output_path.
+     * @param output_path Path of the .so to produce
+     * @param selected Function indices to compile (all if empty)
+     */
+    void compile(const Module& module, const std::string& output_path,
+                 const std::vector<bool>& selected = {}) const;
+
+    /**
+     * Hash of the parts of a module that compiled code depends on
+     * (types, function signatures, locals, bodies and globals). A native
+     * module is only used with the module it was compiled from.
+     */
+    static uint64_t fingerprint(const Module& module);
+
+private:
+    AotOptions options_;
+};
+
+/**
+ * Address range of one compiled function, for profiler symbolization.
+ */
+struct NativeCodeRange {
+    uint32_t func_index;
+    const void* start;
+    size_t size;
+};
+
+/**
+ * A compiled module loaded from a shared object.
+ */
+class NativeModule {
+public:
+    /**
+     * Load a shared object produced by AotCompiler.
+     * @throws AotError if the library or its descriptor cannot be loaded
+     */
+    static std::unique_ptr<NativeModule> load(const std::string& path);
+
+    ~NativeModule();
+
+    NativeModule(const NativeModule&) = delete;
+    NativeModule& operator=(const NativeModule&) = delete;
+
+    const wasm_rt_module& descriptor() const { return *descriptor_; }
+
+    /**
+     * Get the entry point for a function index.
+     * @return The invoker, or nullptr if the function was not compiled
+     */
+    wasm_rt_invoke_fn invoker(uint32_t func_index) const {
+        return func_index < descriptor_->function_count ? descriptor_->invokers[func_index] : nullptr;
+    }
+
+    /**
+     * Code ranges of the compiled functions. The C compiler does not record
+     * function sizes in a form available at run time, so each function is
+     * taken to extend to the next known entry point or to the end of the
+     * library's executable segment.
+     */
+    std::vector<NativeCodeRange> codeRanges() const;
+
+private:
+    NativeModule(void* handle, const wasm_rt_module* descriptor)
+        : handle_(handle), descriptor_(descriptor) {}
+
+    void* handle_;
+    const wasm_rt_module* descriptor_;
+};
+
+} // namespace wasm
+
+#endif // WASM_AOT_H
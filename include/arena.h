@@ -0,0 +1,104 @@
+#ifndef WASM_ARENA_H
+#define WASM_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace wasm {
+
+/**
+ * Read-only view over a contiguous array owned by someone else
+ * (typically a module Arena). Provides the subset of the std::vector
+ * interface used by readers of module data.
+ */
+template<typename T>
+class ArrayView {
+public:
+    ArrayView() : data_(nullptr), size_(0) {}
+    ArrayView(const T* data, size_t size) : data_(data), size_(size) {}
+
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+
+    const T& operator[](size_t index) const { return data_[index]; }
+    const T& back() const { return data_[size_ - 1]; }
+
+private:
+    const T* data_;
+    size_t size_;
+};
+
+/**
+ * Bump allocator for module data.
+ * Allocations are carved sequentially out of large chunks and are only
+ * released together when the arena is destroyed. Sizing the first chunk
+ * from the module binary means most modules live in a single block, so
+ * teardown is a single free and related data stays close in memory.
+ */
+class Arena {
+public:
+    explicit Arena(size_t initial_capacity = DEFAULT_CHUNK_SIZE);
+    ~Arena() = default;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /**
+     * Allocate uninitialized storage.
+     * @param size Number of bytes
+     * @param alignment Required alignment (power of 2)
+     */
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    /**
+     * Allocate uninitialized storage for count objects of trivial type T.
+     */
+    template<typename T>
+    T* allocateArray(size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "Arena only holds trivially copyable data");
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    /**
+     * Copy count objects into the arena and return a view of the copy.
+     */
+    template<typename T>
+    ArrayView<T> copy(const T* data, size_t count) {
+        if (count == 0) {
+            return ArrayView<T>();
+        }
+        T* dest = allocateArray<T>(count);
+        std::memcpy(dest, data, count * sizeof(T));
+        return ArrayView<T>(dest, count);
+    }
+
+    // Statistics
+    size_t bytesUsed() const { return bytes_used_; }
+    size_t bytesReserved() const { return bytes_reserved_; }
+    size_t chunkCount() const { return chunks_.size(); }
+
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+private:
+    std::vector<std::unique_ptr<uint8_t[]>> chunks_;
+    uint8_t* cursor_;
+    uint8_t* end_;
+    size_t next_chunk_size_;
+    size_t bytes_used_;
+    size_t bytes_reserved_;
+
+    void addChunk(size_t min_size);
+};
+
+} // namespace wasm
+
+#endif // WASM_ARENA_H
@@ -0,0 +1,133 @@
+#ifndef WASM_CANONICAL_ABI_H
+#define WASM_CANONICAL_ABI_H
+
+#include "arena.h"
+#include "interpreter.h"
+#include "memory.h"
+#include "types.h"
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace wasm {
+
+/**
+ * Exception thrown when a guest passes a string or list the canonical ABI
+ * does not allow: out of bounds, misaligned, or not validly encoded.
+ */
+class CanonicalAbiError : public std::runtime_error {
+public:
+    explicit CanonicalAbiError(const std::string& message)
+        : std::runtime_error("Canonical ABI error: " + message) {}
+};
+
+/**
+ * String encoding a component's core module uses (its string-encoding
+ * canonical option).
+ *   UTF8          len counts bytes
+ *   UTF16         len counts 16-bit code units; ptr is 2-byte aligned
+ *   LATIN1_UTF16  len with bit 31 clear counts Latin-1 bytes; with bit 31
+ *                 set, the low bits count UTF-16 code units
+ */
+enum class StringEncoding {
+    UTF8,
+    UTF16,
+    LATIN1_UTF16
+};
+
+/**
+ * Whether data is well-formed UTF-8 (no overlong forms, surrogates or
+ * code points above U+10FFFF). Runs of ASCII are checked 16 bytes at a
+ * time with SSE2 or NEON where available.
+ */
+bool isValidUtf8(const uint8_t* data, size_t size);
+
+/**
+ * Canonical ABI lifting and lowering of strings and lists of scalars for
+ * one instance, as used by component-model interfaces.
+ *
+ * Lifting returns views over linear memory whenever the bytes already have
+ * the host representation: UTF-8 strings, and lists of integers and floats
+ * (wasm is little-endian, as are the supported hosts). Only UTF-16 and
+ * Latin-1 strings are transcoded. A view is valid until the guest runs
+ * again or memory grows.
+ *
+ * Lowering makes one call to the guest's exported
+ *   cabi_realloc(old_ptr, old_size, align, new_size) -> ptr
+ * for the exact size and then writes the value with one bulk copy (or one
+ * transcoding pass). The guest owns the allocation afterwards.
+ */
+class CanonicalAbi {
+public:
+    /**
+     * A lowered value, as the pair of core arguments that passes it.
+     */
+    struct Lowered {
+        uint32_t ptr;
+        uint32_t len;   // Bytes or code units (tagged for LATIN1_UTF16), or list elements
+    };
+
+    explicit CanonicalAbi(Interpreter& instance, StringEncoding encoding = StringEncoding::UTF8);
+
+    StringEncoding encoding() const { return encoding_; }
+
+    /**
+     * Lift a string as UTF-8. For UTF-8 guests the result views linear
+     * memory and scratch is untouched; other encodings are transcoded into
+     * scratch, which the result then views.
+     * @throws CanonicalAbiError if out of bounds, misaligned or malformed
+     */
+    std::string_view liftString(uint32_t ptr, uint32_t len, std::string& scratch) const;
+
+    /**
+     * Lift a list of count integers or floats as a view over linear memory.
+     * @throws CanonicalAbiError if out of bounds or not aligned to T
+     */
+    template<typename T>
+    ArrayView<T> liftList(uint32_t ptr, uint32_t count) const {
+        static_assert(std::is_arithmetic<T>::value, "Only lists of scalars lift as views");
+        return ArrayView<T>(reinterpret_cast<const T*>(bytesAt(ptr, uint64_t(count) * sizeof(T), alignof(T))),
+                            count);
+    }
+
+    /**
+     * Lower a UTF-8 string into a guest allocation in the guest's encoding.
+     * @throws CanonicalAbiError if utf8 is malformed or the allocation is bad
+     */
+    Lowered lowerString(std::string_view utf8);
+
+    /**
+     * Lower count integers or floats into a guest allocation.
+     * @throws CanonicalAbiError if the allocation is bad
+     */
+    template<typename T>
+    Lowered lowerList(const T* items, size_t count) {
+        static_assert(std::is_arithmetic<T>::value, "Only lists of scalars lower with one copy");
+        return Lowered{lowerBytes(items, count * sizeof(T), alignof(T)), static_cast<uint32_t>(count)};
+    }
+
+    /**
+     * Number of cabi_realloc calls made so far.
+     */
+    uint64_t reallocCalls() const { return realloc_calls_; }
+
+private:
+    Interpreter& instance_;
+    StringEncoding encoding_;
+    uint64_t realloc_calls_ = 0;
+    std::vector<TypedValue> args_;      // Reused across cabi_realloc calls
+    std::vector<TypedValue> results_;
+
+    Memory& memory() const;
+    const uint8_t* bytesAt(uint32_t ptr, uint64_t size, uint32_t align) const;
+    uint32_t allocate(uint64_t size, uint32_t align);
+    uint32_t lowerBytes(const void* data, size_t size, uint32_t align);
+};
+
+} // namespace wasm
+
+#endif // WASM_CANONICAL_ABI_H
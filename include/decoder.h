@@ -29,6 +29,8 @@ public:
 
     /**
      * Parse a WebAssembly binary file and return a Module.
+     * The file is mapped rather than read where possible; the module then
+     * keeps the mapping (Module::source) and its data segments view it.
      * @param filename Path to the .wasm file
      * @return Parsed module
      * @throws DecoderError if parsing fails
@@ -43,9 +45,26 @@ public:
      */
     Module parseBytes(const std::vector<uint8_t>& bytes);
 
+    /**
+     * Whether parse() maps files (the default). When false, or when a file
+     * cannot be mapped, it is read into a buffer owned by the decoder.
+     */
+    void setMapFiles(bool map) { map_files_ = map; }
+
 private:
-    std::vector<uint8_t> buffer_;
+    std::vector<uint8_t> buffer_;   // Owns the bytes of a file that could not be mapped
+    std::shared_ptr<const MappedFile> source_;  // Mapped file being decoded, if any
+    const uint8_t* bytes_ = nullptr;    // Binary being decoded
+    size_t size_ = 0;
     size_t position_;
+    bool map_files_ = true;
+    Arena* arena_;                  // Arena of the module being decoded
+    const std::vector<CompositeType>* composite_types_ = nullptr;  // Types decoded so far
+
+    // Scratch space reused across function bodies: (count, type) local runs
+    std::vector<std::pair<uint32_t, ValueType>> local_runs_;
+
+    Module parseBuffer();
 
     // Binary reading utilities
     uint8_t readByte();
@@ -54,8 +73,8 @@ private:
     int64_t readI64();
     float readF32();
     double readF64();
-    std::vector<uint8_t> readBytes(size_t count);
-    std::string readName();
+    ArrayView<uint8_t> readBytes(size_t count);
+    std::string_view readName();
 
     // LEB128 decoding
     uint32_t readVarUint32();
@@ -66,6 +85,8 @@ private:
     // Type parsing
     ValueType readValueType();
     FuncType readFuncType();
+    void readSubType(Module& module);
+    FieldType readFieldType();
     Limits readLimits();
 
     // Section parsing
@@ -81,12 +102,15 @@ private:
     void parseExportSection(Module& module);
     void parseStartSection(Module& module);
     void parseElementSection(Module& module);
-    void parseCodeSection(Module& module);
+    void parseCodeSection(Module& module, uint32_t section_size);
     void parseDataSection(Module& module);
     void parseImportSection(Module& module);
+    void parseTagSection(Module& module);
+    void parseCustomSection(Module& module, uint32_t section_size);
+    void parseNameSection(Module& module, size_t section_end);
 
     // Helper for reading init expressions
-    std::vector<uint8_t> readInitExpression();
+    ArrayView<uint8_t> readInitExpression();
 
     // Helper for reading vectors
     template<typename T, typename ParseFunc>
@@ -0,0 +1,87 @@
+#ifndef WASM_FIBER_H
+#define WASM_FIBER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(__aarch64__)) && defined(__ELF__)
+#define WASM_FIBER_ASM 1
+#elif defined(__unix__) || defined(__APPLE__)
+#include <ucontext.h>
+#define WASM_FIBER_UCONTEXT 1
+#endif
+
+namespace wasm {
+
+/**
+ * A native stack that code can be switched onto and off again, used to
+ * run the frames of each continuation apart from its resumer's.
+ *
+ * switchTo() pushes the callee-saved registers on the running stack,
+ * stores its stack pointer here and loads the other fiber's, so a switch
+ * costs a few register moves and no system call (x86-64 and AArch64;
+ * other POSIX systems use swapcontext()). A default-constructed fiber
+ * stands for the stack of the thread that first switches away from it.
+ *
+ * Stacks are mapped without reserving swap, so only the pages a fiber
+ * touches are committed, and a guard page below each one turns overflow
+ * into a fault instead of silent corruption.
+ */
+class Fiber {
+public:
+    /**
+     * Runs on the fiber's own stack. It must not return and exceptions
+     * must not leave it: it ends by switching to another fiber.
+     */
+    using Entry = void (*)(void* arg);
+
+    Fiber() = default;
+
+    /**
+     * Map a stack of stack_bytes (rounded up to whole pages).
+     * @throws std::bad_alloc if it cannot be mapped
+     */
+    explicit Fiber(size_t stack_bytes);
+    ~Fiber();
+
+    Fiber(const Fiber&) = delete;
+    Fiber& operator=(const Fiber&) = delete;
+
+    /**
+     * Make the next switch to this fiber call entry(arg) on a fresh stack,
+     * discarding whatever frames it held. Must not be called on the
+     * running fiber.
+     */
+    void start(Entry entry, void* arg);
+
+    /**
+     * Suspend the calling code, which runs on this fiber, and continue
+     * next where it last switched away (or at its entry function).
+     * Returns when some fiber switches back to this one.
+     */
+    void switchTo(Fiber& next);
+
+    size_t stackBytes() const { return stack_bytes_; }
+
+    /**
+     * Whether fibers work on this platform.
+     */
+    static bool supported();
+
+private:
+    uint8_t* mapping_ = nullptr;    // Guard page followed by the stack
+    size_t mapped_bytes_ = 0;
+    size_t stack_bytes_ = 0;
+#ifdef WASM_FIBER_UCONTEXT
+    ucontext_t context_;
+    Entry entry_ = nullptr;
+    void* arg_ = nullptr;
+    static void trampoline(unsigned int high, unsigned int low);
+#else
+    void* sp_ = nullptr;            // Saved stack pointer while switched away
+#endif
+};
+
+} // namespace wasm
+
+#endif // WASM_FIBER_H
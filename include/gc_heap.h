@@ -0,0 +1,183 @@
+#ifndef WASM_GC_HEAP_H
+#define WASM_GC_HEAP_H
+
+#include "module.h"
+#include "types.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace wasm {
+
+/**
+ * Exception thrown when the GC heap cannot satisfy an allocation.
+ */
+class GcError : public std::runtime_error {
+public:
+    explicit GcError(const std::string& message)
+        : std::runtime_error("GC error: " + message) {}
+};
+
+/**
+ * Work done by a GcHeap since it was created.
+ */
+struct GcStats {
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+    uint64_t minor_collections = 0;
+    uint64_t major_collections = 0;
+    uint64_t promoted_bytes = 0;        // Copied from the nursery into the old generation
+    uint64_t total_pause_ns = 0;
+    uint64_t max_pause_ns = 0;
+    size_t old_bytes = 0;               // Old generation in use
+};
+
+/**
+ * Generation sizes of a GcHeap.
+ */
+struct GcOptions {
+    size_t nursery_bytes = size_t(1) << 20;     // Young generation size
+    size_t major_threshold = size_t(8) << 20;   // Old bytes that trigger the first major collection
+    double growth = 2.0;                        // Next threshold: live old bytes times growth
+    size_t max_bytes = size_t(1) << 30;         // Old generation limit; allocation past it fails
+};
+
+/**
+ * Heap for the structs and arrays of the GC proposal.
+ *
+ * Objects are bump-allocated in a fixed nursery. When it fills, a minor
+ * collection copies the live nursery objects into the old generation
+ * (Cheney scan) and empties it. The roots are the reference slots the
+ * RootScanner visits plus old objects that were given a nursery
+ * reference (remembered by the write barrier in setField() and
+ * setElement()). When the old generation outgrows its threshold, a major
+ * collection copies all live objects into fresh chunks, compacting them.
+ * Objects larger than half the nursery are allocated old.
+ *
+ * A reference is a Value::ref: 0 is null, odd values are i31 and other
+ * values are object addresses. Collections move objects, so references
+ * held outside the root slots are stale after any allocation.
+ */
+class GcHeap {
+public:
+    /**
+     * Called with every root slot; the collector rewrites moved objects.
+     */
+    using RootVisitor = std::function<void(uint64_t& ref)>;
+    using RootScanner = std::function<void(const RootVisitor&)>;
+
+    /**
+     * @param types Type section of the module whose objects live here
+     */
+    explicit GcHeap(const std::vector<CompositeType>& types, const GcOptions& options = GcOptions());
+    ~GcHeap();
+
+    GcHeap(const GcHeap&) = delete;
+    GcHeap& operator=(const GcHeap&) = delete;
+
+    void setRoots(RootScanner roots) { roots_ = std::move(roots); }
+
+    /**
+     * Allocate a struct or array with every field zero (null for
+     * references). May collect first.
+     * @throws GcError if the heap limit is reached
+     */
+    uint64_t allocateStruct(uint32_t type_index);
+    uint64_t allocateArray(uint32_t type_index, uint32_t length);
+
+    // Field and element access; the caller checks null and indices.
+    // Loads return the stored bits zero-extended to 64 bits.
+    uint64_t getField(uint64_t ref, uint32_t field) const;
+    void setField(uint64_t ref, uint32_t field, Value value);
+    uint64_t getElement(uint64_t ref, uint32_t index) const;
+    void setElement(uint64_t ref, uint32_t index, Value value);
+    uint32_t arrayLength(uint64_t ref) const;
+    uint32_t typeIndex(uint64_t ref) const;
+
+    const CompositeType& type(uint32_t type_index) const { return types_[type_index]; }
+
+    /**
+     * Run a major collection, which also empties the nursery.
+     */
+    void collect();
+
+    /**
+     * Drop every object at once, e.g. when a snapshot is restored.
+     */
+    void clear();
+
+    const GcStats& stats() const { return stats_; }
+
+    static bool isObject(uint64_t ref) { return ref != 0 && (ref & 1) == 0; }
+    static bool isI31(uint64_t ref) { return (ref & 1) != 0; }
+    static uint64_t makeI31(int32_t value) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(value) & 0x7FFFFFFFu) << 1) | 1;
+    }
+    static int32_t i31Signed(uint64_t ref) { return static_cast<int32_t>(static_cast<uint32_t>(ref)) >> 1; }
+    static uint32_t i31Unsigned(uint64_t ref) { return static_cast<uint32_t>(ref >> 1) & 0x7FFFFFFFu; }
+
+private:
+    struct Header {
+        uint32_t type_index;        // Overwritten by the new address once forwarded
+        uint32_t length;            // Array length
+        uint32_t size;              // Bytes including this header, a multiple of 8
+        uint32_t flags;
+    };
+    static constexpr uint32_t FORWARDED = 1;
+    static constexpr uint32_t REMEMBERED = 2;
+
+    struct Layout {
+        std::vector<uint32_t> offsets;      // Struct field offsets from the object start
+        std::vector<uint8_t> sizes;         // Struct field sizes
+        std::vector<uint32_t> ref_offsets;  // Struct fields holding references
+        uint32_t size = sizeof(Header);     // Struct object size
+        uint8_t element_size = 0;           // Array element size
+        bool element_ref = false;           // Array elements are references
+    };
+
+    struct Chunk {
+        std::unique_ptr<uint8_t[]> data;
+        size_t capacity;
+        size_t used;
+    };
+
+    static constexpr size_t CHUNK_BYTES = size_t(1) << 20;
+
+    std::vector<CompositeType> types_;
+    std::vector<Layout> layouts_;
+    GcOptions options_;
+    RootScanner roots_;
+
+    std::unique_ptr<uint8_t[]> nursery_;
+    uint8_t* nursery_begin_ = nullptr;
+    uint8_t* nursery_top_ = nullptr;
+    uint8_t* nursery_end_ = nullptr;
+    std::vector<Chunk> old_;
+    size_t old_bytes_ = 0;
+    size_t major_threshold_;
+    std::vector<uint8_t*> remembered_;
+    GcStats stats_;
+
+    static Header* header(uint64_t ref) { return reinterpret_cast<Header*>(static_cast<uintptr_t>(ref)); }
+    bool inNursery(const void* object) const {
+        return object >= nursery_begin_ && object < nursery_end_;
+    }
+
+    uint64_t allocate(uint32_t type_index, size_t size, uint32_t length);
+    uint8_t* allocateOld(size_t size);
+    void writeBarrier(uint64_t ref, uint64_t value);
+
+    void collectMinor();
+    void collectMajor();
+    uint64_t evacuate(uint64_t ref, bool major);
+    void scanObject(uint8_t* object, bool major);
+    void scanFrom(size_t chunk, size_t offset, bool major);
+    void recordPause(uint64_t start_ns);
+};
+
+} // namespace wasm
+
+#endif // WASM_GC_HEAP_H
@@ -1,6 +1,8 @@
 #ifndef WASM_INSTRUCTIONS_H
 #define WASM_INSTRUCTIONS_H
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
@@ -214,7 +216,56 @@ enum class Opcode : uint8_t {
     I32_REINTERPRET_F32 = 0xBC,
     I64_REINTERPRET_F64 = 0xBD,
     F32_REINTERPRET_I32 = 0xBE,
-    F64_REINTERPRET_I64 = 0xBF
+    F64_REINTERPRET_I64 = 0xBF,
+
+    // Reference instructions (reference types and GC proposals)
+    REF_NULL = 0xD0,
+    REF_IS_NULL = 0xD1,
+    REF_FUNC = 0xD2,
+    REF_EQ = 0xD3,
+    REF_AS_NON_NULL = 0xD4,
+    BR_ON_NULL = 0xD5,
+    BR_ON_NON_NULL = 0xD6,
+
+    // Stack switching (typed continuations)
+    CONT_NEW = 0xE0,
+    CONT_BIND = 0xE1,
+    SUSPEND = 0xE2,
+    RESUME = 0xE3,
+    RESUME_THROW = 0xE4,
+    SWITCH = 0xE5,
+
+    // Prefix of the GC instructions; a GcOpcode follows as LEB128 u32
+    GC_PREFIX = 0xFB
+};
+
+/**
+ * GC proposal instructions, encoded after the 0xFB prefix.
+ */
+enum class GcOpcode : uint32_t {
+    STRUCT_NEW = 0x00,
+    STRUCT_NEW_DEFAULT = 0x01,
+    STRUCT_GET = 0x02,
+    STRUCT_GET_S = 0x03,
+    STRUCT_GET_U = 0x04,
+    STRUCT_SET = 0x05,
+    ARRAY_NEW = 0x06,
+    ARRAY_NEW_DEFAULT = 0x07,
+    ARRAY_NEW_FIXED = 0x08,
+    ARRAY_GET = 0x0B,
+    ARRAY_GET_S = 0x0C,
+    ARRAY_GET_U = 0x0D,
+    ARRAY_SET = 0x0E,
+    ARRAY_LEN = 0x0F,
+    ARRAY_FILL = 0x10,
+    ARRAY_COPY = 0x11,
+    REF_TEST = 0x14,
+    REF_TEST_NULL = 0x15,
+    REF_CAST = 0x16,
+    REF_CAST_NULL = 0x17,
+    REF_I31 = 0x1C,
+    I31_GET_S = 0x1D,
+    I31_GET_U = 0x1E
 };
 
 /**
@@ -228,14 +279,408 @@ struct MemArg {
     MemArg(uint32_t a, uint32_t o) : align(a), offset(o) {}
 };
 
+// ===== Opcode metadata =====
+
+/**
+ * Encoding of the immediates that follow an opcode (or a sub-opcode).
+ */
+enum class Immediate : uint8_t {
+    NONE,
+    BLOCK_TYPE,     // 0x40, a value type or an s33 type index
+    U32,            // One LEB128 index, count or reserved byte
+    U32_PAIR,       // Two LEB128 values (call_indirect type and table, ...)
+    S32,            // Signed LEB128 (i32.const)
+    S64,            // Signed LEB128 (i64.const)
+    F32,            // 4 little-endian bytes
+    F64,            // 8 little-endian bytes
+    MEMARG,         // Alignment and offset
+    HEAP_TYPE,      // s33 heap type
+    BR_TABLE,       // Label vector, then the default label
+    SELECT_TYPES,   // Vector of value types
+    RESUME,         // Continuation type, then handler clauses
+    RESUME_THROW,   // Continuation type and tag, then handler clauses
+    BR_ON_CAST,     // Flags byte, label and two heap types
+    PREFIX          // LEB128 sub-opcode, looked up with prefixedOpcodeInfo
+};
+
+/**
+ * Interpreter routine that executes an opcode. UNSUPPORTED marks opcodes
+ * whose encoding is known (so code containing them can be scanned) but
+ * which the interpreter does not execute.
+ */
+enum class Handler : uint8_t {
+    UNSUPPORTED,
+    CONTROL,
+    PARAMETRIC,
+    VARIABLE,
+    MEMORY,
+    CONSTANT,
+    NUMERIC,
+    CONVERSION,
+    REFERENCE,
+    GC,
+    CONTINUATION
+};
+
+/**
+ * Stack effect of instructions whose operand or result count depends on
+ * a type immediate or on the enclosing blocks.
+ */
+constexpr int8_t VARIABLE_ARITY = -1;
+
+/**
+ * Static description of one opcode.
+ */
+struct OpcodeInfo {
+    const char* name;       // Text format name; nullptr if unassigned
+    Immediate immediate;
+    Handler handler;
+    int8_t pops;            // Operands consumed, or VARIABLE_ARITY
+    int8_t pushes;          // Results produced, or VARIABLE_ARITY
+};
+
+namespace detail {
+
+constexpr std::array<OpcodeInfo, 256> makeOpcodeTable() {
+    std::array<OpcodeInfo, 256> table{};
+    for (auto& entry : table) {
+        entry = {nullptr, Immediate::NONE, Handler::UNSUPPORTED, 0, 0};
+    }
+
+    // Control flow
+    table[0x00] = {"unreachable", Immediate::NONE, Handler::CONTROL, 0, 0};
+    table[0x01] = {"nop", Immediate::NONE, Handler::CONTROL, 0, 0};
+    table[0x02] = {"block", Immediate::BLOCK_TYPE, Handler::CONTROL, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0x03] = {"loop", Immediate::BLOCK_TYPE, Handler::CONTROL, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0x04] = {"if", Immediate::BLOCK_TYPE, Handler::CONTROL, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0x05] = {"else", Immediate::NONE, Handler::CONTROL, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0x0B] = {"end", Immediate::NONE, Handler::CONTROL, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0x0C] = {"br", Immediate::U32, Handler::CONTROL, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0x0D] = {"br_if", Immediate::U32, Handler::CONTROL, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0x0E] = {"br_table", Immediate::BR_TABLE, Handler::CONTROL, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0x0F] = {"return", Immediate::NONE, Handler::CONTROL, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0x10] = {"call", Immediate::U32, Handler::CONTROL, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0x11] = {"call_indirect", Immediate::U32_PAIR, Handler::CONTROL, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0x12] = {"return_call", Immediate::U32, Handler::UNSUPPORTED, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0x13] = {"return_call_indirect", Immediate::U32_PAIR, Handler::UNSUPPORTED, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0x14] = {"call_ref", Immediate::U32, Handler::UNSUPPORTED, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0x15] = {"return_call_ref", Immediate::U32, Handler::UNSUPPORTED, VARIABLE_ARITY, VARIABLE_ARITY};
+
+    // Parametric
+    table[0x1A] = {"drop", Immediate::NONE, Handler::PARAMETRIC, 1, 0};
+    table[0x1B] = {"select", Immediate::NONE, Handler::PARAMETRIC, 3, 1};
+    table[0x1C] = {"select", Immediate::SELECT_TYPES, Handler::UNSUPPORTED, 3, 1};
+
+    // Variable access and tables
+    table[0x20] = {"local.get", Immediate::U32, Handler::VARIABLE, 0, 1};
+    table[0x21] = {"local.set", Immediate::U32, Handler::VARIABLE, 1, 0};
+    table[0x22] = {"local.tee", Immediate::U32, Handler::VARIABLE, 1, 1};
+    table[0x23] = {"global.get", Immediate::U32, Handler::VARIABLE, 0, 1};
+    table[0x24] = {"global.set", Immediate::U32, Handler::VARIABLE, 1, 0};
+    table[0x25] = {"table.get", Immediate::U32, Handler::UNSUPPORTED, 1, 1};
+    table[0x26] = {"table.set", Immediate::U32, Handler::UNSUPPORTED, 2, 0};
+
+    // Memory
+    table[0x28] = {"i32.load", Immediate::MEMARG, Handler::MEMORY, 1, 1};
+    table[0x29] = {"i64.load", Immediate::MEMARG, Handler::MEMORY, 1, 1};
+    table[0x2A] = {"f32.load", Immediate::MEMARG, Handler::MEMORY, 1, 1};
+    table[0x2B] = {"f64.load", Immediate::MEMARG, Handler::MEMORY, 1, 1};
+    table[0x2C] = {"i32.load8_s", Immediate::MEMARG, Handler::MEMORY, 1, 1};
+    table[0x2D] = {"i32.load8_u", Immediate::MEMARG, Handler::MEMORY, 1, 1};
+    table[0x2E] = {"i32.load16_s", Immediate::MEMARG, Handler::MEMORY, 1, 1};
+    table[0x2F] = {"i32.load16_u", Immediate::MEMARG, Handler::MEMORY, 1, 1};
+    table[0x30] = {"i64.load8_s", Immediate::MEMARG, Handler::MEMORY, 1, 1};
+    table[0x31] = {"i64.load8_u", Immediate::MEMARG, Handler::MEMORY, 1, 1};
+    table[0x32] = {"i64.load16_s", Immediate::MEMARG, Handler::MEMORY, 1, 1};
+    table[0x33] = {"i64.load16_u", Immediate::MEMARG, Handler::MEMORY, 1, 1};
+    table[0x34] = {"i64.load32_s", Immediate::MEMARG, Handler::MEMORY, 1, 1};
+    table[0x35] = {"i64.load32_u", Immediate::MEMARG, Handler::MEMORY, 1, 1};
+    table[0x36] = {"i32.store", Immediate::MEMARG, Handler::MEMORY, 2, 0};
+    table[0x37] = {"i64.store", Immediate::MEMARG, Handler::MEMORY, 2, 0};
+    table[0x38] = {"f32.store", Immediate::MEMARG, Handler::MEMORY, 2, 0};
+    table[0x39] = {"f64.store", Immediate::MEMARG, Handler::MEMORY, 2, 0};
+    table[0x3A] = {"i32.store8", Immediate::MEMARG, Handler::MEMORY, 2, 0};
+    table[0x3B] = {"i32.store16", Immediate::MEMARG, Handler::MEMORY, 2, 0};
+    table[0x3C] = {"i64.store8", Immediate::MEMARG, Handler::MEMORY, 2, 0};
+    table[0x3D] = {"i64.store16", Immediate::MEMARG, Handler::MEMORY, 2, 0};
+    table[0x3E] = {"i64.store32", Immediate::MEMARG, Handler::MEMORY, 2, 0};
+    table[0x3F] = {"memory.size", Immediate::U32, Handler::MEMORY, 0, 1};
+    table[0x40] = {"memory.grow", Immediate::U32, Handler::MEMORY, 1, 1};
+
+    // Constants
+    table[0x41] = {"i32.const", Immediate::S32, Handler::CONSTANT, 0, 1};
+    table[0x42] = {"i64.const", Immediate::S64, Handler::CONSTANT, 0, 1};
+    table[0x43] = {"f32.const", Immediate::F32, Handler::CONSTANT, 0, 1};
+    table[0x44] = {"f64.const", Immediate::F64, Handler::CONSTANT, 0, 1};
+
+    // Comparisons
+    table[0x45] = {"i32.eqz", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x46] = {"i32.eq", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x47] = {"i32.ne", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x48] = {"i32.lt_s", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x49] = {"i32.lt_u", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x4A] = {"i32.gt_s", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x4B] = {"i32.gt_u", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x4C] = {"i32.le_s", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x4D] = {"i32.le_u", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x4E] = {"i32.ge_s", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x4F] = {"i32.ge_u", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x50] = {"i64.eqz", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x51] = {"i64.eq", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x52] = {"i64.ne", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x53] = {"i64.lt_s", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x54] = {"i64.lt_u", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x55] = {"i64.gt_s", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x56] = {"i64.gt_u", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x57] = {"i64.le_s", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x58] = {"i64.le_u", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x59] = {"i64.ge_s", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x5A] = {"i64.ge_u", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x5B] = {"f32.eq", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x5C] = {"f32.ne", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x5D] = {"f32.lt", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x5E] = {"f32.gt", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x5F] = {"f32.le", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x60] = {"f32.ge", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x61] = {"f64.eq", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x62] = {"f64.ne", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x63] = {"f64.lt", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x64] = {"f64.gt", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x65] = {"f64.le", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x66] = {"f64.ge", Immediate::NONE, Handler::NUMERIC, 2, 1};
+
+    // Arithmetic
+    table[0x67] = {"i32.clz", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x68] = {"i32.ctz", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x69] = {"i32.popcnt", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x6A] = {"i32.add", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x6B] = {"i32.sub", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x6C] = {"i32.mul", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x6D] = {"i32.div_s", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x6E] = {"i32.div_u", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x6F] = {"i32.rem_s", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x70] = {"i32.rem_u", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x71] = {"i32.and", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x72] = {"i32.or", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x73] = {"i32.xor", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x74] = {"i32.shl", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x75] = {"i32.shr_s", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x76] = {"i32.shr_u", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x77] = {"i32.rotl", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x78] = {"i32.rotr", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x79] = {"i64.clz", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x7A] = {"i64.ctz", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x7B] = {"i64.popcnt", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x7C] = {"i64.add", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x7D] = {"i64.sub", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x7E] = {"i64.mul", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x7F] = {"i64.div_s", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x80] = {"i64.div_u", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x81] = {"i64.rem_s", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x82] = {"i64.rem_u", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x83] = {"i64.and", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x84] = {"i64.or", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x85] = {"i64.xor", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x86] = {"i64.shl", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x87] = {"i64.shr_s", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x88] = {"i64.shr_u", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x89] = {"i64.rotl", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x8A] = {"i64.rotr", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x8B] = {"f32.abs", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x8C] = {"f32.neg", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x8D] = {"f32.ceil", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x8E] = {"f32.floor", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x8F] = {"f32.trunc", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x90] = {"f32.nearest", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x91] = {"f32.sqrt", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x92] = {"f32.add", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x93] = {"f32.sub", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x94] = {"f32.mul", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x95] = {"f32.div", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x96] = {"f32.min", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x97] = {"f32.max", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x98] = {"f32.copysign", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0x99] = {"f64.abs", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x9A] = {"f64.neg", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x9B] = {"f64.ceil", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x9C] = {"f64.floor", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x9D] = {"f64.trunc", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x9E] = {"f64.nearest", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0x9F] = {"f64.sqrt", Immediate::NONE, Handler::NUMERIC, 1, 1};
+    table[0xA0] = {"f64.add", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0xA1] = {"f64.sub", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0xA2] = {"f64.mul", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0xA3] = {"f64.div", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0xA4] = {"f64.min", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0xA5] = {"f64.max", Immediate::NONE, Handler::NUMERIC, 2, 1};
+    table[0xA6] = {"f64.copysign", Immediate::NONE, Handler::NUMERIC, 2, 1};
+
+    // Conversions
+    table[0xA7] = {"i32.wrap_i64", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xA8] = {"i32.trunc_f32_s", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xA9] = {"i32.trunc_f32_u", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xAA] = {"i32.trunc_f64_s", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xAB] = {"i32.trunc_f64_u", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xAC] = {"i64.extend_i32_s", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xAD] = {"i64.extend_i32_u", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xAE] = {"i64.trunc_f32_s", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xAF] = {"i64.trunc_f32_u", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xB0] = {"i64.trunc_f64_s", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xB1] = {"i64.trunc_f64_u", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xB2] = {"f32.convert_i32_s", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xB3] = {"f32.convert_i32_u", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xB4] = {"f32.convert_i64_s", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xB5] = {"f32.convert_i64_u", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xB6] = {"f32.demote_f64", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xB7] = {"f64.convert_i32_s", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xB8] = {"f64.convert_i32_u", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xB9] = {"f64.convert_i64_s", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xBA] = {"f64.convert_i64_u", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xBB] = {"f64.promote_f32", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xBC] = {"i32.reinterpret_f32", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xBD] = {"i64.reinterpret_f64", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xBE] = {"f32.reinterpret_i32", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xBF] = {"f64.reinterpret_i64", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0xC0] = {"i32.extend8_s", Immediate::NONE, Handler::UNSUPPORTED, 1, 1};
+    table[0xC1] = {"i32.extend16_s", Immediate::NONE, Handler::UNSUPPORTED, 1, 1};
+    table[0xC2] = {"i64.extend8_s", Immediate::NONE, Handler::UNSUPPORTED, 1, 1};
+    table[0xC3] = {"i64.extend16_s", Immediate::NONE, Handler::UNSUPPORTED, 1, 1};
+    table[0xC4] = {"i64.extend32_s", Immediate::NONE, Handler::UNSUPPORTED, 1, 1};
+
+    // References
+    table[0xD0] = {"ref.null", Immediate::HEAP_TYPE, Handler::REFERENCE, 0, 1};
+    table[0xD1] = {"ref.is_null", Immediate::NONE, Handler::REFERENCE, 1, 1};
+    table[0xD2] = {"ref.func", Immediate::U32, Handler::REFERENCE, 0, 1};
+    table[0xD3] = {"ref.eq", Immediate::NONE, Handler::REFERENCE, 2, 1};
+    table[0xD4] = {"ref.as_non_null", Immediate::NONE, Handler::REFERENCE, 1, 1};
+    table[0xD5] = {"br_on_null", Immediate::U32, Handler::REFERENCE, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0xD6] = {"br_on_non_null", Immediate::U32, Handler::REFERENCE, VARIABLE_ARITY, VARIABLE_ARITY};
+
+    // Stack switching
+    table[0xE0] = {"cont.new", Immediate::U32, Handler::CONTINUATION, 1, 1};
+    table[0xE1] = {"cont.bind", Immediate::U32_PAIR, Handler::CONTINUATION, VARIABLE_ARITY, 1};
+    table[0xE2] = {"suspend", Immediate::U32, Handler::CONTINUATION, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0xE3] = {"resume", Immediate::RESUME, Handler::CONTINUATION, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0xE4] = {"resume_throw", Immediate::RESUME_THROW, Handler::CONTINUATION, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0xE5] = {"switch", Immediate::U32_PAIR, Handler::CONTINUATION, VARIABLE_ARITY, VARIABLE_ARITY};
+
+    // Prefixes; the sub-opcode is looked up in the tables below
+    table[0xFB] = {"gc", Immediate::PREFIX, Handler::GC, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0xFC] = {"misc", Immediate::PREFIX, Handler::CONVERSION, VARIABLE_ARITY, VARIABLE_ARITY};
+    return table;
+}
+
+constexpr std::array<OpcodeInfo, 32> makeGcOpcodeTable() {
+    std::array<OpcodeInfo, 32> table{};
+    for (auto& entry : table) {
+        entry = {nullptr, Immediate::NONE, Handler::UNSUPPORTED, 0, 0};
+    }
+    table[0x00] = {"struct.new", Immediate::U32, Handler::GC, VARIABLE_ARITY, 1};
+    table[0x01] = {"struct.new_default", Immediate::U32, Handler::GC, 0, 1};
+    table[0x02] = {"struct.get", Immediate::U32_PAIR, Handler::GC, 1, 1};
+    table[0x03] = {"struct.get_s", Immediate::U32_PAIR, Handler::GC, 1, 1};
+    table[0x04] = {"struct.get_u", Immediate::U32_PAIR, Handler::GC, 1, 1};
+    table[0x05] = {"struct.set", Immediate::U32_PAIR, Handler::GC, 2, 0};
+    table[0x06] = {"array.new", Immediate::U32, Handler::GC, 2, 1};
+    table[0x07] = {"array.new_default", Immediate::U32, Handler::GC, 1, 1};
+    table[0x08] = {"array.new_fixed", Immediate::U32_PAIR, Handler::GC, VARIABLE_ARITY, 1};
+    table[0x09] = {"array.new_data", Immediate::U32_PAIR, Handler::UNSUPPORTED, 2, 1};
+    table[0x0A] = {"array.new_elem", Immediate::U32_PAIR, Handler::UNSUPPORTED, 2, 1};
+    table[0x0B] = {"array.get", Immediate::U32, Handler::GC, 2, 1};
+    table[0x0C] = {"array.get_s", Immediate::U32, Handler::GC, 2, 1};
+    table[0x0D] = {"array.get_u", Immediate::U32, Handler::GC, 2, 1};
+    table[0x0E] = {"array.set", Immediate::U32, Handler::GC, 3, 0};
+    table[0x0F] = {"array.len", Immediate::NONE, Handler::GC, 1, 1};
+    table[0x10] = {"array.fill", Immediate::U32, Handler::GC, 4, 0};
+    table[0x11] = {"array.copy", Immediate::U32_PAIR, Handler::GC, 5, 0};
+    table[0x12] = {"array.init_data", Immediate::U32_PAIR, Handler::UNSUPPORTED, 4, 0};
+    table[0x13] = {"array.init_elem", Immediate::U32_PAIR, Handler::UNSUPPORTED, 4, 0};
+    table[0x14] = {"ref.test", Immediate::HEAP_TYPE, Handler::GC, 1, 1};
+    table[0x15] = {"ref.test", Immediate::HEAP_TYPE, Handler::GC, 1, 1};
+    table[0x16] = {"ref.cast", Immediate::HEAP_TYPE, Handler::GC, 1, 1};
+    table[0x17] = {"ref.cast", Immediate::HEAP_TYPE, Handler::GC, 1, 1};
+    table[0x18] = {"br_on_cast", Immediate::BR_ON_CAST, Handler::UNSUPPORTED, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0x19] = {"br_on_cast_fail", Immediate::BR_ON_CAST, Handler::UNSUPPORTED, VARIABLE_ARITY, VARIABLE_ARITY};
+    table[0x1A] = {"any.convert_extern", Immediate::NONE, Handler::UNSUPPORTED, 1, 1};
+    table[0x1B] = {"extern.convert_any", Immediate::NONE, Handler::UNSUPPORTED, 1, 1};
+    table[0x1C] = {"ref.i31", Immediate::NONE, Handler::GC, 1, 1};
+    table[0x1D] = {"i31.get_s", Immediate::NONE, Handler::GC, 1, 1};
+    table[0x1E] = {"i31.get_u", Immediate::NONE, Handler::GC, 1, 1};
+    return table;
+}
+
+constexpr std::array<OpcodeInfo, 18> makeMiscOpcodeTable() {
+    std::array<OpcodeInfo, 18> table{};
+    table[0x00] = {"i32.trunc_sat_f32_s", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0x01] = {"i32.trunc_sat_f32_u", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0x02] = {"i32.trunc_sat_f64_s", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0x03] = {"i32.trunc_sat_f64_u", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0x04] = {"i64.trunc_sat_f32_s", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0x05] = {"i64.trunc_sat_f32_u", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0x06] = {"i64.trunc_sat_f64_s", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0x07] = {"i64.trunc_sat_f64_u", Immediate::NONE, Handler::CONVERSION, 1, 1};
+    table[0x08] = {"memory.init", Immediate::U32_PAIR, Handler::UNSUPPORTED, 3, 0};
+    table[0x09] = {"data.drop", Immediate::U32, Handler::UNSUPPORTED, 0, 0};
+    table[0x0A] = {"memory.copy", Immediate::U32_PAIR, Handler::UNSUPPORTED, 3, 0};
+    table[0x0B] = {"memory.fill", Immediate::U32, Handler::UNSUPPORTED, 3, 0};
+    table[0x0C] = {"table.init", Immediate::U32_PAIR, Handler::UNSUPPORTED, 3, 0};
+    table[0x0D] = {"elem.drop", Immediate::U32, Handler::UNSUPPORTED, 0, 0};
+    table[0x0E] = {"table.copy", Immediate::U32_PAIR, Handler::UNSUPPORTED, 3, 0};
+    table[0x0F] = {"table.grow", Immediate::U32, Handler::UNSUPPORTED, 2, 1};
+    table[0x10] = {"table.size", Immediate::U32, Handler::UNSUPPORTED, 0, 1};
+    table[0x11] = {"table.fill", Immediate::U32, Handler::UNSUPPORTED, 3, 0};
+    return table;
+}
+
+} // namespace detail
+
+/**
+ * Metadata for every single-byte opcode, indexed by the opcode byte. This
+ * is the one place opcode encodings are described: names, immediate
+ * skipping in the interpreter, AOT compiler and decoder, and interpreter
+ * dispatch are all driven by it.
+ */
+inline constexpr std::array<OpcodeInfo, 256> OPCODE_TABLE = detail::makeOpcodeTable();
+
+/**
+ * Metadata for GC (0xFB) and miscellaneous (0xFC) sub-opcodes.
+ */
+inline constexpr std::array<OpcodeInfo, 32> GC_OPCODE_TABLE = detail::makeGcOpcodeTable();
+inline constexpr std::array<OpcodeInfo, 18> MISC_OPCODE_TABLE = detail::makeMiscOpcodeTable();
+
+/**
+ * Metadata for a prefixed instruction, or nullptr if the sub-opcode is
+ * not assigned.
+ */
+constexpr const OpcodeInfo* prefixedOpcodeInfo(uint8_t prefix, uint32_t sub_opcode) {
+    if (prefix == static_cast<uint8_t>(Opcode::GC_PREFIX) && sub_opcode < GC_OPCODE_TABLE.size()) {
+        const OpcodeInfo& info = GC_OPCODE_TABLE[sub_opcode];
+        return info.name ? &info : nullptr;
+    }
+    if (prefix == 0xFC && sub_opcode < MISC_OPCODE_TABLE.size()) {
+        return &MISC_OPCODE_TABLE[sub_opcode];
+    }
+    return nullptr;
+}
+
 /**
  * Instruction utilities.
  */
 std::string opcodeToString(Opcode opcode);
+std::string opcodeToString(uint8_t prefix, uint32_t sub_opcode);
 bool isControlFlowInstruction(Opcode opcode);
 bool isMemoryInstruction(Opcode opcode);
 bool isNumericInstruction(Opcode opcode);
 
+/**
+ * Advance pc past the immediates of the instruction whose opcode byte was
+ * just read, as described by OPCODE_TABLE (prefixed instructions include
+ * their sub-opcode). Unassigned single-byte opcodes have no immediates.
+ * @return false if the immediates run past size or the sub-opcode of a
+ *         prefixed instruction is unassigned; pc is then size
+ */
+bool skipImmediates(uint8_t opcode, const uint8_t* code, size_t size, size_t& pc);
+
 } // namespace wasm
 
 #endif // WASM_INSTRUCTIONS_H
@@ -4,7 +4,15 @@
 #include "module.h"
 #include "stack.h"
 #include "memory.h"
+#include "gc_heap.h"
+#include "fiber.h"
 #include "instructions.h"
+#include "wasm_rt.h"
+#include "perf_map.h"
+#include "perf_counters.h"
+#include "tracer.h"
+#include <exception>
+#include <functional>
 #include <vector>
 #include <memory>
 #include <string>
@@ -13,6 +21,10 @@
 
 namespace wasm {
 
+class NativeModule;
+class TierUpCompiler;
+struct TierUpOptions;
+
 /**
  * Exception thrown during interpretation.
  */
@@ -31,6 +43,16 @@ public:
         : std::runtime_error("Trap: " + message) {}
 };
 
+/**
+ * Exception thrown when an import cannot be linked to another instance's
+ * export: nothing exports it, or the export's kind or type differs.
+ */
+class LinkError : public std::runtime_error {
+public:
+    explicit LinkError(const std::string& message)
+        : std::runtime_error("Link error: " + message) {}
+};
+
 /**
  * WebAssembly interpreter.
  * Executes WebAssembly bytecode using stack-based interpretation.
@@ -47,6 +69,49 @@ public:
      */
     void instantiate(Module&& module);
 
+    /**
+     * Finds the instance whose exports satisfy an import, or returns
+     * nullptr if none does.
+     */
+    using ImportResolver = std::function<Interpreter*(const Import& import)>;
+
+    /**
+     * Instantiate a module whose imports are exports of other instances
+     * (see Store). Imported functions run directly on this instance's
+     * operand stack, memories and tables are shared with their exporter,
+     * and immutable globals are copied at link time. WASI imports are
+     * handled as by instantiate(Module&&). Exporters must outlive this
+     * instance and must not be instantiated again while it is in use.
+     * @throws LinkError if an import does not resolve or does not match
+     */
+    void instantiate(Module&& module, const ImportResolver& resolve);
+
+    /**
+     * Save memory, globals and the table, so restoreSnapshot() can return
+     * the instance to this state without decoding and instantiating again.
+     * Usually taken right after instantiate(). instantiate() discards it.
+     * @throws InterpreterError if a global holds a GC object
+     */
+    void takeSnapshot();
+
+    /**
+     * Return memory, globals and the table to the snapshot, and drop
+     * operands left behind by a trap. Only the memory pages written since
+     * the snapshot or the last restore are copied back. GC objects are all
+     * dropped.
+     * @throws InterpreterError if no snapshot was taken
+     */
+    void restoreSnapshot();
+
+    bool hasSnapshot() const { return snapshot_ != nullptr; }
+
+    /**
+     * Signature of an exported function, e.g. to parse arguments for it.
+     * @throws InterpreterError if there is no such exported function, or its
+     *         index or type is out of range
+     */
+    const FuncType& exportType(const std::string& function_name) const;
+
     /**
      * Call an exported function by name.
      * @param function_name Name of the exported function
@@ -65,6 +130,146 @@ public:
     std::vector<TypedValue> callFunction(uint32_t func_index,
                                          const std::vector<TypedValue>& args = {});
 
+    /**
+     * Call an exported function, writing its results into a caller-owned
+     * vector. Once the vector and the interpreter's stacks have grown to
+     * fit the workload, interpreted calls make no host heap allocations.
+     */
+    void call(const std::string& function_name, const std::vector<TypedValue>& args,
+              std::vector<TypedValue>& results);
+
+    /**
+     * Call a function by index, writing its results into a caller-owned
+     * vector (see call()).
+     */
+    void callFunction(uint32_t func_index, const std::vector<TypedValue>& args,
+                      std::vector<TypedValue>& results);
+
+    /**
+     * Execute the instantiated module's functions from a shared object built
+     * by wasm-aot instead of interpreting them. Memory, globals and the
+     * table stay owned by this interpreter, so call() behaves the same in
+     * both modes. Must be called after instantiate().
+     * @param path Path to the compiled module
+     * @throws AotError if the library was not compiled from this module
+     */
+    void loadNative(const std::string& path);
+
+    /**
+     * Whether any function is dispatched to compiled code.
+     */
+    bool isNative() const { return !native_modules_.empty(); }
+
+    /**
+     * Compile hot functions in the background and switch to them once
+     * built. A function is hot after TierUpOptions::hot_threshold calls.
+     * Must be called after instantiate().
+     */
+    void enableTierUp();
+    void enableTierUp(const TierUpOptions& options);
+
+    /**
+     * Block until background compilation has caught up with the profile,
+     * then install the result.
+     * @return False if tier-up is disabled or compilation failed
+     */
+    bool waitForTierUp();
+
+    /**
+     * Number of times a function has been entered (the call profile).
+     */
+    uint64_t callCount(uint32_t func_index) const {
+        return func_index < call_counts_.size() ? call_counts_[func_index] : 0;
+    }
+
+    /**
+     * Whether a function currently runs as compiled code.
+     */
+    bool isCompiled(uint32_t func_index) const {
+        return func_index < native_invokers_.size() && native_invokers_[func_index] != nullptr;
+    }
+
+    /**
+     * Describe guest functions to Linux perf. Compiled functions are named
+     * in the perf map (or jitdump) as they are loaded; interpreted
+     * functions are entered through per-function trampolines so call
+     * graphs recorded with frame pointers show guest frames. Names come
+     * from the module's name section. Stays on across instantiate().
+     * @return False if the perf output could not be opened
+     */
+    bool enablePerf(PerfFormat format = PerfFormat::MAP);
+
+    /**
+     * Record guest calls, host calls, memory growth and traps into a
+     * tracer. The tracer may be shared with interpreters on other threads.
+     * Stays set across instantiate(); pass nullptr to stop tracing.
+     */
+    void setTracer(std::shared_ptr<Tracer> tracer);
+
+    /**
+     * Collect hardware counters (cycles, instructions, branch and cache
+     * misses) per guest function and per call from the embedder. Counters
+     * cover the thread that created the profile, so call from that thread.
+     * When perf_event_open is unavailable the profile still counts calls.
+     * Stays set across instantiate(); pass nullptr to stop.
+     */
+    void setCounterProfile(std::shared_ptr<CounterProfile> profile);
+
+    /**
+     * Count linear memory accesses per page into a profile (heatmap).
+     * Only interpreted accesses are counted; functions running as compiled
+     * code bypass the profile. Stays set across instantiate(); pass
+     * nullptr to stop profiling.
+     */
+    void setMemoryProfile(std::shared_ptr<MemoryProfile> profile);
+
+    /**
+     * Backend for the linear memory created by the next instantiate().
+     * Defaults to defaultMemoryBackend().
+     */
+    void setMemoryBackend(MemoryBackend backend) { memory_backend_ = backend; }
+
+    /**
+     * Bounds check for the linear memory created by the next instantiate().
+     * Defaults to EXPLICIT; see Memory::boundsCheck() for the fallbacks.
+     */
+    void setBoundsCheck(BoundsCheck bounds) { bounds_check_ = bounds; }
+
+    /**
+     * Nursery size and collection thresholds of the GC heap created by the
+     * next instantiate() of a module that declares struct or array types.
+     */
+    void setGcOptions(const GcOptions& options) { gc_options_ = options; }
+
+    /**
+     * GC heap of the instance, or nullptr if the module declares no struct
+     * or array types. References returned to the host by call() are not
+     * roots: they are only valid until the next call.
+     */
+    const GcHeap* gcHeap() const { return gc_heap_.get(); }
+    GcHeap* gcHeap() { return gc_heap_.get(); }
+
+    /**
+     * Native stack reserved for each continuation created by cont.new
+     * (stack switching proposal). Only the pages a continuation touches are
+     * committed, and stacks are reused once their continuation finishes.
+     * Applies to continuations created after the call.
+     */
+    void setContinuationStackSize(size_t bytes) { continuation_stack_bytes_ = bytes; }
+
+    /**
+     * Continuations created and not yet finished. Suspended continuations
+     * the guest drops stay allocated until the next instantiate() or
+     * restoreSnapshot().
+     */
+    size_t liveContinuations() const { return continuations_.size() - free_continuations_.size(); }
+
+    /**
+     * Linear memory of the instance, or nullptr if the module has none.
+     */
+    const Memory* memory() const { return memory_.get(); }
+    Memory* memory() { return memory_.get(); }
+
     /**
      * Get current state for debugging.
      */
@@ -74,9 +279,34 @@ private:
     std::unique_ptr<Module> module_;
     Stack stack_;
     CallStack call_stack_;
-    std::unique_ptr<Memory> memory_;
+    std::shared_ptr<Memory> memory_;    // Shared with importers and the exporter
+    MemoryBackend memory_backend_ = defaultMemoryBackend();
+    BoundsCheck bounds_check_ = BoundsCheck::EXPLICIT;
+    std::unique_ptr<GcHeap> gc_heap_;
+    GcOptions gc_options_;
     std::vector<TypedValue> globals_;
-    std::vector<TypedValue> locals_;
+    std::vector<TypedValue> locals_;    // Locals of all active frames, innermost last
+    size_t locals_base_;                // First local of the running function
+
+    // Table 0, materialized from element segments at instantiation
+    static constexpr uint32_t NULL_FUNCTION_INDEX = UINT32_MAX;
+    std::vector<uint32_t> table_;
+
+    // Imports linked to other instances' exports
+    struct LinkedFunction {
+        Interpreter* instance;      // Instance defining the function, or nullptr
+        uint32_t func_index;        // Index in that instance
+    };
+    std::vector<LinkedFunction> linked_functions_;  // By imported function index
+    Interpreter* table_owner_ = nullptr;            // Instance whose table 0 was imported
+
+    // Instance state saved by takeSnapshot()
+    struct Snapshot {
+        std::unique_ptr<Memory> memory;
+        std::vector<TypedValue> globals;
+        std::vector<uint32_t> table;
+    };
+    std::unique_ptr<Snapshot> snapshot_;
 
     // Execution state
     const uint8_t* code_;           // Current function bytecode
@@ -84,14 +314,21 @@ private:
     size_t pc_;                     // Program counter
 
     // Module initialization
+    void linkImports(const ImportResolver& resolve);
+    void linkImport(const Import& import, Interpreter& exporter);
+    bool isGlobalMutable(uint32_t index) const;
     void initializeMemory();
     void initializeGlobals();
     void initializeTables();
     void initializeElements();
     void initializeData();
+    uint32_t evaluateOffsetExpression(ArrayView<uint8_t> expr) const;
 
     // Execution
     void execute(uint32_t func_index);
+    void dispatch(uint32_t func_index);
+    void callLinked(Interpreter& callee, uint32_t func_index);
+    void executeBody(uint32_t func_index);
     void executeInstruction();
     void executeBlock(ValueType block_type);
     void executeLoop(ValueType block_type);
@@ -102,20 +339,133 @@ private:
         size_t target_pc;           // Jump target
         size_t stack_height;        // Stack height at label
         bool is_loop;               // Loop vs block/if
-        size_t arity;               // Number of result values (0 or 1 in MVP)
+        size_t arity;               // Values a branch carries: results, or a loop's parameters
+    };
+    std::vector<Label> labels_;         // Labels of all active frames, innermost last
+    size_t labels_base_;                // First label of the running function
+
+    // A function's frame on the locals and label stacks. Entering makes the
+    // tops of both stacks the new bases; leaving, normally or by a trap,
+    // pops the frame and restores the caller's bases.
+    class Frame {
+    public:
+        explicit Frame(Interpreter& owner)
+            : owner_(owner), locals_base_(owner.locals_base_), labels_base_(owner.labels_base_),
+              function_(owner.function_) {
+            owner_.locals_base_ = owner_.locals_.size();
+            owner_.labels_base_ = owner_.labels_.size();
+        }
+
+        ~Frame() {
+            owner_.locals_.resize(owner_.locals_base_);
+            owner_.labels_.resize(owner_.labels_base_);
+            owner_.locals_base_ = locals_base_;
+            owner_.labels_base_ = labels_base_;
+            owner_.function_ = function_;
+        }
+
+        Frame(const Frame&) = delete;
+        Frame& operator=(const Frame&) = delete;
+
+    private:
+        Interpreter& owner_;
+        size_t locals_base_;            // Caller's bases
+        size_t labels_base_;
+        size_t function_;               // Caller's local function index
     };
-    std::vector<Label> labels_;
 
     void pushLabel(size_t target_pc, size_t stack_height, bool is_loop, size_t arity = 0);
     void popLabel();
     void branch(uint32_t depth);
     void branchIf(uint32_t depth);
-    void branchTable(const std::vector<uint32_t>& targets, uint32_t default_target);
+
+    // Pre-resolved br_table dispatch
+    // The first br_table a function executes resolves every site in it into
+    // a dense table of targets. A site's ordinal is found from a bitmap of
+    // site offsets with a running count per word, so execution is a
+    // popcount, an index, a clamp and a jump.
+    struct BranchTarget {
+        size_t target_pc;           // Resolved jump target
+        uint32_t depth;             // Label depth (locates the runtime stack height)
+        uint32_t labels_to_pop;     // Labels removed from the label stack
+        size_t arity;               // Result values preserved across the unwind
+        bool is_return;             // Branch to the function body (acts as return)
+        bool is_valid;              // False if the depth exceeds the enclosing labels
+    };
+    struct BranchTable {
+        std::vector<BranchTarget> targets;  // Case targets followed by the default target
+    };
+    struct FunctionBranches {
+        std::vector<uint64_t> site_bits;    // One bit per body byte: br_table immediates start here
+        std::vector<uint32_t> site_ranks;   // Sites before each word of site_bits
+        std::vector<BranchTable> tables;    // By site ordinal, in code order
+    };
+    std::vector<std::unique_ptr<FunctionBranches>> function_branches_;  // By local function index
+    size_t function_ = 0;                   // Local index of the running function
+
+    const BranchTable& branchTable();
+    std::unique_ptr<FunctionBranches> resolveBranchTables() const;
+    void branchTo(const BranchTarget& target);
 
     // Control flow helpers
     size_t findMatchingEnd(size_t start_pc) const;
     size_t findMatchingElseAndEnd(size_t start_pc, size_t& else_pc) const;
-    void skipInstructionOperands(uint8_t opcode, size_t& pc) const;
+
+    // Operand counts of a block type; a type index may give several of each
+    struct BlockSignature {
+        size_t params;
+        size_t results;
+    };
+    BlockSignature blockSignature(size_t& pc) const;     // Decode the block type at pc and skip it
+    BlockSignature readBlockType();
+
+    // Compiled module support
+    // Replaced modules stay loaded: their code may still be on the stack
+    std::vector<std::unique_ptr<NativeModule>> native_modules_;
+    std::vector<wasm_rt_invoke_fn> native_invokers_;    // Per function index
+    wasm_rt_instance native_instance_;
+
+    // Call profile and background compilation of hot functions
+    std::vector<uint64_t> call_counts_;
+    std::unique_ptr<TierUpCompiler> tier_up_;
+
+    void installNative(std::unique_ptr<NativeModule> native);
+    void executeNative(uint32_t func_index);
+    void bindNativeInstance();
+    void profileCall(uint32_t func_index);
+    static void nativeTrap(wasm_rt_instance* inst, wasm_rt_trap_kind kind, const char* message);
+    static int32_t nativeMemoryGrow(wasm_rt_instance* inst, uint32_t delta_pages);
+    static void nativeCallHost(wasm_rt_instance* inst, uint32_t func_index,
+                               const wasm_rt_value* args, wasm_rt_value* results);
+
+    // Linux perf integration
+    bool perf_enabled_;
+    std::unique_ptr<PerfTrampolines> perf_trampolines_;
+    std::exception_ptr perf_exception_;     // Carried across a trampoline frame
+
+    std::string displayName(uint32_t func_index) const;     // Name section, export, or func[i]
+    std::string perfName(uint32_t func_index) const;
+    void registerPerfCode(const NativeModule& native) const;
+    void createPerfTrampolines();
+    static void perfEntry(void* context, uint32_t func_index);
+
+    // Hardware performance counters
+    std::shared_ptr<CounterProfile> counter_profile_;
+
+    void nameCounterProfile();
+
+    // Memory access heatmap
+    std::shared_ptr<MemoryProfile> memory_profile_;
+
+    // Timeline tracing
+    std::shared_ptr<Tracer> tracer_;
+    std::vector<uint32_t> trace_names_;     // Interned name per function index
+    uint32_t trace_memory_grow_;            // Interned "memory.grow"
+    uint32_t trace_depth_;
+
+    void internTraceNames();
+    void traceTrap(const std::exception& error);
+    int32_t growMemory(uint32_t delta_pages);
 
     // WASI support
     std::unordered_map<std::string, bool> wasi_imports_;
@@ -126,9 +476,87 @@ private:
     void executeParametric(Opcode opcode);
     void executeVariable(Opcode opcode);
     void executeMemory(Opcode opcode);
+    template<BoundsCheck B>
+    void executeMemoryAccess(Opcode opcode, uint32_t offset);
+    template<BoundsCheck B, typename T>
+    T loadMemory(uint32_t offset);
+    template<BoundsCheck B, typename T>
+    void storeMemory(uint32_t offset, T value);
     void executeNumericConst(Opcode opcode);
     void executeNumeric(Opcode opcode);
     void executeConversion(Opcode opcode);
+    void executeReference(Opcode opcode);
+    void executeGc();
+
+    // GC proposal helpers
+    void visitGcRoots(const GcHeap::RootVisitor& visit);
+    GcHeap& gcHeapFor(uint32_t type_index, CompositeType::Kind kind);
+    uint64_t popObject();
+    bool refMatches(uint64_t ref, int64_t heap_type) const;
+    void pushField(const FieldType& field, uint64_t bits, bool sign_extend);
+    ValueType refType(int64_t heap_type) const;
+
+    // Stack switching
+    // Interpreter frames live on the native stack (execute() recurses), so
+    // each continuation runs on a Fiber of its own. The members describing
+    // the running frames are its ExecutionState; a switch exchanges them
+    // with the saved state of the next context, which swaps vector buffers
+    // rather than copying frames, then switches fibers.
+    struct ExecutionState {
+        Stack stack;
+        std::vector<TypedValue> locals;
+        size_t locals_base = 0;
+        std::vector<Label> labels;
+        size_t labels_base = 0;
+        const uint8_t* code = nullptr;
+        size_t code_size = 0;
+        size_t pc = 0;
+        size_t function = 0;
+    };
+    struct Context {
+        Fiber fiber;
+        ExecutionState saved;               // Frames while another context runs
+        Context* parent = nullptr;          // Resumer, while this context runs or is resumed
+        const uint8_t* handlers = nullptr;  // Handler clauses of the parent's resume
+        uint32_t handler_count = 0;
+        // Continuations only
+        Interpreter* owner = nullptr;
+        uint32_t func_index = 0;
+        uint32_t slot = 0;                  // Index in continuations_
+        uint32_t generation = 0;            // Bumped whenever a reference is consumed
+        bool suspended = false;             // The current reference may resume it
+        Context* chain_top = nullptr;       // Outermost context suspended along with it
+
+        Context() = default;
+        explicit Context(size_t stack_bytes) : fiber(stack_bytes) {}
+    };
+    // How a continuation last handed control back to its resumer
+    struct Transfer {
+        enum class Kind { RETURNED, SUSPENDED, TRAPPED };
+        Kind kind = Kind::RETURNED;
+        Context* from = nullptr;            // Continuation that suspended, returned or trapped
+        uint32_t tag = 0;
+        std::exception_ptr error;
+    };
+    Context root_context_;                  // The host thread's stack
+    Context* current_;
+    std::vector<std::unique_ptr<Context>> continuations_;
+    std::vector<uint32_t> free_continuations_;
+    size_t continuation_stack_bytes_;
+    Transfer transfer_;
+
+    void executeContinuation(Opcode opcode);
+    void swapState(ExecutionState& state);
+    void switchContext(Context& next);
+    Context& newContinuation(uint32_t func_index);
+    Context& takeContinuation(const TypedValue& ref);
+    uint64_t continuationRef(const Context& continuation) const;
+    void releaseContinuation(Context& continuation);
+    void releaseContinuations();
+    bool findHandler(const Context& context, uint32_t tag, uint32_t& label) const;
+    const FuncType& contFuncType(uint32_t type_index) const;
+    const FuncType& tagType(uint32_t tag) const;
+    static void runContinuation(void* arg);
 
     // Variable access
     void setLocal(uint32_t index, const TypedValue& value);
@@ -149,7 +577,8 @@ private:
     double readF64();
 
     // Validation
-    void validateFunctionCall(uint32_t func_index) const;
+    void validateFunctionCall(uint32_t func_index, const std::vector<TypedValue>& args) const;
+    uint32_t exportedFunction(const std::string& function_name) const;
     void validateMemoryAccess() const;
     void checkStackUnderflow(size_t required) const;
 };
@@ -0,0 +1,75 @@
+#ifndef WASM_LEB128_H
+#define WASM_LEB128_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+namespace wasm {
+
+/**
+ * LEB128 decoding eight bytes at a time. Callers that have at least
+ * LEB128_WORD readable bytes load them with loadLeb128Word, find the
+ * value's length from the continuation bits with one count-trailing-zeros
+ * and gather its 7-bit groups without a per-byte loop or bounds check.
+ * Values longer than eight bytes (only possible for 64-bit values, or for
+ * padded encodings) take the caller's byte-at-a-time path.
+ */
+constexpr size_t LEB128_WORD = 8;
+
+inline uint64_t loadLeb128Word(const uint8_t* data) {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));     // Little-endian hosts only, as elsewhere
+    return word;
+}
+
+/**
+ * Bytes in the LEB128 value starting at the low byte of word, or 0 if
+ * all eight bytes have the continuation bit set.
+ */
+inline unsigned leb128Length(uint64_t word) {
+    uint64_t last = ~word & 0x8080808080808080ull;
+    if (last == 0) {
+        return 0;
+    }
+    return static_cast<unsigned>(__builtin_ctzll(last) >> 3) + 1;
+}
+
+/**
+ * The 7-bit groups of the first length (1-8) bytes of word, concatenated:
+ * the value of a length-byte unsigned LEB128.
+ */
+inline uint64_t leb128Payload(uint64_t word, unsigned length) {
+    if (length < 8) {
+        word &= (uint64_t(1) << (8 * length)) - 1;
+    }
+#if defined(__BMI2__)
+    return _pext_u64(word, 0x7F7F7F7F7F7F7F7Full);
+#else
+    // Close the gaps between groups in three steps: bytes into 14-bit
+    // pairs, pairs into 28-bit quads, quads into the 56-bit result
+    word &= 0x7F7F7F7F7F7F7F7Full;
+    word = (word & 0x007F007F007F007Full) | ((word & 0x7F007F007F007F00ull) >> 1);
+    word = (word & 0x00003FFF00003FFFull) | ((word & 0x3FFF00003FFF0000ull) >> 2);
+    return (word & 0x000000000FFFFFFFull) | ((word & 0x0FFFFFFF00000000ull) >> 4);
+#endif
+}
+
+/**
+ * Sign-extend the payload of a length-byte signed LEB128.
+ */
+inline int64_t leb128Signed(uint64_t payload, unsigned length) {
+    unsigned bits = 7 * length;
+    if (bits < 64 && (payload >> (bits - 1)) & 1) {
+        payload |= ~uint64_t(0) << bits;
+    }
+    return static_cast<int64_t>(payload);
+}
+
+} // namespace wasm
+
+#endif // WASM_LEB128_H
@@ -0,0 +1,52 @@
+#ifndef WASM_MAPPED_FILE_H
+#define WASM_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace wasm {
+
+/**
+ * A module file mapped read-only into memory. The descriptor stays open so
+ * linear memory can map data segments from the same file copy-on-write;
+ * every mapping of one file shares the page cache until it is written.
+ * The file must not be modified or truncated while it is mapped.
+ */
+class MappedFile {
+public:
+    /**
+     * Map a whole file.
+     * @return The mapping, or nullptr if the file cannot be opened or
+     *         mapped (e.g. it is empty, or mmap is not available)
+     */
+    static std::shared_ptr<const MappedFile> open(const std::string& path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    int fd() const { return fd_; }
+
+    /**
+     * Whether [bytes, bytes + count) lies inside the mapping.
+     */
+    bool contains(const uint8_t* bytes, size_t count) const {
+        return bytes >= data_ && bytes <= data_ + size_ && count <= static_cast<size_t>(data_ + size_ - bytes);
+    }
+
+private:
+    MappedFile(int fd, const uint8_t* data, size_t size) : fd_(fd), data_(data), size_(size) {}
+
+    int fd_;
+    const uint8_t* data_;
+    size_t size_;
+};
+
+} // namespace wasm
+
+#endif // WASM_MAPPED_FILE_H
@@ -2,8 +2,14 @@
 #define WASM_MEMORY_H
 
 #include "types.h"
+#include "memory_profile.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <memory>
 #include <vector>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <stdexcept>
 
 namespace wasm {
@@ -17,6 +23,38 @@ public:
         : std::runtime_error("Memory error: " + message) {}
 };
 
+/**
+ * Where linear memory bytes live.
+ */
+enum class MemoryBackend : uint8_t {
+    HEAP,   // std::vector: zero-filled when created or grown, moves on grow
+    LAZY,   // Reserved address space: the kernel supplies zero pages on first
+            // touch, so cost and RSS follow the pages the guest uses
+    HUGE_PAGES  // LAZY on 2 MiB pages to cut TLB misses: hugetlbfs when its pool
+                // can hold the maximum size, else transparent huge pages
+};
+
+/**
+ * LAZY where mmap is available, HEAP otherwise.
+ */
+MemoryBackend defaultMemoryBackend();
+
+const char* memoryBackendName(MemoryBackend backend);
+
+/**
+ * How guest loads and stores are kept inside linear memory.
+ */
+enum class BoundsCheck : uint8_t {
+    EXPLICIT,   // Compare each effective address with the size and trap
+    MASKED,     // AND with size - 1 (power-of-two sizes only): no branch and
+                // no speculation past the end, but out-of-bounds accesses
+                // wrap into memory instead of trapping
+    GUARD       // No check: LAZY memory reserves every 33-bit effective
+                // address, and faults past the end trap via SIGSEGV
+};
+
+const char* boundsCheckName(BoundsCheck bounds);
+
 /**
  * Linear memory implementation for WebAssembly.
  * Memory is organized in pages of 64KB each.
@@ -25,10 +63,44 @@ class Memory {
 public:
     static constexpr uint32_t PAGE_SIZE = 65536;  // 64KB
     static constexpr uint32_t MAX_PAGES = 65536;  // 4GB maximum
+    static constexpr size_t HUGE_PAGE_SIZE = 2u << 20;
+    static constexpr uint32_t DIRTY_PAGE_SIZE = 4096;
 
     Memory() = default;
-    explicit Memory(const Limits& limits);
-    ~Memory() = default;
+
+    /**
+     * LAZY and HUGE_PAGES memories reserve address space for their maximum
+     * size (4 GiB without a maximum), so data() stays valid across grow().
+     * HUGE_PAGES memory is 2 MiB aligned and grows in 2 MiB steps. If the
+     * reservation fails the memory falls back to HEAP.
+     * A GUARD bounds check needs LAZY memory and reserves 8 GiB.
+     */
+    explicit Memory(const Limits& limits, MemoryBackend backend = defaultMemoryBackend(),
+                    BoundsCheck bounds = BoundsCheck::EXPLICIT);
+    ~Memory();
+
+    /**
+     * Copies have the same backend, size and contents. Copying a LAZY
+     * memory skips all-zero pages, so untouched pages stay unpopulated.
+     */
+    Memory(const Memory& other);
+    Memory& operator=(const Memory& other);
+
+    MemoryBackend backend() const { return backend_; }
+
+    /**
+     * For HUGE_PAGES memory: "hugetlbfs", "transparent", or "none" if the
+     * kernel refused transparent huge pages. "" for other backends.
+     */
+    const char* hugePageSource() const { return huge_page_source_; }
+
+    /**
+     * Bounds check in effect for loadAt() and storeAt(). Falls back to
+     * EXPLICIT while a MASKED memory's size is not a power of two, and for
+     * GUARD where guard pages are unavailable (not LAZY, not Linux, or no
+     * address space).
+     */
+    BoundsCheck boundsCheck() const { return bounds_; }
 
     // Load operations (read from memory)
     int32_t loadI32(uint32_t address) const;
@@ -55,6 +127,19 @@ public:
     void storeU32(uint32_t address, uint32_t value);
     void storeU64(uint32_t address, uint64_t value);
 
+    /**
+     * Load or store at base + offset under policy B, which must be
+     * boundsCheck(). Out-of-bounds accesses throw MemoryError, except under
+     * MASKED, where they are redirected into memory. EXPLICIT and MASKED
+     * are inlined into the caller; GUARD stays in memory.cpp, the only
+     * translation unit built to unwind from a faulting access.
+     */
+    template<BoundsCheck B, typename T>
+    T loadAt(uint32_t base, uint32_t offset) const;
+
+    template<BoundsCheck B, typename T>
+    void storeAt(uint32_t base, uint32_t offset, T value);
+
     // Memory operations
     /**
      * Grow memory by delta pages.
@@ -73,26 +158,111 @@ public:
      */
     uint32_t sizeInBytes() const { return current_pages_ * PAGE_SIZE; }
 
+    /**
+     * Limits the memory was created with; max bounds grow().
+     */
+    const Limits& limits() const { return limits_; }
+
     /**
      * Initialize memory region with data.
      * Used during module instantiation for data segments.
      */
-    void initialize(uint32_t offset, const std::vector<uint8_t>& data);
+    void initialize(uint32_t offset, const uint8_t* data, size_t size);
+
+    /**
+     * Like initialize(), for size bytes at file_offset in a mapped module
+     * file. On LAZY memory, whole OS pages whose memory and file offsets
+     * line up are mapped copy-on-write from the file instead of copied, so
+     * instances share them until written. The rest is copied.
+     * @return Bytes mapped rather than copied
+     */
+    size_t initializeMapped(uint32_t offset, std::shared_ptr<const MappedFile> file, size_t file_offset,
+                            size_t size);
 
     /**
-     * Get raw pointer to memory data (for debugging).
+     * Get raw pointer to memory data.
+     * The pointer is invalidated by grow() unless the backend is LAZY.
      */
-    const uint8_t* data() const { return data_.data(); }
+    const uint8_t* data() const { return data_; }
+    uint8_t* data() { return data_; }
 
     /**
      * Clear all memory.
      */
     void clear();
 
+    /**
+     * Record which 4 KiB pages are written from now on, so resetTo() only
+     * rewrites those. Stores and initialize() mark pages; code that writes
+     * through data() must call markDirty() itself. Copies start untracked.
+     */
+    void trackDirtyPages(bool enable);
+    bool tracksDirtyPages() const { return track_dirty_; }
+
+    /**
+     * Mark [offset, offset + size) as written. No-op without tracking.
+     */
+    void markDirty(uint32_t offset, size_t size);
+
+    /**
+     * Number of 4 KiB pages written since tracking began or the last reset.
+     */
+    size_t dirtyPageCount() const;
+
+    /**
+     * Return to the contents and size of pristine, a copy of this memory
+     * taken when tracking began or at the last reset. Only dirty pages are
+     * rewritten and growth since then is undone, so the cost follows what
+     * was written. Without tracking this is a full assignment.
+     * @return Number of 4 KiB pages rewritten
+     */
+    size_t resetTo(const Memory& pristine);
+
+    /**
+     * Count accesses per page into a profile, or stop with nullptr.
+     * The profile must outlive its attachment. Accesses made through
+     * data() (compiled code) are not counted.
+     */
+    void setProfile(MemoryProfile* profile);
+
 private:
-    std::vector<uint8_t> data_;
+    MemoryBackend backend_ = MemoryBackend::HEAP;
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;               // Accessible bytes
+    std::vector<uint8_t> heap_;     // HEAP storage
+    size_t reserved_ = 0;           // LAZY: bytes of address space reserved
+    size_t committed_ = 0;          // LAZY: mprotected bytes, size_ rounded up to a huge page
+    const char* huge_page_source_ = "";
+    BoundsCheck requested_bounds_ = BoundsCheck::EXPLICIT;
+    BoundsCheck bounds_ = BoundsCheck::EXPLICIT;
+    uint64_t mask_ = 0;             // MASKED: size_ - 1
+    bool guarded_ = false;          // Reservation registered as guard pages
     Limits limits_;
-    uint32_t current_pages_;
+    uint32_t current_pages_ = 0;
+    MemoryProfile* profile_ = nullptr;
+    bool track_dirty_ = false;
+    std::vector<uint64_t> dirty_;   // One bit per DIRTY_PAGE_SIZE page
+
+    // Range mapped from a module file by initializeMapped()
+    struct FileRegion {
+        size_t offset;
+        size_t size;
+        std::shared_ptr<const MappedFile> file;
+        size_t file_offset;
+    };
+    std::vector<FileRegion> file_regions_;  // May include ranges since overwritten
+
+    void reserve();
+    void updateBoundsCheck();
+    bool reserveHugePages(size_t max_bytes);
+    bool commit(size_t bytes);
+    void copyContents(const Memory& other);
+    bool mapRegion(const FileRegion& region);
+    bool fileBacked(size_t offset, size_t size) const;
+    void discard(size_t offset, size_t size);
+    void resizeDirty();
+    void setDirty(uint32_t offset, size_t size);
+    void restorePages(const Memory& pristine, size_t first, size_t last);
 
     // Bounds checking
     void checkAddress(uint32_t address, size_t size) const;
@@ -103,8 +273,60 @@ private:
 
     template<typename T>
     void store(uint32_t address, T value);
+
+    // GUARD accesses, which may fault on guard pages
+    template<typename T>
+    T loadGuarded(uint64_t address) const;
+
+    template<typename T>
+    void storeGuarded(uint64_t address, T value);
 };
 
+template<BoundsCheck B, typename T>
+inline T Memory::loadAt(uint32_t base, uint32_t offset) const {
+    uint64_t address = static_cast<uint64_t>(base) + offset;
+    if constexpr (B == BoundsCheck::GUARD) {
+        return loadGuarded<T>(address);
+    } else {
+        if constexpr (B == BoundsCheck::EXPLICIT) {
+            if (address + sizeof(T) > size_) {
+                throw MemoryError("Memory access out of bounds");
+            }
+        } else {
+            address = std::min<uint64_t>(address & mask_, size_ - sizeof(T));
+        }
+        T value;
+        std::memcpy(&value, data_ + address, sizeof(T));
+        if (profile_) {
+            profile_->recordRead(static_cast<uint32_t>(address), sizeof(T));
+        }
+        return value;
+    }
+}
+
+template<BoundsCheck B, typename T>
+inline void Memory::storeAt(uint32_t base, uint32_t offset, T value) {
+    uint64_t address = static_cast<uint64_t>(base) + offset;
+    if constexpr (B == BoundsCheck::GUARD) {
+        storeGuarded<T>(address, value);
+    } else {
+        if constexpr (B == BoundsCheck::EXPLICIT) {
+            if (address + sizeof(T) > size_) {
+                throw MemoryError("Memory access out of bounds");
+            }
+        } else {
+            address = std::min<uint64_t>(address & mask_, size_ - sizeof(T));
+        }
+        std::memcpy(data_ + address, &value, sizeof(T));
+        if (profile_) {
+            profile_->recordWrite(static_cast<uint32_t>(address), sizeof(T));
+        }
+        if (track_dirty_) {
+            setDirty(static_cast<uint32_t>(address), sizeof(T));
+        }
+    }
+}
+
 } // namespace wasm
 
 #endif // WASM_MEMORY_H
@@ -0,0 +1,139 @@
+#ifndef WASM_MEMORY_PROFILE_H
+#define WASM_MEMORY_PROFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace wasm {
+
+/**
+ * Output format for MemoryProfile::write().
+ */
+enum class HeatmapFormat {
+    CSV,        // One row per page: page,reads,writes
+    PPM         // Image, 64 pages per row; red = writes, green = reads (log scale)
+};
+
+/**
+ * Per-page access counts for one linear memory.
+ * Attached to a Memory, it counts loads and stores per 64KB page and
+ * tracks which pages have been touched. With a sample rate of N only every
+ * Nth access is recorded and counts are scaled by N, so totals stay
+ * comparable while the cost drops.
+ *
+ * Touched pages are counted per window: startWindow() begins a new one
+ * (for example per request), and the peak is the largest number of pages
+ * any window touched. Comparing the peak with the memory size shows how
+ * much of an instance's memory is actually used.
+ */
+class MemoryProfile {
+public:
+    static constexpr uint32_t PAGE_SHIFT = 16;
+
+    explicit MemoryProfile(uint32_t sample_rate = 1);
+
+    void recordRead(uint32_t address, uint32_t size) {
+        if (sample()) {
+            count(reads_, address, size);
+        }
+    }
+
+    void recordWrite(uint32_t address, uint32_t size) {
+        if (sample()) {
+            count(writes_, address, size);
+        }
+    }
+
+    /**
+     * Record a bulk write (data segment, fill, copy). Every page in the
+     * range counts once, unsampled.
+     */
+    void recordBulkWrite(uint32_t address, size_t size);
+
+    /**
+     * Track a memory of the given size. Called on attach and on grow.
+     */
+    void resize(uint32_t pages);
+
+    uint32_t pageCount() const { return static_cast<uint32_t>(reads_.size()); }
+    uint64_t reads(uint32_t page) const { return page < reads_.size() ? reads_[page] : 0; }
+    uint64_t writes(uint32_t page) const { return page < writes_.size() ? writes_[page] : 0; }
+    uint64_t totalReads() const;
+    uint64_t totalWrites() const;
+    uint32_t sampleRate() const { return sample_rate_; }
+
+    /**
+     * Pages touched in the current window.
+     */
+    uint32_t touchedPages() const { return live_touched_; }
+
+    /**
+     * Most pages touched in any window.
+     */
+    uint32_t peakTouchedPages() const { return peak_touched_; }
+
+    /**
+     * Start a new touched-page window. Access counts are kept.
+     */
+    void startWindow();
+
+    /**
+     * Clear all counts, windows and the peak.
+     */
+    void reset();
+
+    void write(std::ostream& out, HeatmapFormat format) const;
+
+    /**
+     * @return False if the file could not be written
+     */
+    bool writeFile(const std::string& path, HeatmapFormat format) const;
+
+private:
+    uint32_t sample_rate_;
+    uint32_t countdown_;
+    std::vector<uint64_t> reads_;
+    std::vector<uint64_t> writes_;
+    std::vector<uint8_t> touched_;      // Per page, current window
+    uint32_t live_touched_;
+    uint32_t peak_touched_;
+
+    bool sample() {
+        if (--countdown_ != 0) {
+            return false;
+        }
+        countdown_ = sample_rate_;
+        return true;
+    }
+
+    // Callers have bounds checked the access, so its pages exist
+    void count(std::vector<uint64_t>& counters, uint32_t address, uint32_t size) {
+        uint32_t first = address >> PAGE_SHIFT;
+        uint32_t last = (address + size - 1) >> PAGE_SHIFT;
+        counters[first] += sample_rate_;
+        touch(first);
+        if (last != first) {
+            counters[last] += sample_rate_;
+            touch(last);
+        }
+    }
+
+    void touch(uint32_t page) {
+        if (!touched_[page]) {
+            touched_[page] = 1;
+            if (++live_touched_ > peak_touched_) {
+                peak_touched_ = live_touched_;
+            }
+        }
+    }
+
+    void writeCsv(std::ostream& out) const;
+    void writePpm(std::ostream& out) const;
+};
+
+} // namespace wasm
+
+#endif // WASM_MEMORY_PROFILE_H
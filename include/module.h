@@ -2,22 +2,111 @@
 #define WASM_MODULE_H
 
 #include "types.h"
+#include "arena.h"
+#include "mapped_file.h"
 #include <vector>
 #include <string>
+#include <string_view>
 #include <cstdint>
 #include <memory>
+#include <unordered_map>
 
 namespace wasm {
 
 /**
  * Represents a WebAssembly function with its locals and bytecode.
+ * This is a lightweight view into the module's FunctionTable; the locals
+ * and body live in the module arena.
  */
 struct Function {
     uint32_t type_index;                    // Index into type section
-    std::vector<ValueType> locals;          // Local variables (excluding parameters)
-    std::vector<uint8_t> body;              // Function bytecode
+    ArrayView<ValueType> locals;            // Local variables (excluding parameters)
+    ArrayView<uint8_t> body;                // Function bytecode
 
     Function() : type_index(0) {}
+    Function(uint32_t type, ArrayView<ValueType> l, ArrayView<uint8_t> b)
+        : type_index(type), locals(l), body(b) {}
+};
+
+/**
+ * Struct-of-arrays storage for the functions defined by a module.
+ * Bodies are stored back to back in one arena block, so walking the code
+ * section touches contiguous memory; per-function metadata lives in
+ * parallel columns. Indexing yields a Function view.
+ */
+class FunctionTable {
+public:
+    class const_iterator {
+    public:
+        const_iterator(const FunctionTable* table, size_t index) : table_(table), index_(index) {}
+        Function operator*() const { return (*table_)[index_]; }
+        const_iterator& operator++() { ++index_; return *this; }
+        bool operator!=(const const_iterator& other) const { return index_ != other.index_; }
+        bool operator==(const const_iterator& other) const { return index_ == other.index_; }
+
+    private:
+        const FunctionTable* table_;
+        size_t index_;
+    };
+
+    size_t size() const { return type_indices_.size(); }
+    bool empty() const { return type_indices_.empty(); }
+    void reserve(size_t count);
+
+    /**
+     * Append a function. The locals and body must already live in the
+     * module arena.
+     */
+    void add(uint32_t type_index, ArrayView<ValueType> locals, ArrayView<uint8_t> body);
+
+    Function operator[](size_t index) const {
+        return Function(type_indices_[index],
+                        ArrayView<ValueType>(locals_[index], local_counts_[index]),
+                        ArrayView<uint8_t>(bodies_[index], body_sizes_[index]));
+    }
+
+    uint32_t typeIndex(size_t index) const { return type_indices_[index]; }
+    ArrayView<uint8_t> body(size_t index) const {
+        return ArrayView<uint8_t>(bodies_[index], body_sizes_[index]);
+    }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+private:
+    std::vector<uint32_t> type_indices_;
+    std::vector<const uint8_t*> bodies_;
+    std::vector<uint32_t> body_sizes_;
+    std::vector<const ValueType*> locals_;
+    std::vector<uint32_t> local_counts_;
+};
+
+/**
+ * A field of a GC struct type, or the element type of an array type.
+ * Packed fields (i8, i16) are stored in packed_size bytes and read as i32.
+ */
+struct FieldType {
+    ValueType type;                         // I32 for packed fields
+    uint8_t packed_size;                    // 1 (i8) or 2 (i16), 0 when not packed
+    bool is_mutable;
+
+    FieldType() : type(ValueType::I32), packed_size(0), is_mutable(false) {}
+    FieldType(ValueType t, uint8_t packed, bool mut) : type(t), packed_size(packed), is_mutable(mut) {}
+};
+
+/**
+ * Kind and fields of a type section entry (GC and stack switching
+ * proposals). Function types keep their signature in Module::types at the
+ * same index.
+ */
+struct CompositeType {
+    static constexpr uint32_t NO_SUPERTYPE = UINT32_MAX;
+
+    enum class Kind : uint8_t { FUNC, STRUCT, ARRAY, CONT };
+    Kind kind = Kind::FUNC;
+    std::vector<FieldType> fields;          // Struct fields; the element type of an array
+    uint32_t supertype = NO_SUPERTYPE;      // Declared supertype index
+    uint32_t func_type = 0;                 // Continuation type: its function type index
 };
 
 /**
@@ -36,11 +125,11 @@ struct MemoryType {
 struct Global {
     ValueType type;                         // Type of the global
     bool is_mutable;                        // Mutability flag
-    std::vector<uint8_t> init_expr;         // Initialization expression bytecode
+    ArrayView<uint8_t> init_expr;           // Initialization expression bytecode
 
     Global() : type(ValueType::I32), is_mutable(false) {}
-    Global(ValueType t, bool mut, std::vector<uint8_t> init)
-        : type(t), is_mutable(mut), init_expr(std::move(init)) {}
+    Global(ValueType t, bool mut, ArrayView<uint8_t> init)
+        : type(t), is_mutable(mut), init_expr(init) {}
 };
 
 /**
@@ -61,28 +150,29 @@ enum class ExternalKind : uint8_t {
     FUNCTION = 0x00,
     TABLE = 0x01,
     MEMORY = 0x02,
-    GLOBAL = 0x03
+    GLOBAL = 0x03,
+    TAG = 0x04
 };
 
 /**
  * Represents an export from the module.
  */
 struct Export {
-    std::string name;                       // Export name
+    std::string_view name;                  // Export name
     ExternalKind kind;                      // What is being exported
     uint32_t index;                         // Index into the respective space
 
     Export() : kind(ExternalKind::FUNCTION), index(0) {}
-    Export(std::string n, ExternalKind k, uint32_t idx)
-        : name(std::move(n)), kind(k), index(idx) {}
+    Export(std::string_view n, ExternalKind k, uint32_t idx)
+        : name(n), kind(k), index(idx) {}
 };
 
 /**
  * Represents an import into the module.
  */
 struct Import {
-    std::string module_name;                // Module name to import from
-    std::string field_name;                 // Field name to import
+    std::string_view module_name;           // Module name to import from
+    std::string_view field_name;            // Field name to import
     ExternalKind kind;                      // What is being imported
 
     // Type-specific data (only one is used based on kind)
@@ -99,8 +189,8 @@ struct Import {
  */
 struct DataSegment {
     uint32_t memory_index;                  // Memory index (always 0 in MVP)
-    std::vector<uint8_t> offset_expr;       // Offset expression bytecode
-    std::vector<uint8_t> data;              // Raw data bytes
+    ArrayView<uint8_t> offset_expr;         // Offset expression bytecode
+    ArrayView<uint8_t> data;                // Raw data bytes (arena, or Module::source)
 
     DataSegment() : memory_index(0) {}
 };
@@ -110,46 +200,111 @@ struct DataSegment {
  */
 struct ElementSegment {
     uint32_t table_index;                   // Table index (always 0 in MVP)
-    std::vector<uint8_t> offset_expr;       // Offset expression bytecode
-    std::vector<uint32_t> func_indices;     // Function indices
+    ArrayView<uint8_t> offset_expr;         // Offset expression bytecode
+    ArrayView<uint32_t> func_indices;       // Function indices
 
     ElementSegment() : table_index(0) {}
 };
 
 /**
  * Represents a complete WebAssembly module.
- * Contains all sections parsed from the binary format.
+ * Contains all sections parsed from the binary format. Bodies, names,
+ * init expressions and segment payloads are allocated from the module's
+ * arena and referenced through views, so they stay valid for the
+ * lifetime of the Module (including across moves). Data segments of a
+ * mapped file view the mapping in `source` instead.
  */
 class Module {
 public:
-    Module() = default;
+    Module() : arena_(std::make_unique<Arena>()) {}
+    explicit Module(size_t arena_capacity) : arena_(std::make_unique<Arena>(arena_capacity)) {}
     ~Module() = default;
 
     // Section data
     std::vector<FuncType> types;            // Type section
-    std::vector<Function> functions;        // Code section (combined with function section)
+    std::vector<CompositeType> composite_types; // Type section kinds (parallel to types)
+    FunctionTable functions;                // Code section (combined with function section)
     std::vector<uint32_t> function_types;   // Function section (type indices)
     std::vector<MemoryType> memories;       // Memory section
     std::vector<Global> globals;            // Global section
+    std::vector<uint32_t> tags;             // Tag section (function type index per tag)
     std::vector<Table> tables;              // Table section
     std::vector<Export> exports;            // Export section
     std::vector<Import> imports;            // Import section
     std::vector<DataSegment> data_segments; // Data section
     std::vector<ElementSegment> element_segments; // Element section
+    std::vector<std::string_view> function_names; // Name section (by function index, empty if unnamed)
 
     uint32_t start_function_index;          // Start section (optional)
     bool has_start_function;
 
+    // File the module was decoded from, if it was mapped; data segment
+    // payloads then view this mapping instead of the arena
+    std::shared_ptr<const MappedFile> source;
+
     Module(const Module&) = delete;
     Module& operator=(const Module&) = delete;
     Module(Module&&) = default;
     Module& operator=(Module&&) = default;
 
-    // Query methods
+    /**
+     * Build the function, table, memory and global index spaces and the
+     * export name and exported function indexes. Each index space lists imports first, followed by
+     * the module's own definitions. Called by the decoder once all sections
+     * are parsed; must be called again if the section data is modified.
+     */
+    void buildIndexSpaces();
+
+    /**
+     * Arena owning the module's bodies, names, expressions and segments.
+     */
+    Arena& arena() { return *arena_; }
+    const Arena& arena() const { return *arena_; }
+
+    // Query methods (O(1) once index spaces are built)
     const FuncType* getFunctionType(uint32_t func_index) const;
-    const Export* findExport(const std::string& name) const;
-    uint32_t getImportedFunctionCount() const;
-    uint32_t getTotalFunctionCount() const;
+    const Export* findExport(std::string_view name) const;
+
+    /**
+     * Human-readable name of a function for profilers and diagnostics:
+     * the name section entry, else the first export name, else
+     * "module.field" for imports.
+     * @return The name, or an empty string if the function has none
+     */
+    std::string functionName(uint32_t func_index) const;
+
+    /**
+     * Get the import backing an entry of an index space.
+     * @return The import, or nullptr if the index refers to a local definition
+     */
+    const Import* getImport(ExternalKind kind, uint32_t index) const;
+
+    uint32_t getImportedFunctionCount() const { return static_cast<uint32_t>(function_imports_.size()); }
+    uint32_t getImportedTableCount() const { return static_cast<uint32_t>(table_imports_.size()); }
+    uint32_t getImportedMemoryCount() const { return static_cast<uint32_t>(memory_imports_.size()); }
+    uint32_t getImportedGlobalCount() const { return static_cast<uint32_t>(global_imports_.size()); }
+
+    uint32_t getTotalFunctionCount() const { return static_cast<uint32_t>(function_type_indices_.size()); }
+    uint32_t getTotalTableCount() const { return getImportedTableCount() + static_cast<uint32_t>(tables.size()); }
+    uint32_t getTotalMemoryCount() const { return getImportedMemoryCount() + static_cast<uint32_t>(memories.size()); }
+    uint32_t getTotalGlobalCount() const { return getImportedGlobalCount() + static_cast<uint32_t>(globals.size()); }
+
+private:
+    std::unique_ptr<Arena> arena_;
+
+    // Index spaces
+    std::vector<uint32_t> function_type_indices_;   // Type index per function index
+    std::vector<uint32_t> function_imports_;        // Import index per imported function
+    std::vector<uint32_t> table_imports_;           // Import index per imported table
+    std::vector<uint32_t> memory_imports_;          // Import index per imported memory
+    std::vector<uint32_t> global_imports_;          // Import index per imported global
+
+    // Export name (viewing arena storage) -> index into exports
+    std::unordered_map<std::string_view, uint32_t> export_index_;
+    std::vector<uint32_t> function_exports_;        // First export per function index, or NO_EXPORT
+    static constexpr uint32_t NO_EXPORT = UINT32_MAX;
+
+    const std::vector<uint32_t>& importsOfKind(ExternalKind kind) const;
 };
 
 } // namespace wasm
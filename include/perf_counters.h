@@ -0,0 +1,189 @@
+#ifndef WASM_PERF_COUNTERS_H
+#define WASM_PERF_COUNTERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace wasm {
+
+/**
+ * Counters collected with perf_event_open. All count user space only.
+ */
+enum class Counter : uint8_t {
+    CYCLES,
+    INSTRUCTIONS,
+    BRANCH_MISSES,
+    L1D_MISSES,         // L1 data cache read misses
+    LLC_MISSES,         // Last-level cache misses
+    DTLB_MISSES,        // Data TLB read misses
+    TASK_CLOCK,         // Software event (ns on CPU); works without a PMU
+    COUNT
+};
+
+constexpr size_t COUNTER_COUNT = static_cast<size_t>(Counter::COUNT);
+
+const char* counterName(Counter counter);
+
+/**
+ * One value per counter. Counters that could not be opened read as 0.
+ */
+struct CounterValues {
+    uint64_t values[COUNTER_COUNT] = {};
+
+    uint64_t operator[](Counter counter) const { return values[static_cast<size_t>(counter)]; }
+
+    CounterValues& operator+=(const CounterValues& other) {
+        for (size_t i = 0; i < COUNTER_COUNT; i++) {
+            values[i] += other.values[i];
+        }
+        return *this;
+    }
+
+    CounterValues operator-(const CounterValues& other) const {
+        CounterValues result;
+        for (size_t i = 0; i < COUNTER_COUNT; i++) {
+            result.values[i] = values[i] - other.values[i];
+        }
+        return result;
+    }
+};
+
+/**
+ * Hardware and software counters for the calling thread.
+ * Each counter is opened on its own, so a missing one (no PMU in a VM or
+ * container, perf_event_paranoid, seccomp) only disables itself. When the
+ * kernel multiplexes counters, values are scaled by enabled/running time.
+ * Counts only the thread that constructed the object.
+ */
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    /**
+     * Whether any counter could be opened.
+     */
+    bool available() const;
+    bool available(Counter counter) const { return fds_[static_cast<size_t>(counter)] >= 0; }
+
+    /**
+     * Why the first unavailable counter could not be opened, or "".
+     */
+    const std::string& error() const { return error_; }
+
+    /**
+     * Current counts since construction. Free when nothing is available.
+     */
+    CounterValues read() const;
+
+private:
+    int fds_[COUNTER_COUNT];
+    bool any_;
+    std::string error_;
+};
+
+/**
+ * Counts for one guest function, accumulated over all its calls.
+ */
+struct FunctionCounters {
+    uint64_t calls = 0;
+    CounterValues inclusive;        // Including callees
+    CounterValues self;             // Excluding callees
+};
+
+/**
+ * Counter totals per guest function and per top-level call.
+ * Attached with Interpreter::setCounterProfile(), which brackets every
+ * guest call with enter()/leave(). Reading the counters costs a system
+ * call per counter on each guest call and return, so this is a
+ * measurement mode, not an always-on profile. Use it on the thread that
+ * created it.
+ */
+class CounterProfile {
+public:
+    CounterProfile() = default;
+
+    const PerfCounters& counters() const { return counters_; }
+
+    void enter(uint32_t func_index);
+    void leave(uint32_t func_index);
+
+    /**
+     * Counts of the most recent call from the embedder.
+     */
+    const CounterValues& lastCall() const { return last_call_; }
+
+    /**
+     * Totals over all calls from the embedder.
+     */
+    const CounterValues& total() const { return total_; }
+    uint64_t invocations() const { return invocations_; }
+
+    const FunctionCounters& function(uint32_t func_index) const;
+
+    /**
+     * Names used by write(), indexed by function index.
+     */
+    void setFunctionNames(std::vector<std::string> names) { names_ = std::move(names); }
+
+    /**
+     * Clear all counts; names are kept.
+     */
+    void reset();
+
+    /**
+     * Write a table of the functions that were called, by self cycles (or
+     * self task clock without a PMU), with IPC and miss rates.
+     */
+    void write(std::ostream& out) const;
+
+private:
+    struct ActiveCall {
+        CounterValues start;
+        CounterValues callees;      // Inclusive counts of finished callees
+    };
+
+    PerfCounters counters_;
+    std::vector<FunctionCounters> functions_;
+    std::vector<ActiveCall> active_;
+    std::vector<std::string> names_;
+    CounterValues last_call_;
+    CounterValues total_;
+    uint64_t invocations_ = 0;
+};
+
+/**
+ * Brackets a guest call for a counter profile; a null profile costs a
+ * branch.
+ */
+class CounterScope {
+public:
+    CounterScope(CounterProfile* profile, uint32_t func_index) : profile_(profile), func_index_(func_index) {
+        if (profile_) {
+            profile_->enter(func_index_);
+        }
+    }
+
+    ~CounterScope() {
+        if (profile_) {
+            profile_->leave(func_index_);
+        }
+    }
+
+    CounterScope(const CounterScope&) = delete;
+    CounterScope& operator=(const CounterScope&) = delete;
+
+private:
+    CounterProfile* profile_;
+    uint32_t func_index_;
+};
+
+} // namespace wasm
+
+#endif // WASM_PERF_COUNTERS_H
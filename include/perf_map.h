@@ -0,0 +1,99 @@
+#ifndef WASM_PERF_MAP_H
+#define WASM_PERF_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace wasm {
+
+/**
+ * How guest code is described to Linux perf.
+ */
+enum class PerfFormat {
+    MAP,        // /tmp/perf-<pid>.map, read by perf report directly
+    JITDUMP     // /tmp/jit-<pid>.dump, merged with perf inject --jit
+};
+
+/**
+ * Process-wide writer for perf code annotations.
+ * The map format names address ranges and is enough for code in anonymous
+ * memory (the interpreter trampolines). Jitdump records carry a copy of
+ * the code, so samples in compiled modules whose library has since been
+ * unlinked (tier-up) are still attributed; record with
+ * `perf record -k mono` so timestamps match.
+ */
+class PerfMap {
+public:
+    static PerfMap& instance();
+
+    /**
+     * Start writing the given format. Idempotent; both formats may be on.
+     * @return False if the output file could not be created
+     */
+    bool enable(PerfFormat format);
+
+    bool enabled() const { return map_file_ != nullptr || dump_file_ != nullptr; }
+
+    /**
+     * Describe a range of executable code. With jitdump, the code bytes are
+     * copied, so the range must be readable.
+     */
+    void addCode(const void* start, size_t size, const std::string& name);
+
+private:
+    PerfMap() = default;
+    ~PerfMap();
+    PerfMap(const PerfMap&) = delete;
+    PerfMap& operator=(const PerfMap&) = delete;
+
+    std::mutex mutex_;
+    FILE* map_file_ = nullptr;
+    FILE* dump_file_ = nullptr;
+    void* dump_marker_ = nullptr;       // Executable mapping that tells perf about the dump
+    uint64_t code_index_ = 0;
+
+    bool openJitDump();
+    void writeJitCodeLoad(const void* start, size_t size, const std::string& name);
+};
+
+/**
+ * Per-function native entry stubs for interpreted code.
+ * Every guest function gets its own small stub that sets up a frame and
+ * calls the interpreter. Naming the stubs in the perf map makes
+ * frame-pointer call graphs (perf record -g) show which guest functions
+ * are on the stack, even though all samples land in the interpreter loop.
+ * Stubs have no unwind info: the target must not let exceptions escape.
+ * Only x86-64 is supported; elsewhere available() is false.
+ */
+class PerfTrampolines {
+public:
+    using Entry = void (*)(void* context, uint32_t func_index);
+
+    PerfTrampolines(uint32_t count, Entry target);
+    ~PerfTrampolines();
+
+    PerfTrampolines(const PerfTrampolines&) = delete;
+    PerfTrampolines& operator=(const PerfTrampolines&) = delete;
+
+    bool available() const { return code_ != nullptr; }
+
+    Entry entry(uint32_t func_index) const {
+        return reinterpret_cast<Entry>(static_cast<uint8_t*>(code_) + func_index * STUB_SIZE);
+    }
+
+    const void* stub(uint32_t func_index) const { return static_cast<uint8_t*>(code_) + func_index * STUB_SIZE; }
+
+    static constexpr size_t STUB_SIZE = 32;
+
+private:
+    void* code_ = nullptr;
+    size_t mapped_size_ = 0;
+};
+
+} // namespace wasm
+
+#endif // WASM_PERF_MAP_H
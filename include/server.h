@@ -0,0 +1,248 @@
+#ifndef WASM_SERVER_H
+#define WASM_SERVER_H
+
+#include "interpreter.h"
+#include "types.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace wasm {
+
+/**
+ * Exception thrown for socket and protocol failures.
+ */
+class ServerError : public std::runtime_error {
+public:
+    explicit ServerError(const std::string& message)
+        : std::runtime_error("Server error: " + message) {}
+};
+
+/**
+ * Wire protocol between wasm-interpreter --serve and its clients.
+ *
+ * Every message is a frame: a little-endian u32 payload length followed by
+ * the payload. All integers are little-endian; strings and byte blocks are
+ * a u32 length followed by the bytes. A value is its type byte (the
+ * ValueType encoding, e.g. 0x7F for i32) followed by 8 bytes holding the
+ * zero-extended bits.
+ *
+ * Request payloads start with a kind byte:
+ *   INVOKE    u32 module id, string export, u32 count, values,
+ *             u32 memory offset, bytes written there before the call,
+ *             u32 read offset, u32 read length (memory returned after it)
+ *   LOAD      string path of a .wasm file on the server's file system
+ *   SHUTDOWN  (empty)
+ *
+ * Response payloads start with a status byte. OK is followed by u32 count,
+ * values and a byte block (INVOKE), or by the u32 module id (LOAD). ERROR
+ * is followed by a string message.
+ */
+namespace protocol {
+
+enum class RequestKind : uint8_t {
+    INVOKE = 1,
+    LOAD = 2,
+    SHUTDOWN = 3
+};
+
+enum class Status : uint8_t {
+    OK = 0,
+    ERROR = 1
+};
+
+constexpr uint32_t MAX_FRAME_SIZE = 64u << 20;
+
+struct InvokeRequest {
+    uint32_t module_id = 0;
+    std::string function_name;
+    std::vector<TypedValue> args;
+    uint32_t memory_offset = 0;
+    std::vector<uint8_t> memory;        // Written at memory_offset before the call
+    uint32_t read_offset = 0;
+    uint32_t read_length = 0;           // Bytes of memory returned after the call
+};
+
+struct InvokeResponse {
+    std::vector<TypedValue> results;
+    std::vector<uint8_t> memory;
+};
+
+using Bytes = std::vector<uint8_t>;
+
+Bytes encodeInvoke(const InvokeRequest& request);
+Bytes encodeLoad(const std::string& path);
+Bytes encodeShutdown();
+
+/**
+ * Read a frame from a socket.
+ * @return false if the peer closed the connection before the frame began
+ * @throws ServerError on a truncated or oversized frame
+ */
+bool readFrame(int fd, Bytes& payload);
+
+/**
+ * Write a frame to a socket.
+ * @throws ServerError if the peer has gone away
+ */
+void writeFrame(int fd, const Bytes& payload);
+
+} // namespace protocol
+
+/**
+ * Warm instances of one module, handed out to one request at a time.
+ * Each instance decodes the module once, is instantiated, and keeps a
+ * snapshot of its fresh state; release() restores the snapshot, so every
+ * request starts from the freshly instantiated module whichever instance
+ * serves it. At most max_instances run at once; further requests wait.
+ */
+class InstancePool {
+public:
+    InstancePool(std::vector<uint8_t> bytes, size_t max_instances);
+
+    /**
+     * Decode every instance from a module file, so instances share its
+     * data segments through the file mapping until they write them.
+     */
+    InstancePool(std::string path, size_t max_instances);
+
+    InstancePool(const InstancePool&) = delete;
+    InstancePool& operator=(const InstancePool&) = delete;
+
+    /**
+     * Take an idle instance, creating one if fewer than max_instances
+     * exist, or wait for one to be released.
+     */
+    std::unique_ptr<Interpreter> acquire();
+
+    /**
+     * Reset an instance to its snapshot and return it to the pool. An
+     * instance whose reset fails is destroyed instead, freeing its slot.
+     * Called from destructors, so it never throws.
+     */
+    void release(std::unique_ptr<Interpreter> instance) noexcept;
+
+    size_t instances() const;
+
+private:
+    std::unique_ptr<Interpreter> create() const;
+
+    std::vector<uint8_t> bytes_;
+    std::string path_;              // Module file, if decoded from one
+    size_t max_instances_;
+    mutable std::mutex mutex_;
+    std::condition_variable available_;
+    std::vector<std::unique_ptr<Interpreter>> idle_;
+    size_t created_ = 0;
+};
+
+/**
+ * Invocation daemon on a Unix domain socket.
+ * Modules are decoded and instantiated once and then serve requests from
+ * their instance pools, so a call costs a socket round trip instead of a
+ * decode and instantiation. Each connection is served on its own thread
+ * and may send any number of requests.
+ */
+class Server {
+public:
+    /**
+     * @param pool_size Maximum concurrent instances per module
+     */
+    explicit Server(size_t pool_size);
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    /**
+     * Add a module from its binary or file. The first instance is created
+     * here, so invalid modules are reported before serving. Modules loaded
+     * from a file map their data segments from it.
+     * @return Module id used by INVOKE requests
+     */
+    uint32_t addModule(std::vector<uint8_t> bytes);
+    uint32_t loadModule(const std::string& path);
+
+    /**
+     * Bind and listen on a socket path, replacing a stale socket file.
+     * @throws ServerError if the socket cannot be created
+     */
+    void listen(const std::string& socket_path);
+
+    /**
+     * Accept and serve connections until stop() or a SHUTDOWN request,
+     * then close all connections and remove the socket file.
+     */
+    void serve();
+
+    /**
+     * Make serve() return. Safe to call from any thread.
+     */
+    void stop();
+
+private:
+    InstancePool& pool(uint32_t module_id);
+    uint32_t addPool(std::unique_ptr<InstancePool> pool);
+    void serveConnection(int fd);
+    protocol::Bytes handle(const protocol::Bytes& request);
+    protocol::InvokeResponse invoke(const protocol::InvokeRequest& request);
+
+    size_t pool_size_;
+    std::mutex modules_mutex_;
+    std::vector<std::unique_ptr<InstancePool>> modules_;
+
+    std::string socket_path_;
+    int listen_fd_ = -1;
+    std::atomic<bool> stopping_{false};
+    // Open connections, each served by a detached thread
+    std::mutex connections_mutex_;
+    std::condition_variable connections_done_;
+    std::vector<int> connection_fds_;
+};
+
+/**
+ * Client for a Server, one connection per object.
+ */
+class Client {
+public:
+    /**
+     * @throws ServerError if nothing is listening on socket_path
+     */
+    explicit Client(const std::string& socket_path);
+    ~Client();
+
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+
+    /**
+     * @throws std::runtime_error carrying the server's message (Trap: ...,
+     *         Interpreter error: ...) if the call failed, or ServerError if
+     *         the connection failed
+     */
+    protocol::InvokeResponse invoke(const protocol::InvokeRequest& request);
+
+    std::vector<TypedValue> call(uint32_t module_id, const std::string& function_name,
+                                 const std::vector<TypedValue>& args);
+
+    /**
+     * Ask the server to load a module from its file system.
+     * @return Module id
+     */
+    uint32_t load(const std::string& path);
+
+    void shutdown();
+
+private:
+    protocol::Bytes roundTrip(const protocol::Bytes& request);
+
+    int fd_;
+};
+
+} // namespace wasm
+
+#endif // WASM_SERVER_H
@@ -31,6 +31,7 @@ public:
     void pushI64(int64_t value);
     void pushF32(float value);
     void pushF64(double value);
+    void pushRef(uint64_t ref);
     void push(const TypedValue& value);
 
     // Pop operations with type checking
@@ -38,6 +39,7 @@ public:
     int64_t popI64();
     float popF32();
     double popF64();
+    uint64_t popRef();
     TypedValue pop();
 
     // Peek operations (non-destructive)
@@ -53,6 +55,31 @@ public:
     bool empty() const { return stack_.empty(); }
     void clear() { stack_.clear(); }
 
+    /**
+     * Unwind the stack to a label height, preserving the top values.
+     * Used by branches: the top 'keep' values are moved down to 'height'
+     * and everything above them is discarded in one step.
+     */
+    void unwind(size_t height, size_t keep);
+
+    /**
+     * Move the top 'count' values onto another stack, keeping their order.
+     * Continuations pass arguments and results this way.
+     */
+    void transfer(Stack& to, size_t count);
+
+    void swap(Stack& other) { stack_.swap(other.stack_); }
+
+    /**
+     * Visit every value, bottom first. The GC heap finds its roots here.
+     */
+    template<typename Visitor>
+    void forEach(Visitor&& visit) {
+        for (TypedValue& value : stack_) {
+            visit(value);
+        }
+    }
+
     // For debugging
     void dump() const;
 
@@ -0,0 +1,64 @@
+#ifndef WASM_STORE_H
+#define WASM_STORE_H
+
+#include "interpreter.h"
+#include "module.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace wasm {
+
+/**
+ * A set of named instances whose modules import from one another.
+ *
+ * An import (module "m", field "f") resolves to the export "f" of the
+ * instance registered as "m", so modules must be instantiated after the
+ * modules they import from. Linking happens once, in instantiate():
+ *
+ *   - Functions: a call to an imported function runs the exporter's code
+ *     on the caller's operand stack, the same as a local call plus one
+ *     stack swap. Signatures must match exactly and may not contain
+ *     reference types, which are only meaningful in their own instance.
+ *   - Memories: importers share the exporter's Memory, so stores and
+ *     memory.grow are visible to all of them.
+ *   - Tables: call_indirect in an importer reads the exporter's table
+ *     and calls into the exporter. Importers cannot write the table with
+ *     element segments, and cannot load compiled code.
+ *   - Globals: immutable globals are copied; mutable imports do not link.
+ *
+ * A trap in a callee unwinds through every instance on the call path.
+ * Continuations do not cross instances: a suspend only finds handlers of
+ * its own instance. Restoring a snapshot of any instance resets a shared
+ * memory for all of them.
+ *
+ * Instances live as long as the store and are never re-instantiated.
+ */
+class Store {
+public:
+    /**
+     * Instantiate module under name, with its imports
+     * resolved against the instances already in the store. WASI imports
+     * are handled as by Interpreter::instantiate().
+     * @return The new instance
+     * @throws LinkError if name is taken or an import cannot be linked
+     */
+    Interpreter& instantiate(const std::string& name, Module&& module);
+
+    /**
+     * The instance registered as name, or nullptr.
+     */
+    Interpreter* instance(const std::string& name);
+
+    size_t size() const { return instances_.size(); }
+
+private:
+    std::vector<std::unique_ptr<Interpreter>> instances_;
+    std::unordered_map<std::string, Interpreter*> names_;
+};
+
+} // namespace wasm
+
+#endif // WASM_STORE_H
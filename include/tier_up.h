@@ -0,0 +1,98 @@
+#ifndef WASM_TIER_UP_H
+#define WASM_TIER_UP_H
+
+#include "aot.h"
+#include "module.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace wasm {
+
+/**
+ * Settings for compiling hot functions in the background.
+ */
+struct TierUpOptions {
+    uint32_t hot_threshold;     // Calls before a function is compiled
+    AotOptions compiler;        // Optimizing tier settings
+    std::string work_dir;       // Parent of the private build directory ($TMPDIR or /tmp)
+
+    TierUpOptions();
+};
+
+/**
+ * Background compiler for the optimizing tier.
+ * The interpreter's call profile decides which functions are hot; each
+ * request is compiled on a worker thread together with every function
+ * requested before it, so the newest shared object always covers the
+ * whole hot set. Functions that are not hot stay interpreted and are
+ * reached from compiled code through call_host. The interpreter polls
+ * for a finished module at function entry and installs it there.
+ */
+class TierUpCompiler {
+public:
+    /**
+     * @param module Module to compile from; must outlive the compiler
+     */
+    TierUpCompiler(const Module& module, TierUpOptions options);
+    ~TierUpCompiler();
+
+    TierUpCompiler(const TierUpCompiler&) = delete;
+    TierUpCompiler& operator=(const TierUpCompiler&) = delete;
+
+    uint32_t hotThreshold() const { return options_.hot_threshold; }
+
+    /**
+     * Queue a function for compilation. Returns immediately.
+     */
+    void request(uint32_t func_index);
+
+    /**
+     * Whether a compiled module is waiting to be installed.
+     */
+    bool hasReady() const { return ready_flag_.load(std::memory_order_acquire); }
+
+    /**
+     * Take the newest compiled module, or nullptr if none is ready.
+     */
+    std::unique_ptr<NativeModule> takeReady();
+
+    /**
+     * Block until every requested function has been compiled (or
+     * compilation has failed).
+     */
+    void wait();
+
+    /**
+     * Error that stopped background compilation, or empty.
+     */
+    std::string lastError() const;
+
+private:
+    const Module& module_;
+    TierUpOptions options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<bool> hot_;                 // Requested function indices
+    bool pending_;                          // Requests not yet picked up by the worker
+    bool busy_;                             // Worker is compiling
+    bool stop_;
+    bool failed_;                           // A compile failed; further requests are ignored
+    uint32_t generation_;                   // Shared objects built so far
+    std::string error_;
+    std::unique_ptr<NativeModule> ready_;
+    std::atomic<bool> ready_flag_;
+    std::thread worker_;
+
+    void run();
+};
+
+} // namespace wasm
+
+#endif // WASM_TIER_UP_H
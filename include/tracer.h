@@ -0,0 +1,169 @@
+#ifndef WASM_TRACER_H
+#define WASM_TRACER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace wasm {
+
+/**
+ * What a trace event describes.
+ */
+enum class TraceEventKind : uint8_t {
+    CALL,           // Guest function (interpreted or compiled)
+    HOST_CALL,      // Imported function executed by the host
+    MEMORY_GROW,    // memory.grow
+    TRAP            // Instant: a trap reached the embedder
+};
+
+/**
+ * One recorded event. Spans are recorded once they end, as a start time
+ * and duration, so events below the threshold are never stored.
+ */
+struct TraceEvent {
+    uint64_t start_ns;          // Monotonic clock
+    uint64_t duration_ns;       // 0 for instant events
+    uint32_t name;              // Interned name id
+    uint32_t depth;             // Guest call depth, for ordering nested spans
+    TraceEventKind kind;
+};
+
+/**
+ * Output format for Tracer::write().
+ */
+enum class TraceFormat {
+    CHROME_JSON,    // Chrome trace-event JSON (chrome://tracing, Perfetto UI)
+    PERFETTO        // Perfetto protobuf trace
+};
+
+/**
+ * Tracer configuration.
+ */
+struct TracerOptions {
+    uint64_t min_duration_ns;       // Calls shorter than this are not recorded
+    size_t buffer_capacity;         // Events per thread before new ones are dropped
+
+    TracerOptions() : min_duration_ns(0), buffer_capacity(1u << 16) {}
+};
+
+/**
+ * Timeline tracer for guest calls, host calls, memory growth and traps.
+ * Each recording thread owns a fixed-size single-producer ring buffer, so
+ * recording is lock-free; only a thread's first event and flushing take
+ * the tracer mutex. One tracer may be shared by interpreters running on
+ * different threads. Flushing drains the buffers, so each write contains
+ * the events recorded since the previous one.
+ */
+class Tracer {
+public:
+    explicit Tracer(TracerOptions options = TracerOptions());
+    ~Tracer();
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    /**
+     * Get a stable id for an event name.
+     */
+    uint32_t intern(const std::string& name);
+
+    /**
+     * Record a span that started at start_ns and ends now. Calls shorter
+     * than the threshold are discarded; other kinds are always kept.
+     */
+    void complete(TraceEventKind kind, uint32_t name, uint32_t depth, uint64_t start_ns);
+
+    /**
+     * Record an instant event.
+     */
+    void instant(TraceEventKind kind, uint32_t name, uint32_t depth);
+
+    /**
+     * Events discarded because a thread's buffer was full.
+     */
+    uint64_t dropped() const;
+
+    /**
+     * Drain all buffers and write the events.
+     */
+    void write(std::ostream& out, TraceFormat format);
+
+    /**
+     * Drain all buffers to a file.
+     * @return False if the file could not be written
+     */
+    bool writeFile(const std::string& path, TraceFormat format);
+
+    static uint64_t now();
+
+private:
+    struct ThreadBuffer {
+        uint32_t tid;
+        std::vector<TraceEvent> slots;
+        std::atomic<uint64_t> head;     // Next slot to write (recording thread)
+        std::atomic<uint64_t> tail;     // Next slot to read (flush)
+        std::atomic<uint64_t> dropped;
+
+        ThreadBuffer(uint32_t thread_id, size_t capacity)
+            : tid(thread_id), slots(capacity), head(0), tail(0), dropped(0) {}
+    };
+
+    struct ThreadEvents {
+        uint32_t tid;
+        std::vector<TraceEvent> events;
+    };
+
+    TracerOptions options_;
+    uint64_t id_;                       // Distinguishes tracers in the thread-local cache
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+    std::vector<std::string> names_;
+
+    ThreadBuffer& threadBuffer();
+    void push(const TraceEvent& event);
+    std::vector<ThreadEvents> drain();
+    void writeChromeJson(std::ostream& out, const std::vector<ThreadEvents>& threads) const;
+    void writePerfetto(std::ostream& out, const std::vector<ThreadEvents>& threads) const;
+};
+
+/**
+ * Records a span for the lifetime of the scope, including when it is left
+ * by an exception. A null tracer makes the scope free apart from the
+ * branch.
+ */
+class TraceScope {
+public:
+    TraceScope(Tracer* tracer, TraceEventKind kind, uint32_t name, uint32_t& depth)
+        : tracer_(tracer), kind_(kind), name_(name), depth_(depth), start_ns_(0) {
+        if (tracer_) {
+            depth_++;
+            start_ns_ = Tracer::now();
+        }
+    }
+
+    ~TraceScope() {
+        if (tracer_) {
+            depth_--;
+            tracer_->complete(kind_, name_, depth_, start_ns_);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    Tracer* tracer_;
+    TraceEventKind kind_;
+    uint32_t name_;
+    uint32_t& depth_;
+    uint64_t start_ns_;
+};
+
+} // namespace wasm
+
+#endif // WASM_TRACER_H
@@ -8,13 +8,17 @@
 namespace wasm {
 
 /**
- * WebAssembly value types as defined in the MVP specification.
+ * WebAssembly value types as defined in the MVP specification, plus one
+ * tag for every GC proposal reference type.
  */
 enum class ValueType : uint8_t {
     I32 = 0x7F,  // 32-bit integer
     I64 = 0x7E,  // 64-bit integer
     F32 = 0x7D,  // 32-bit floating point
     F64 = 0x7C,  // 64-bit floating point
+    ANYREF = 0x6E, // GC reference (anyref, eqref, i31ref, struct and array refs)
+    FUNCREF = 0x70, // Function reference
+    CONTREF = 0x68, // Continuation reference (stack switching)
     VOID = 0x40  // Empty type for blocks/functions with no result
 };
 
@@ -27,6 +31,8 @@ union Value {
     int64_t i64;
     float f32;
     double f64;
+    uint64_t ref;   // 0 is null. anyref: odd is an i31 (value << 1 | 1), else a GcHeap
+                    // object. funcref: function index + 1. contref: see Interpreter
 
     Value() : i64(0) {}
     explicit Value(int32_t v) : i32(v) {}
@@ -61,6 +67,12 @@ struct TypedValue {
     static TypedValue makeF64(double v) {
         return TypedValue(ValueType::F64, Value(v));
     }
+
+    static TypedValue makeRef(uint64_t ref, ValueType type = ValueType::ANYREF) {
+        Value v;
+        v.ref = ref;
+        return TypedValue(type, v);
+    }
 };
 
 /**
@@ -99,6 +111,22 @@ struct Limits {
 std::string valueTypeToString(ValueType type);
 size_t getValueTypeSize(ValueType type);
 
+/**
+ * Parse a value as written on a command line.
+ * Integers are decimal or 0x hex, optionally negative, and may use the
+ * unsigned range (0xFFFFFFFF is i32 -1). Floats accept decimal and hex
+ * float syntax, inf, nan and nan:0x<payload> as in the text format.
+ * The only reference a host can write is null.
+ * @throws std::invalid_argument if text is not a value of the type
+ */
+TypedValue parseValue(const std::string& text, ValueType type);
+
+/**
+ * Format a value so parseValue() reads it back bit for bit: floats with
+ * round-trip precision and NaNs with their payload.
+ */
+std::string formatValue(const TypedValue& value);
+
 } // namespace wasm
 
 #endif // WASM_TYPES_H
@@ -0,0 +1,324 @@
+#ifndef WASM_RT_H
+#define WASM_RT_H
+
+/*
+ * Runtime interface between ahead-of-time compiled modules and the host.
+ *
+ * wasm-aot translates a Module into portable C that includes this header.
+ * The generated code never owns instance state: linear memory, globals and
+ * the function table belong to the host Interpreter and are reached through
+ * a wasm_rt_instance. Traps, memory.grow and imported functions are
+ * callbacks into the host. This header is C99 and is also included by the
+ * C++ host, so both sides agree on the layout.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WASM_RT_ABI_VERSION 2u
+#define WASM_RT_PAGE_SIZE 65536u
+#define WASM_RT_NULL_FUNCTION UINT32_MAX
+#define WASM_RT_MAX_CALL_DEPTH 10000u
+
+#if defined(__GNUC__) || defined(__clang__)
+#define WASM_RT_NORETURN __attribute__((noreturn))
+#define WASM_RT_EXPORT __attribute__((visibility("default")))
+#define WASM_RT_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#define WASM_RT_NORETURN
+#define WASM_RT_EXPORT
+#define WASM_RT_UNLIKELY(x) (x)
+#endif
+
+/* Value types (same encoding as the binary format and wasm::ValueType) */
+enum {
+    WASM_RT_I32 = 0x7F,
+    WASM_RT_I64 = 0x7E,
+    WASM_RT_F32 = 0x7D,
+    WASM_RT_F64 = 0x7C
+};
+
+/* Trap kinds reported to the host */
+typedef enum {
+    WASM_RT_TRAP_UNREACHABLE = 0,
+    WASM_RT_TRAP_OUT_OF_BOUNDS,
+    WASM_RT_TRAP_DIV_BY_ZERO,
+    WASM_RT_TRAP_INT_OVERFLOW,
+    WASM_RT_TRAP_INVALID_CONVERSION,
+    WASM_RT_TRAP_UNDEFINED_ELEMENT,
+    WASM_RT_TRAP_SIGNATURE_MISMATCH,
+    WASM_RT_TRAP_CALL_STACK_EXHAUSTED
+} wasm_rt_trap_kind;
+
+/*
+ * Typed value. Layout-compatible with wasm::TypedValue so argument and
+ * result vectors are passed to compiled code without conversion.
+ */
+typedef struct wasm_rt_value {
+    uint8_t type;
+    union {
+        int32_t i32;
+        int64_t i64;
+        float f32;
+        double f64;
+    } value;
+} wasm_rt_value;
+
+/* Per-instance state shared between the host and compiled code */
+typedef struct wasm_rt_instance {
+    uint8_t* memory;                /* Linear memory base (may move on grow) */
+    uint64_t memory_size;           /* Linear memory size in bytes */
+    wasm_rt_value* globals;         /* Global values, indexed by global index */
+    const uint32_t* table;          /* Table 0: function indices */
+    uint32_t table_size;
+    uint32_t call_depth;            /* Guards against native stack overflow */
+    void* host;                     /* Opaque host pointer */
+
+    /* Host callbacks. trap must not return. call_host runs a function the
+     * host executes: an import, or a function that was not compiled. */
+    void (*trap)(struct wasm_rt_instance* inst, wasm_rt_trap_kind kind, const char* message);
+    int32_t (*memory_grow)(struct wasm_rt_instance* inst, uint32_t delta_pages);
+    void (*call_host)(struct wasm_rt_instance* inst, uint32_t func_index,
+                      const wasm_rt_value* args, wasm_rt_value* results);
+} wasm_rt_instance;
+
+/* Uniform entry point generated for every defined function */
+typedef void (*wasm_rt_invoke_fn)(wasm_rt_instance* inst, const wasm_rt_value* args,
+                                  wasm_rt_value* results);
+
+/* Untyped function pointer; cast to the function's signature to call */
+typedef void (*wasm_rt_any_fn)(void);
+
+/* Descriptor exported by a compiled module */
+typedef struct wasm_rt_module {
+    uint32_t abi_version;           /* WASM_RT_ABI_VERSION */
+    uint64_t fingerprint;           /* Identifies the source module */
+    uint32_t function_count;        /* Size of the function index space */
+    const wasm_rt_invoke_fn* invokers;  /* Per function index; NULL if not compiled */
+    const char* const* names;       /* Per function index; NULL if unnamed */
+    const wasm_rt_any_fn* functions;    /* Per function index; code entry (host thunk if not compiled) */
+} wasm_rt_module;
+
+#define WASM_RT_MODULE_SYMBOL "wasm_rt_get_module"
+typedef const wasm_rt_module* (*wasm_rt_get_module_fn)(void);
+
+/* ===== Helpers used by generated code ===== */
+
+static inline WASM_RT_NORETURN void wasm_rt_trap(wasm_rt_instance* inst, wasm_rt_trap_kind kind,
+                                                 const char* message) {
+    inst->trap(inst, kind, message);
+    abort();  /* The host trap callback does not return */
+}
+
+/*
+ * Memory access. The _at forms take the memory base and size explicitly so
+ * optimized code can keep them in locals (reloading only after calls and
+ * memory.grow), which lets the C compiler merge and hoist bounds checks.
+ * The _unchecked forms are used for accesses proven in bounds at
+ * translation time.
+ */
+static inline uint8_t* wasm_rt_address_at(wasm_rt_instance* inst, uint8_t* base, uint64_t mem_size,
+                                          uint64_t addr, uint64_t size) {
+    /* Effective addresses are 33-bit (base + offset), so this cannot overflow */
+    if (WASM_RT_UNLIKELY(addr + size > mem_size)) {
+        wasm_rt_trap(inst, WASM_RT_TRAP_OUT_OF_BOUNDS, "Memory access out of bounds");
+    }
+    return base + addr;
+}
+
+static inline uint8_t* wasm_rt_address(wasm_rt_instance* inst, uint64_t addr, uint64_t size) {
+    return wasm_rt_address_at(inst, inst->memory, inst->memory_size, addr, size);
+}
+
+#define WASM_RT_DEFINE_LOAD(name, mem_t, result_t)                                             \
+    static inline result_t name##_at(wasm_rt_instance* inst, uint8_t* base, uint64_t mem_size, \
+                                     uint64_t addr) {                                          \
+        mem_t value;                                                                           \
+        memcpy(&value, wasm_rt_address_at(inst, base, mem_size, addr, sizeof(mem_t)),          \
+               sizeof(mem_t));                                                                 \
+        return (result_t)value;                                                                \
+    }                                                                                          \
+    static inline result_t name##_unchecked(const uint8_t* base, uint64_t addr) {              \
+        mem_t value;                                                                           \
+        memcpy(&value, base + addr, sizeof(mem_t));                                            \
+        return (result_t)value;                                                                \
+    }                                                                                          \
+    static inline result_t name(wasm_rt_instance* inst, uint64_t addr) {                       \
+        return name##_at(inst, inst->memory, inst->memory_size, addr);                         \
+    }
+
+#define WASM_RT_DEFINE_STORE(name, mem_t, value_t)                                             \
+    static inline void name##_at(wasm_rt_instance* inst, uint8_t* base, uint64_t mem_size,     \
+                                 uint64_t addr, value_t v) {                                   \
+        mem_t value = (mem_t)v;                                                                \
+        memcpy(wasm_rt_address_at(inst, base, mem_size, addr, sizeof(mem_t)), &value,          \
+               sizeof(mem_t));                                                                 \
+    }                                                                                          \
+    static inline void name##_unchecked(uint8_t* base, uint64_t addr, value_t v) {             \
+        mem_t value = (mem_t)v;                                                                \
+        memcpy(base + addr, &value, sizeof(mem_t));                                            \
+    }                                                                                          \
+    static inline void name(wasm_rt_instance* inst, uint64_t addr, value_t v) {                \
+        name##_at(inst, inst->memory, inst->memory_size, addr, v);                             \
+    }
+
+WASM_RT_DEFINE_LOAD(wasm_rt_i32_load, uint32_t, uint32_t)
+WASM_RT_DEFINE_LOAD(wasm_rt_i64_load, uint64_t, uint64_t)
+WASM_RT_DEFINE_LOAD(wasm_rt_f32_load, float, float)
+WASM_RT_DEFINE_LOAD(wasm_rt_f64_load, double, double)
+WASM_RT_DEFINE_LOAD(wasm_rt_i32_load8_s, int8_t, uint32_t)
+WASM_RT_DEFINE_LOAD(wasm_rt_i32_load8_u, uint8_t, uint32_t)
+WASM_RT_DEFINE_LOAD(wasm_rt_i32_load16_s, int16_t, uint32_t)
+WASM_RT_DEFINE_LOAD(wasm_rt_i32_load16_u, uint16_t, uint32_t)
+WASM_RT_DEFINE_LOAD(wasm_rt_i64_load8_s, int8_t, uint64_t)
+WASM_RT_DEFINE_LOAD(wasm_rt_i64_load8_u, uint8_t, uint64_t)
+WASM_RT_DEFINE_LOAD(wasm_rt_i64_load16_s, int16_t, uint64_t)
+WASM_RT_DEFINE_LOAD(wasm_rt_i64_load16_u, uint16_t, uint64_t)
+WASM_RT_DEFINE_LOAD(wasm_rt_i64_load32_s, int32_t, uint64_t)
+WASM_RT_DEFINE_LOAD(wasm_rt_i64_load32_u, uint32_t, uint64_t)
+
+WASM_RT_DEFINE_STORE(wasm_rt_i32_store, uint32_t, uint32_t)
+WASM_RT_DEFINE_STORE(wasm_rt_i64_store, uint64_t, uint64_t)
+WASM_RT_DEFINE_STORE(wasm_rt_f32_store, float, float)
+WASM_RT_DEFINE_STORE(wasm_rt_f64_store, double, double)
+WASM_RT_DEFINE_STORE(wasm_rt_i32_store8, uint8_t, uint32_t)
+WASM_RT_DEFINE_STORE(wasm_rt_i32_store16, uint16_t, uint32_t)
+WASM_RT_DEFINE_STORE(wasm_rt_i64_store8, uint8_t, uint64_t)
+WASM_RT_DEFINE_STORE(wasm_rt_i64_store16, uint16_t, uint64_t)
+WASM_RT_DEFINE_STORE(wasm_rt_i64_store32, uint32_t, uint64_t)
+
+static inline uint32_t wasm_rt_memory_size(wasm_rt_instance* inst) {
+    return (uint32_t)(inst->memory_size / WASM_RT_PAGE_SIZE);
+}
+
+static inline uint32_t wasm_rt_memory_grow(wasm_rt_instance* inst, uint32_t delta) {
+    return (uint32_t)inst->memory_grow(inst, delta);
+}
+
+/* Integer division and remainder with WebAssembly trap semantics */
+
+static inline uint32_t wasm_rt_i32_div_s(wasm_rt_instance* inst, uint32_t a, uint32_t b) {
+    if (WASM_RT_UNLIKELY(b == 0)) wasm_rt_trap(inst, WASM_RT_TRAP_DIV_BY_ZERO, "integer divide by zero");
+    if (WASM_RT_UNLIKELY(a == 0x80000000u && b == 0xFFFFFFFFu))
+        wasm_rt_trap(inst, WASM_RT_TRAP_INT_OVERFLOW, "integer overflow");
+    return (uint32_t)((int32_t)a / (int32_t)b);
+}
+
+static inline uint32_t wasm_rt_i32_div_u(wasm_rt_instance* inst, uint32_t a, uint32_t b) {
+    if (WASM_RT_UNLIKELY(b == 0)) wasm_rt_trap(inst, WASM_RT_TRAP_DIV_BY_ZERO, "integer divide by zero");
+    return a / b;
+}
+
+static inline uint32_t wasm_rt_i32_rem_s(wasm_rt_instance* inst, uint32_t a, uint32_t b) {
+    if (WASM_RT_UNLIKELY(b == 0)) wasm_rt_trap(inst, WASM_RT_TRAP_DIV_BY_ZERO, "integer divide by zero");
+    if (b == 0xFFFFFFFFu) return 0;  /* INT32_MIN % -1 is 0, not a trap */
+    return (uint32_t)((int32_t)a % (int32_t)b);
+}
+
+static inline uint32_t wasm_rt_i32_rem_u(wasm_rt_instance* inst, uint32_t a, uint32_t b) {
+    if (WASM_RT_UNLIKELY(b == 0)) wasm_rt_trap(inst, WASM_RT_TRAP_DIV_BY_ZERO, "integer divide by zero");
+    return a % b;
+}
+
+static inline uint64_t wasm_rt_i64_div_s(wasm_rt_instance* inst, uint64_t a, uint64_t b) {
+    if (WASM_RT_UNLIKELY(b == 0)) wasm_rt_trap(inst, WASM_RT_TRAP_DIV_BY_ZERO, "integer divide by zero");
+    if (WASM_RT_UNLIKELY(a == 0x8000000000000000ull && b == 0xFFFFFFFFFFFFFFFFull))
+        wasm_rt_trap(inst, WASM_RT_TRAP_INT_OVERFLOW, "integer overflow");
+    return (uint64_t)((int64_t)a / (int64_t)b);
+}
+
+static inline uint64_t wasm_rt_i64_div_u(wasm_rt_instance* inst, uint64_t a, uint64_t b) {
+    if (WASM_RT_UNLIKELY(b == 0)) wasm_rt_trap(inst, WASM_RT_TRAP_DIV_BY_ZERO, "integer divide by zero");
+    return a / b;
+}
+
+static inline uint64_t wasm_rt_i64_rem_s(wasm_rt_instance* inst, uint64_t a, uint64_t b) {
+    if (WASM_RT_UNLIKELY(b == 0)) wasm_rt_trap(inst, WASM_RT_TRAP_DIV_BY_ZERO, "integer divide by zero");
+    if (b == 0xFFFFFFFFFFFFFFFFull) return 0;
+    return (uint64_t)((int64_t)a % (int64_t)b);
+}
+
+static inline uint64_t wasm_rt_i64_rem_u(wasm_rt_instance* inst, uint64_t a, uint64_t b) {
+    if (WASM_RT_UNLIKELY(b == 0)) wasm_rt_trap(inst, WASM_RT_TRAP_DIV_BY_ZERO, "integer divide by zero");
+    return a % b;
+}
+
+/* Bit counting and rotation */
+
+static inline uint32_t wasm_rt_i32_clz(uint32_t a) { return a ? (uint32_t)__builtin_clz(a) : 32u; }
+static inline uint32_t wasm_rt_i32_ctz(uint32_t a) { return a ? (uint32_t)__builtin_ctz(a) : 32u; }
+static inline uint32_t wasm_rt_i32_popcnt(uint32_t a) { return (uint32_t)__builtin_popcount(a); }
+static inline uint64_t wasm_rt_i64_clz(uint64_t a) { return a ? (uint64_t)__builtin_clzll(a) : 64u; }
+static inline uint64_t wasm_rt_i64_ctz(uint64_t a) { return a ? (uint64_t)__builtin_ctzll(a) : 64u; }
+static inline uint64_t wasm_rt_i64_popcnt(uint64_t a) { return (uint64_t)__builtin_popcountll(a); }
+
+static inline uint32_t wasm_rt_i32_rotl(uint32_t a, uint32_t b) {
+    b &= 31u;
+    return b ? (a << b) | (a >> (32u - b)) : a;
+}
+static inline uint32_t wasm_rt_i32_rotr(uint32_t a, uint32_t b) {
+    b &= 31u;
+    return b ? (a >> b) | (a << (32u - b)) : a;
+}
+static inline uint64_t wasm_rt_i64_rotl(uint64_t a, uint64_t b) {
+    b &= 63u;
+    return b ? (a << b) | (a >> (64u - b)) : a;
+}
+static inline uint64_t wasm_rt_i64_rotr(uint64_t a, uint64_t b) {
+    b &= 63u;
+    return b ? (a >> b) | (a << (64u - b)) : a;
+}
+
+/* Reinterpretation */
+
+static inline float wasm_rt_f32_from_bits(uint32_t bits) { float f; memcpy(&f, &bits, 4); return f; }
+static inline double wasm_rt_f64_from_bits(uint64_t bits) { double d; memcpy(&d, &bits, 8); return d; }
+static inline uint32_t wasm_rt_f32_bits(float f) { uint32_t bits; memcpy(&bits, &f, 4); return bits; }
+static inline uint64_t wasm_rt_f64_bits(double d) { uint64_t bits; memcpy(&bits, &d, 8); return bits; }
+
+/* Float to integer truncation: trapping and saturating forms */
+
+#define WASM_RT_DEFINE_TRUNC(name, float_t, int_t, result_t, lower, upper)                 \
+    static inline result_t name(wasm_rt_instance* inst, float_t a) {                       \
+        if (WASM_RT_UNLIKELY(isnan(a) || !(a > (lower) && a < (upper))))                  \
+            wasm_rt_trap(inst, WASM_RT_TRAP_INVALID_CONVERSION, "Invalid conversion");    \
+        return (result_t)(int_t)a;                                                         \
+    }
+
+WASM_RT_DEFINE_TRUNC(wasm_rt_i32_trunc_f32_s, float, int32_t, uint32_t, -2147483904.0f, 2147483648.0f)
+WASM_RT_DEFINE_TRUNC(wasm_rt_i32_trunc_f32_u, float, uint32_t, uint32_t, -1.0f, 4294967296.0f)
+WASM_RT_DEFINE_TRUNC(wasm_rt_i32_trunc_f64_s, double, int32_t, uint32_t, -2147483649.0, 2147483648.0)
+WASM_RT_DEFINE_TRUNC(wasm_rt_i32_trunc_f64_u, double, uint32_t, uint32_t, -1.0, 4294967296.0)
+WASM_RT_DEFINE_TRUNC(wasm_rt_i64_trunc_f32_s, float, int64_t, uint64_t, -9223373136366403584.0f, 9223372036854775808.0f)
+WASM_RT_DEFINE_TRUNC(wasm_rt_i64_trunc_f32_u, float, uint64_t, uint64_t, -1.0f, 18446744073709551616.0f)
+WASM_RT_DEFINE_TRUNC(wasm_rt_i64_trunc_f64_s, double, int64_t, uint64_t, -9223372036854777856.0, 9223372036854775808.0)
+WASM_RT_DEFINE_TRUNC(wasm_rt_i64_trunc_f64_u, double, uint64_t, uint64_t, -1.0, 18446744073709551616.0)
+
+#define WASM_RT_DEFINE_TRUNC_SAT(name, float_t, int_t, result_t, lower, upper, min_v, max_v)  \
+    static inline result_t name(float_t a) {                                                 \
+        if (isnan(a)) return 0;                                                              \
+        if (a <= (lower)) return (result_t)(min_v);                                          \
+        if (a >= (upper)) return (result_t)(max_v);                                          \
+        return (result_t)(int_t)a;                                                           \
+    }
+
+WASM_RT_DEFINE_TRUNC_SAT(wasm_rt_i32_trunc_sat_f32_s, float, int32_t, uint32_t, -2147483904.0f, 2147483648.0f, INT32_MIN, INT32_MAX)
+WASM_RT_DEFINE_TRUNC_SAT(wasm_rt_i32_trunc_sat_f32_u, float, uint32_t, uint32_t, -1.0f, 4294967296.0f, 0, UINT32_MAX)
+WASM_RT_DEFINE_TRUNC_SAT(wasm_rt_i32_trunc_sat_f64_s, double, int32_t, uint32_t, -2147483649.0, 2147483648.0, INT32_MIN, INT32_MAX)
+WASM_RT_DEFINE_TRUNC_SAT(wasm_rt_i32_trunc_sat_f64_u, double, uint32_t, uint32_t, -1.0, 4294967296.0, 0, UINT32_MAX)
+WASM_RT_DEFINE_TRUNC_SAT(wasm_rt_i64_trunc_sat_f32_s, float, int64_t, uint64_t, -9223373136366403584.0f, 9223372036854775808.0f, INT64_MIN, INT64_MAX)
+WASM_RT_DEFINE_TRUNC_SAT(wasm_rt_i64_trunc_sat_f32_u, float, uint64_t, uint64_t, -1.0f, 18446744073709551616.0f, 0, UINT64_MAX)
+WASM_RT_DEFINE_TRUNC_SAT(wasm_rt_i64_trunc_sat_f64_s, double, int64_t, uint64_t, -9223372036854777856.0, 9223372036854775808.0, INT64_MIN, INT64_MAX)
+WASM_RT_DEFINE_TRUNC_SAT(wasm_rt_i64_trunc_sat_f64_u, double, uint64_t, uint64_t, -1.0, 18446744073709551616.0, 0, UINT64_MAX)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WASM_RT_H */
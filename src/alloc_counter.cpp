@@ -0,0 +1,57 @@
+#include "alloc_counter.h"
+#include <cstdlib>
+#include <new>
+
+// Replacements for the global allocation functions. Every other form of
+// operator new and delete forwards to these in libstdc++ and libc++.
+
+namespace {
+
+// Plain integers need no dynamic TLS initialization, so counting cannot
+// recurse into operator new
+thread_local uint64_t allocation_count = 0;
+thread_local uint64_t allocation_bytes = 0;
+
+void* allocate(std::size_t size) {
+    allocation_count++;
+    allocation_bytes += size;
+    if (void* pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* allocateAligned(std::size_t size, std::align_val_t alignment) {
+    allocation_count++;
+    allocation_bytes += size;
+    std::size_t align = static_cast<std::size_t>(alignment);
+    // aligned_alloc requires the size to be a multiple of the alignment
+    if (void* pointer = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+} // anonymous namespace
+
+namespace wasm {
+
+AllocationStats threadAllocations() {
+    return {allocation_count, allocation_bytes};
+}
+
+} // namespace wasm
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { std::free(pointer); }
@@ -0,0 +1,1351 @@
+#include "aot.h"
+#include "instructions.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+#ifndef WASM_RT_INCLUDE_DIR
+#define WASM_RT_INCLUDE_DIR "include"
+#endif
+
+namespace wasm {
+
+namespace {
+
+// ===== C type helpers =====
+
+const char* cType(ValueType type) {
+    switch (type) {
+        case ValueType::I32: return "uint32_t";
+        case ValueType::I64: return "uint64_t";
+        case ValueType::F32: return "float";
+        case ValueType::F64: return "double";
+        default: return "void";
+    }
+}
+
+// Suffix distinguishing the per-type variables of one stack slot
+char slotSuffix(ValueType type) {
+    switch (type) {
+        case ValueType::I32: return 'i';
+        case ValueType::I64: return 'j';
+        case ValueType::F32: return 'f';
+        default: return 'd';
+    }
+}
+
+size_t slotTypeIndex(ValueType type) {
+    switch (type) {
+        case ValueType::I32: return 0;
+        case ValueType::I64: return 1;
+        case ValueType::F32: return 2;
+        default: return 3;
+    }
+}
+
+bool isNumeric(ValueType type) {
+    return type == ValueType::I32 || type == ValueType::I64 || type == ValueType::F32 || type == ValueType::F64;
+}
+
+const ValueType SLOT_TYPES[4] = {ValueType::I32, ValueType::I64, ValueType::F32, ValueType::F64};
+
+const char* runtimeTypeName(ValueType type) {
+    switch (type) {
+        case ValueType::I32: return "WASM_RT_I32";
+        case ValueType::I64: return "WASM_RT_I64";
+        case ValueType::F32: return "WASM_RT_F32";
+        default: return "WASM_RT_F64";
+    }
+}
+
+// Read a wasm_rt_value field as the C type used for locals
+std::string fromRuntimeValue(const std::string& value, ValueType type) {
+    switch (type) {
+        case ValueType::I32: return "(uint32_t)" + value + ".value.i32";
+        case ValueType::I64: return "(uint64_t)" + value + ".value.i64";
+        case ValueType::F32: return value + ".value.f32";
+        default: return value + ".value.f64";
+    }
+}
+
+// Store a C value into a wasm_rt_value field
+std::string toRuntimeValue(const std::string& value, ValueType type, const std::string& expr) {
+    switch (type) {
+        case ValueType::I32: return value + ".value.i32 = (int32_t)" + expr + ";";
+        case ValueType::I64: return value + ".value.i64 = (int64_t)" + expr + ";";
+        case ValueType::F32: return value + ".value.f32 = " + expr + ";";
+        default: return value + ".value.f64 = " + expr + ";";
+    }
+}
+
+std::string hex(uint64_t value, int digits) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "0x%0*llX", digits, static_cast<unsigned long long>(value));
+    return buffer;
+}
+
+std::string cStringLiteral(std::string_view text) {
+    std::string result = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += static_cast<char>(c);
+        } else if (c < 0x20 || c >= 0x7F) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\%03o", c);
+            result += buffer;
+        } else {
+            result += static_cast<char>(c);
+        }
+    }
+    return result + "\"";
+}
+
+// C symbol for a function: the index keeps it unique, the sanitized guest
+// name lets profilers and debuggers attribute the code without a map
+std::string functionSymbol(const Module& module, uint32_t func_index) {
+    constexpr size_t MAX_NAME_LENGTH = 48;
+    std::string symbol = "w2c_f" + std::to_string(func_index);
+    std::string name = module.functionName(func_index);
+    if (!name.empty()) {
+        symbol += "_";
+        for (size_t i = 0; i < name.size() && i < MAX_NAME_LENGTH; i++) {
+            unsigned char c = static_cast<unsigned char>(name[i]);
+            symbol += std::isalnum(c) ? static_cast<char>(c) : '_';
+        }
+    }
+    return symbol;
+}
+
+// C parameter list for a signature: instance first, then l0..lN-1
+std::string parameterList(const FuncType& type) {
+    std::string params = "wasm_rt_instance* inst";
+    for (size_t i = 0; i < type.params.size(); i++) {
+        params += ", ";
+        params += cType(type.params[i]);
+        params += " l" + std::to_string(i);
+    }
+    return params;
+}
+
+std::string resultType(const FuncType& type) {
+    return type.results.empty() ? "void" : cType(type.results[0]);
+}
+
+std::string prototype(const FuncType& type, const std::string& symbol) {
+    return "static " + resultType(type) + " " + symbol + "(" + parameterList(type) + ")";
+}
+
+// ===== Bytecode reading =====
+
+class BodyReader {
+public:
+    BodyReader(const uint8_t* data, size_t size) : data_(data), size_(size), pos_(0) {}
+
+    bool atEnd() const { return pos_ >= size_; }
+
+    uint8_t readByte() {
+        if (pos_ >= size_) {
+            throw AotError("Unexpected end of function body");
+        }
+        return data_[pos_++];
+    }
+
+    uint64_t readUnsigned(unsigned max_bits) {
+        uint64_t result = 0;
+        unsigned shift = 0;
+        uint8_t byte;
+        do {
+            if (shift >= max_bits + 7) {
+                throw AotError("LEB128 immediate too long");
+            }
+            byte = readByte();
+            result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        return result;
+    }
+
+    int64_t readSigned(unsigned max_bits) {
+        int64_t result = 0;
+        unsigned shift = 0;
+        uint8_t byte;
+        do {
+            if (shift >= max_bits + 7) {
+                throw AotError("LEB128 immediate too long");
+            }
+            byte = readByte();
+            result |= static_cast<int64_t>(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        if (shift < 64 && (byte & 0x40)) {
+            result |= -(static_cast<int64_t>(1) << shift);
+        }
+        return result;
+    }
+
+    uint32_t readU32() { return static_cast<uint32_t>(readUnsigned(32)); }
+
+    // Past the immediates of an instruction, as the opcode table describes them
+    void skipImmediates(uint8_t opcode) {
+        if (!wasm::skipImmediates(opcode, data_, size_, pos_)) {
+            throw AotError("Truncated instruction or unknown sub-opcode in function body");
+        }
+    }
+
+    uint64_t readFixed(size_t bytes) {
+        uint64_t result = 0;
+        for (size_t i = 0; i < bytes; i++) {
+            result |= static_cast<uint64_t>(readByte()) << (8 * i);
+        }
+        return result;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_;
+};
+
+// ===== Operator templates =====
+// $a and $b stand for the operand variables; the result replaces the
+// left operand's stack slot.
+
+struct OperatorInfo {
+    uint8_t arity;          // 0 if the opcode is not a simple operator
+    ValueType operand;
+    ValueType result;
+    const char* pattern;
+};
+
+OperatorInfo numericOperator(uint8_t opcode) {
+    const ValueType I32 = ValueType::I32, I64 = ValueType::I64;
+    const ValueType F32 = ValueType::F32, F64 = ValueType::F64;
+
+    switch (static_cast<Opcode>(opcode)) {
+        // i32 comparisons
+        case Opcode::I32_EQZ: return {1, I32, I32, "(uint32_t)($a == 0)"};
+        case Opcode::I32_EQ: return {2, I32, I32, "(uint32_t)($a == $b)"};
+        case Opcode::I32_NE: return {2, I32, I32, "(uint32_t)($a != $b)"};
+        case Opcode::I32_LT_S: return {2, I32, I32, "(uint32_t)((int32_t)$a < (int32_t)$b)"};
+        case Opcode::I32_LT_U: return {2, I32, I32, "(uint32_t)($a < $b)"};
+        case Opcode::I32_GT_S: return {2, I32, I32, "(uint32_t)((int32_t)$a > (int32_t)$b)"};
+        case Opcode::I32_GT_U: return {2, I32, I32, "(uint32_t)($a > $b)"};
+        case Opcode::I32_LE_S: return {2, I32, I32, "(uint32_t)((int32_t)$a <= (int32_t)$b)"};
+        case Opcode::I32_LE_U: return {2, I32, I32, "(uint32_t)($a <= $b)"};
+        case Opcode::I32_GE_S: return {2, I32, I32, "(uint32_t)((int32_t)$a >= (int32_t)$b)"};
+        case Opcode::I32_GE_U: return {2, I32, I32, "(uint32_t)($a >= $b)"};
+
+        // i64 comparisons
+        case Opcode::I64_EQZ: return {1, I64, I32, "(uint32_t)($a == 0)"};
+        case Opcode::I64_EQ: return {2, I64, I32, "(uint32_t)($a == $b)"};
+        case Opcode::I64_NE: return {2, I64, I32, "(uint32_t)($a != $b)"};
+        case Opcode::I64_LT_S: return {2, I64, I32, "(uint32_t)((int64_t)$a < (int64_t)$b)"};
+        case Opcode::I64_LT_U: return {2, I64, I32, "(uint32_t)($a < $b)"};
+        case Opcode::I64_GT_S: return {2, I64, I32, "(uint32_t)((int64_t)$a > (int64_t)$b)"};
+        case Opcode::I64_GT_U: return {2, I64, I32, "(uint32_t)($a > $b)"};
+        case Opcode::I64_LE_S: return {2, I64, I32, "(uint32_t)((int64_t)$a <= (int64_t)$b)"};
+        case Opcode::I64_LE_U: return {2, I64, I32, "(uint32_t)($a <= $b)"};
+        case Opcode::I64_GE_S: return {2, I64, I32, "(uint32_t)((int64_t)$a >= (int64_t)$b)"};
+        case Opcode::I64_GE_U: return {2, I64, I32, "(uint32_t)($a >= $b)"};
+
+        // Float comparisons
+        case Opcode::F32_EQ: return {2, F32, I32, "(uint32_t)($a == $b)"};
+        case Opcode::F32_NE: return {2, F32, I32, "(uint32_t)($a != $b)"};
+        case Opcode::F32_LT: return {2, F32, I32, "(uint32_t)($a < $b)"};
+        case Opcode::F32_GT: return {2, F32, I32, "(uint32_t)($a > $b)"};
+        case Opcode::F32_LE: return {2, F32, I32, "(uint32_t)($a <= $b)"};
+        case Opcode::F32_GE: return {2, F32, I32, "(uint32_t)($a >= $b)"};
+        case Opcode::F64_EQ: return {2, F64, I32, "(uint32_t)($a == $b)"};
+        case Opcode::F64_NE: return {2, F64, I32, "(uint32_t)($a != $b)"};
+        case Opcode::F64_LT: return {2, F64, I32, "(uint32_t)($a < $b)"};
+        case Opcode::F64_GT: return {2, F64, I32, "(uint32_t)($a > $b)"};
+        case Opcode::F64_LE: return {2, F64, I32, "(uint32_t)($a <= $b)"};
+        case Opcode::F64_GE: return {2, F64, I32, "(uint32_t)($a >= $b)"};
+
+        // i32 arithmetic
+        case Opcode::I32_CLZ: return {1, I32, I32, "wasm_rt_i32_clz($a)"};
+        case Opcode::I32_CTZ: return {1, I32, I32, "wasm_rt_i32_ctz($a)"};
+        case Opcode::I32_POPCNT: return {1, I32, I32, "wasm_rt_i32_popcnt($a)"};
+        case Opcode::I32_ADD: return {2, I32, I32, "$a + $b"};
+        case Opcode::I32_SUB: return {2, I32, I32, "$a - $b"};
+        case Opcode::I32_MUL: return {2, I32, I32, "$a * $b"};
+        case Opcode::I32_DIV_S: return {2, I32, I32, "wasm_rt_i32_div_s(inst, $a, $b)"};
+        case Opcode::I32_DIV_U: return {2, I32, I32, "wasm_rt_i32_div_u(inst, $a, $b)"};
+        case Opcode::I32_REM_S: return {2, I32, I32, "wasm_rt_i32_rem_s(inst, $a, $b)"};
+        case Opcode::I32_REM_U: return {2, I32, I32, "wasm_rt_i32_rem_u(inst, $a, $b)"};
+        case Opcode::I32_AND: return {2, I32, I32, "$a & $b"};
+        case Opcode::I32_OR: return {2, I32, I32, "$a | $b"};
+        case Opcode::I32_XOR: return {2, I32, I32, "$a ^ $b"};
+        case Opcode::I32_SHL: return {2, I32, I32, "$a << ($b & 31u)"};
+        case Opcode::I32_SHR_S: return {2, I32, I32, "(uint32_t)((int32_t)$a >> ($b & 31u))"};
+        case Opcode::I32_SHR_U: return {2, I32, I32, "$a >> ($b & 31u)"};
+        case Opcode::I32_ROTL: return {2, I32, I32, "wasm_rt_i32_rotl($a, $b)"};
+        case Opcode::I32_ROTR: return {2, I32, I32, "wasm_rt_i32_rotr($a, $b)"};
+
+        // i64 arithmetic
+        case Opcode::I64_CLZ: return {1, I64, I64, "wasm_rt_i64_clz($a)"};
+        case Opcode::I64_CTZ: return {1, I64, I64, "wasm_rt_i64_ctz($a)"};
+        case Opcode::I64_POPCNT: return {1, I64, I64, "wasm_rt_i64_popcnt($a)"};
+        case Opcode::I64_ADD: return {2, I64, I64, "$a + $b"};
+        case Opcode::I64_SUB: return {2, I64, I64, "$a - $b"};
+        case Opcode::I64_MUL: return {2, I64, I64, "$a * $b"};
+        case Opcode::I64_DIV_S: return {2, I64, I64, "wasm_rt_i64_div_s(inst, $a, $b)"};
+        case Opcode::I64_DIV_U: return {2, I64, I64, "wasm_rt_i64_div_u(inst, $a, $b)"};
+        case Opcode::I64_REM_S: return {2, I64, I64, "wasm_rt_i64_rem_s(inst, $a, $b)"};
+        case Opcode::I64_REM_U: return {2, I64, I64, "wasm_rt_i64_rem_u(inst, $a, $b)"};
+        case Opcode::I64_AND: return {2, I64, I64, "$a & $b"};
+        case Opcode::I64_OR: return {2, I64, I64, "$a | $b"};
+        case Opcode::I64_XOR: return {2, I64, I64, "$a ^ $b"};
+        case Opcode::I64_SHL: return {2, I64, I64, "$a << ($b & 63u)"};
+        case Opcode::I64_SHR_S: return {2, I64, I64, "(uint64_t)((int64_t)$a >> ($b & 63u))"};
+        case Opcode::I64_SHR_U: return {2, I64, I64, "$a >> ($b & 63u)"};
+        case Opcode::I64_ROTL: return {2, I64, I64, "wasm_rt_i64_rotl($a, $b)"};
+        case Opcode::I64_ROTR: return {2, I64, I64, "wasm_rt_i64_rotr($a, $b)"};
+
+        // f32 arithmetic (mirrors the interpreter's libm choices)
+        case Opcode::F32_ABS: return {1, F32, F32, "fabsf($a)"};
+        case Opcode::F32_NEG: return {1, F32, F32, "-$a"};
+        case Opcode::F32_CEIL: return {1, F32, F32, "ceilf($a)"};
+        case Opcode::F32_FLOOR: return {1, F32, F32, "floorf($a)"};
+        case Opcode::F32_TRUNC: return {1, F32, F32, "truncf($a)"};
+        case Opcode::F32_NEAREST: return {1, F32, F32, "nearbyintf($a)"};
+        case Opcode::F32_SQRT: return {1, F32, F32, "sqrtf($a)"};
+        case Opcode::F32_ADD: return {2, F32, F32, "$a + $b"};
+        case Opcode::F32_SUB: return {2, F32, F32, "$a - $b"};
+        case Opcode::F32_MUL: return {2, F32, F32, "$a * $b"};
+        case Opcode::F32_DIV: return {2, F32, F32, "$a / $b"};
+        case Opcode::F32_MIN: return {2, F32, F32, "fminf($a, $b)"};
+        case Opcode::F32_MAX: return {2, F32, F32, "fmaxf($a, $b)"};
+        case Opcode::F32_COPYSIGN: return {2, F32, F32, "copysignf($a, $b)"};
+
+        // f64 arithmetic
+        case Opcode::F64_ABS: return {1, F64, F64, "fabs($a)"};
+        case Opcode::F64_NEG: return {1, F64, F64, "-$a"};
+        case Opcode::F64_CEIL: return {1, F64, F64, "ceil($a)"};
+        case Opcode::F64_FLOOR: return {1, F64, F64, "floor($a)"};
+        case Opcode::F64_TRUNC: return {1, F64, F64, "trunc($a)"};
+        case Opcode::F64_NEAREST: return {1, F64, F64, "nearbyint($a)"};
+        case Opcode::F64_SQRT: return {1, F64, F64, "sqrt($a)"};
+        case Opcode::F64_ADD: return {2, F64, F64, "$a + $b"};
+        case Opcode::F64_SUB: return {2, F64, F64, "$a - $b"};
+        case Opcode::F64_MUL: return {2, F64, F64, "$a * $b"};
+        case Opcode::F64_DIV: return {2, F64, F64, "$a / $b"};
+        case Opcode::F64_MIN: return {2, F64, F64, "fmin($a, $b)"};
+        case Opcode::F64_MAX: return {2, F64, F64, "fmax($a, $b)"};
+        case Opcode::F64_COPYSIGN: return {2, F64, F64, "copysign($a, $b)"};
+
+        // Conversions
+        case Opcode::I32_WRAP_I64: return {1, I64, I32, "(uint32_t)$a"};
+        case Opcode::I32_TRUNC_F32_S: return {1, F32, I32, "wasm_rt_i32_trunc_f32_s(inst, $a)"};
+        case Opcode::I32_TRUNC_F32_U: return {1, F32, I32, "wasm_rt_i32_trunc_f32_u(inst, $a)"};
+        case Opcode::I32_TRUNC_F64_S: return {1, F64, I32, "wasm_rt_i32_trunc_f64_s(inst, $a)"};
+        case Opcode::I32_TRUNC_F64_U: return {1, F64, I32, "wasm_rt_i32_trunc_f64_u(inst, $a)"};
+        case Opcode::I64_EXTEND_I32_S: return {1, I32, I64, "(uint64_t)(int64_t)(int32_t)$a"};
+        case Opcode::I64_EXTEND_I32_U: return {1, I32, I64, "(uint64_t)$a"};
+        case Opcode::I64_TRUNC_F32_S: return {1, F32, I64, "wasm_rt_i64_trunc_f32_s(inst, $a)"};
+        case Opcode::I64_TRUNC_F32_U: return {1, F32, I64, "wasm_rt_i64_trunc_f32_u(inst, $a)"};
+        case Opcode::I64_TRUNC_F64_S: return {1, F64, I64, "wasm_rt_i64_trunc_f64_s(inst, $a)"};
+        case Opcode::I64_TRUNC_F64_U: return {1, F64, I64, "wasm_rt_i64_trunc_f64_u(inst, $a)"};
+        case Opcode::F32_CONVERT_I32_S: return {1, I32, F32, "(float)(int32_t)$a"};
+        case Opcode::F32_CONVERT_I32_U: return {1, I32, F32, "(float)$a"};
+        case Opcode::F32_CONVERT_I64_S: return {1, I64, F32, "(float)(int64_t)$a"};
+        case Opcode::F32_CONVERT_I64_U: return {1, I64, F32, "(float)$a"};
+        case Opcode::F32_DEMOTE_F64: return {1, F64, F32, "(float)$a"};
+        case Opcode::F64_CONVERT_I32_S: return {1, I32, F64, "(double)(int32_t)$a"};
+        case Opcode::F64_CONVERT_I32_U: return {1, I32, F64, "(double)$a"};
+        case Opcode::F64_CONVERT_I64_S: return {1, I64, F64, "(double)(int64_t)$a"};
+        case Opcode::F64_CONVERT_I64_U: return {1, I64, F64, "(double)$a"};
+        case Opcode::F64_PROMOTE_F32: return {1, F32, F64, "(double)$a"};
+        case Opcode::I32_REINTERPRET_F32: return {1, F32, I32, "wasm_rt_f32_bits($a)"};
+        case Opcode::I64_REINTERPRET_F64: return {1, F64, I64, "wasm_rt_f64_bits($a)"};
+        case Opcode::F32_REINTERPRET_I32: return {1, I32, F32, "wasm_rt_f32_from_bits($a)"};
+        case Opcode::F64_REINTERPRET_I64: return {1, I64, F64, "wasm_rt_f64_from_bits($a)"};
+
+        default: return {0, I32, I32, nullptr};
+    }
+}
+
+// 0xFC 0x00-0x07: saturating truncation
+OperatorInfo saturatingOperator(uint32_t sub_opcode) {
+    const ValueType I32 = ValueType::I32, I64 = ValueType::I64;
+    const ValueType F32 = ValueType::F32, F64 = ValueType::F64;
+
+    switch (sub_opcode) {
+        case 0x00: return {1, F32, I32, "wasm_rt_i32_trunc_sat_f32_s($a)"};
+        case 0x01: return {1, F32, I32, "wasm_rt_i32_trunc_sat_f32_u($a)"};
+        case 0x02: return {1, F64, I32, "wasm_rt_i32_trunc_sat_f64_s($a)"};
+        case 0x03: return {1, F64, I32, "wasm_rt_i32_trunc_sat_f64_u($a)"};
+        case 0x04: return {1, F32, I64, "wasm_rt_i64_trunc_sat_f32_s($a)"};
+        case 0x05: return {1, F32, I64, "wasm_rt_i64_trunc_sat_f32_u($a)"};
+        case 0x06: return {1, F64, I64, "wasm_rt_i64_trunc_sat_f64_s($a)"};
+        case 0x07: return {1, F64, I64, "wasm_rt_i64_trunc_sat_f64_u($a)"};
+        default: return {0, I32, I32, nullptr};
+    }
+}
+
+struct MemoryOperator {
+    bool is_store;
+    ValueType type;
+    uint32_t size;          // Bytes accessed
+    const char* helper;
+};
+
+bool memoryOperator(uint8_t opcode, MemoryOperator& op) {
+    switch (static_cast<Opcode>(opcode)) {
+        case Opcode::I32_LOAD: op = {false, ValueType::I32, 4, "wasm_rt_i32_load"}; return true;
+        case Opcode::I64_LOAD: op = {false, ValueType::I64, 8, "wasm_rt_i64_load"}; return true;
+        case Opcode::F32_LOAD: op = {false, ValueType::F32, 4, "wasm_rt_f32_load"}; return true;
+        case Opcode::F64_LOAD: op = {false, ValueType::F64, 8, "wasm_rt_f64_load"}; return true;
+        case Opcode::I32_LOAD8_S: op = {false, ValueType::I32, 1, "wasm_rt_i32_load8_s"}; return true;
+        case Opcode::I32_LOAD8_U: op = {false, ValueType::I32, 1, "wasm_rt_i32_load8_u"}; return true;
+        case Opcode::I32_LOAD16_S: op = {false, ValueType::I32, 2, "wasm_rt_i32_load16_s"}; return true;
+        case Opcode::I32_LOAD16_U: op = {false, ValueType::I32, 2, "wasm_rt_i32_load16_u"}; return true;
+        case Opcode::I64_LOAD8_S: op = {false, ValueType::I64, 1, "wasm_rt_i64_load8_s"}; return true;
+        case Opcode::I64_LOAD8_U: op = {false, ValueType::I64, 1, "wasm_rt_i64_load8_u"}; return true;
+        case Opcode::I64_LOAD16_S: op = {false, ValueType::I64, 2, "wasm_rt_i64_load16_s"}; return true;
+        case Opcode::I64_LOAD16_U: op = {false, ValueType::I64, 2, "wasm_rt_i64_load16_u"}; return true;
+        case Opcode::I64_LOAD32_S: op = {false, ValueType::I64, 4, "wasm_rt_i64_load32_s"}; return true;
+        case Opcode::I64_LOAD32_U: op = {false, ValueType::I64, 4, "wasm_rt_i64_load32_u"}; return true;
+        case Opcode::I32_STORE: op = {true, ValueType::I32, 4, "wasm_rt_i32_store"}; return true;
+        case Opcode::I64_STORE: op = {true, ValueType::I64, 8, "wasm_rt_i64_store"}; return true;
+        case Opcode::F32_STORE: op = {true, ValueType::F32, 4, "wasm_rt_f32_store"}; return true;
+        case Opcode::F64_STORE: op = {true, ValueType::F64, 8, "wasm_rt_f64_store"}; return true;
+        case Opcode::I32_STORE8: op = {true, ValueType::I32, 1, "wasm_rt_i32_store8"}; return true;
+        case Opcode::I32_STORE16: op = {true, ValueType::I32, 2, "wasm_rt_i32_store16"}; return true;
+        case Opcode::I64_STORE8: op = {true, ValueType::I64, 1, "wasm_rt_i64_store8"}; return true;
+        case Opcode::I64_STORE16: op = {true, ValueType::I64, 2, "wasm_rt_i64_store16"}; return true;
+        case Opcode::I64_STORE32: op = {true, ValueType::I64, 4, "wasm_rt_i64_store32"}; return true;
+        default: return false;
+    }
+}
+
+std::string substitute(const char* pattern, const std::string& a, const std::string& b) {
+    std::string result;
+    for (const char* p = pattern; *p; p++) {
+        if (p[0] == '$' && p[1] == 'a') {
+            result += a;
+            p++;
+        } else if (p[0] == '$' && p[1] == 'b') {
+            result += b;
+            p++;
+        } else {
+            result += *p;
+        }
+    }
+    return result;
+}
+
+// ===== Module-level translation state =====
+
+struct ModuleInfo {
+    const Module& module;
+    uint32_t import_count;
+    bool optimize;
+    std::vector<uint32_t> canonical_types;  // Type index -> first structurally equal type
+    std::vector<ValueType> global_types;    // Global index space
+    uint64_t min_memory_bytes;              // Memory never shrinks below its initial size
+    std::vector<std::string> symbols;       // C symbol per function index
+
+    ModuleInfo(const Module& m, bool opt)
+        : module(m), import_count(m.getImportedFunctionCount()), optimize(opt), min_memory_bytes(0) {
+        canonical_types.resize(m.types.size());
+        for (uint32_t i = 0; i < m.types.size(); i++) {
+            canonical_types[i] = i;
+            for (uint32_t j = 0; j < i; j++) {
+                if (m.types[j] == m.types[i]) {
+                    canonical_types[i] = j;
+                    break;
+                }
+            }
+        }
+
+        for (uint32_t i = 0; i < m.getImportedGlobalCount(); i++) {
+            global_types.push_back(m.getImport(ExternalKind::GLOBAL, i)->global.type);
+        }
+        for (const auto& global : m.globals) {
+            global_types.push_back(global.type);
+        }
+
+        const Import* memory_import = m.getImport(ExternalKind::MEMORY, 0);
+        if (memory_import) {
+            min_memory_bytes = static_cast<uint64_t>(memory_import->memory.limits.min) * WASM_RT_PAGE_SIZE;
+        } else if (!m.memories.empty()) {
+            min_memory_bytes = static_cast<uint64_t>(m.memories[0].limits.min) * WASM_RT_PAGE_SIZE;
+        }
+
+        for (uint32_t i = 0; i < m.getTotalFunctionCount(); i++) {
+            symbols.push_back(functionSymbol(m, i));
+        }
+    }
+
+    const FuncType& functionType(uint32_t func_index) const {
+        const FuncType* type = module.getFunctionType(func_index);
+        if (!type) {
+            throw AotError("Function " + std::to_string(func_index) + " has an invalid type");
+        }
+        return *type;
+    }
+};
+
+/**
+ * Translates one function body.
+ * The operand stack is tracked at translation time: stack slot N holding
+ * a value of type T is the C variable sN_<t>, so every instruction becomes
+ * an assignment between named variables that the C compiler allocates to
+ * registers.
+ */
+class FunctionEmitter {
+public:
+    FunctionEmitter(const ModuleInfo& info, uint32_t func_index)
+        : info_(info), func_index_(func_index), type_(info.functionType(func_index)),
+          next_label_(0), unreachable_(false), dead_depth_(0) {}
+
+    std::string emit();
+
+private:
+    enum class ControlKind { FUNCTION, BLOCK, LOOP, IF };
+
+    struct Control {
+        ControlKind kind;
+        uint32_t label;
+        ValueType result;
+        size_t height;          // Operand stack height at entry
+        bool has_else;
+    };
+
+    const ModuleInfo& info_;
+    uint32_t func_index_;
+    const FuncType& type_;
+
+    std::vector<ValueType> locals_;
+    std::vector<ValueType> stack_;
+    std::vector<Control> controls_;
+    std::vector<uint8_t> used_slots_;   // Bit per slot type, per depth
+    std::vector<int64_t> constants_;    // Known i32 constant per depth, or -1
+    std::ostringstream body_;
+    uint32_t next_label_;
+    bool unreachable_;
+    uint32_t dead_depth_;
+
+    std::string slot(size_t depth, ValueType type) {
+        if (used_slots_.size() <= depth) {
+            used_slots_.resize(depth + 1, 0);
+        }
+        used_slots_[depth] |= static_cast<uint8_t>(1u << slotTypeIndex(type));
+        return "s" + std::to_string(depth) + "_" + slotSuffix(type);
+    }
+
+    std::string push(ValueType type) {
+        stack_.push_back(type);
+        if (constants_.size() < stack_.size()) {
+            constants_.resize(stack_.size());
+        }
+        constants_[stack_.size() - 1] = -1;
+        return slot(stack_.size() - 1, type);
+    }
+
+    // Optimized code caches the memory base and size in locals; anything
+    // that can grow memory (calls, memory.grow) must refresh them
+    void reloadMemory() {
+        if (info_.optimize) {
+            line("w2c_mem = inst->memory; w2c_mem_size = inst->memory_size;");
+        }
+    }
+
+    std::string pop() {
+        if (stack_.size() <= controls_.back().height) {
+            fail("operand stack underflow");
+        }
+        ValueType type = stack_.back();
+        stack_.pop_back();
+        return slot(stack_.size(), type);
+    }
+
+    std::string top() {
+        if (stack_.empty()) {
+            fail("operand stack underflow");
+        }
+        return slot(stack_.size() - 1, stack_.back());
+    }
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw AotError("Function " + std::to_string(func_index_) + ": " + message);
+    }
+
+    // Empty or one numeric result; type-index (multi-value) block types are
+    // left to the interpreter
+    ValueType readBlockType(BodyReader& reader) const {
+        ValueType type = static_cast<ValueType>(reader.readByte());
+        if (type != ValueType::VOID && !isNumeric(type)) {
+            fail("unsupported block type");
+        }
+        return type;
+    }
+
+    void line(const std::string& statement) { body_ << "  " << statement << "\n"; }
+
+    std::string label(const Control& control) const { return "L" + std::to_string(control.label); }
+
+    std::string returnStatement();
+    std::string branchStatement(uint32_t depth);
+    void emitInstruction(uint8_t opcode, BodyReader& reader);
+    void emitEnd();
+    void emitElse();
+    void emitCall(uint32_t callee);
+    void emitCallIndirect(uint32_t type_index);
+    void emitMemoryAccess(const MemoryOperator& memory_op, uint32_t offset);
+    void skipImmediates(uint8_t opcode, BodyReader& reader);
+};
+
+std::string FunctionEmitter::emit() {
+    // Locals: parameters first, then declared locals
+    locals_ = type_.params;
+    Function func = info_.module.functions[func_index_ - info_.import_count];
+    locals_.insert(locals_.end(), func.locals.begin(), func.locals.end());
+    for (ValueType type : locals_) {
+        if (!isNumeric(type)) {
+            fail("reference-typed parameters and locals are not supported");
+        }
+    }
+    for (ValueType type : type_.results) {
+        if (!isNumeric(type)) {
+            fail("reference-typed results are not supported");
+        }
+    }
+
+    ValueType result = type_.results.empty() ? ValueType::VOID : type_.results[0];
+    controls_.push_back({ControlKind::FUNCTION, next_label_++, result, 0, false});
+
+    BodyReader reader(func.body.data(), func.body.size());
+    while (!controls_.empty()) {
+        if (reader.atEnd()) {
+            fail("missing end of function body");
+        }
+        uint8_t opcode = reader.readByte();
+
+        if (unreachable_) {
+            // Skip dead code up to the end or else of the current block
+            Opcode op = static_cast<Opcode>(opcode);
+            if (op == Opcode::BLOCK || op == Opcode::LOOP || op == Opcode::IF) {
+                readBlockType(reader);
+                dead_depth_++;
+                continue;
+            }
+            if (dead_depth_ > 0) {
+                if (op == Opcode::END) {
+                    dead_depth_--;
+                } else if (op != Opcode::ELSE) {
+                    skipImmediates(opcode, reader);
+                }
+                continue;
+            }
+            if (op != Opcode::END && op != Opcode::ELSE) {
+                skipImmediates(opcode, reader);
+                continue;
+            }
+        }
+
+        emitInstruction(opcode, reader);
+    }
+
+    std::ostringstream out;
+    out << prototype(type_, info_.symbols[func_index_]) << " {\n";
+    for (size_t i = type_.params.size(); i < locals_.size(); i++) {
+        out << "  " << cType(locals_[i]) << " l" << i << " = 0;\n";
+    }
+    for (size_t depth = 0; depth < used_slots_.size(); depth++) {
+        for (size_t t = 0; t < 4; t++) {
+            if (used_slots_[depth] & (1u << t)) {
+                out << "  " << cType(SLOT_TYPES[t]) << " s" << depth << "_"
+                    << slotSuffix(SLOT_TYPES[t]) << " = 0;\n";
+            }
+        }
+    }
+    if (info_.optimize) {
+        out << "  uint8_t* w2c_mem = inst->memory;\n"
+            << "  uint64_t w2c_mem_size = inst->memory_size;\n";
+    }
+    out << "  if (WASM_RT_UNLIKELY(++inst->call_depth > WASM_RT_MAX_CALL_DEPTH))\n"
+        << "    wasm_rt_trap(inst, WASM_RT_TRAP_CALL_STACK_EXHAUSTED, \"call stack exhausted\");\n";
+    out << body_.str();
+    out << "}\n\n";
+    return out.str();
+}
+
+std::string FunctionEmitter::returnStatement() {
+    if (type_.results.empty()) {
+        return "inst->call_depth--; return;";
+    }
+    return "inst->call_depth--; return " + top() + ";";
+}
+
+std::string FunctionEmitter::branchStatement(uint32_t depth) {
+    if (depth >= controls_.size()) {
+        fail("branch depth out of range");
+    }
+    const Control& target = controls_[controls_.size() - 1 - depth];
+
+    if (target.kind == ControlKind::FUNCTION) {
+        return returnStatement();
+    }
+    if (target.kind == ControlKind::LOOP) {
+        return "goto " + label(target) + "_loop;";
+    }
+
+    std::string statement;
+    if (target.result != ValueType::VOID) {
+        std::string value = top();
+        std::string dest = slot(target.height, target.result);
+        if (value != dest) {
+            statement = dest + " = " + value + "; ";
+        }
+    }
+    return statement + "goto " + label(target) + ";";
+}
+
+void FunctionEmitter::emitEnd() {
+    Control control = controls_.back();
+
+    if (control.kind == ControlKind::FUNCTION) {
+        if (!unreachable_) {
+            line(returnStatement());
+        }
+        controls_.pop_back();
+        return;
+    }
+
+    // Fallthrough delivers the block result to the slot at the entry height
+    if (!unreachable_ && control.result != ValueType::VOID) {
+        std::string value = top();
+        std::string dest = slot(control.height, control.result);
+        if (value != dest) {
+            line(dest + " = " + value + ";");
+        }
+    }
+
+    if (control.kind == ControlKind::IF && !control.has_else) {
+        body_ << label(control) << "_else:;\n";
+    }
+    if (control.kind != ControlKind::LOOP) {
+        body_ << label(control) << ":;\n";
+    }
+
+    controls_.pop_back();
+    stack_.resize(control.height);
+    if (control.result != ValueType::VOID) {
+        push(control.result);
+    }
+    unreachable_ = false;
+}
+
+void FunctionEmitter::emitElse() {
+    Control& control = controls_.back();
+    if (control.kind != ControlKind::IF || control.has_else) {
+        fail("else without matching if");
+    }
+
+    if (!unreachable_) {
+        if (control.result != ValueType::VOID) {
+            std::string value = top();
+            std::string dest = slot(control.height, control.result);
+            if (value != dest) {
+                line(dest + " = " + value + ";");
+            }
+        }
+        line("goto " + label(control) + ";");
+    }
+    body_ << label(control) << "_else:;\n";
+
+    control.has_else = true;
+    stack_.resize(control.height);
+    unreachable_ = false;
+}
+
+void FunctionEmitter::emitCall(uint32_t callee) {
+    const FuncType& callee_type = info_.functionType(callee);
+    size_t param_count = callee_type.params.size();
+    if (stack_.size() < controls_.back().height + param_count) {
+        fail("operand stack underflow at call");
+    }
+
+    size_t base = stack_.size() - param_count;
+    std::string call = info_.symbols[callee] + "(inst";
+    for (size_t i = 0; i < param_count; i++) {
+        call += ", " + slot(base + i, stack_[base + i]);
+    }
+    call += ")";
+    stack_.resize(base);
+
+    if (callee_type.results.empty()) {
+        line(call + ";");
+    } else {
+        line(push(callee_type.results[0]) + " = " + call + ";");
+    }
+    reloadMemory();
+}
+
+void FunctionEmitter::emitCallIndirect(uint32_t type_index) {
+    if (type_index >= info_.module.types.size()) {
+        fail("call_indirect type index out of range");
+    }
+    const FuncType& callee_type = info_.module.types[type_index];
+    uint32_t canonical = info_.canonical_types[type_index];
+
+    std::string element = pop();
+    size_t param_count = callee_type.params.size();
+    if (stack_.size() < controls_.back().height + param_count) {
+        fail("operand stack underflow at call_indirect");
+    }
+
+    size_t base = stack_.size() - param_count;
+    std::string call = "((w2c_sig" + std::to_string(canonical) + ")w2c_funcs[w2c_callee])(inst";
+    for (size_t i = 0; i < param_count; i++) {
+        call += ", " + slot(base + i, stack_[base + i]);
+    }
+    call += ")";
+    stack_.resize(base);
+
+    line("{");
+    line("  uint32_t w2c_callee;");
+    line("  if (" + element + " >= inst->table_size || inst->table[" + element +
+         "] >= W2C_FUNCTION_COUNT)");
+    line("    wasm_rt_trap(inst, WASM_RT_TRAP_UNDEFINED_ELEMENT, \"Undefined element in call_indirect\");");
+    line("  w2c_callee = inst->table[" + element + "];");
+    line("  if (w2c_func_types[w2c_callee] != " + std::to_string(canonical) + "u)");
+    line("    wasm_rt_trap(inst, WASM_RT_TRAP_SIGNATURE_MISMATCH, \"Indirect call signature mismatch\");");
+    if (callee_type.results.empty()) {
+        line("  " + call + ";");
+    } else {
+        line("  " + push(callee_type.results[0]) + " = " + call + ";");
+    }
+    line("}");
+    reloadMemory();
+}
+
+void FunctionEmitter::emitInstruction(uint8_t opcode, BodyReader& reader) {
+    Opcode op = static_cast<Opcode>(opcode);
+
+    switch (op) {
+        case Opcode::UNREACHABLE:
+            line("wasm_rt_trap(inst, WASM_RT_TRAP_UNREACHABLE, \"unreachable instruction executed\");");
+            unreachable_ = true;
+            return;
+
+        case Opcode::NOP:
+            return;
+
+        case Opcode::BLOCK:
+        case Opcode::LOOP: {
+            ValueType result = readBlockType(reader);
+            Control control{op == Opcode::LOOP ? ControlKind::LOOP : ControlKind::BLOCK,
+                            next_label_++, result, stack_.size(), false};
+            if (op == Opcode::LOOP) {
+                body_ << label(control) << "_loop:;\n";
+            }
+            controls_.push_back(control);
+            return;
+        }
+
+        case Opcode::IF: {
+            ValueType result = readBlockType(reader);
+            std::string condition = pop();
+            Control control{ControlKind::IF, next_label_++, result, stack_.size(), false};
+            line("if (!" + condition + ") goto " + label(control) + "_else;");
+            controls_.push_back(control);
+            return;
+        }
+
+        case Opcode::ELSE:
+            emitElse();
+            return;
+
+        case Opcode::END:
+            emitEnd();
+            return;
+
+        case Opcode::BR:
+            line(branchStatement(reader.readU32()));
+            unreachable_ = true;
+            return;
+
+        case Opcode::BR_IF: {
+            uint32_t depth = reader.readU32();
+            std::string condition = pop();
+            line("if (" + condition + ") { " + branchStatement(depth) + " }");
+            return;
+        }
+
+        case Opcode::BR_TABLE: {
+            uint32_t count = reader.readU32();
+            std::vector<uint32_t> depths(count);
+            for (uint32_t i = 0; i < count; i++) {
+                depths[i] = reader.readU32();
+            }
+            uint32_t default_depth = reader.readU32();
+            std::string index = pop();
+
+            line("switch (" + index + ") {");
+            for (uint32_t i = 0; i < count; i++) {
+                line("  case " + std::to_string(i) + "u: " + branchStatement(depths[i]));
+            }
+            line("  default: " + branchStatement(default_depth));
+            line("}");
+            unreachable_ = true;
+            return;
+        }
+
+        case Opcode::RETURN:
+            line(returnStatement());
+            unreachable_ = true;
+            return;
+
+        case Opcode::CALL:
+            emitCall(reader.readU32());
+            return;
+
+        case Opcode::CALL_INDIRECT: {
+            uint32_t type_index = reader.readU32();
+            if (reader.readByte() != 0x00) {
+                fail("invalid table index in call_indirect");
+            }
+            emitCallIndirect(type_index);
+            return;
+        }
+
+        case Opcode::DROP:
+            pop();
+            return;
+
+        case Opcode::SELECT: {
+            std::string condition = pop();
+            std::string b = pop();
+            std::string a = top();
+            line(a + " = " + condition + " ? " + a + " : " + b + ";");
+            constants_[stack_.size() - 1] = -1;
+            return;
+        }
+
+        case Opcode::LOCAL_GET:
+        case Opcode::LOCAL_SET:
+        case Opcode::LOCAL_TEE: {
+            uint32_t index = reader.readU32();
+            if (index >= locals_.size()) {
+                fail("local index out of range");
+            }
+            std::string local = "l" + std::to_string(index);
+            if (op == Opcode::LOCAL_GET) {
+                line(push(locals_[index]) + " = " + local + ";");
+            } else if (op == Opcode::LOCAL_SET) {
+                line(local + " = " + pop() + ";");
+            } else {
+                line(local + " = " + top() + ";");
+            }
+            return;
+        }
+
+        case Opcode::GLOBAL_GET:
+        case Opcode::GLOBAL_SET: {
+            uint32_t index = reader.readU32();
+            if (index >= info_.global_types.size()) {
+                fail("global index out of range");
+            }
+            ValueType type = info_.global_types[index];
+            std::string global = "inst->globals[" + std::to_string(index) + "u]";
+            if (op == Opcode::GLOBAL_GET) {
+                line(push(type) + " = " + fromRuntimeValue(global, type) + ";");
+            } else {
+                line(toRuntimeValue(global, type, pop()));
+            }
+            return;
+        }
+
+        case Opcode::MEMORY_SIZE:
+            reader.readByte();
+            line(push(ValueType::I32) + " = wasm_rt_memory_size(inst);");
+            return;
+
+        case Opcode::MEMORY_GROW: {
+            reader.readByte();
+            std::string delta = top();
+            line(delta + " = wasm_rt_memory_grow(inst, " + delta + ");");
+            constants_[stack_.size() - 1] = -1;
+            reloadMemory();
+            return;
+        }
+
+        case Opcode::I32_CONST: {
+            uint32_t value = static_cast<uint32_t>(reader.readSigned(32));
+            line(push(ValueType::I32) + " = " + hex(value, 8) + "u;");
+            constants_[stack_.size() - 1] = value;
+            return;
+        }
+
+        case Opcode::I64_CONST:
+            line(push(ValueType::I64) + " = " +
+                 hex(static_cast<uint64_t>(reader.readSigned(64)), 16) + "ull;");
+            return;
+
+        case Opcode::F32_CONST:
+            line(push(ValueType::F32) + " = wasm_rt_f32_from_bits(" + hex(reader.readFixed(4), 8) + "u);");
+            return;
+
+        case Opcode::F64_CONST:
+            line(push(ValueType::F64) + " = wasm_rt_f64_from_bits(" + hex(reader.readFixed(8), 16) + "ull);");
+            return;
+
+        default:
+            break;
+    }
+
+    MemoryOperator memory_op;
+    if (memoryOperator(opcode, memory_op)) {
+        reader.readU32();  // Alignment hint
+        emitMemoryAccess(memory_op, reader.readU32());
+        return;
+    }
+
+    OperatorInfo info = numericOperator(opcode);
+    if (opcode == 0xFC) {
+        uint32_t sub_opcode = reader.readU32();
+        info = saturatingOperator(sub_opcode);
+        if (info.arity == 0) {
+            fail("unsupported 0xFC sub-opcode " + std::to_string(sub_opcode));
+        }
+    }
+    if (info.arity == 0) {
+        fail("unsupported opcode " + hex(opcode, 2));
+    }
+
+    std::string b = info.arity == 2 ? pop() : std::string();
+    std::string a = pop();
+    line(push(info.result) + " = " + substitute(info.pattern, a, b) + ";");
+}
+
+void FunctionEmitter::emitMemoryAccess(const MemoryOperator& memory_op, uint32_t offset) {
+    std::string value = memory_op.is_store ? pop() : std::string();
+    size_t address_depth = stack_.size() - 1;
+    std::string address = pop();
+    std::string effective = "(uint64_t)" + address + " + " + std::to_string(offset) + "u";
+    std::string helper = memory_op.helper;
+    std::string arguments;
+
+    if (!info_.optimize) {
+        arguments = "inst, " + effective;
+    } else {
+        // A constant address inside the initial memory can never be out of
+        // bounds, since memory only grows
+        int64_t constant = address_depth < constants_.size() ? constants_[address_depth] : -1;
+        uint64_t access_size = memory_op.size;
+        if (constant >= 0 &&
+            static_cast<uint64_t>(constant) + offset + access_size <= info_.min_memory_bytes) {
+            helper += "_unchecked";
+            arguments = "w2c_mem, " + effective;
+        } else {
+            helper += "_at";
+            arguments = "inst, w2c_mem, w2c_mem_size, " + effective;
+        }
+    }
+
+    if (memory_op.is_store) {
+        line(helper + "(" + arguments + ", " + value + ");");
+    } else {
+        line(push(memory_op.type) + " = " + helper + "(" + arguments + ");");
+    }
+}
+
+void FunctionEmitter::skipImmediates(uint8_t opcode, BodyReader& reader) {
+    reader.skipImmediates(opcode);
+}
+
+// ===== Whole-module emission =====
+
+// Functions the host executes (imports, and functions left out of a
+// partial compilation) are reached through the call_host callback
+void emitHostThunk(std::ostringstream& out, const ModuleInfo& info, uint32_t func_index) {
+    const FuncType& type = info.functionType(func_index);
+    size_t param_count = type.params.size();
+
+    out << prototype(type, info.symbols[func_index]) << " {\n";
+    out << "  wasm_rt_value args[" << (param_count ? param_count : 1) << "];\n";
+    out << "  wasm_rt_value results[1];\n";
+    for (size_t i = 0; i < param_count; i++) {
+        std::string arg = "args[" + std::to_string(i) + "]";
+        out << "  " << arg << ".type = " << runtimeTypeName(type.params[i]) << ";\n";
+        out << "  " << toRuntimeValue(arg, type.params[i], "l" + std::to_string(i)) << "\n";
+    }
+    out << "  inst->call_host(inst, " << func_index << "u, args, results);\n";
+    if (!type.results.empty()) {
+        out << "  return " << fromRuntimeValue("results[0]", type.results[0]) << ";\n";
+    }
+    out << "}\n\n";
+}
+
+void emitInvoker(std::ostringstream& out, const ModuleInfo& info, uint32_t func_index) {
+    const FuncType& type = info.functionType(func_index);
+
+    out << "static void w2c_invoke_" << func_index
+        << "(wasm_rt_instance* inst, const wasm_rt_value* args, wasm_rt_value* results) {\n";
+    std::string call = info.symbols[func_index] + "(inst";
+    for (size_t i = 0; i < type.params.size(); i++) {
+        call += ", " + fromRuntimeValue("args[" + std::to_string(i) + "]", type.params[i]);
+    }
+    call += ")";
+
+    if (type.params.empty()) {
+        out << "  (void)args;\n";
+    }
+    if (type.results.empty()) {
+        out << "  (void)results;\n";
+        out << "  " << call << ";\n";
+    } else {
+        out << "  results[0].type = " << runtimeTypeName(type.results[0]) << ";\n";
+        out << "  " << toRuntimeValue("results[0]", type.results[0], call) << "\n";
+    }
+    out << "}\n\n";
+}
+
+uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+template<typename T>
+uint64_t fnv1aValue(uint64_t hash, T value) {
+    return fnv1a(hash, &value, sizeof(value));
+}
+
+std::string quoteArgument(const std::string& argument) {
+    std::string quoted = "'";
+    for (char c : argument) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+}
+
+// Write a new file, failing if anything (including a symlink) is already
+// at path, so another user cannot redirect what gets compiled
+void writeExclusive(const std::string& path, const std::string& contents) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        throw AotError("Cannot write generated source: " + path + ": " + std::strerror(errno));
+    }
+    size_t done = 0;
+    while (done < contents.size()) {
+        ssize_t n = ::write(fd, contents.data() + done, contents.size() - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            close(fd);
+            throw AotError("Failed to write generated source: " + path);
+        }
+        done += static_cast<size_t>(n);
+    }
+    close(fd);
+}
+
+// Directory only this user can enter, removed with what was built in it
+class PrivateDirectory {
+public:
+    explicit PrivateDirectory(const std::string& parent) {
+        std::string pattern = parent + "/.wasm-aot-XXXXXX";
+        if (!mkdtemp(&pattern[0])) {
+            throw AotError("Cannot create build directory in " + parent + ": " + std::strerror(errno));
+        }
+        path_ = pattern;
+    }
+    ~PrivateDirectory() {
+        std::remove((path_ + "/module.c").c_str());
+        std::remove((path_ + "/module.so").c_str());
+        rmdir(path_.c_str());
+    }
+
+    PrivateDirectory(const PrivateDirectory&) = delete;
+    PrivateDirectory& operator=(const PrivateDirectory&) = delete;
+
+    std::string file(const char* name) const { return path_ + "/" + name; }
+
+private:
+    std::string path_;
+};
+
+} // anonymous namespace
+
+AotOptions::AotOptions()
+    : optimization("-O2"), runtime_include_dir(WASM_RT_INCLUDE_DIR), keep_source(false), optimize(false) {
+    const char* cc = std::getenv("CC");
+    compiler = (cc && *cc) ? cc : "cc";
+}
+
+AotCompiler::AotCompiler(AotOptions options) : options_(std::move(options)) {
+}
+
+uint64_t AotCompiler::fingerprint(const Module& module) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+
+    hash = fnv1aValue(hash, static_cast<uint64_t>(module.types.size()));
+    for (const auto& type : module.types) {
+        hash = fnv1aValue(hash, static_cast<uint32_t>(type.params.size()));
+        hash = fnv1a(hash, type.params.data(), type.params.size());
+        hash = fnv1aValue(hash, static_cast<uint32_t>(type.results.size()));
+        hash = fnv1a(hash, type.results.data(), type.results.size());
+    }
+
+    hash = fnv1aValue(hash, module.getImportedFunctionCount());
+    hash = fnv1aValue(hash, static_cast<uint64_t>(module.functions.size()));
+    for (const Function& func : module.functions) {
+        hash = fnv1aValue(hash, func.type_index);
+        hash = fnv1aValue(hash, static_cast<uint64_t>(func.locals.size()));
+        hash = fnv1a(hash, func.locals.data(), func.locals.size());
+        hash = fnv1aValue(hash, static_cast<uint64_t>(func.body.size()));
+        hash = fnv1a(hash, func.body.data(), func.body.size());
+    }
+
+    hash = fnv1aValue(hash, module.getTotalGlobalCount());
+    for (const auto& global : module.globals) {
+        hash = fnv1aValue(hash, global.type);
+    }
+    return hash;
+}
+
+std::string AotCompiler::translate(const Module& module, const std::vector<bool>& selected) const {
+    ModuleInfo info(module, options_.optimize);
+    uint32_t function_count = module.getTotalFunctionCount();
+    auto is_compiled = [&](uint32_t func_index) {
+        return func_index >= info.import_count &&
+               (selected.empty() || (func_index < selected.size() && selected[func_index]));
+    };
+
+    std::ostringstream out;
+    out << "/* Generated by wasm-aot. Do not edit. */\n";
+    out << "#include \"wasm_rt.h\"\n\n";
+    out << "#define W2C_FUNCTION_COUNT " << function_count << "u\n\n";
+
+    // Signatures for indirect calls, one per canonical type
+    for (uint32_t i = 0; i < module.types.size(); i++) {
+        if (info.canonical_types[i] == i) {
+            out << "typedef " << resultType(module.types[i]) << " (*w2c_sig" << i << ")("
+                << parameterList(module.types[i]) << ");\n";
+        }
+    }
+    out << "\n";
+
+    for (uint32_t i = 0; i < function_count; i++) {
+        out << prototype(info.functionType(i), info.symbols[i]) << ";\n";
+    }
+    out << "\n";
+
+    // Function index space for call_indirect
+    out << "static const uint32_t w2c_func_types[" << function_count + 1 << "] = {";
+    for (uint32_t i = 0; i < function_count; i++) {
+        out << (i % 16 == 0 ? "\n  " : " ")
+            << info.canonical_types[module.getFunctionType(i) - module.types.data()] << "u,";
+    }
+    out << "\n  0u\n};\n\n";
+
+    out << "static const wasm_rt_any_fn w2c_funcs[" << function_count + 1 << "] = {";
+    for (uint32_t i = 0; i < function_count; i++) {
+        out << "\n  (wasm_rt_any_fn)" << info.symbols[i] << ",";
+    }
+    out << "\n  0\n};\n\n";
+
+    for (uint32_t i = 0; i < function_count; i++) {
+        if (is_compiled(i)) {
+            FunctionEmitter emitter(info, i);
+            out << emitter.emit();
+        } else {
+            emitHostThunk(out, info, i);
+        }
+    }
+    for (uint32_t i = 0; i < function_count; i++) {
+        if (is_compiled(i)) {
+            emitInvoker(out, info, i);
+        }
+    }
+
+    // Descriptor
+    std::vector<std::string_view> names(function_count);
+    for (const auto& exp : module.exports) {
+        if (exp.kind == ExternalKind::FUNCTION && exp.index < function_count && names[exp.index].empty()) {
+            names[exp.index] = exp.name;
+        }
+    }
+
+    out << "static const wasm_rt_invoke_fn w2c_invokers[" << function_count + 1 << "] = {";
+    for (uint32_t i = 0; i < function_count; i++) {
+        out << "\n  " << (is_compiled(i) ? "w2c_invoke_" + std::to_string(i) : std::string("0")) << ",";
+    }
+    out << "\n  0\n};\n\n";
+
+    out << "static const char* const w2c_names[" << function_count + 1 << "] = {";
+    for (uint32_t i = 0; i < function_count; i++) {
+        out << "\n  " << (names[i].empty() ? std::string("0") : cStringLiteral(names[i])) << ",";
+    }
+    out << "\n  0\n};\n\n";
+
+    out << "static const wasm_rt_module w2c_module = {\n"
+        << "  WASM_RT_ABI_VERSION,\n"
+        << "  " << hex(fingerprint(module), 16) << "ull,\n"
+        << "  W2C_FUNCTION_COUNT,\n"
+        << "  w2c_invokers,\n"
+        << "  w2c_names,\n"
+        << "  w2c_funcs\n"
+        << "};\n\n";
+    out << "WASM_RT_EXPORT const wasm_rt_module* wasm_rt_get_module(void) {\n"
+        << "  return &w2c_module;\n"
+        << "}\n";
+
+    return out.str();
+}
+
+void AotCompiler::compile(const Module& module, const std::string& output_path,
+                          const std::vector<bool>& selected) const {
+    // Build in a fresh directory next to the output, so neither the source
+    // nor the shared object can be swapped by another user before use, and
+    // the result can be renamed into place
+    size_t slash = output_path.rfind('/');
+    std::string parent = slash == std::string::npos ? "." : slash == 0 ? "/" : output_path.substr(0, slash);
+    PrivateDirectory build(parent);
+    std::string source_path = build.file("module.c");
+    std::string library_path = build.file("module.so");
+    writeExclusive(source_path, translate(module, selected));
+
+    // -fexceptions lets host traps (C++ exceptions) unwind through compiled
+    // frames; -ffp-contract=off keeps float results bit-identical to the
+    // interpreter
+    std::string command = quoteArgument(options_.compiler) + " -std=c99 " + options_.optimization +
+        " -ffp-contract=off -fexceptions -fPIC -shared -I " + quoteArgument(options_.runtime_include_dir) +
+        " -o " + quoteArgument(library_path) + " " + quoteArgument(source_path) + " -lm";
+    int status = std::system(command.c_str());
+    if (status != 0) {
+        throw AotError("C compiler failed (status " + std::to_string(status) + "): " + command);
+    }
+
+    // rename replaces whatever is at the destination rather than following it
+    if (std::rename(library_path.c_str(), output_path.c_str()) != 0) {
+        throw AotError("Cannot move compiled module to " + output_path + ": " + std::strerror(errno));
+    }
+    if (options_.keep_source) {
+        std::string kept = output_path + ".c";
+        if (std::rename(source_path.c_str(), kept.c_str()) != 0) {
+            throw AotError("Cannot move generated source to " + kept + ": " + std::strerror(errno));
+        }
+    }
+}
+
+} // namespace wasm
@@ -0,0 +1,41 @@
+#include "arena.h"
+#include <algorithm>
+
+namespace wasm {
+
+Arena::Arena(size_t initial_capacity)
+    : cursor_(nullptr), end_(nullptr),
+      next_chunk_size_(std::max<size_t>(initial_capacity, 1)),
+      bytes_used_(0), bytes_reserved_(0) {
+}
+
+void* Arena::allocate(size_t size, size_t alignment) {
+    // Align the cursor up; alignment is a power of 2
+    uintptr_t current = reinterpret_cast<uintptr_t>(cursor_);
+    uintptr_t aligned = (current + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+
+    if (cursor_ == nullptr || aligned + size > reinterpret_cast<uintptr_t>(end_)) {
+        addChunk(size + alignment);
+        current = reinterpret_cast<uintptr_t>(cursor_);
+        aligned = (current + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+    }
+
+    uint8_t* result = reinterpret_cast<uint8_t*>(aligned);
+    cursor_ = result + size;
+    bytes_used_ += size;
+    return result;
+}
+
+void Arena::addChunk(size_t min_size) {
+    // Chunks double in size so a badly underestimated module still needs
+    // only a logarithmic number of allocations
+    size_t chunk_size = std::max(next_chunk_size_, min_size);
+    chunks_.emplace_back(new uint8_t[chunk_size]);
+
+    cursor_ = chunks_.back().get();
+    end_ = cursor_ + chunk_size;
+    bytes_reserved_ += chunk_size;
+    next_chunk_size_ = chunk_size * 2;
+}
+
+} // namespace wasm
@@ -0,0 +1,316 @@
+#include "canonical_abi.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define WASM_UTF8_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define WASM_UTF8_NEON 1
+#endif
+
+namespace wasm {
+
+namespace {
+
+// LATIN1_UTF16 lengths with this bit set count UTF-16 code units
+constexpr uint32_t UTF16_TAG = 0x80000000u;
+
+// Longest string the canonical ABI can pass, in bytes or code units
+constexpr uint64_t MAX_STRING_LENGTH = 0x7FFFFFFFu;
+
+// Number of leading bytes of data below 0x80
+size_t asciiPrefix(const uint8_t* data, size_t size) {
+    size_t i = 0;
+#if defined(WASM_UTF8_SSE2)
+    // Four vectors per step while the text is ASCII, then one at a time
+    // to find the first non-ASCII byte
+    for (; i + 64 <= size; i += 64) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 16));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 32));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 48));
+        if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))) != 0) {
+            break;
+        }
+    }
+    for (; i + 16 <= size; i += 16) {
+        int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+        if (mask != 0) {
+            return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+    }
+#elif defined(WASM_UTF8_NEON)
+    for (; i + 64 <= size; i += 64) {
+        uint8x16_t any = vorrq_u8(vorrq_u8(vld1q_u8(data + i), vld1q_u8(data + i + 16)),
+                                  vorrq_u8(vld1q_u8(data + i + 32), vld1q_u8(data + i + 48)));
+        if (vmaxvq_u8(any) >= 0x80) {
+            break;
+        }
+    }
+    for (; i + 16 <= size && vmaxvq_u8(vld1q_u8(data + i)) < 0x80; i += 16) {
+    }
+#endif
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        if (word & 0x8080808080808080ull) {
+            break;
+        }
+    }
+    while (i < size && data[i] < 0x80) {
+        i++;
+    }
+    return i;
+}
+
+// Length of the well-formed sequence at data, with its code point, or 0
+// if it is malformed or cut short (RFC 3629, table 3-7 of Unicode)
+size_t decodeUtf8(const uint8_t* data, size_t size, uint32_t& code_point) {
+    uint8_t lead = data[0];
+    if (lead < 0x80) {
+        code_point = lead;
+        return 1;
+    }
+
+    size_t length;
+    uint8_t low = 0x80, high = 0xBF;    // Range of the second byte
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+        code_point = lead & 0x1F;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        code_point = lead & 0x0F;
+        if (lead == 0xE0) {
+            low = 0xA0;     // Overlong
+        } else if (lead == 0xED) {
+            high = 0x9F;    // Surrogates
+        }
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        code_point = lead & 0x07;
+        if (lead == 0xF0) {
+            low = 0x90;     // Overlong
+        } else if (lead == 0xF4) {
+            high = 0x8F;    // Above U+10FFFF
+        }
+    } else {
+        return 0;
+    }
+
+    if (size < length) {
+        return 0;
+    }
+    for (size_t i = 1; i < length; i++) {
+        uint8_t byte = data[i];
+        if (byte < low || byte > high) {
+            return 0;
+        }
+        low = 0x80;
+        high = 0xBF;
+        code_point = code_point << 6 | (byte & 0x3F);
+    }
+    return length;
+}
+
+void appendUtf8(std::string& out, uint32_t code_point) {
+    if (code_point < 0x80) {
+        out.push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | code_point >> 6));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | code_point >> 12));
+        out.push_back(static_cast<char>(0x80 | (code_point >> 6 & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | code_point >> 18));
+        out.push_back(static_cast<char>(0x80 | (code_point >> 12 & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point >> 6 & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+void transcodeUtf16(const uint8_t* data, uint32_t units, std::string& out) {
+    out.clear();
+    out.reserve(units);
+    for (uint32_t i = 0; i < units; i++) {
+        uint16_t unit;
+        std::memcpy(&unit, data + 2 * static_cast<size_t>(i), 2);
+        uint32_t code_point = unit;
+        if (unit >= 0xD800 && unit <= 0xDFFF) {
+            uint16_t low = 0;
+            if (unit <= 0xDBFF && i + 1 < units) {
+                std::memcpy(&low, data + 2 * static_cast<size_t>(i + 1), 2);
+            }
+            if (low < 0xDC00 || low > 0xDFFF) {
+                throw CanonicalAbiError("String has an unpaired UTF-16 surrogate");
+            }
+            code_point = 0x10000 + ((unit - 0xD800u) << 10 | (low - 0xDC00u));
+            i++;
+        }
+        appendUtf8(out, code_point);
+    }
+}
+
+} // anonymous namespace
+
+bool isValidUtf8(const uint8_t* data, size_t size) {
+    size_t i = 0;
+    while (true) {
+        i += asciiPrefix(data + i, size - i);
+        // Stay in the scalar decoder through a run of non-ASCII text
+        while (i < size && data[i] >= 0x80) {
+            uint32_t code_point;
+            size_t length = decodeUtf8(data + i, size - i, code_point);
+            if (length == 0) {
+                return false;
+            }
+            i += length;
+        }
+        if (i == size) {
+            return true;
+        }
+    }
+}
+
+// ===== CanonicalAbi =====
+
+CanonicalAbi::CanonicalAbi(Interpreter& instance, StringEncoding encoding)
+    : instance_(instance), encoding_(encoding), args_(4) {
+}
+
+Memory& CanonicalAbi::memory() const {
+    Memory* memory = instance_.memory();
+    if (!memory) {
+        throw CanonicalAbiError("Instance has no memory");
+    }
+    return *memory;
+}
+
+const uint8_t* CanonicalAbi::bytesAt(uint32_t ptr, uint64_t size, uint32_t align) const {
+    Memory& mem = memory();
+    if (ptr % align != 0) {
+        throw CanonicalAbiError("Pointer " + std::to_string(ptr) + " is not " + std::to_string(align) +
+                                "-byte aligned");
+    }
+    if (static_cast<uint64_t>(ptr) + size > mem.sizeInBytes()) {
+        throw CanonicalAbiError(std::to_string(size) + " bytes at " + std::to_string(ptr) + " out of bounds");
+    }
+    return mem.data() + ptr;
+}
+
+std::string_view CanonicalAbi::liftString(uint32_t ptr, uint32_t len, std::string& scratch) const {
+    switch (encoding_) {
+        case StringEncoding::UTF8: {
+            const uint8_t* bytes = bytesAt(ptr, len, 1);
+            if (!isValidUtf8(bytes, len)) {
+                throw CanonicalAbiError("String is not valid UTF-8");
+            }
+            return std::string_view(reinterpret_cast<const char*>(bytes), len);
+        }
+        case StringEncoding::UTF16:
+            transcodeUtf16(bytesAt(ptr, static_cast<uint64_t>(len) * 2, 2), len, scratch);
+            return scratch;
+        case StringEncoding::LATIN1_UTF16:
+            if (len & UTF16_TAG) {
+                uint32_t units = len & ~UTF16_TAG;
+                transcodeUtf16(bytesAt(ptr, static_cast<uint64_t>(units) * 2, 2), units, scratch);
+            } else {
+                const uint8_t* bytes = bytesAt(ptr, len, 2);
+                scratch.clear();
+                scratch.reserve(len);
+                for (uint32_t i = 0; i < len; i++) {
+                    appendUtf8(scratch, bytes[i]);
+                }
+            }
+            return scratch;
+    }
+    return {};
+}
+
+CanonicalAbi::Lowered CanonicalAbi::lowerString(std::string_view utf8) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(utf8.data());
+    if (utf8.size() > MAX_STRING_LENGTH) {
+        throw CanonicalAbiError("String of " + std::to_string(utf8.size()) + " bytes is too long");
+    }
+    if (!isValidUtf8(bytes, utf8.size())) {
+        throw CanonicalAbiError("String is not valid UTF-8");
+    }
+    if (encoding_ == StringEncoding::UTF8) {
+        return Lowered{lowerBytes(bytes, utf8.size(), 1), static_cast<uint32_t>(utf8.size())};
+    }
+
+    // Size the guest allocation exactly, so cabi_realloc is called once
+    uint64_t units = 0;
+    uint32_t max_code_point = 0;
+    for (size_t i = 0; i < utf8.size();) {
+        uint32_t code_point;
+        i += decodeUtf8(bytes + i, utf8.size() - i, code_point);
+        units += code_point > 0xFFFF ? 2 : 1;
+        max_code_point = std::max(max_code_point, code_point);
+    }
+
+    bool latin1 = encoding_ == StringEncoding::LATIN1_UTF16 && max_code_point <= 0xFF;
+    uint64_t size = latin1 ? units : units * 2;
+    uint32_t ptr = allocate(size, 2);
+    uint8_t* out = memory().data() + ptr;
+    for (size_t i = 0; i < utf8.size();) {
+        uint32_t code_point;
+        i += decodeUtf8(bytes + i, utf8.size() - i, code_point);
+        if (latin1) {
+            *out++ = static_cast<uint8_t>(code_point);
+            continue;
+        }
+        uint16_t pair[2];
+        size_t count = 1;
+        if (code_point > 0xFFFF) {
+            pair[0] = static_cast<uint16_t>(0xD800 + ((code_point - 0x10000) >> 10));
+            pair[1] = static_cast<uint16_t>(0xDC00 + ((code_point - 0x10000) & 0x3FF));
+            count = 2;
+        } else {
+            pair[0] = static_cast<uint16_t>(code_point);
+        }
+        std::memcpy(out, pair, 2 * count);
+        out += 2 * count;
+    }
+    // Written through data(), so snapshot restore must be told
+    memory().markDirty(ptr, static_cast<size_t>(size));
+
+    uint32_t len = static_cast<uint32_t>(units);
+    if (encoding_ == StringEncoding::LATIN1_UTF16 && !latin1) {
+        len |= UTF16_TAG;
+    }
+    return Lowered{ptr, len};
+}
+
+uint32_t CanonicalAbi::allocate(uint64_t size, uint32_t align) {
+    if (size > UINT32_MAX) {
+        throw CanonicalAbiError("Allocation of " + std::to_string(size) + " bytes exceeds linear memory");
+    }
+    args_[0] = TypedValue::makeI32(0);
+    args_[1] = TypedValue::makeI32(0);
+    args_[2] = TypedValue::makeI32(static_cast<int32_t>(align));
+    args_[3] = TypedValue::makeI32(static_cast<int32_t>(size));
+    instance_.call("cabi_realloc", args_, results_);
+    realloc_calls_++;
+    if (results_.size() != 1 || results_[0].type != ValueType::I32) {
+        throw CanonicalAbiError("cabi_realloc must return one i32");
+    }
+
+    // The guest's allocation must be usable as returned
+    uint32_t ptr = static_cast<uint32_t>(results_[0].value.i32);
+    bytesAt(ptr, size, align);
+    return ptr;
+}
+
+uint32_t CanonicalAbi::lowerBytes(const void* data, size_t size, uint32_t align) {
+    uint32_t ptr = allocate(size, align);
+    if (size > 0) {
+        memory().initialize(ptr, static_cast<const uint8_t*>(data), size);
+    }
+    return ptr;
+}
+
+} // namespace wasm
@@ -1,4 +1,6 @@
 #include "decoder.h"
+#include "instructions.h"
+#include "leb128.h"
 #include <fstream>
 #include <cstring>
 #include <sstream>
@@ -24,18 +26,34 @@ namespace {
     constexpr uint8_t SEC_ELEMENT = 9;   // Element segments (table initialization)
     constexpr uint8_t SEC_CODE = 10;     // Function bodies
     constexpr uint8_t SEC_DATA = 11;     // Data segments (memory initialization)
+    constexpr uint8_t SEC_TAG = 13;      // Tags (stack switching suspension points)
 
     // Instruction opcodes
-    constexpr uint8_t OP_END = 0x0B;     // End of block/function
+    constexpr uint8_t OP_END = 0x0B;         // End of block/function
+
+    // Implementation limit on locals per function (matches other engines)
+    constexpr uint32_t MAX_FUNCTION_LOCALS = 50000;
 }
 
 Module Decoder::parse(const std::string& filename) {
+    // Decode straight from a mapping of the file where possible, so data
+    // segments need not be copied at all
+    source_ = map_files_ ? MappedFile::open(filename) : nullptr;
+    if (source_) {
+        bytes_ = source_->data();
+        size_ = source_->size();
+        return parseBuffer();
+    }
+
     std::ifstream file(filename, std::ios::binary | std::ios::ate);
     if (!file.is_open()) {
         throw DecoderError("Failed to open file: " + filename);
     }
 
     std::streamsize size = file.tellg();
+    if (size < 0) {
+        throw DecoderError("Failed to read file: " + filename);
+    }
     file.seekg(0, std::ios::beg);
 
     buffer_.resize(static_cast<size_t>(size));
@@ -43,23 +61,39 @@ Module Decoder::parse(const std::string& filename) {
         throw DecoderError("Failed to read file: " + filename);
     }
 
-    return parseBytes(buffer_);
+    bytes_ = buffer_.data();
+    size_ = buffer_.size();
+    return parseBuffer();
 }
 
 Module Decoder::parseBytes(const std::vector<uint8_t>& bytes) {
-    buffer_ = bytes;
+    // Everything the module keeps is copied to its arena, so the caller's
+    // bytes only need to outlive the parse
+    source_.reset();
+    bytes_ = bytes.data();
+    size_ = bytes.size();
+    return parseBuffer();
+}
+
+Module Decoder::parseBuffer() {
     position_ = 0;
 
-    Module module;
+    // Everything the module keeps from the binary is bounded by the binary
+    // size (except expanded locals), so one arena chunk usually suffices
+    Module module(size_ + Arena::DEFAULT_CHUNK_SIZE);
+    arena_ = &module.arena();
+    composite_types_ = &module.composite_types;
 
     verifyMagicAndVersion();
     parseModule(module);
+    module.buildIndexSpaces();
+    module.source = std::move(source_);
 
     return module;
 }
 
 void Decoder::verifyMagicAndVersion() {
-    if (buffer_.size() < 8) {
+    if (size_ < 8) {
         throw DecoderError("File too small to be a valid WASM module");
     }
 
@@ -94,8 +128,7 @@ void Decoder::parseModule(Module& module) {
 
 void Decoder::parseSection(Module& module, uint8_t section_id, uint32_t section_size) {
     // Parse the section based on its ID
-    // Note: section_size is used by the caller for bounds checking
-    (void)section_size;  // Suppress unused parameter warning
+    // Note: section_size is also used by the caller for bounds checking
 
     switch (section_id) {
         case SEC_TYPE:
@@ -126,13 +159,16 @@ void Decoder::parseSection(Module& module, uint8_t section_id, uint32_t section_
             parseElementSection(module);
             break;
         case SEC_CODE:
-            parseCodeSection(module);
+            parseCodeSection(module, section_size);
             break;
         case SEC_DATA:
             parseDataSection(module);
             break;
+        case SEC_TAG:
+            parseTagSection(module);
+            break;
         case SEC_CUSTOM:
-            // Skip custom sections
+            parseCustomSection(module, section_size);
             break;
         default:
             throw DecoderError("Unknown section ID: " + std::to_string(section_id));
@@ -140,14 +176,26 @@ void Decoder::parseSection(Module& module, uint8_t section_id, uint32_t section_
 }
 
 void Decoder::parseTypeSection(Module& module) {
-    // Type section: vector of function type signatures
+    // Type section: vector of function type signatures, or with the GC
+    // proposal of recursion groups (0x4E) of struct, array and func types
     // Format: count (varuint32) followed by function types
     uint32_t count = readVarUint32();
     module.types.reserve(count);
+    module.composite_types.reserve(count);
 
     for (uint32_t i = 0; i < count; i++) {
         try {
-            module.types.push_back(readFuncType());
+            ensureBytes(1);
+            if (bytes_[position_] == 0x4E) {
+                // Recursion group: its types take consecutive indices
+                readByte();
+                uint32_t group_size = readVarUint32();
+                for (uint32_t j = 0; j < group_size; j++) {
+                    readSubType(module);
+                }
+            } else {
+                readSubType(module);
+            }
         } catch (const DecoderError& e) {
             throw DecoderError(formatError("In type section, entry " +
                              std::to_string(i) + ": " + e.what()));
@@ -223,11 +271,11 @@ void Decoder::parseExportSection(Module& module) {
     module.exports.reserve(count);
 
     for (uint32_t i = 0; i < count; i++) {
-        std::string name = readName();
+        std::string_view name = readName();
         ExternalKind kind = static_cast<ExternalKind>(readByte());
         uint32_t index = readVarUint32();
 
-        module.exports.emplace_back(std::move(name), kind, index);
+        module.exports.emplace_back(name, kind, index);
     }
 }
 
@@ -253,23 +301,26 @@ void Decoder::parseElementSection(Module& module) {
         segment.offset_expr = readInitExpression();
 
         // Read vector of function indices to place in the table
+        // Each index takes at least one byte, which bounds the allocation
         uint32_t elem_count = readVarUint32();
-        segment.func_indices.reserve(elem_count);
+        ensureBytes(elem_count);
+        uint32_t* func_indices = arena_->allocateArray<uint32_t>(elem_count);
         for (uint32_t j = 0; j < elem_count; j++) {
-            segment.func_indices.push_back(readVarUint32());
+            func_indices[j] = readVarUint32();
         }
+        segment.func_indices = ArrayView<uint32_t>(func_indices, elem_count);
 
         module.element_segments.push_back(std::move(segment));
     }
 }
 
-void Decoder::parseCodeSection(Module& module) {
+void Decoder::parseCodeSection(Module& module, uint32_t section_size) {
     // Code section: vector of function bodies
     // Format: count followed by function bodies
     // Must have same count as Function section
     // Each body: size, locals, instructions
+    size_t section_end = position_ + section_size;
     uint32_t count = readVarUint32();
-    module.functions.reserve(count);
 
     // Validate that code count matches function count
     if (count != module.function_types.size()) {
@@ -278,30 +329,66 @@ void Decoder::parseCodeSection(Module& module) {
                          std::to_string(module.function_types.size()) + ")"));
     }
 
+    module.functions.reserve(count);
+
+    // All bodies are copied back to back into one block; the section size
+    // is an upper bound on their total size
+    if (section_size > size_) {
+        throw DecoderError(formatError("Code section size exceeds module size"));
+    }
+    uint8_t* code = arena_->allocateArray<uint8_t>(section_size);
+    size_t code_used = 0;
+
     for (uint32_t i = 0; i < count; i++) {
         uint32_t body_size = readVarUint32();
         size_t body_start = position_;
-
-        Function func;
-        func.type_index = module.function_types[i];
+        if (body_start > section_end || body_size > section_end - body_start) {
+            throw DecoderError(formatError("Function body " + std::to_string(i) +
+                             " extends past the end of the code section"));
+        }
+        ensureBytes(body_size);
 
         // Parse locals: compressed format with (count, type) pairs
         // Example: [(2, i32), (1, i64)] means 2 i32 locals and 1 i64 local
         uint32_t local_decl_count = readVarUint32();
+        uint64_t total_locals = 0;
+        local_runs_.clear();
         for (uint32_t j = 0; j < local_decl_count; j++) {
             uint32_t local_count = readVarUint32();
             ValueType type = readValueType();
-            for (uint32_t k = 0; k < local_count; k++) {
-                func.locals.push_back(type);
+            total_locals += local_count;
+            if (total_locals > MAX_FUNCTION_LOCALS) {
+                throw DecoderError(formatError("Too many locals in function " +
+                                 std::to_string(i)));
+            }
+            local_runs_.emplace_back(local_count, type);
+        }
+
+        ValueType* locals = arena_->allocateArray<ValueType>(total_locals);
+        size_t local_index = 0;
+        for (const auto& run : local_runs_) {
+            for (uint32_t k = 0; k < run.first; k++) {
+                locals[local_index++] = run.second;
             }
         }
 
         // Read function body bytecode (instructions)
         // Body ends with 0x0B (END instruction)
-        size_t body_bytes = body_size - (position_ - body_start);
-        func.body = readBytes(body_bytes);
+        size_t header_size = position_ - body_start;
+        if (header_size > body_size) {
+            throw DecoderError(formatError("Function body size too small for locals"));
+        }
+        size_t body_bytes = body_size - header_size;
+        if (code_used + body_bytes > section_size) {
+            throw DecoderError(formatError("Function bodies exceed the code section size"));
+        }
+        std::memcpy(code + code_used, bytes_ + position_, body_bytes);
+        position_ += body_bytes;
 
-        module.functions.push_back(std::move(func));
+        module.functions.add(module.function_types[i],
+                             ArrayView<ValueType>(locals, total_locals),
+                             ArrayView<uint8_t>(code + code_used, body_bytes));
+        code_used += body_bytes;
     }
 }
 
@@ -321,7 +408,15 @@ void Decoder::parseDataSection(Module& module) {
 
         // Read the actual data bytes
         uint32_t data_size = readVarUint32();
-        segment.data = readBytes(data_size);
+        if (source_) {
+            // Leave the bytes in the mapped file, so linear memory can map
+            // them too; the module keeps the mapping alive
+            ensureBytes(data_size);
+            segment.data = ArrayView<uint8_t>(bytes_ + position_, data_size);
+            position_ += data_size;
+        } else {
+            segment.data = readBytes(data_size);
+        }
 
         module.data_segments.push_back(std::move(segment));
     }
@@ -360,35 +455,112 @@ void Decoder::parseImportSection(Module& module) {
                 import.global.type = readValueType();
                 import.global.is_mutable = readByte() != 0;
                 break;
+            case ExternalKind::TAG:
+                throw DecoderError("Tag imports are not supported");
         }
 
         module.imports.push_back(std::move(import));
     }
 }
 
+void Decoder::parseTagSection(Module& module) {
+    // Tag section: count followed by (attribute 0x00, type index) pairs
+    uint32_t count = readVarUint32();
+    module.tags.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        if (readByte() != 0x00) {
+            throw DecoderError(formatError("Invalid tag attribute"));
+        }
+        uint32_t type_index = readVarUint32();
+        if (type_index >= module.composite_types.size() ||
+            module.composite_types[type_index].kind != CompositeType::Kind::FUNC) {
+            throw DecoderError(formatError("Tag type must be a function type"));
+        }
+        module.tags.push_back(type_index);
+    }
+}
+
+void Decoder::parseCustomSection(Module& module, uint32_t section_size) {
+    // Custom section: name followed by arbitrary payload
+    // Only the "name" section is interpreted; the rest are skipped
+    size_t section_end = position_ + section_size;
+    std::string_view name = readName();
+    if (name == "name") {
+        parseNameSection(module, section_end);
+    }
+}
+
+void Decoder::parseNameSection(Module& module, size_t section_end) {
+    // Name section: sequence of (id, size, payload) subsections
+    // Subsection 1 maps function indices to debug names. Names are advisory,
+    // so a malformed name section is dropped rather than failing the module.
+    constexpr uint8_t NAME_FUNCTIONS = 1;
+
+    try {
+        while (position_ < section_end) {
+            uint8_t id = readByte();
+            uint32_t size = readVarUint32();
+            size_t subsection_end = position_ + size;
+            if (subsection_end > section_end) {
+                throw DecoderError("Name subsection exceeds section");
+            }
+
+            if (id == NAME_FUNCTIONS) {
+                // The name section follows the import and function sections
+                size_t function_count = module.function_types.size();
+                for (const auto& import : module.imports) {
+                    function_count += import.kind == ExternalKind::FUNCTION ? 1 : 0;
+                }
+                module.function_names.resize(function_count);
+
+                uint32_t count = readVarUint32();
+                for (uint32_t i = 0; i < count; i++) {
+                    uint32_t func_index = readVarUint32();
+                    std::string_view func_name = readName();
+                    if (func_index < function_count) {
+                        module.function_names[func_index] = func_name;
+                    }
+                }
+            }
+            position_ = subsection_end;
+        }
+        if (position_ > section_end) {
+            throw DecoderError("Name section overrun");
+        }
+    } catch (const DecoderError&) {
+        module.function_names.clear();
+    }
+    position_ = section_end;
+}
+
 // Helper functions
 
-std::vector<uint8_t> Decoder::readInitExpression() {
+ArrayView<uint8_t> Decoder::readInitExpression() {
     // Read an initialization expression (constant expression)
     // Format: instruction(s) followed by END (0x0B)
     // Common examples: i32.const 0, global.get 0, etc.
-    std::vector<uint8_t> expr;
+    // Immediates are skipped as the opcode table describes them, so that an
+    // operand byte equal to 0x0B (e.g. i32.const 11) is not mistaken for END.
+    size_t start = position_;
 
     while (true) {
-        uint8_t byte = readByte();
-        expr.push_back(byte);
+        uint8_t opcode = readByte();
 
-        if (byte == OP_END) {
+        if (opcode == OP_END) {
             break;
         }
 
-        // Safety check to prevent infinite loops on malformed input
-        if (expr.size() > 1024) {
+        if (!skipImmediates(opcode, bytes_, size_, position_)) {
+            throw DecoderError(formatError("Truncated instruction or unknown sub-opcode in init expression"));
+        }
+
+        // Safety check to prevent runaway scans on malformed input
+        if (position_ - start > 1024) {
             throw DecoderError(formatError("Init expression too large (> 1024 bytes)"));
         }
     }
 
-    return expr;
+    return arena_->copy(bytes_ + start, position_ - start);
 }
 
 std::string Decoder::formatError(const std::string& message) const {
@@ -402,14 +574,14 @@ std::string Decoder::formatError(const std::string& message) const {
 
 uint8_t Decoder::readByte() {
     ensureBytes(1);
-    return buffer_[position_++];
+    return bytes_[position_++];
 }
 
 uint32_t Decoder::readU32() {
     // Read unsigned 32-bit integer in little-endian format
     ensureBytes(4);
     uint32_t value;
-    std::memcpy(&value, &buffer_[position_], 4);
+    std::memcpy(&value, &bytes_[position_], 4);
     position_ += 4;
     return value;
 }
@@ -423,7 +595,7 @@ int64_t Decoder::readI64() {
     // Read signed 64-bit integer in little-endian format
     ensureBytes(8);
     int64_t value;
-    std::memcpy(&value, &buffer_[position_], 8);
+    std::memcpy(&value, &bytes_[position_], 8);
     position_ += 8;
     return value;
 }
@@ -432,7 +604,7 @@ float Decoder::readF32() {
     // Read IEEE 754 single-precision float in little-endian format
     ensureBytes(4);
     float value;
-    std::memcpy(&value, &buffer_[position_], 4);
+    std::memcpy(&value, &bytes_[position_], 4);
     position_ += 4;
     return value;
 }
@@ -441,29 +613,25 @@ double Decoder::readF64() {
     // Read IEEE 754 double-precision float in little-endian format
     ensureBytes(8);
     double value;
-    std::memcpy(&value, &buffer_[position_], 8);
+    std::memcpy(&value, &bytes_[position_], 8);
     position_ += 8;
     return value;
 }
 
-std::vector<uint8_t> Decoder::readBytes(size_t count) {
-    // Read a sequence of raw bytes
+ArrayView<uint8_t> Decoder::readBytes(size_t count) {
+    // Read a sequence of raw bytes into the module arena
     ensureBytes(count);
-    std::vector<uint8_t> result(buffer_.begin() + position_,
-                                 buffer_.begin() + position_ + count);
+    ArrayView<uint8_t> result = arena_->copy(bytes_ + position_, count);
     position_ += count;
     return result;
 }
 
-std::string Decoder::readName() {
+std::string_view Decoder::readName() {
     // Read a UTF-8 string with LEB128 length prefix
     // Format: length (varuint32) followed by UTF-8 bytes
     uint32_t length = readVarUint32();
-    ensureBytes(length);
-
-    std::string name(reinterpret_cast<const char*>(&buffer_[position_]), length);
-    position_ += length;
-    return name;
+    ArrayView<uint8_t> bytes = readBytes(length);
+    return std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size());
 }
 
 // LEB128 decoding
@@ -471,7 +639,24 @@ std::string Decoder::readName() {
 // Each byte contains 7 bits of data and 1 continuation bit (MSB)
 // Continuation bit = 1 means more bytes follow, 0 means last byte
 
+// The LEB128 readers first try a single byte, then, while a word of input
+// remains, decode the whole value from one load without per-byte bounds
+// checks. Anything else (the end of the input, over-long or malformed
+// encodings) takes the byte-at-a-time loop, which reports the error.
+
 uint32_t Decoder::readVarUint32() {
+    if (position_ < size_ && bytes_[position_] < 0x80) {
+        return bytes_[position_++];
+    }
+    if (position_ + LEB128_WORD <= size_) {
+        uint64_t word = loadLeb128Word(bytes_ + position_);
+        unsigned length = leb128Length(word);
+        if (length != 0 && length <= 5) {
+            position_ += length;
+            return static_cast<uint32_t>(leb128Payload(word, length));
+        }
+    }
+
     // Decode unsigned 32-bit LEB128 integer
     // Maximum 5 bytes for 32-bit value (5 * 7 = 35 bits, covers 32)
     uint32_t result = 0;
@@ -496,6 +681,15 @@ uint32_t Decoder::readVarUint32() {
 }
 
 uint64_t Decoder::readVarUint64() {
+    if (position_ + LEB128_WORD <= size_) {
+        uint64_t word = loadLeb128Word(bytes_ + position_);
+        unsigned length = leb128Length(word);
+        if (length != 0) {
+            position_ += length;
+            return leb128Payload(word, length);
+        }
+    }
+
     // Decode unsigned 64-bit LEB128 integer
     // Maximum 10 bytes for 64-bit value (10 * 7 = 70 bits, covers 64)
     uint64_t result = 0;
@@ -520,6 +714,15 @@ uint64_t Decoder::readVarUint64() {
 }
 
 int32_t Decoder::readVarInt32() {
+    if (position_ + LEB128_WORD <= size_) {
+        uint64_t word = loadLeb128Word(bytes_ + position_);
+        unsigned length = leb128Length(word);
+        if (length != 0 && length <= 5) {
+            position_ += length;
+            return static_cast<int32_t>(leb128Signed(leb128Payload(word, length), length));
+        }
+    }
+
     // Decode signed 32-bit LEB128 integer with sign extension
     int32_t result = 0;
     int shift = 0;
@@ -540,6 +743,15 @@ int32_t Decoder::readVarInt32() {
 }
 
 int64_t Decoder::readVarInt64() {
+    if (position_ + LEB128_WORD <= size_) {
+        uint64_t word = loadLeb128Word(bytes_ + position_);
+        unsigned length = leb128Length(word);
+        if (length != 0) {
+            position_ += length;
+            return leb128Signed(leb128Payload(word, length), length);
+        }
+    }
+
     // Decode signed 64-bit LEB128 integer with sign extension
     int64_t result = 0;
     int shift = 0;
@@ -563,8 +775,46 @@ ValueType Decoder::readValueType() {
     // Read a value type byte
     // 0x7F = i32, 0x7E = i64, 0x7D = f32, 0x7C = f64
     // 0x70 = funcref (for tables), 0x40 = void/empty
+    // GC references share the ANYREF tag: the shorthands anyref, eqref,
+    // i31ref, structref, arrayref and nullref, and (ref null? <heaptype>)
+    // of GC heap types. Function and continuation references have their own
+    // tags
     uint8_t byte = readByte();
-    return static_cast<ValueType>(byte);
+    switch (byte) {
+        case 0x63:      // ref null <heaptype>
+        case 0x64: {    // ref <heaptype>
+            int64_t heap_type = readVarInt64();
+            // func/nofunc and extern/noextern keep their table element tags
+            if (heap_type == -0x10 || heap_type == -0x0D) {
+                return ValueType::FUNCREF;
+            }
+            if (heap_type == -0x11 || heap_type == -0x0E) {
+                return static_cast<ValueType>(0x6F);
+            }
+            if (heap_type == -0x18 || heap_type == -0x0B) {
+                return ValueType::CONTREF;
+            }
+            // Concrete types declared so far; later ones in the same
+            // recursion group are taken as GC types
+            if (heap_type >= 0 && static_cast<uint64_t>(heap_type) < composite_types_->size()) {
+                switch ((*composite_types_)[static_cast<size_t>(heap_type)].kind) {
+                    case CompositeType::Kind::FUNC:
+                        return ValueType::FUNCREF;
+                    case CompositeType::Kind::CONT:
+                        return ValueType::CONTREF;
+                    default:
+                        break;
+                }
+            }
+            return ValueType::ANYREF;
+        }
+        case 0x6E: case 0x6D: case 0x6C: case 0x6B: case 0x6A: case 0x71:
+            return ValueType::ANYREF;
+        case 0x68: case 0x75:   // contref, nullcontref
+            return ValueType::CONTREF;
+        default:
+            return static_cast<ValueType>(byte);
+    }
 }
 
 FuncType Decoder::readFuncType() {
@@ -596,6 +846,73 @@ FuncType Decoder::readFuncType() {
     return func_type;
 }
 
+void Decoder::readSubType(Module& module) {
+    // Optional sub/sub final prefix listing supertypes, then a func (0x60),
+    // struct (0x5F), array (0x5E) or continuation (0x5D) type
+    CompositeType composite;
+    ensureBytes(1);
+    if (bytes_[position_] == 0x50 || bytes_[position_] == 0x4F) {
+        readByte();
+        uint32_t supertype_count = readVarUint32();
+        for (uint32_t i = 0; i < supertype_count; i++) {
+            uint32_t supertype = readVarUint32();
+            // Supertypes come first, which also rules out cycles
+            if (supertype >= module.composite_types.size()) {
+                throw DecoderError("Supertype " + std::to_string(supertype) + " is not declared before its subtype");
+            }
+            if (i == 0) {
+                composite.supertype = supertype;
+            }
+        }
+    }
+
+    ensureBytes(1);
+    uint8_t form = bytes_[position_];
+    if (form == 0x5F) {
+        readByte();
+        composite.kind = CompositeType::Kind::STRUCT;
+        uint32_t field_count = readVarUint32();
+        composite.fields.reserve(field_count);
+        for (uint32_t i = 0; i < field_count; i++) {
+            composite.fields.push_back(readFieldType());
+        }
+        module.types.emplace_back();
+    } else if (form == 0x5E) {
+        readByte();
+        composite.kind = CompositeType::Kind::ARRAY;
+        composite.fields.push_back(readFieldType());
+        module.types.emplace_back();
+    } else if (form == 0x5D) {
+        readByte();
+        composite.kind = CompositeType::Kind::CONT;
+        composite.func_type = readVarUint32();
+        if (composite.func_type >= module.composite_types.size() ||
+            module.composite_types[composite.func_type].kind != CompositeType::Kind::FUNC) {
+            throw DecoderError("Continuation type must refer to an earlier function type");
+        }
+        module.types.emplace_back();
+    } else {
+        module.types.push_back(readFuncType());
+    }
+    module.composite_types.push_back(std::move(composite));
+}
+
+FieldType Decoder::readFieldType() {
+    // Storage type (a value type, or 0x78 i8 / 0x77 i16) and mutability
+    ensureBytes(1);
+    FieldType field;
+    uint8_t storage = bytes_[position_];
+    if (storage == 0x78 || storage == 0x77) {
+        readByte();
+        field.type = ValueType::I32;
+        field.packed_size = storage == 0x78 ? 1 : 2;
+    } else {
+        field.type = readValueType();
+    }
+    field.is_mutable = readByte() != 0;
+    return field;
+}
+
 Limits Decoder::readLimits() {
     // Read memory or table limits
     // Format: flags byte followed by min (and optionally max)
@@ -612,11 +929,11 @@ Limits Decoder::readLimits() {
 }
 
 bool Decoder::hasMoreData() const {
-    return position_ < buffer_.size();
+    return position_ < size_;
 }
 
 void Decoder::ensureBytes(size_t count) const {
-    if (position_ + count > buffer_.size()) {
+    if (position_ + count > size_) {
         throw DecoderError("Unexpected end of file");
     }
 }
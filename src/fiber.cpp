@@ -0,0 +1,229 @@
+#include "fiber.h"
+#include <cstdlib>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define WASM_HAVE_MMAP 1
+#endif
+
+#ifdef WASM_FIBER_ASM
+// wasm_fiber_switch(save_sp, next_sp) pushes the callee-saved registers,
+// stores the stack pointer in *save_sp, loads next_sp and pops the
+// registers saved there. A new stack is laid out as if it had switched
+// away from the start of wasm_fiber_start, which calls entry(arg) from
+// the registers the switch restores.
+#if defined(__x86_64__)
+// Saved frame, lowest address first: MXCSR and x87 control word, r15,
+// r14, r13, r12, rbx, rbp, return address
+asm(R"(
+    .text
+    .p2align 4
+    .globl wasm_fiber_switch
+    .hidden wasm_fiber_switch
+    .type wasm_fiber_switch, @function
+wasm_fiber_switch:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    subq $8, %rsp
+    stmxcsr (%rsp)
+    fnstcw 4(%rsp)
+    movq %rsp, (%rdi)
+    movq %rsi, %rsp
+    ldmxcsr (%rsp)
+    fldcw 4(%rsp)
+    addq $8, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size wasm_fiber_switch, .-wasm_fiber_switch
+
+    .p2align 4
+    .globl wasm_fiber_start
+    .hidden wasm_fiber_start
+    .type wasm_fiber_start, @function
+wasm_fiber_start:
+    .cfi_startproc
+    .cfi_undefined rip
+    movq %r12, %rdi
+    callq *%r13
+    ud2
+    .cfi_endproc
+    .size wasm_fiber_start, .-wasm_fiber_start
+)");
+#elif defined(__aarch64__)
+// Saved frame, lowest address first: x19-x30, then d8-d15
+asm(R"(
+    .text
+    .p2align 4
+    .globl wasm_fiber_switch
+    .hidden wasm_fiber_switch
+    .type wasm_fiber_switch, %function
+wasm_fiber_switch:
+    sub sp, sp, #160
+    stp x19, x20, [sp, #0]
+    stp x21, x22, [sp, #16]
+    stp x23, x24, [sp, #32]
+    stp x25, x26, [sp, #48]
+    stp x27, x28, [sp, #64]
+    stp x29, x30, [sp, #80]
+    stp d8, d9, [sp, #96]
+    stp d10, d11, [sp, #112]
+    stp d12, d13, [sp, #128]
+    stp d14, d15, [sp, #144]
+    mov x9, sp
+    str x9, [x0]
+    mov sp, x1
+    ldp x19, x20, [sp, #0]
+    ldp x21, x22, [sp, #16]
+    ldp x23, x24, [sp, #32]
+    ldp x25, x26, [sp, #48]
+    ldp x27, x28, [sp, #64]
+    ldp x29, x30, [sp, #80]
+    ldp d8, d9, [sp, #96]
+    ldp d10, d11, [sp, #112]
+    ldp d12, d13, [sp, #128]
+    ldp d14, d15, [sp, #144]
+    add sp, sp, #160
+    ret
+    .size wasm_fiber_switch, .-wasm_fiber_switch
+
+    .p2align 4
+    .globl wasm_fiber_start
+    .hidden wasm_fiber_start
+    .type wasm_fiber_start, %function
+wasm_fiber_start:
+    .cfi_startproc
+    .cfi_undefined x30
+    mov x0, x19
+    blr x20
+    brk #0
+    .cfi_endproc
+    .size wasm_fiber_start, .-wasm_fiber_start
+)");
+#endif
+
+extern "C" void wasm_fiber_switch(void** save_sp, void* next_sp);
+extern "C" void wasm_fiber_start();
+#endif
+
+namespace wasm {
+
+Fiber::Fiber(size_t stack_bytes) {
+#ifdef WASM_HAVE_MMAP
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    stack_bytes_ = (stack_bytes + page - 1) / page * page;
+    mapped_bytes_ = stack_bytes_ + page;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+#ifdef MAP_STACK
+    flags |= MAP_STACK;
+#endif
+    void* mapping = mmap(nullptr, mapped_bytes_, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (mapping == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    mapping_ = static_cast<uint8_t*>(mapping);
+    mprotect(mapping_, page, PROT_NONE);     // Stacks grow down into the guard page
+#else
+    (void)stack_bytes;
+    throw std::bad_alloc();
+#endif
+}
+
+Fiber::~Fiber() {
+#ifdef WASM_HAVE_MMAP
+    if (mapping_) {
+        munmap(mapping_, mapped_bytes_);
+    }
+#endif
+}
+
+bool Fiber::supported() {
+#if defined(WASM_FIBER_ASM) || defined(WASM_FIBER_UCONTEXT)
+    return true;
+#else
+    return false;
+#endif
+}
+
+#if defined(WASM_FIBER_ASM)
+
+void Fiber::start(Entry entry, void* arg) {
+    uintptr_t top = reinterpret_cast<uintptr_t>(mapping_ + mapped_bytes_) & ~uintptr_t(15);
+    void** frame;
+#if defined(__x86_64__)
+    // rsp is 16-byte aligned after the final ret, as at a call site
+    frame = reinterpret_cast<void**>(top - 80);
+    frame[0] = reinterpret_cast<void*>(uintptr_t(0x037F) << 32 | 0x1F80);  // Default FPU control
+    frame[1] = nullptr;                                     // r15
+    frame[2] = nullptr;                                     // r14
+    frame[3] = reinterpret_cast<void*>(entry);              // r13
+    frame[4] = arg;                                         // r12
+    frame[5] = nullptr;                                     // rbx
+    frame[6] = nullptr;                                     // rbp
+    frame[7] = reinterpret_cast<void*>(wasm_fiber_start);   // Return address
+#else
+    frame = reinterpret_cast<void**>(top - 160);
+    for (size_t i = 0; i < 20; i++) {
+        frame[i] = nullptr;
+    }
+    frame[0] = arg;                                         // x19
+    frame[1] = reinterpret_cast<void*>(entry);              // x20
+    frame[11] = reinterpret_cast<void*>(wasm_fiber_start);  // x30
+#endif
+    sp_ = frame;
+}
+
+void Fiber::switchTo(Fiber& next) {
+    wasm_fiber_switch(&sp_, next.sp_);
+}
+
+#elif defined(WASM_FIBER_UCONTEXT)
+
+void Fiber::start(Entry entry, void* arg) {
+    entry_ = entry;
+    arg_ = arg;
+    getcontext(&context_);
+    context_.uc_stack.ss_sp = mapping_ + (mapped_bytes_ - stack_bytes_);
+    context_.uc_stack.ss_size = stack_bytes_;
+    context_.uc_link = nullptr;
+    // makecontext() passes int arguments only, so the pointer is split
+    uintptr_t self = reinterpret_cast<uintptr_t>(this);
+    makecontext(&context_, reinterpret_cast<void (*)()>(trampoline), 2,
+                static_cast<unsigned int>(static_cast<uint64_t>(self) >> 32),
+                static_cast<unsigned int>(self));
+}
+
+void Fiber::trampoline(unsigned int high, unsigned int low) {
+    Fiber* fiber = reinterpret_cast<Fiber*>(static_cast<uintptr_t>(static_cast<uint64_t>(high) << 32 | low));
+    fiber->entry_(fiber->arg_);
+    std::abort();
+}
+
+void Fiber::switchTo(Fiber& next) {
+    swapcontext(&context_, &next.context_);
+}
+
+#else
+
+void Fiber::start(Entry, void*) {}
+
+void Fiber::switchTo(Fiber&) {
+    std::abort();
+}
+
+#endif
+
+} // namespace wasm
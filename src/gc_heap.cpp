@@ -0,0 +1,311 @@
+#include "gc_heap.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace wasm {
+
+namespace {
+
+uint64_t nowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Bytes a field occupies in an object; funcref and externref fields are
+// kept as 8-byte values but not traced
+uint8_t storageSize(const FieldType& field) {
+    if (field.packed_size != 0) {
+        return field.packed_size;
+    }
+    size_t size = getValueTypeSize(field.type);
+    return static_cast<uint8_t>(size == 0 ? 8 : size);
+}
+
+} // anonymous namespace
+
+GcHeap::GcHeap(const std::vector<CompositeType>& types, const GcOptions& options)
+    : types_(types), options_(options), major_threshold_(options.major_threshold) {
+    layouts_.resize(types_.size());
+    for (size_t i = 0; i < types_.size(); i++) {
+        const CompositeType& composite = types_[i];
+        Layout& layout = layouts_[i];
+        if (composite.kind == CompositeType::Kind::ARRAY) {
+            layout.element_size = storageSize(composite.fields[0]);
+            layout.element_ref = composite.fields[0].type == ValueType::ANYREF;
+        } else if (composite.kind == CompositeType::Kind::STRUCT) {
+            // Fields in declaration order, each aligned to its size
+            size_t offset = sizeof(Header);
+            for (const FieldType& field : composite.fields) {
+                uint8_t size = storageSize(field);
+                offset = alignUp(offset, size);
+                layout.offsets.push_back(static_cast<uint32_t>(offset));
+                layout.sizes.push_back(size);
+                if (field.type == ValueType::ANYREF) {
+                    layout.ref_offsets.push_back(static_cast<uint32_t>(offset));
+                }
+                offset += size;
+            }
+            layout.size = static_cast<uint32_t>(alignUp(offset, 8));
+        }
+    }
+
+    size_t nursery_bytes = alignUp(std::max<size_t>(options_.nursery_bytes, 4096), 8);
+    options_.nursery_bytes = nursery_bytes;
+    nursery_.reset(new uint8_t[nursery_bytes]);
+    nursery_begin_ = nursery_.get();
+    nursery_top_ = nursery_begin_;
+    nursery_end_ = nursery_begin_ + nursery_bytes;
+}
+
+GcHeap::~GcHeap() = default;
+
+uint64_t GcHeap::allocateStruct(uint32_t type_index) {
+    return allocate(type_index, layouts_[type_index].size, 0);
+}
+
+uint64_t GcHeap::allocateArray(uint32_t type_index, uint32_t length) {
+    uint64_t bytes = sizeof(Header) + static_cast<uint64_t>(length) * layouts_[type_index].element_size;
+    if (bytes > options_.max_bytes) {
+        throw GcError("Array of " + std::to_string(length) + " elements exceeds the heap limit");
+    }
+    return allocate(type_index, alignUp(static_cast<size_t>(bytes), 8), length);
+}
+
+uint64_t GcHeap::allocate(uint32_t type_index, size_t size, uint32_t length) {
+    uint8_t* object;
+    if (size > options_.nursery_bytes / 2) {
+        // Too big to copy out of the nursery cheaply: allocate it old
+        if (old_bytes_ + size > major_threshold_) {
+            collectMinor();
+            if (old_bytes_ + size > major_threshold_) {
+                collectMajor();
+            }
+        }
+        if (old_bytes_ + size > options_.max_bytes) {
+            throw GcError("Heap limit of " + std::to_string(options_.max_bytes) + " bytes exceeded");
+        }
+        object = allocateOld(size);
+    } else {
+        if (static_cast<size_t>(nursery_end_ - nursery_top_) < size) {
+            collectMinor();
+            if (old_bytes_ > options_.max_bytes) {
+                throw GcError("Heap limit of " + std::to_string(options_.max_bytes) + " bytes exceeded");
+            }
+        }
+        object = nursery_top_;
+        nursery_top_ += size;
+    }
+
+    std::memset(object, 0, size);
+    Header* h = reinterpret_cast<Header*>(object);
+    h->type_index = type_index;
+    h->length = length;
+    h->size = static_cast<uint32_t>(size);
+    stats_.allocations++;
+    stats_.allocated_bytes += size;
+    return reinterpret_cast<uintptr_t>(object);
+}
+
+uint8_t* GcHeap::allocateOld(size_t size) {
+    if (old_.empty() || old_.back().capacity - old_.back().used < size) {
+        size_t capacity = std::max(CHUNK_BYTES, size);
+        old_.push_back(Chunk{std::unique_ptr<uint8_t[]>(new uint8_t[capacity]), capacity, 0});
+    }
+    Chunk& chunk = old_.back();
+    uint8_t* object = chunk.data.get() + chunk.used;
+    chunk.used += size;
+    old_bytes_ += size;
+    return object;
+}
+
+// ===== Field access =====
+
+uint64_t GcHeap::getField(uint64_t ref, uint32_t field) const {
+    const Layout& layout = layouts_[header(ref)->type_index];
+    uint64_t bits = 0;
+    std::memcpy(&bits, reinterpret_cast<const uint8_t*>(header(ref)) + layout.offsets[field], layout.sizes[field]);
+    return bits;
+}
+
+void GcHeap::setField(uint64_t ref, uint32_t field, Value value) {
+    uint32_t type_index = header(ref)->type_index;
+    const Layout& layout = layouts_[type_index];
+    std::memcpy(reinterpret_cast<uint8_t*>(header(ref)) + layout.offsets[field], &value, layout.sizes[field]);
+    if (types_[type_index].fields[field].type == ValueType::ANYREF) {
+        writeBarrier(ref, value.ref);
+    }
+}
+
+uint64_t GcHeap::getElement(uint64_t ref, uint32_t index) const {
+    const Layout& layout = layouts_[header(ref)->type_index];
+    uint64_t bits = 0;
+    std::memcpy(&bits, reinterpret_cast<const uint8_t*>(header(ref)) + sizeof(Header) +
+                       static_cast<size_t>(index) * layout.element_size, layout.element_size);
+    return bits;
+}
+
+void GcHeap::setElement(uint64_t ref, uint32_t index, Value value) {
+    const Layout& layout = layouts_[header(ref)->type_index];
+    std::memcpy(reinterpret_cast<uint8_t*>(header(ref)) + sizeof(Header) +
+                static_cast<size_t>(index) * layout.element_size, &value, layout.element_size);
+    if (layout.element_ref) {
+        writeBarrier(ref, value.ref);
+    }
+}
+
+uint32_t GcHeap::arrayLength(uint64_t ref) const {
+    return header(ref)->length;
+}
+
+uint32_t GcHeap::typeIndex(uint64_t ref) const {
+    return header(ref)->type_index;
+}
+
+void GcHeap::writeBarrier(uint64_t ref, uint64_t value) {
+    // Old objects pointing into the nursery are extra roots for the next
+    // minor collection
+    if (isObject(value) && inNursery(header(value)) && !inNursery(header(ref))) {
+        Header* h = header(ref);
+        if ((h->flags & REMEMBERED) == 0) {
+            h->flags |= REMEMBERED;
+            remembered_.push_back(reinterpret_cast<uint8_t*>(h));
+        }
+    }
+}
+
+// ===== Collection =====
+
+void GcHeap::collect() {
+    collectMajor();
+    stats_.old_bytes = old_bytes_;
+}
+
+void GcHeap::clear() {
+    nursery_top_ = nursery_begin_;
+    old_.clear();
+    old_bytes_ = 0;
+    remembered_.clear();
+    major_threshold_ = options_.major_threshold;
+    stats_.old_bytes = 0;
+}
+
+void GcHeap::collectMinor() {
+    uint64_t start = nowNs();
+
+    // Promoted objects are appended from here on and scanned in order
+    size_t scan_chunk = old_.empty() ? 0 : old_.size() - 1;
+    size_t scan_offset = old_.empty() ? 0 : old_.back().used;
+
+    if (roots_) {
+        roots_([this](uint64_t& ref) { ref = evacuate(ref, false); });
+    }
+    for (uint8_t* object : remembered_) {
+        reinterpret_cast<Header*>(object)->flags &= ~REMEMBERED;
+        scanObject(object, false);
+    }
+    remembered_.clear();
+    scanFrom(scan_chunk, scan_offset, false);
+
+    nursery_top_ = nursery_begin_;
+    stats_.minor_collections++;
+    recordPause(start);
+
+    if (old_bytes_ > major_threshold_) {
+        collectMajor();
+    }
+    stats_.old_bytes = old_bytes_;
+}
+
+void GcHeap::collectMajor() {
+    uint64_t start = nowNs();
+
+    // Copy everything reachable, nursery included, into fresh chunks
+    std::vector<Chunk> from;
+    from.swap(old_);
+    old_bytes_ = 0;
+    remembered_.clear();
+
+    if (roots_) {
+        roots_([this](uint64_t& ref) { ref = evacuate(ref, true); });
+    }
+    scanFrom(0, 0, true);
+
+    nursery_top_ = nursery_begin_;
+    major_threshold_ = std::max(options_.major_threshold, static_cast<size_t>(old_bytes_ * options_.growth));
+    stats_.major_collections++;
+    stats_.old_bytes = old_bytes_;
+    recordPause(start);
+}
+
+uint64_t GcHeap::evacuate(uint64_t ref, bool major) {
+    if (!isObject(ref)) {
+        return ref;
+    }
+    Header* h = header(ref);
+    if (!major && !inNursery(h)) {
+        return ref;
+    }
+    uint64_t forwarded;
+    if (h->flags & FORWARDED) {
+        std::memcpy(&forwarded, h, sizeof(forwarded));
+        return forwarded;
+    }
+
+    uint8_t* copy = allocateOld(h->size);
+    std::memcpy(copy, h, h->size);
+    reinterpret_cast<Header*>(copy)->flags &= ~REMEMBERED;
+    if (!major) {
+        stats_.promoted_bytes += h->size;
+    }
+
+    // The new address replaces type_index and length of the old copy
+    forwarded = reinterpret_cast<uintptr_t>(copy);
+    std::memcpy(h, &forwarded, sizeof(forwarded));
+    h->flags |= FORWARDED;
+    return forwarded;
+}
+
+void GcHeap::scanObject(uint8_t* object, bool major) {
+    const Header* h = reinterpret_cast<const Header*>(object);
+    const Layout& layout = layouts_[h->type_index];
+    if (types_[h->type_index].kind == CompositeType::Kind::ARRAY) {
+        if (layout.element_ref) {
+            uint64_t* slots = reinterpret_cast<uint64_t*>(object + sizeof(Header));
+            for (uint32_t i = 0; i < h->length; i++) {
+                slots[i] = evacuate(slots[i], major);
+            }
+        }
+    } else {
+        for (uint32_t offset : layout.ref_offsets) {
+            uint64_t* slot = reinterpret_cast<uint64_t*>(object + offset);
+            *slot = evacuate(*slot, major);
+        }
+    }
+}
+
+void GcHeap::scanFrom(size_t chunk, size_t offset, bool major) {
+    // Cheney scan: objects copied while scanning are appended behind the
+    // scan position, possibly in new chunks
+    while (chunk < old_.size()) {
+        while (offset < old_[chunk].used) {
+            uint8_t* object = old_[chunk].data.get() + offset;
+            scanObject(object, major);
+            offset += reinterpret_cast<const Header*>(object)->size;
+        }
+        chunk++;
+        offset = 0;
+    }
+}
+
+void GcHeap::recordPause(uint64_t start_ns) {
+    uint64_t pause = nowNs() - start_ns;
+    stats_.total_pause_ns += pause;
+    stats_.max_pause_ns = std::max(stats_.max_pause_ns, pause);
+}
+
+} // namespace wasm
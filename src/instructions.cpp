@@ -1,108 +1,211 @@
 #include "instructions.h"
-#include <unordered_map>
+#include "leb128.h"
 
 namespace wasm {
 
 namespace {
-    // Opcode name lookup table
-    const std::unordered_map<Opcode, std::string> opcode_names = {
-        // Control flow
-        {Opcode::UNREACHABLE, "unreachable"},
-        {Opcode::NOP, "nop"},
-        {Opcode::BLOCK, "block"},
-        {Opcode::LOOP, "loop"},
-        {Opcode::IF, "if"},
-        {Opcode::ELSE, "else"},
-        {Opcode::END, "end"},
-        {Opcode::BR, "br"},
-        {Opcode::BR_IF, "br_if"},
-        {Opcode::BR_TABLE, "br_table"},
-        {Opcode::RETURN, "return"},
-        {Opcode::CALL, "call"},
-        {Opcode::CALL_INDIRECT, "call_indirect"},
-
-        // Parametric
-        {Opcode::DROP, "drop"},
-        {Opcode::SELECT, "select"},
-
-        // Variable access
-        {Opcode::LOCAL_GET, "local.get"},
-        {Opcode::LOCAL_SET, "local.set"},
-        {Opcode::LOCAL_TEE, "local.tee"},
-        {Opcode::GLOBAL_GET, "global.get"},
-        {Opcode::GLOBAL_SET, "global.set"},
-
-        // Memory
-        {Opcode::I32_LOAD, "i32.load"},
-        {Opcode::I64_LOAD, "i64.load"},
-        {Opcode::F32_LOAD, "f32.load"},
-        {Opcode::F64_LOAD, "f64.load"},
-        {Opcode::I32_STORE, "i32.store"},
-        {Opcode::I64_STORE, "i64.store"},
-        {Opcode::F32_STORE, "f32.store"},
-        {Opcode::F64_STORE, "f64.store"},
-        {Opcode::MEMORY_SIZE, "memory.size"},
-        {Opcode::MEMORY_GROW, "memory.grow"},
-
-        // Constants
-        {Opcode::I32_CONST, "i32.const"},
-        {Opcode::I64_CONST, "i64.const"},
-        {Opcode::F32_CONST, "f32.const"},
-        {Opcode::F64_CONST, "f64.const"},
-
-        // i32 operations
-        {Opcode::I32_ADD, "i32.add"},
-        {Opcode::I32_SUB, "i32.sub"},
-        {Opcode::I32_MUL, "i32.mul"},
-        {Opcode::I32_DIV_S, "i32.div_s"},
-        {Opcode::I32_DIV_U, "i32.div_u"},
-        {Opcode::I32_EQ, "i32.eq"},
-        {Opcode::I32_NE, "i32.ne"},
-        {Opcode::I32_LT_S, "i32.lt_s"},
-        {Opcode::I32_LT_U, "i32.lt_u"},
-        {Opcode::I32_GT_S, "i32.gt_s"},
-        {Opcode::I32_GT_U, "i32.gt_u"},
-
-        // i64 operations
-        {Opcode::I64_ADD, "i64.add"},
-        {Opcode::I64_SUB, "i64.sub"},
-        {Opcode::I64_MUL, "i64.mul"},
-        {Opcode::I64_EQ, "i64.eq"},
-
-        // f32 operations
-        {Opcode::F32_ADD, "f32.add"},
-        {Opcode::F32_SUB, "f32.sub"},
-        {Opcode::F32_MUL, "f32.mul"},
-        {Opcode::F32_DIV, "f32.div"},
-
-        // f64 operations
-        {Opcode::F64_ADD, "f64.add"},
-        {Opcode::F64_SUB, "f64.sub"},
-        {Opcode::F64_MUL, "f64.mul"},
-        {Opcode::F64_DIV, "f64.div"},
+    // Every entry is either unassigned or fully described
+    constexpr bool tableIsConsistent() {
+        for (const OpcodeInfo& info : OPCODE_TABLE) {
+            if (!info.name && (info.handler != Handler::UNSUPPORTED || info.immediate != Immediate::NONE)) {
+                return false;
+            }
+        }
+        for (const OpcodeInfo& info : MISC_OPCODE_TABLE) {
+            if (!info.name) {
+                return false;
+            }
+        }
+        return true;
+    }
+    static_assert(tableIsConsistent(), "Unassigned opcodes must have no handler or immediates");
+    static_assert(OPCODE_TABLE[0x11].immediate == Immediate::U32_PAIR, "call_indirect has type and table");
+    static_assert(OPCODE_TABLE[0x3F].immediate == Immediate::U32, "memory.size has one memory index");
+
+    // Reads immediates, noting rather than throwing when they run past the end
+    class Cursor {
+    public:
+        Cursor(const uint8_t* code, size_t size, size_t pc) : code_(code), size_(size), pc_(pc) {}
+
+        size_t pc() const { return pc_; }
+        bool truncated() const { return truncated_; }
+
+        uint8_t byte() {
+            if (pc_ >= size_) {
+                truncated_ = true;
+                return 0;
+            }
+            return code_[pc_++];
+        }
+
+        void skip(size_t bytes) {
+            if (size_ - pc_ < bytes) {
+                truncated_ = true;
+                pc_ = size_;
+            } else {
+                pc_ += bytes;
+            }
+        }
+
+        // Past one LEB128 value, whatever its width. Most are one byte;
+        // longer ones take one load while a word remains
+        void skipLeb() {
+            if (pc_ < size_ && code_[pc_] < 0x80) {
+                pc_++;
+                return;
+            }
+            if (pc_ + LEB128_WORD <= size_) {
+                unsigned length = leb128Length(loadLeb128Word(code_ + pc_));
+                if (length != 0) {
+                    pc_ += length;
+                    return;
+                }
+            }
+            while (byte() & 0x80) {}
+        }
+
+        uint32_t readLeb() {
+            if (pc_ < size_ && code_[pc_] < 0x80) {
+                return code_[pc_++];
+            }
+            if (pc_ + LEB128_WORD <= size_) {
+                uint64_t word = loadLeb128Word(code_ + pc_);
+                unsigned length = leb128Length(word);
+                if (length != 0) {
+                    pc_ += length;
+                    return static_cast<uint32_t>(leb128Payload(word, length));
+                }
+            }
+            uint32_t value = 0;
+            int shift = 0;
+            uint8_t next;
+            do {
+                next = byte();
+                if (shift < 32) value |= static_cast<uint32_t>(next & 0x7F) << shift;
+                shift += 7;
+            } while (next & 0x80);
+            return value;
+        }
+
+        // A value type or block type: one byte or s33, or (ref null? <heaptype>)
+        void skipValueType() {
+            if (pc_ < size_ && (code_[pc_] == 0x63 || code_[pc_] == 0x64)) {
+                pc_++;
+            }
+            skipLeb();
+        }
+
+        // Resume handler clauses: (on $tag $label) is 0x00, (on $tag switch) 0x01
+        void skipHandlers() {
+            uint32_t count = readLeb();
+            for (uint32_t i = 0; i < count && !truncated_; i++) {
+                uint8_t kind = byte();
+                skipLeb();
+                if (kind == 0x00) skipLeb();
+            }
+        }
+
+    private:
+        const uint8_t* code_;
+        size_t size_;
+        size_t pc_;
+        bool truncated_ = false;
     };
 }
 
 std::string opcodeToString(Opcode opcode) {
-    auto it = opcode_names.find(opcode);
-    if (it != opcode_names.end()) {
-        return it->second;
-    }
-    return "unknown";
+    const char* name = OPCODE_TABLE[static_cast<uint8_t>(opcode)].name;
+    return name ? name : "unknown";
+}
+
+std::string opcodeToString(uint8_t prefix, uint32_t sub_opcode) {
+    const OpcodeInfo* info = prefixedOpcodeInfo(prefix, sub_opcode);
+    return info ? info->name : "unknown";
 }
 
 bool isControlFlowInstruction(Opcode opcode) {
-    return opcode >= Opcode::UNREACHABLE && opcode <= Opcode::CALL_INDIRECT;
+    return OPCODE_TABLE[static_cast<uint8_t>(opcode)].handler == Handler::CONTROL;
 }
 
 bool isMemoryInstruction(Opcode opcode) {
-    return (opcode >= Opcode::I32_LOAD && opcode <= Opcode::I64_STORE32) ||
-           opcode == Opcode::MEMORY_SIZE || opcode == Opcode::MEMORY_GROW;
+    return OPCODE_TABLE[static_cast<uint8_t>(opcode)].handler == Handler::MEMORY;
 }
 
 bool isNumericInstruction(Opcode opcode) {
-    return (opcode >= Opcode::I32_CONST && opcode <= Opcode::F64_CONST) ||
-           (opcode >= Opcode::I32_EQZ && opcode <= Opcode::F64_REINTERPRET_I64);
+    Handler handler = OPCODE_TABLE[static_cast<uint8_t>(opcode)].handler;
+    return handler == Handler::CONSTANT || handler == Handler::NUMERIC ||
+           (handler == Handler::CONVERSION && opcode != static_cast<Opcode>(0xFC));
+}
+
+bool skipImmediates(uint8_t opcode, const uint8_t* code, size_t size, size_t& pc) {
+    Cursor in(code, size, pc);
+    const OpcodeInfo* info = &OPCODE_TABLE[opcode];
+    if (info->immediate == Immediate::PREFIX) {
+        info = prefixedOpcodeInfo(opcode, in.readLeb());
+        if (!info) {
+            // Its immediates are unknown, so the rest of the body cannot be followed
+            pc = size;
+            return false;
+        }
+    }
+
+    switch (info->immediate) {
+        case Immediate::NONE:
+        case Immediate::PREFIX:
+            break;
+        case Immediate::U32:
+        case Immediate::S32:
+        case Immediate::S64:
+        case Immediate::HEAP_TYPE:
+            in.skipLeb();
+            break;
+        case Immediate::U32_PAIR:
+        case Immediate::MEMARG:
+            in.skipLeb();
+            in.skipLeb();
+            break;
+        case Immediate::F32:
+            in.skip(4);
+            break;
+        case Immediate::F64:
+            in.skip(8);
+            break;
+        case Immediate::BLOCK_TYPE:
+            in.skipValueType();
+            break;
+        case Immediate::BR_TABLE: {
+            uint32_t count = in.readLeb();
+            for (uint32_t i = 0; i <= count && !in.truncated(); i++) {
+                in.skipLeb();
+            }
+            break;
+        }
+        case Immediate::SELECT_TYPES: {
+            uint32_t count = in.readLeb();
+            for (uint32_t i = 0; i < count && !in.truncated(); i++) {
+                in.skipValueType();
+            }
+            break;
+        }
+        case Immediate::RESUME:
+            in.skipLeb();
+            in.skipHandlers();
+            break;
+        case Immediate::RESUME_THROW:
+            in.skipLeb();
+            in.skipLeb();
+            in.skipHandlers();
+            break;
+        case Immediate::BR_ON_CAST:
+            in.byte();
+            in.skipLeb();
+            in.skipLeb();
+            in.skipLeb();
+            break;
+    }
+
+    pc = in.pc();
+    return !in.truncated();
 }
 
 } // namespace wasm
@@ -1,19 +1,63 @@
 #include "interpreter.h"
+#include "aot.h"
+#include "tier_up.h"
 #include <iostream>
 #include <cmath>
 #include <cstdint>
 #include <cstring>
+#include <algorithm>
+#include <cstddef>
 
 namespace wasm {
 
+// Argument, result and global vectors are handed to compiled code as-is
+static_assert(sizeof(TypedValue) == sizeof(wasm_rt_value), "TypedValue layout must match wasm_rt_value");
+static_assert(offsetof(TypedValue, value) == offsetof(wasm_rt_value, value),
+              "TypedValue layout must match wasm_rt_value");
+
 Interpreter::Interpreter()
-    : code_(nullptr), code_size_(0), pc_(0) {
+    : locals_base_(0), code_(nullptr), code_size_(0), pc_(0), labels_base_(0), native_instance_(),
+      perf_enabled_(false), trace_memory_grow_(0), trace_depth_(0), current_(&root_context_),
+      continuation_stack_bytes_(size_t(1) << 20) {
 }
 
 Interpreter::~Interpreter() = default;
 
 void Interpreter::instantiate(Module&& module) {
+    instantiate(std::move(module), ImportResolver());
+}
+
+void Interpreter::instantiate(Module&& module, const ImportResolver& resolve) {
+    // Background compilation refers to the old module; stop it first
+    tier_up_.reset();
+    native_invokers_.clear();
+    native_modules_.clear();
+
     module_ = std::make_unique<Module>(std::move(module));
+    snapshot_.reset();
+    releaseContinuations();
+    gc_heap_.reset();
+    for (const CompositeType& type : module_->composite_types) {
+        if (type.kind == CompositeType::Kind::STRUCT || type.kind == CompositeType::Kind::ARRAY) {
+            gc_heap_ = std::make_unique<GcHeap>(module_->composite_types, gc_options_);
+            gc_heap_->setRoots([this](const GcHeap::RootVisitor& visit) { visitGcRoots(visit); });
+            break;
+        }
+    }
+    function_branches_.clear();
+    function_branches_.resize(module_->functions.size());
+    call_counts_.assign(module_->getTotalFunctionCount(), 0);
+    perf_trampolines_.reset();
+    if (perf_enabled_) {
+        createPerfTrampolines();
+    }
+    trace_depth_ = 0;
+    if (tracer_) {
+        internTraceNames();
+    }
+    if (counter_profile_) {
+        nameCounterProfile();
+    }
 
     // Handle imports - register WASI functions
     for (const auto& import : module_->imports) {
@@ -22,12 +66,13 @@ void Interpreter::instantiate(Module&& module) {
             if (import.module_name == "wasi_snapshot_preview1") {
                 // Register WASI functions
                 if (import.field_name == "fd_write") {
-                    wasi_imports_[import.field_name] = true;
+                    wasi_imports_[std::string(import.field_name)] = true;
                 }
             }
         }
     }
 
+    linkImports(resolve);
     initializeMemory();
     initializeGlobals();
     initializeTables();
@@ -40,8 +85,70 @@ void Interpreter::instantiate(Module&& module) {
     }
 }
 
+void Interpreter::takeSnapshot() {
+    if (!module_) {
+        throw InterpreterError("No module instantiated");
+    }
+    if (gc_heap_) {
+        // The heap is not saved; restoreSnapshot() empties it
+        for (const TypedValue& global : globals_) {
+            if (global.type == ValueType::ANYREF && GcHeap::isObject(global.value.ref)) {
+                throw InterpreterError("Cannot snapshot globals that hold GC objects");
+            }
+        }
+    }
+    snapshot_ = std::make_unique<Snapshot>();
+    if (memory_) {
+        snapshot_->memory = std::make_unique<Memory>(*memory_);
+        memory_->trackDirtyPages(true);
+    }
+    snapshot_->globals = globals_;
+    snapshot_->table = table_;
+}
+
+void Interpreter::restoreSnapshot() {
+    if (!snapshot_) {
+        throw InterpreterError("No snapshot taken");
+    }
+    if (memory_) {
+        if (isNative()) {
+            // Compiled code writes through data() without marking pages
+            memory_->markDirty(0, memory_->sizeInBytes());
+        }
+        memory_->resetTo(*snapshot_->memory);
+        memory_->setProfile(memory_profile_.get());
+    }
+    globals_ = snapshot_->globals;
+    table_ = snapshot_->table;
+    stack_.clear();
+    releaseContinuations();
+    if (gc_heap_) {
+        gc_heap_->clear();
+    }
+}
+
 std::vector<TypedValue> Interpreter::call(const std::string& function_name,
                                           const std::vector<TypedValue>& args) {
+    std::vector<TypedValue> results;
+    call(function_name, args, results);
+    return results;
+}
+
+void Interpreter::call(const std::string& function_name, const std::vector<TypedValue>& args,
+                       std::vector<TypedValue>& results) {
+    callFunction(exportedFunction(function_name), args, results);
+}
+
+const FuncType& Interpreter::exportType(const std::string& function_name) const {
+    uint32_t func_index = exportedFunction(function_name);
+    const FuncType* type = module_->getFunctionType(func_index);
+    if (!type) {
+        throw InterpreterError("Invalid function type for export: " + function_name);
+    }
+    return *type;
+}
+
+uint32_t Interpreter::exportedFunction(const std::string& function_name) const {
     if (!module_) {
         throw InterpreterError("No module instantiated");
     }
@@ -55,16 +162,29 @@ std::vector<TypedValue> Interpreter::call(const std::string& function_name,
         throw InterpreterError("Export is not a function: " + function_name);
     }
 
-    return callFunction(exp->index, args);
+    if (exp->index >= module_->getTotalFunctionCount()) {
+        throw InterpreterError("Invalid function index for export: " + function_name);
+    }
+    return exp->index;
 }
 
 std::vector<TypedValue> Interpreter::callFunction(uint32_t func_index,
                                                    const std::vector<TypedValue>& args) {
+    std::vector<TypedValue> results;
+    callFunction(func_index, args, results);
+    return results;
+}
+
+void Interpreter::callFunction(uint32_t func_index, const std::vector<TypedValue>& args,
+                               std::vector<TypedValue>& results) {
     if (!module_) {
         throw InterpreterError("No module instantiated");
     }
 
-    validateFunctionCall(func_index);
+    validateFunctionCall(func_index, args);
+
+    // Entry from the host: no compiled frames are live
+    native_instance_.call_depth = 0;
 
     // Push arguments onto stack
     for (const auto& arg : args) {
@@ -72,28 +192,160 @@ std::vector<TypedValue> Interpreter::callFunction(uint32_t func_index,
     }
 
     // Execute function
-    execute(func_index);
+    if (tracer_) {
+        try {
+            execute(func_index);
+        } catch (const std::exception& error) {
+            traceTrap(error);
+            throw;
+        }
+    } else {
+        execute(func_index);
+    }
 
     // Collect results
     const FuncType* func_type = module_->getFunctionType(func_index);
-    std::vector<TypedValue> results;
+    size_t result_count = func_type ? func_type->results.size() : 0;
+    results.resize(result_count);
+
+    // Pop results in reverse order
+    for (size_t i = result_count; i > 0; i--) {
+        results[i - 1] = stack_.pop();
+    }
+}
+
+// ===== Linking =====
+
+namespace {
+
+std::string importName(const Import& import) {
+    return std::string(import.module_name) + "." + std::string(import.field_name);
+}
 
-    if (func_type && !func_type->results.empty()) {
-        size_t result_count = func_type->results.size();
-        results.resize(result_count);
+bool hasReference(const std::vector<ValueType>& types) {
+    for (ValueType type : types) {
+        if (type == ValueType::ANYREF || type == ValueType::FUNCREF || type == ValueType::CONTREF) {
+            return true;
+        }
+    }
+    return false;
+}
 
-        // Pop results in reverse order
-        for (size_t i = result_count; i > 0; i--) {
-            results[i - 1] = stack_.pop();
+} // anonymous namespace
+
+void Interpreter::linkImports(const ImportResolver& resolve) {
+    // Each function import appends one entry, in import order
+    linked_functions_.clear();
+    linked_functions_.reserve(module_->getImportedFunctionCount());
+    table_owner_ = nullptr;
+    memory_.reset();
+    globals_.clear();
+
+    for (const Import& import : module_->imports) {
+        Interpreter* exporter = nullptr;
+        if (resolve && import.module_name != "wasi_snapshot_preview1") {
+            exporter = resolve(import);
+            if (!exporter) {
+                throw LinkError("Unresolved import " + importName(import));
+            }
+        }
+        if (exporter) {
+            linkImport(import, *exporter);
+        } else if (import.kind == ExternalKind::FUNCTION) {
+            linked_functions_.push_back(LinkedFunction{nullptr, 0});
+        } else if (import.kind == ExternalKind::GLOBAL) {
+            // Unlinked globals read as zero but keep the index space intact
+            TypedValue value;
+            value.type = import.global.type;
+            value.value.i64 = 0;
+            globals_.push_back(value);
         }
     }
+}
 
-    return results;
+void Interpreter::linkImport(const Import& import, Interpreter& exporter) {
+    const Export* exp = exporter.module_ ? exporter.module_->findExport(import.field_name) : nullptr;
+    if (!exp || exp->kind != import.kind) {
+        throw LinkError("No matching export for import " + importName(import));
+    }
+
+    switch (import.kind) {
+        case ExternalKind::FUNCTION: {
+            // Re-exported imports are followed to the defining instance, so
+            // a call is never forwarded twice
+            LinkedFunction target{&exporter, exp->index};
+            if (exp->index < exporter.module_->getImportedFunctionCount()) {
+                target = exporter.linked_functions_[exp->index];
+                if (!target.instance) {
+                    throw LinkError("Import " + importName(import) + " re-exports an unlinked import");
+                }
+            }
+            const FuncType* actual = target.instance->module_->getFunctionType(target.func_index);
+            if (import.type_index >= module_->types.size() ||
+                actual->params != module_->types[import.type_index].params ||
+                actual->results != module_->types[import.type_index].results) {
+                throw LinkError("Function signature mismatch for import " + importName(import));
+            }
+            // References are indices into their own instance's heap or table
+            if (hasReference(actual->params) || hasReference(actual->results)) {
+                throw LinkError("Reference types cannot cross instances: " + importName(import));
+            }
+            linked_functions_.push_back(target);
+            break;
+        }
+        case ExternalKind::MEMORY: {
+            const Limits& limits = import.memory.limits;
+            if (!exporter.memory_ || exporter.memory_->size() < limits.min ||
+                (limits.has_max && (!exporter.memory_->limits().has_max || exporter.memory_->limits().max > limits.max))) {
+                throw LinkError("Memory limits mismatch for import " + importName(import));
+            }
+            memory_ = exporter.memory_;
+            break;
+        }
+        case ExternalKind::TABLE: {
+            Interpreter* owner = exporter.table_owner_ ? exporter.table_owner_ : &exporter;
+            if (owner->table_.size() < import.table.limits.min) {
+                throw LinkError("Table limits mismatch for import " + importName(import));
+            }
+            // Table entries are function indices of the owner, so this
+            // module cannot place its own functions there
+            for (const auto& segment : module_->element_segments) {
+                if (segment.table_index == 0) {
+                    throw LinkError("Element segments cannot initialize imported table " + importName(import));
+                }
+            }
+            table_owner_ = owner;
+            break;
+        }
+        case ExternalKind::GLOBAL: {
+            if (import.global.is_mutable) {
+                throw LinkError("Mutable global imports are not supported: " + importName(import));
+            }
+            const TypedValue& value = exporter.globals_[exp->index];
+            if (exporter.isGlobalMutable(exp->index) || value.type != import.global.type) {
+                throw LinkError("Global type mismatch for import " + importName(import));
+            }
+            if (hasReference({value.type})) {
+                throw LinkError("Reference types cannot cross instances: " + importName(import));
+            }
+            globals_.push_back(value);
+            break;
+        }
+        case ExternalKind::TAG:
+            throw LinkError("Tag imports are not supported: " + importName(import));
+    }
+}
+
+bool Interpreter::isGlobalMutable(uint32_t index) const {
+    // Imported globals are immutable (mutable imports do not link)
+    uint32_t import_count = module_->getImportedGlobalCount();
+    return index >= import_count && module_->globals[index - import_count].is_mutable;
 }
 
 void Interpreter::initializeMemory() {
     if (!module_->memories.empty()) {
-        memory_ = std::make_unique<Memory>(module_->memories[0].limits);
+        memory_ = std::make_shared<Memory>(module_->memories[0].limits, memory_backend_, bounds_check_);
+        memory_->setProfile(memory_profile_.get());
     }
 }
 
@@ -154,6 +406,12 @@ void Interpreter::initializeGlobals() {
                         throw InterpreterError("Global index out of bounds in init expression");
                     }
                     value = globals_[global_index];
+                } else if (opcode == 0xD0) {
+                    // ref.null <heaptype>
+                    value = TypedValue::makeRef(0, refType(readVarInt64()));
+                } else if (opcode == 0xFB && readVarUint32() == static_cast<uint32_t>(GcOpcode::REF_I31)) {
+                    // ref.i31 of the preceding i32.const
+                    value = TypedValue::makeRef(GcHeap::makeI31(value.value.i32));
                 } else {
                     throw InterpreterError("Unsupported opcode in global init expression: 0x" +
                                          std::to_string(opcode));
@@ -171,15 +429,40 @@ void Interpreter::initializeGlobals() {
 }
 
 void Interpreter::initializeTables() {
-    // Tables are initialized on-demand during call_indirect operations
-    // Element segments populate table entries via initializeElements()
-    // This deferred initialization approach is sufficient for MVP test coverage
+    // Table 0 may be defined locally or imported; entries start out null
+    table_.clear();
+    if (table_owner_) {
+        return;     // call_indirect reads the exporter's table
+    }
+
+    const Table* table = nullptr;
+    if (const Import* import = module_->getImport(ExternalKind::TABLE, 0)) {
+        table = &import->table;
+    } else if (!module_->tables.empty()) {
+        table = &module_->tables[0];
+    }
+
+    if (table) {
+        table_.assign(table->limits.min, NULL_FUNCTION_INDEX);
+    }
 }
 
 void Interpreter::initializeElements() {
-    // Element segments define function table entries for call_indirect
-    // Current implementation handles element initialization inline during execution
-    // Tables are populated as needed, providing correct behavior for all MVP tests
+    // Element segments place function references into the table, so that
+    // call_indirect is a single indexed load
+    for (const auto& segment : module_->element_segments) {
+        if (segment.table_index != 0) {
+            continue;
+        }
+
+        uint32_t offset = evaluateOffsetExpression(segment.offset_expr);
+        if (static_cast<uint64_t>(offset) + segment.func_indices.size() > table_.size()) {
+            throw InterpreterError("Element segment out of bounds");
+        }
+
+        std::copy(segment.func_indices.begin(), segment.func_indices.end(),
+                  table_.begin() + offset);
+    }
 }
 
 void Interpreter::initializeData() {
@@ -187,80 +470,165 @@ void Interpreter::initializeData() {
         return;
     }
 
+    const MappedFile* source = module_->source.get();
     for (const auto& segment : module_->data_segments) {
         // Evaluate offset expression to determine where to place data
-        uint32_t offset = 0;
-
-        if (!segment.offset_expr.empty()) {
-            // Most common: i32.const followed by end (0x0B)
-            if (segment.offset_expr[0] == 0x41) {  // i32.const opcode
-                // Read LEB128 signed value after opcode
-                size_t pos = 1;
-                int32_t value = 0;
-                int shift = 0;
-                uint8_t byte;
-
-                while (pos < segment.offset_expr.size() - 1) {  // -1 for END byte
-                    byte = segment.offset_expr[pos++];
-                    value |= (byte & 0x7F) << shift;
-                    if ((byte & 0x80) == 0) break;  // No continuation bit
-                    shift += 7;
-                }
+        uint32_t offset = evaluateOffsetExpression(segment.offset_expr);
 
-                // Sign extend if needed (for LEB128 signed)
-                if (shift < 32 && (byte & 0x40)) {
-                    value |= -(1 << (shift + 7));
-                }
+        // Initialize memory with data at computed offset, mapping it from
+        // the module file where the decoder left it there
+        if (source && source->contains(segment.data.data(), segment.data.size())) {
+            memory_->initializeMapped(offset, module_->source, static_cast<size_t>(segment.data.data() - source->data()),
+                                      segment.data.size());
+        } else {
+            memory_->initialize(offset, segment.data.data(), segment.data.size());
+        }
+    }
+}
 
-                offset = static_cast<uint32_t>(value);
-            }
-            // Could also handle global.get (0x23) if needed, but tests typically use i32.const
+uint32_t Interpreter::evaluateOffsetExpression(ArrayView<uint8_t> expr) const {
+    // Offset expressions are constant: i32.const <value> end or global.get <index> end
+    if (expr.empty()) {
+        return 0;
+    }
+
+    // Decode the LEB128 immediate after the opcode (the final byte is END)
+    auto readImmediate = [&expr](bool is_signed) {
+        uint32_t value = 0;
+        int shift = 0;
+        uint8_t byte = 0;
+        size_t pos = 1;
+
+        while (pos < expr.size()) {
+            byte = expr[pos++];
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            shift += 7;
+            if ((byte & 0x80) == 0) break;  // No continuation bit
         }
 
-        // Initialize memory with data at computed offset
-        memory_->initialize(offset, segment.data);
+        // Sign extend if needed (for LEB128 signed)
+        if (is_signed && shift < 32 && (byte & 0x40)) {
+            value |= ~0u << shift;
+        }
+        return value;
+    };
+
+    if (expr[0] == 0x41) {  // i32.const
+        return readImmediate(true);
     }
+
+    if (expr[0] == 0x23) {  // global.get
+        uint32_t global_index = readImmediate(false);
+        if (global_index >= globals_.size() || globals_[global_index].type != ValueType::I32) {
+            throw InterpreterError("Invalid global in offset expression");
+        }
+        return static_cast<uint32_t>(globals_[global_index].value.i32);
+    }
+
+    throw InterpreterError("Unsupported opcode in offset expression: 0x" +
+                           std::to_string(expr[0]));
 }
 
 void Interpreter::execute(uint32_t func_index) {
+    if (!tracer_ && !counter_profile_) {
+        dispatch(func_index);
+        return;
+    }
+    TraceEventKind kind = func_index < module_->getImportedFunctionCount() ? TraceEventKind::HOST_CALL
+                                                                           : TraceEventKind::CALL;
+    uint32_t name = func_index < trace_names_.size() ? trace_names_[func_index] : 0;
+    TraceScope scope(tracer_.get(), kind, name, trace_depth_);
+    CounterScope counters(counter_profile_.get(), func_index);
+    dispatch(func_index);
+}
+
+void Interpreter::dispatch(uint32_t func_index) {
+    profileCall(func_index);
+    if (func_index < native_invokers_.size() && native_invokers_[func_index]) {
+        executeNative(func_index);
+        return;
+    }
+
     uint32_t import_count = module_->getImportedFunctionCount();
 
     if (func_index < import_count) {
+        const LinkedFunction& linked = linked_functions_[func_index];
+        if (linked.instance) {
+            callLinked(*linked.instance, linked.func_index);
+            return;
+        }
+
         // Check if it's a WASI import
-        if (func_index < module_->imports.size()) {
-            const auto& import = module_->imports[func_index];
-            if (import.kind == ExternalKind::FUNCTION &&
-                import.module_name == "wasi_snapshot_preview1") {
-                if (import.field_name == "fd_write") {
-                    executeWASIFdWrite();
-                    return;
-                }
+        const Import* import = module_->getImport(ExternalKind::FUNCTION, func_index);
+        if (import->module_name == "wasi_snapshot_preview1") {
+            if (import->field_name == "fd_write") {
+                executeWASIFdWrite();
+                return;
             }
         }
         throw InterpreterError("Cannot execute imported function");
     }
 
-    uint32_t local_index = func_index - import_count;
+    if (perf_trampolines_ && func_index < module_->getTotalFunctionCount()) {
+        perf_trampolines_->entry(func_index)(this, func_index);
+        if (perf_exception_) {
+            std::exception_ptr exception = perf_exception_;
+            perf_exception_ = nullptr;
+            std::rethrow_exception(exception);
+        }
+        return;
+    }
+    executeBody(func_index);
+}
+
+// The callee borrows this instance's operand stack: the arguments are
+// already where its frame pops them from, and its results are left where
+// the caller expects them, so nothing is copied
+void Interpreter::callLinked(Interpreter& callee, uint32_t func_index) {
+    struct Loan {
+        Interpreter& caller;
+        Interpreter& callee;
+        uint32_t saved_depth;   // Compiled frames of both share the native stack
+
+        Loan(Interpreter& caller, Interpreter& callee)
+            : caller(caller), callee(callee), saved_depth(callee.native_instance_.call_depth) {
+            caller.stack_.swap(callee.stack_);
+            callee.native_instance_.call_depth = caller.native_instance_.call_depth;
+        }
+        ~Loan() {
+            caller.stack_.swap(callee.stack_);
+            callee.native_instance_.call_depth = saved_depth;
+        }
+    } loan(*this, callee);
+    callee.execute(func_index);
+}
+
+void Interpreter::executeBody(uint32_t func_index) {
+    uint32_t local_index = func_index - module_->getImportedFunctionCount();
     if (local_index >= module_->functions.size()) {
         throw InterpreterError("Invalid function index");
     }
 
-    const Function& func = module_->functions[local_index];
+    const Function func = module_->functions[local_index];
     const FuncType* func_type = module_->getFunctionType(func_index);
 
     if (!func_type) {
         throw InterpreterError("Invalid function type");
     }
 
+    // Push a frame: the callee's locals and labels go on top of the
+    // caller's, and are popped again however the body is left
+    Frame frame(*this);
+    function_ = local_index;
+
     // Set up locals
     size_t param_count = func_type->params.size();
     size_t local_count = func.locals.size();
-    locals_.clear();
-    locals_.resize(param_count + local_count);
+    locals_.resize(locals_base_ + param_count + local_count);
 
     // Pop parameters from stack into locals (in reverse order)
     for (size_t i = param_count; i > 0; i--) {
-        locals_[i - 1] = stack_.pop();
+        locals_[locals_base_ + i - 1] = stack_.pop();
     }
 
     // Initialize local variables to zero
@@ -268,14 +636,13 @@ void Interpreter::execute(uint32_t func_index) {
         TypedValue val;
         val.type = func.locals[i];
         val.value.i64 = 0;
-        locals_[param_count + i] = val;
+        locals_[locals_base_ + param_count + i] = val;
     }
 
     // Set up execution state
     code_ = func.body.data();
     code_size_ = func.body.size();
     pc_ = 0;
-    labels_.clear();
 
     // Execute instructions
     while (pc_ < code_size_) {
@@ -290,28 +657,42 @@ void Interpreter::executeInstruction() {
 
     Opcode opcode = static_cast<Opcode>(code_[pc_++]);
 
-    // Dispatch based on instruction category
-    if (isControlFlowInstruction(opcode)) {
-        executeControlFlow(opcode);
-    } else if (opcode == Opcode::DROP || opcode == Opcode::SELECT) {
-        executeParametric(opcode);
-    } else if (opcode >= Opcode::LOCAL_GET && opcode <= Opcode::GLOBAL_SET) {
-        executeVariable(opcode);
-    } else if (isMemoryInstruction(opcode)) {
-        executeMemory(opcode);
-    } else if (opcode >= Opcode::I32_CONST && opcode <= Opcode::F64_CONST) {
-        executeNumericConst(opcode);
-    } else if (opcode >= Opcode::I32_WRAP_I64 && opcode <= Opcode::F64_REINTERPRET_I64) {
-        // Conversion instructions (0xA7 - 0xBF)
-        executeConversion(opcode);
-    } else if (static_cast<uint8_t>(opcode) == 0xFC) {
-        // Saturating conversion instructions (0xFC prefix)
-        executeConversion(opcode);
-    } else if (isNumericInstruction(opcode)) {
-        executeNumeric(opcode);
-    } else {
-        throw InterpreterError("Unknown or unimplemented opcode: " +
-                             std::to_string(static_cast<uint8_t>(opcode)));
+    // The opcode table names the routine, so dispatch is one load and a jump
+    switch (OPCODE_TABLE[static_cast<uint8_t>(opcode)].handler) {
+        case Handler::CONTROL:
+            executeControlFlow(opcode);
+            break;
+        case Handler::PARAMETRIC:
+            executeParametric(opcode);
+            break;
+        case Handler::VARIABLE:
+            executeVariable(opcode);
+            break;
+        case Handler::MEMORY:
+            executeMemory(opcode);
+            break;
+        case Handler::CONSTANT:
+            executeNumericConst(opcode);
+            break;
+        case Handler::NUMERIC:
+            executeNumeric(opcode);
+            break;
+        case Handler::CONVERSION:
+            // Includes the saturating conversions behind the 0xFC prefix
+            executeConversion(opcode);
+            break;
+        case Handler::REFERENCE:
+            executeReference(opcode);
+            break;
+        case Handler::GC:
+            executeGc();
+            break;
+        case Handler::CONTINUATION:
+            executeContinuation(opcode);
+            break;
+        case Handler::UNSUPPORTED:
+            throw InterpreterError("Unknown or unimplemented opcode: " +
+                                 std::to_string(static_cast<uint8_t>(opcode)));
     }
 }
 
@@ -327,13 +708,12 @@ void Interpreter::executeControlFlow(Opcode opcode) {
         case Opcode::BLOCK: {
             // Block: structured control flow
             // Format: block <blocktype> <instructions>* end
-            uint8_t block_type = readByte();  // Block type byte (0x40 for void, or value type)
-
-            // Determine arity (number of result values)
-            // 0x40 = void (arity 0), value types (0x7F-0x7C) have arity 1
-            size_t arity = (block_type == 0x40) ? 0 : 1;
+            // Parameters stay on the stack and belong to the block
+            BlockSignature signature = readBlockType();
+            checkStackUnderflow(signature.params);
+            size_t arity = signature.results;
 
-            size_t stack_height = stack_.size();
+            size_t stack_height = stack_.size() - signature.params;
 
             // Find the matching END instruction
             size_t end_pc = findMatchingEnd(pc_);
@@ -349,13 +729,13 @@ void Interpreter::executeControlFlow(Opcode opcode) {
         case Opcode::LOOP: {
             // Loop: like block but branches jump back to start
             // Format: loop <blocktype> <instructions>* end
-            uint8_t loop_type = readByte();  // Loop type byte
+            BlockSignature signature = readBlockType();
+            checkStackUnderflow(signature.params);
 
-            // Determine arity (number of result values)
-            // For loops, arity is 0 because branches to loop jump to start (no results)
-            size_t arity = 0;
+            // Branches to a loop jump to its start and carry its parameters
+            size_t arity = signature.params;
 
-            size_t stack_height = stack_.size();
+            size_t stack_height = stack_.size() - signature.params;
             size_t loop_start = pc_;
 
             // Push label - for loops, branches jump back to loop_start
@@ -373,15 +753,13 @@ void Interpreter::executeControlFlow(Opcode opcode) {
         case Opcode::IF: {
             // If: conditional execution
             // Format: if <blocktype> <instructions>* [else <instructions>*]? end
-            uint8_t result_type = readByte();  // Result type byte
-
-            // Determine arity (number of result values)
-            // 0x40 = void (arity 0), value types (0x7F-0x7C) have arity 1
-            size_t arity = (result_type == 0x40) ? 0 : 1;
+            BlockSignature signature = readBlockType();
+            size_t arity = signature.results;
 
             int32_t condition = stack_.popI32();
+            checkStackUnderflow(signature.params);
 
-            size_t stack_height = stack_.size();
+            size_t stack_height = stack_.size() - signature.params;
 
             // Find else and end positions
             size_t else_pc = 0;
@@ -408,7 +786,7 @@ void Interpreter::executeControlFlow(Opcode opcode) {
             // Else: marks start of else branch in if statement
             // When we encounter else during normal execution (after then branch),
             // we need to jump to end
-            if (labels_.empty()) {
+            if (labels_.size() == labels_base_) {
                 throw InterpreterError("ELSE without matching IF");
             }
 
@@ -421,9 +799,7 @@ void Interpreter::executeControlFlow(Opcode opcode) {
 
         case Opcode::END: {
             // End: marks end of block/loop/if
-            if (!labels_.empty()) {
-                popLabel();
-            }
+            popLabel();
             break;
         }
 
@@ -448,47 +824,34 @@ void Interpreter::executeControlFlow(Opcode opcode) {
         case Opcode::BR_TABLE: {
             // Branch table: multi-way branch (switch statement)
             // Format: br_table <label_count> <labels>* <default_label>
-            uint32_t label_count = readVarUint32();
-
-            std::vector<uint32_t> labels;
-            labels.reserve(label_count);
-            for (uint32_t i = 0; i < label_count; i++) {
-                labels.push_back(readVarUint32());
-            }
-
-            uint32_t default_label = readVarUint32();
-            int32_t index = stack_.popI32();
-
-            // Select label based on index
-            uint32_t selected_depth;
-            if (index < 0 || static_cast<uint32_t>(index) >= label_count) {
-                selected_depth = default_label;
-            } else {
-                selected_depth = labels[static_cast<size_t>(index)];
-            }
+            // The immediates are decoded once per function into a jump table;
+            // the last entry is the default target.
+            const BranchTable& table = branchTable();
+            uint32_t index = static_cast<uint32_t>(stack_.popI32());
 
-            branch(selected_depth);
+            // Negative indices wrap to large unsigned values and select the default
+            size_t default_index = table.targets.size() - 1;
+            branchTo(table.targets[index < default_index ? index : default_index]);
             break;
         }
 
         case Opcode::RETURN: {
             // Return: exit current function
             pc_ = code_size_;
-            labels_.clear();
+            labels_.resize(labels_base_);
             break;
         }
 
         case Opcode::CALL: {
             // Call: function call
-            // Saves current execution state, executes called function, then restores state
+            // Saves the current position, executes the called function, then restores it.
+            // Locals and labels are frames on their own stacks, so nothing is copied.
             uint32_t func_index = readVarUint32();
 
             // Save current execution state
             size_t return_pc = pc_;
             const uint8_t* return_code = code_;
             size_t return_code_size = code_size_;
-            std::vector<TypedValue> return_locals = locals_;
-            std::vector<Label> return_labels = labels_;
 
             // Execute the called function
             // The function will pop its arguments from stack and push results
@@ -498,8 +861,6 @@ void Interpreter::executeControlFlow(Opcode opcode) {
             pc_ = return_pc;
             code_ = return_code;
             code_size_ = return_code_size;
-            locals_ = return_locals;
-            labels_ = return_labels;
 
             // Results from called function are now on top of stack
             break;
@@ -522,45 +883,18 @@ void Interpreter::executeControlFlow(Opcode opcode) {
                 throw Trap("Undefined element in call_indirect");
             }
 
-            // Get function index from element segments
-            // Element segments map table indices to function indices
-            uint32_t func_index = 0;
-            bool found = false;
-
-            for (const auto& elem : module_->element_segments) {
-                if (elem.table_index == 0) {  // Table 0
-                    // Evaluate offset expression (usually i32.const 0)
-                    uint32_t offset = 0;
-                    if (!elem.offset_expr.empty() && elem.offset_expr[0] == 0x41) {
-                        // Simple i32.const evaluation (LEB128 decode)
-                        size_t pos = 1;
-                        int32_t value = 0;
-                        int shift = 0;
-                        while (pos < elem.offset_expr.size() - 1) {
-                            uint8_t byte = elem.offset_expr[pos++];
-                            value |= (byte & 0x7F) << shift;
-                            if ((byte & 0x80) == 0) break;
-                            shift += 7;
-                        }
-                        offset = static_cast<uint32_t>(value);
-                    }
-
-                    // Check if elem_index is in range
-                    uint32_t actual_index = static_cast<uint32_t>(elem_index) - offset;
-                    if (actual_index < elem.func_indices.size()) {
-                        func_index = elem.func_indices[actual_index];
-                        found = true;
-                        break;
-                    }
-                }
-            }
-
-            if (!found) {
+            // Get function index from the table; an imported table holds
+            // functions of the instance that exports it
+            Interpreter* owner = table_owner_ ? table_owner_ : this;
+            const std::vector<uint32_t>& table = owner->table_;
+            if (static_cast<uint32_t>(elem_index) >= table.size() ||
+                table[static_cast<uint32_t>(elem_index)] == NULL_FUNCTION_INDEX) {
                 throw Trap("Undefined element in call_indirect");
             }
+            uint32_t func_index = table[static_cast<uint32_t>(elem_index)];
 
             // Verify function type matches expected type
-            const FuncType* func_type = module_->getFunctionType(func_index);
+            const FuncType* func_type = owner->module_->getFunctionType(func_index);
             if (!func_type || type_index >= module_->types.size()) {
                 throw Trap("Type mismatch in call_indirect");
             }
@@ -589,19 +923,22 @@ void Interpreter::executeControlFlow(Opcode opcode) {
             size_t return_pc = pc_;
             const uint8_t* return_code = code_;
             size_t return_code_size = code_size_;
-            std::vector<TypedValue> return_locals = locals_;
-            std::vector<Label> return_labels = labels_;
 
             // Execute the called function
             // Arguments are already on stack, function will pop them
-            execute(func_index);
+            if (owner == this) {
+                execute(func_index);
+            } else {
+                if (hasReference(func_type->params) || hasReference(func_type->results)) {
+                    throw Trap("Reference types cannot cross instances in call_indirect");
+                }
+                callLinked(*owner, func_index);
+            }
 
             // Restore execution state after function returns
             pc_ = return_pc;
             code_ = return_code;
             code_size_ = return_code_size;
-            locals_ = return_locals;
-            labels_ = return_labels;
 
             // Results from called function are now on top of stack
             break;
@@ -678,51 +1015,82 @@ void Interpreter::executeMemory(Opcode opcode) {
     if (opcode == Opcode::MEMORY_GROW) {
         readByte();  // Reserved byte (should be 0x00 per spec)
         int32_t delta = stack_.popI32();
-        int32_t result = memory_->grow(static_cast<uint32_t>(delta));
+        int32_t result = growMemory(static_cast<uint32_t>(delta));
         stack_.pushI32(result);
         return;
     }
 
-    // All other memory instructions have memarg (align + offset)
+    // All other memory instructions have memarg (align + offset). Dispatch
+    // once per access to the handlers specialized for the bounds check
     MemArg memarg = readMemArg();
+    switch (memory_->boundsCheck()) {
+        case BoundsCheck::MASKED:
+            executeMemoryAccess<BoundsCheck::MASKED>(opcode, memarg.offset);
+            break;
+        case BoundsCheck::GUARD:
+            executeMemoryAccess<BoundsCheck::GUARD>(opcode, memarg.offset);
+            break;
+        default:
+            executeMemoryAccess<BoundsCheck::EXPLICIT>(opcode, memarg.offset);
+            break;
+    }
+}
+
+template<BoundsCheck B, typename T>
+T Interpreter::loadMemory(uint32_t offset) {
+    uint32_t base = static_cast<uint32_t>(stack_.popI32());
+    if constexpr (B == BoundsCheck::EXPLICIT) {
+        return memory_->loadAt<B, T>(effectiveAddress(base, offset), 0);
+    } else {
+        // MASKED and GUARD bound the 33-bit effective address themselves
+        return memory_->loadAt<B, T>(base, offset);
+    }
+}
 
+template<BoundsCheck B, typename T>
+void Interpreter::storeMemory(uint32_t offset, T value) {
+    uint32_t base = static_cast<uint32_t>(stack_.popI32());
+    if constexpr (B == BoundsCheck::EXPLICIT) {
+        memory_->storeAt<B, T>(effectiveAddress(base, offset), 0, value);
+    } else {
+        memory_->storeAt<B, T>(base, offset, value);
+    }
+}
+
+template<BoundsCheck B>
+void Interpreter::executeMemoryAccess(Opcode opcode, uint32_t offset) {
     switch (opcode) {
         // ===== 32-bit Load Operations =====
 
         case Opcode::I32_LOAD: {
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            stack_.pushI32(memory_->loadI32(addr));
+            stack_.pushI32(loadMemory<B, int32_t>(offset));
             break;
         }
 
         case Opcode::I32_LOAD8_S: {
             // Load signed 8-bit, extend to 32-bit with sign extension
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            int8_t value = memory_->loadI8(addr);
+            int8_t value = loadMemory<B, int8_t>(offset);
             stack_.pushI32(static_cast<int32_t>(value));
             break;
         }
 
         case Opcode::I32_LOAD8_U: {
             // Load unsigned 8-bit, extend to 32-bit with zero extension
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            uint8_t value = memory_->loadU8(addr);
+            uint8_t value = loadMemory<B, uint8_t>(offset);
             stack_.pushI32(static_cast<int32_t>(value));
             break;
         }
 
         case Opcode::I32_LOAD16_S: {
             // Load signed 16-bit, extend to 32-bit with sign extension
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            int16_t value = memory_->loadI16(addr);
+            int16_t value = loadMemory<B, int16_t>(offset);
             stack_.pushI32(static_cast<int32_t>(value));
             break;
         }
 
         case Opcode::I32_LOAD16_U: {
             // Load unsigned 16-bit, extend to 32-bit with zero extension
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            uint16_t value = memory_->loadU16(addr);
+            uint16_t value = loadMemory<B, uint16_t>(offset);
             stack_.pushI32(static_cast<int32_t>(value));
             break;
         }
@@ -730,146 +1098,799 @@ void Interpreter::executeMemory(Opcode opcode) {
         // ===== 64-bit Load Operations =====
 
         case Opcode::I64_LOAD: {
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            stack_.pushI64(memory_->loadI64(addr));
+            stack_.pushI64(loadMemory<B, int64_t>(offset));
             break;
         }
 
         case Opcode::I64_LOAD8_S: {
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            int8_t value = memory_->loadI8(addr);
+            int8_t value = loadMemory<B, int8_t>(offset);
             stack_.pushI64(static_cast<int64_t>(value));
             break;
         }
 
         case Opcode::I64_LOAD8_U: {
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            uint8_t value = memory_->loadU8(addr);
+            uint8_t value = loadMemory<B, uint8_t>(offset);
             stack_.pushI64(static_cast<int64_t>(value));
             break;
         }
 
         case Opcode::I64_LOAD16_S: {
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            int16_t value = memory_->loadI16(addr);
+            int16_t value = loadMemory<B, int16_t>(offset);
             stack_.pushI64(static_cast<int64_t>(value));
             break;
         }
 
         case Opcode::I64_LOAD16_U: {
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            uint16_t value = memory_->loadU16(addr);
+            uint16_t value = loadMemory<B, uint16_t>(offset);
             stack_.pushI64(static_cast<int64_t>(value));
             break;
         }
 
         case Opcode::I64_LOAD32_S: {
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            int32_t value = memory_->loadI32(addr);
+            int32_t value = loadMemory<B, int32_t>(offset);
             stack_.pushI64(static_cast<int64_t>(value));
             break;
         }
 
         case Opcode::I64_LOAD32_U: {
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            uint32_t value = memory_->loadU32(addr);
+            uint32_t value = loadMemory<B, uint32_t>(offset);
             stack_.pushI64(static_cast<int64_t>(value));
             break;
         }
 
-        // ===== Float Load Operations =====
+        // ===== Float Load Operations =====
+
+        case Opcode::F32_LOAD: {
+            stack_.pushF32(loadMemory<B, float>(offset));
+            break;
+        }
+
+        case Opcode::F64_LOAD: {
+            stack_.pushF64(loadMemory<B, double>(offset));
+            break;
+        }
+
+        // ===== 32-bit Store Operations =====
+
+        case Opcode::I32_STORE: {
+            int32_t value = stack_.popI32();
+            storeMemory<B, int32_t>(offset, value);
+            break;
+        }
+
+        case Opcode::I32_STORE8: {
+            // Store low 8 bits
+            int32_t value = stack_.popI32();
+            storeMemory<B, uint8_t>(offset, static_cast<uint8_t>(value & 0xFF));
+            break;
+        }
+
+        case Opcode::I32_STORE16: {
+            // Store low 16 bits
+            int32_t value = stack_.popI32();
+            storeMemory<B, uint16_t>(offset, static_cast<uint16_t>(value & 0xFFFF));
+            break;
+        }
+
+        // ===== 64-bit Store Operations =====
+
+        case Opcode::I64_STORE: {
+            int64_t value = stack_.popI64();
+            storeMemory<B, int64_t>(offset, value);
+            break;
+        }
+
+        case Opcode::I64_STORE8: {
+            int64_t value = stack_.popI64();
+            storeMemory<B, uint8_t>(offset, static_cast<uint8_t>(value & 0xFF));
+            break;
+        }
+
+        case Opcode::I64_STORE16: {
+            int64_t value = stack_.popI64();
+            storeMemory<B, uint16_t>(offset, static_cast<uint16_t>(value & 0xFFFF));
+            break;
+        }
+
+        case Opcode::I64_STORE32: {
+            int64_t value = stack_.popI64();
+            storeMemory<B, uint32_t>(offset, static_cast<uint32_t>(value & 0xFFFFFFFF));
+            break;
+        }
+
+        // ===== Float Store Operations =====
+
+        case Opcode::F32_STORE: {
+            float value = stack_.popF32();
+            storeMemory<B, float>(offset, value);
+            break;
+        }
+
+        case Opcode::F64_STORE: {
+            double value = stack_.popF64();
+            storeMemory<B, double>(offset, value);
+            break;
+        }
+
+        // ===== Memory Control =====
+        // NOTE: MEMORY_SIZE and MEMORY_GROW are handled before the switch
+        // because they don't have memarg
+
+        default:
+            throw InterpreterError("Memory instruction not implemented: " +
+                                 opcodeToString(opcode));
+    }
+}
+
+// ===== Reference and GC Instructions =====
+
+void Interpreter::executeReference(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::REF_NULL:
+            // Every null is 0, tagged with the kind of reference it stands for
+            stack_.push(TypedValue::makeRef(0, refType(readVarInt64())));
+            break;
+
+        case Opcode::REF_FUNC: {
+            uint32_t func_index = readVarUint32();
+            if (func_index >= module_->getTotalFunctionCount()) {
+                throw InterpreterError("Invalid function index in ref.func");
+            }
+            stack_.push(TypedValue::makeRef(static_cast<uint64_t>(func_index) + 1, ValueType::FUNCREF));
+            break;
+        }
+
+        case Opcode::REF_IS_NULL:
+            stack_.pushI32(stack_.pop().value.ref == 0 ? 1 : 0);
+            break;
+
+        case Opcode::REF_EQ: {
+            uint64_t b = stack_.popRef();
+            uint64_t a = stack_.popRef();
+            stack_.pushI32(a == b ? 1 : 0);
+            break;
+        }
+
+        case Opcode::REF_AS_NON_NULL:
+            stack_.pushRef(popObject());
+            break;
+
+        case Opcode::BR_ON_NULL: {
+            uint32_t depth = readVarUint32();
+            uint64_t ref = stack_.popRef();
+            if (ref == 0) {
+                branch(depth);
+            } else {
+                stack_.pushRef(ref);
+            }
+            break;
+        }
+
+        case Opcode::BR_ON_NON_NULL: {
+            uint32_t depth = readVarUint32();
+            uint64_t ref = stack_.popRef();
+            if (ref != 0) {
+                stack_.pushRef(ref);
+                branch(depth);
+            }
+            break;
+        }
+
+        default:
+            throw InterpreterError("Reference instruction not implemented: " + opcodeToString(opcode));
+    }
+}
+
+void Interpreter::executeGc() {
+    GcOpcode opcode = static_cast<GcOpcode>(readVarUint32());
+    switch (opcode) {
+        // ===== Structs =====
+
+        case GcOpcode::STRUCT_NEW: {
+            uint32_t type_index = readVarUint32();
+            GcHeap& heap = gcHeapFor(type_index, CompositeType::Kind::STRUCT);
+            // Allocate while the field values are still on the stack, where
+            // a collection finds and updates them
+            uint64_t object = heap.allocateStruct(type_index);
+            for (size_t i = heap.type(type_index).fields.size(); i > 0; i--) {
+                heap.setField(object, static_cast<uint32_t>(i - 1), stack_.pop().value);
+            }
+            stack_.pushRef(object);
+            break;
+        }
+
+        case GcOpcode::STRUCT_NEW_DEFAULT: {
+            uint32_t type_index = readVarUint32();
+            stack_.pushRef(gcHeapFor(type_index, CompositeType::Kind::STRUCT).allocateStruct(type_index));
+            break;
+        }
+
+        case GcOpcode::STRUCT_GET:
+        case GcOpcode::STRUCT_GET_S:
+        case GcOpcode::STRUCT_GET_U: {
+            uint32_t type_index = readVarUint32();
+            uint32_t field = readVarUint32();
+            GcHeap& heap = gcHeapFor(type_index, CompositeType::Kind::STRUCT);
+            if (field >= heap.type(type_index).fields.size()) {
+                throw InterpreterError("Invalid field index");
+            }
+            uint64_t object = popObject();
+            pushField(heap.type(type_index).fields[field], heap.getField(object, field),
+                      opcode == GcOpcode::STRUCT_GET_S);
+            break;
+        }
+
+        case GcOpcode::STRUCT_SET: {
+            uint32_t type_index = readVarUint32();
+            uint32_t field = readVarUint32();
+            GcHeap& heap = gcHeapFor(type_index, CompositeType::Kind::STRUCT);
+            if (field >= heap.type(type_index).fields.size()) {
+                throw InterpreterError("Invalid field index");
+            }
+            Value value = stack_.pop().value;
+            heap.setField(popObject(), field, value);
+            break;
+        }
+
+        // ===== Arrays =====
+
+        case GcOpcode::ARRAY_NEW: {
+            uint32_t type_index = readVarUint32();
+            GcHeap& heap = gcHeapFor(type_index, CompositeType::Kind::ARRAY);
+            // The initial value stays on the stack across the allocation
+            uint32_t length = static_cast<uint32_t>(stack_.peekI32());
+            uint64_t array = heap.allocateArray(type_index, length);
+            stack_.popI32();
+            Value value = stack_.pop().value;
+            for (uint32_t i = 0; i < length; i++) {
+                heap.setElement(array, i, value);
+            }
+            stack_.pushRef(array);
+            break;
+        }
+
+        case GcOpcode::ARRAY_NEW_DEFAULT: {
+            uint32_t type_index = readVarUint32();
+            GcHeap& heap = gcHeapFor(type_index, CompositeType::Kind::ARRAY);
+            stack_.pushRef(heap.allocateArray(type_index, static_cast<uint32_t>(stack_.popI32())));
+            break;
+        }
+
+        case GcOpcode::ARRAY_NEW_FIXED: {
+            uint32_t type_index = readVarUint32();
+            uint32_t length = readVarUint32();
+            GcHeap& heap = gcHeapFor(type_index, CompositeType::Kind::ARRAY);
+            uint64_t array = heap.allocateArray(type_index, length);
+            for (uint32_t i = length; i > 0; i--) {
+                heap.setElement(array, i - 1, stack_.pop().value);
+            }
+            stack_.pushRef(array);
+            break;
+        }
+
+        case GcOpcode::ARRAY_GET:
+        case GcOpcode::ARRAY_GET_S:
+        case GcOpcode::ARRAY_GET_U: {
+            uint32_t type_index = readVarUint32();
+            GcHeap& heap = gcHeapFor(type_index, CompositeType::Kind::ARRAY);
+            uint32_t index = static_cast<uint32_t>(stack_.popI32());
+            uint64_t array = popObject();
+            if (index >= heap.arrayLength(array)) {
+                throw Trap("Array index out of bounds");
+            }
+            pushField(heap.type(type_index).fields[0], heap.getElement(array, index),
+                      opcode == GcOpcode::ARRAY_GET_S);
+            break;
+        }
+
+        case GcOpcode::ARRAY_SET: {
+            uint32_t type_index = readVarUint32();
+            GcHeap& heap = gcHeapFor(type_index, CompositeType::Kind::ARRAY);
+            Value value = stack_.pop().value;
+            uint32_t index = static_cast<uint32_t>(stack_.popI32());
+            uint64_t array = popObject();
+            if (index >= heap.arrayLength(array)) {
+                throw Trap("Array index out of bounds");
+            }
+            heap.setElement(array, index, value);
+            break;
+        }
+
+        case GcOpcode::ARRAY_LEN:
+            if (!gc_heap_) {
+                throw InterpreterError("Module declares no struct or array types");
+            }
+            stack_.pushI32(static_cast<int32_t>(gc_heap_->arrayLength(popObject())));
+            break;
+
+        case GcOpcode::ARRAY_FILL: {
+            uint32_t type_index = readVarUint32();
+            GcHeap& heap = gcHeapFor(type_index, CompositeType::Kind::ARRAY);
+            uint32_t count = static_cast<uint32_t>(stack_.popI32());
+            Value value = stack_.pop().value;
+            uint32_t offset = static_cast<uint32_t>(stack_.popI32());
+            uint64_t array = popObject();
+            if (static_cast<uint64_t>(offset) + count > heap.arrayLength(array)) {
+                throw Trap("Array index out of bounds");
+            }
+            for (uint32_t i = 0; i < count; i++) {
+                heap.setElement(array, offset + i, value);
+            }
+            break;
+        }
+
+        case GcOpcode::ARRAY_COPY: {
+            uint32_t dst_type = readVarUint32();
+            uint32_t src_type = readVarUint32();
+            GcHeap& heap = gcHeapFor(dst_type, CompositeType::Kind::ARRAY);
+            gcHeapFor(src_type, CompositeType::Kind::ARRAY);
+            uint32_t count = static_cast<uint32_t>(stack_.popI32());
+            uint32_t src_offset = static_cast<uint32_t>(stack_.popI32());
+            uint64_t src = popObject();
+            uint32_t dst_offset = static_cast<uint32_t>(stack_.popI32());
+            uint64_t dst = popObject();
+            if (static_cast<uint64_t>(src_offset) + count > heap.arrayLength(src) ||
+                static_cast<uint64_t>(dst_offset) + count > heap.arrayLength(dst)) {
+                throw Trap("Array index out of bounds");
+            }
+            // Copy backwards when the ranges overlap with the source first
+            bool backwards = src == dst && src_offset < dst_offset;
+            for (uint32_t i = 0; i < count; i++) {
+                uint32_t k = backwards ? count - 1 - i : i;
+                Value element;
+                element.i64 = static_cast<int64_t>(heap.getElement(src, src_offset + k));
+                heap.setElement(dst, dst_offset + k, element);
+            }
+            break;
+        }
+
+        // ===== Casts =====
+
+        case GcOpcode::REF_TEST:
+        case GcOpcode::REF_TEST_NULL:
+        case GcOpcode::REF_CAST:
+        case GcOpcode::REF_CAST_NULL: {
+            int64_t heap_type = readVarInt64();
+            bool nullable = opcode == GcOpcode::REF_TEST_NULL || opcode == GcOpcode::REF_CAST_NULL;
+            uint64_t ref = stack_.popRef();
+            bool matches = ref == 0 ? nullable : refMatches(ref, heap_type);
+            if (opcode == GcOpcode::REF_TEST || opcode == GcOpcode::REF_TEST_NULL) {
+                stack_.pushI32(matches ? 1 : 0);
+            } else if (!matches) {
+                throw Trap("Cast failure");
+            } else {
+                stack_.pushRef(ref);
+            }
+            break;
+        }
+
+        // ===== i31 =====
+
+        case GcOpcode::REF_I31:
+            stack_.pushRef(GcHeap::makeI31(stack_.popI32()));
+            break;
+
+        case GcOpcode::I31_GET_S:
+        case GcOpcode::I31_GET_U: {
+            uint64_t ref = stack_.popRef();
+            if (ref == 0) {
+                throw Trap("Null reference");
+            }
+            stack_.pushI32(opcode == GcOpcode::I31_GET_S ? GcHeap::i31Signed(ref)
+                                                         : static_cast<int32_t>(GcHeap::i31Unsigned(ref)));
+            break;
+        }
+
+        default:
+            throw InterpreterError("GC instruction not implemented: 0xFB " +
+                                   std::to_string(static_cast<uint32_t>(opcode)) + " " +
+                                   opcodeToString(0xFB, static_cast<uint32_t>(opcode)));
+    }
+}
+
+void Interpreter::visitGcRoots(const GcHeap::RootVisitor& visit) {
+    // The operand stack, locals and globals are typed, so every slot
+    // tagged ANYREF is a root
+    auto visitValue = [&visit](TypedValue& value) {
+        if (value.type == ValueType::ANYREF) {
+            visit(value.value.ref);
+        }
+    };
+    stack_.forEach(visitValue);
+    for (TypedValue& local : locals_) {
+        visitValue(local);
+    }
+    for (TypedValue& global : globals_) {
+        visitValue(global);
+    }
+
+    // So are the frames of every context that is not running
+    auto visitState = [&visitValue](ExecutionState& state) {
+        state.stack.forEach(visitValue);
+        for (TypedValue& local : state.locals) {
+            visitValue(local);
+        }
+    };
+    visitState(root_context_.saved);
+    for (const std::unique_ptr<Context>& continuation : continuations_) {
+        visitState(continuation->saved);
+    }
+}
+
+GcHeap& Interpreter::gcHeapFor(uint32_t type_index, CompositeType::Kind kind) {
+    if (!gc_heap_ || type_index >= module_->composite_types.size() ||
+        module_->composite_types[type_index].kind != kind) {
+        throw InterpreterError(std::string("Type ") + std::to_string(type_index) + " is not a " +
+                               (kind == CompositeType::Kind::STRUCT ? "struct" : "array") + " type");
+    }
+    return *gc_heap_;
+}
+
+uint64_t Interpreter::popObject() {
+    uint64_t ref = stack_.popRef();
+    if (ref == 0) {
+        throw Trap("Null reference");
+    }
+    return ref;
+}
+
+bool Interpreter::refMatches(uint64_t ref, int64_t heap_type) const {
+    if (heap_type >= 0) {
+        // Concrete type: the object's type or one of its supertypes
+        if (!GcHeap::isObject(ref)) {
+            return false;
+        }
+        uint32_t type_index = gc_heap_->typeIndex(ref);
+        while (type_index != CompositeType::NO_SUPERTYPE) {
+            if (type_index == heap_type) {
+                return true;
+            }
+            type_index = module_->composite_types[type_index].supertype;
+        }
+        return false;
+    }
+    switch (heap_type) {
+        case -0x12:     // any
+        case -0x13:     // eq
+            return true;
+        case -0x14:     // i31
+            return GcHeap::isI31(ref);
+        case -0x15:     // struct
+            return GcHeap::isObject(ref) &&
+                   gc_heap_->type(gc_heap_->typeIndex(ref)).kind == CompositeType::Kind::STRUCT;
+        case -0x16:     // array
+            return GcHeap::isObject(ref) &&
+                   gc_heap_->type(gc_heap_->typeIndex(ref)).kind == CompositeType::Kind::ARRAY;
+        default:        // none, and func/extern hierarchies
+            return false;
+    }
+}
+
+void Interpreter::pushField(const FieldType& field, uint64_t bits, bool sign_extend) {
+    if (field.packed_size == 1) {
+        stack_.pushI32(sign_extend ? static_cast<int8_t>(bits) : static_cast<int32_t>(bits & 0xFF));
+    } else if (field.packed_size == 2) {
+        stack_.pushI32(sign_extend ? static_cast<int16_t>(bits) : static_cast<int32_t>(bits & 0xFFFF));
+    } else {
+        Value value;
+        value.i64 = static_cast<int64_t>(bits);
+        stack_.push(TypedValue(field.type, value));
+    }
+}
+
+// Value tag of a reference to a heap type: function references and
+// continuations are not GC objects
+ValueType Interpreter::refType(int64_t heap_type) const {
+    if (heap_type >= 0) {
+        if (static_cast<uint64_t>(heap_type) < module_->composite_types.size()) {
+            CompositeType::Kind kind = module_->composite_types[static_cast<size_t>(heap_type)].kind;
+            if (kind == CompositeType::Kind::FUNC) {
+                return ValueType::FUNCREF;
+            }
+            if (kind == CompositeType::Kind::CONT) {
+                return ValueType::CONTREF;
+            }
+        }
+        return ValueType::ANYREF;
+    }
+    switch (heap_type) {
+        case -0x10:     // func
+        case -0x0D:     // nofunc
+            return ValueType::FUNCREF;
+        case -0x18:     // cont
+        case -0x0B:     // nocont
+            return ValueType::CONTREF;
+        default:
+            return ValueType::ANYREF;
+    }
+}
+
+// ===== Stack Switching =====
+
+// Immediates that were read once already, e.g. handler clauses found when
+// a resume executed, are decoded again without bounds checks
+static uint32_t decodeVarUint32(const uint8_t*& bytes) {
+    uint32_t result = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        byte = *bytes++;
+        if (shift < 32) {
+            result |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        }
+        shift += 7;
+    } while (byte & 0x80);
+    return result;
+}
+
+void Interpreter::executeContinuation(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::CONT_NEW: {
+            // cont.new $ct: a suspended continuation that will call the function
+            const FuncType& type = contFuncType(readVarUint32());
+            TypedValue ref = stack_.pop();
+            if (ref.value.ref == 0) {
+                throw Trap("Null function reference");
+            }
+            if (ref.type != ValueType::FUNCREF || ref.value.ref > module_->getTotalFunctionCount()) {
+                throw InterpreterError("cont.new expects a function reference");
+            }
+            uint32_t func_index = static_cast<uint32_t>(ref.value.ref - 1);
+            const FuncType* func_type = module_->getFunctionType(func_index);
+            if (!func_type || func_type->params != type.params || func_type->results != type.results) {
+                throw Trap("Function type does not match the continuation type");
+            }
+            stack_.push(TypedValue::makeRef(continuationRef(newContinuation(func_index)), ValueType::CONTREF));
+            break;
+        }
+
+        case Opcode::CONT_BIND: {
+            // cont.bind $ct1 $ct2: pass the leading parameters now and
+            // return a continuation that takes the rest
+            const FuncType& from = contFuncType(readVarUint32());
+            const FuncType& to = contFuncType(readVarUint32());
+            if (to.params.size() > from.params.size()) {
+                throw InterpreterError("cont.bind cannot add parameters");
+            }
+            Context& continuation = takeContinuation(stack_.pop());
+            size_t count = from.params.size() - to.params.size();
+            checkStackUnderflow(count);
+            stack_.transfer(continuation.saved.stack, count);
+            continuation.suspended = true;
+            stack_.push(TypedValue::makeRef(continuationRef(continuation), ValueType::CONTREF));
+            break;
+        }
+
+        case Opcode::RESUME: {
+            // resume $ct (on $tag $label)*: run the continuation until it
+            // returns, or suspends to one of these handlers
+            const FuncType& type = contFuncType(readVarUint32());
+            uint32_t handler_count = readVarUint32();
+            const uint8_t* handlers = code_ + pc_;
+            for (uint32_t i = 0; i < handler_count; i++) {
+                uint8_t kind = readByte();
+                tagType(readVarUint32());
+                if (kind == 0x00) {
+                    readVarUint32();        // Label
+                } else if (kind != 0x01) {  // (on $tag switch) only matters to switch
+                    throw InterpreterError("Invalid resume handler");
+                }
+            }
 
-        case Opcode::F32_LOAD: {
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            stack_.pushF32(memory_->loadF32(addr));
+            Context& continuation = takeContinuation(stack_.pop());
+            checkStackUnderflow(type.params.size());
+            stack_.transfer(continuation.saved.stack, type.params.size());
+
+            // A continuation that suspended from inside nested resumes brings
+            // them along; the outermost of them now answers to this resume
+            Context& top = *continuation.chain_top;
+            top.parent = current_;
+            top.handlers = handlers;
+            top.handler_count = handler_count;
+            switchContext(continuation);
+
+            if (transfer_.kind == Transfer::Kind::RETURNED) {
+                top.saved.stack.transfer(stack_, type.results.size());
+                releaseContinuation(top);
+            } else if (transfer_.kind == Transfer::Kind::TRAPPED) {
+                std::exception_ptr error = transfer_.error;
+                transfer_.error = nullptr;
+                releaseContinuation(top);
+                std::rethrow_exception(error);
+            } else {
+                // Suspended: hand the tag's parameters and the rest of the
+                // computation to the handler block
+                Context& suspended = *transfer_.from;
+                uint32_t label = 0;
+                findHandler(top, transfer_.tag, label);
+                suspended.saved.stack.transfer(stack_, tagType(transfer_.tag).params.size());
+                stack_.push(TypedValue::makeRef(continuationRef(suspended), ValueType::CONTREF));
+                branch(label);
+            }
             break;
         }
 
-        case Opcode::F64_LOAD: {
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            stack_.pushF64(memory_->loadF64(addr));
-            break;
-        }
+        case Opcode::SUSPEND: {
+            // suspend $tag: return to the innermost resume handling the tag;
+            // when resumed, the tag's results are on the stack
+            uint32_t tag = readVarUint32();
+            checkStackUnderflow(tagType(tag).params.size());
 
-        // ===== 32-bit Store Operations =====
+            Context* top = current_;
+            uint32_t label = 0;
+            while (top != &root_context_ && !findHandler(*top, tag, label)) {
+                top = top->parent;
+            }
+            if (top == &root_context_) {
+                throw Trap("Unhandled tag " + std::to_string(tag));
+            }
 
-        case Opcode::I32_STORE: {
-            int32_t value = stack_.popI32();
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            memory_->storeI32(addr, value);
+            Context& self = *current_;
+            Context& handler = *top->parent;
+            top->parent = nullptr;
+            self.chain_top = top;
+            self.suspended = true;
+            transfer_.kind = Transfer::Kind::SUSPENDED;
+            transfer_.from = &self;
+            transfer_.tag = tag;
+            switchContext(handler);
             break;
         }
 
-        case Opcode::I32_STORE8: {
-            // Store low 8 bits
-            int32_t value = stack_.popI32();
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            memory_->storeU8(addr, static_cast<uint8_t>(value & 0xFF));
-            break;
-        }
+        default:
+            // resume_throw needs exception handling; switch is not implemented
+            throw InterpreterError("Stack switching instruction not implemented: " + opcodeToString(opcode));
+    }
+}
 
-        case Opcode::I32_STORE16: {
-            // Store low 16 bits
-            int32_t value = stack_.popI32();
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            memory_->storeU16(addr, static_cast<uint16_t>(value & 0xFFFF));
-            break;
-        }
+void Interpreter::swapState(ExecutionState& state) {
+    stack_.swap(state.stack);
+    locals_.swap(state.locals);
+    std::swap(locals_base_, state.locals_base);
+    labels_.swap(state.labels);
+    std::swap(labels_base_, state.labels_base);
+    std::swap(code_, state.code);
+    std::swap(code_size_, state.code_size);
+    std::swap(pc_, state.pc);
+    std::swap(function_, state.function);
+}
 
-        // ===== 64-bit Store Operations =====
+void Interpreter::switchContext(Context& next) {
+    // The running frames move into the current context and next's move
+    // out of it. The running context's own saved state is always empty,
+    // so it is what the two swaps leave in next.
+    Context& previous = *current_;
+    swapState(previous.saved);
+    swapState(next.saved);
+    current_ = &next;
+    previous.fiber.switchTo(next.fiber);
+}
 
-        case Opcode::I64_STORE: {
-            int64_t value = stack_.popI64();
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            memory_->storeI64(addr, value);
-            break;
-        }
+void Interpreter::runContinuation(void* arg) {
+    Context& continuation = *static_cast<Context*>(arg);
+    Interpreter& self = *continuation.owner;
+    try {
+        self.execute(continuation.func_index);
+        self.transfer_.kind = Transfer::Kind::RETURNED;
+    } catch (...) {
+        self.transfer_.kind = Transfer::Kind::TRAPPED;
+        self.transfer_.error = std::current_exception();
+    }
+    self.transfer_.from = &continuation;
+    Context& parent = *continuation.parent;
+    continuation.parent = nullptr;
+    self.switchContext(parent);
+    // Not switched back to: the next cont.new on this stack starts afresh
+}
 
-        case Opcode::I64_STORE8: {
-            int64_t value = stack_.popI64();
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            memory_->storeU8(addr, static_cast<uint8_t>(value & 0xFF));
-            break;
-        }
+Interpreter::Context& Interpreter::newContinuation(uint32_t func_index) {
+    if (!Fiber::supported()) {
+        throw InterpreterError("Stack switching is not supported on this platform");
+    }
 
-        case Opcode::I64_STORE16: {
-            int64_t value = stack_.popI64();
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            memory_->storeU16(addr, static_cast<uint16_t>(value & 0xFFFF));
-            break;
-        }
+    Context* continuation;
+    if (!free_continuations_.empty()) {
+        continuation = continuations_[free_continuations_.back()].get();
+        free_continuations_.pop_back();
+    } else {
+        try {
+            continuations_.push_back(std::make_unique<Context>(continuation_stack_bytes_));
+        } catch (const std::bad_alloc&) {
+            throw Trap("Out of memory for continuation stacks");
+        }
+        continuation = continuations_.back().get();
+        continuation->owner = this;
+        continuation->slot = static_cast<uint32_t>(continuations_.size() - 1);
+    }
+    continuation->func_index = func_index;
+    continuation->chain_top = continuation;
+    continuation->suspended = true;
+    continuation->fiber.start(runContinuation, continuation);
+    return *continuation;
+}
 
-        case Opcode::I64_STORE32: {
-            int64_t value = stack_.popI64();
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            memory_->storeU32(addr, static_cast<uint32_t>(value & 0xFFFFFFFF));
-            break;
-        }
+// A reference is the slot plus one in its low half and the generation in
+// its high half, so references already used to resume are recognized
+Interpreter::Context& Interpreter::takeContinuation(const TypedValue& ref) {
+    if (ref.value.ref == 0) {
+        throw Trap("Null continuation reference");
+    }
+    if (ref.type != ValueType::CONTREF) {
+        throw InterpreterError("Expected a continuation reference");
+    }
+    uint64_t slot = (ref.value.ref & 0xFFFFFFFFu) - 1;
+    uint32_t generation = static_cast<uint32_t>(ref.value.ref >> 32);
+    if (slot >= continuations_.size() || continuations_[slot]->generation != generation ||
+        !continuations_[slot]->suspended) {
+        throw Trap("Continuation already resumed");
+    }
+    Context& continuation = *continuations_[slot];
+    continuation.generation++;
+    continuation.suspended = false;
+    return continuation;
+}
 
-        // ===== Float Store Operations =====
+uint64_t Interpreter::continuationRef(const Context& continuation) const {
+    return static_cast<uint64_t>(continuation.generation) << 32 | (static_cast<uint64_t>(continuation.slot) + 1);
+}
 
-        case Opcode::F32_STORE: {
-            float value = stack_.popF32();
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            memory_->storeF32(addr, value);
-            break;
-        }
+// The fiber keeps its stack for the next cont.new; frames it still held
+// are abandoned without unwinding
+void Interpreter::releaseContinuation(Context& continuation) {
+    continuation.generation++;
+    continuation.suspended = false;
+    continuation.parent = nullptr;
+    continuation.handlers = nullptr;
+    continuation.handler_count = 0;
+    continuation.chain_top = nullptr;
+    ExecutionState& saved = continuation.saved;
+    saved.stack.clear();
+    saved.locals.clear();
+    saved.locals_base = 0;
+    saved.labels.clear();
+    saved.labels_base = 0;
+    saved.code = nullptr;
+    saved.code_size = 0;
+    saved.pc = 0;
+    free_continuations_.push_back(continuation.slot);
+}
 
-        case Opcode::F64_STORE: {
-            double value = stack_.popF64();
-            uint32_t addr = effectiveAddress(stack_.popI32(), memarg.offset);
-            memory_->storeF64(addr, value);
-            break;
+void Interpreter::releaseContinuations() {
+    free_continuations_.clear();
+    for (const std::unique_ptr<Context>& continuation : continuations_) {
+        releaseContinuation(*continuation);
+    }
+}
+
+bool Interpreter::findHandler(const Context& context, uint32_t tag, uint32_t& label) const {
+    const uint8_t* bytes = context.handlers;
+    for (uint32_t i = 0; i < context.handler_count; i++) {
+        uint8_t kind = *bytes++;
+        uint32_t handler_tag = decodeVarUint32(bytes);
+        if (kind == 0x00) {
+            uint32_t handler_label = decodeVarUint32(bytes);
+            if (handler_tag == tag) {
+                label = handler_label;
+                return true;
+            }
         }
+    }
+    return false;
+}
 
-        // ===== Memory Control =====
-        // NOTE: MEMORY_SIZE and MEMORY_GROW are handled before the switch
-        // because they don't have memarg
+const FuncType& Interpreter::contFuncType(uint32_t type_index) const {
+    if (type_index >= module_->composite_types.size() ||
+        module_->composite_types[type_index].kind != CompositeType::Kind::CONT) {
+        throw InterpreterError("Invalid continuation type index: " + std::to_string(type_index));
+    }
+    return module_->types[module_->composite_types[type_index].func_type];
+}
 
-        default:
-            throw InterpreterError("Memory instruction not implemented: " +
-                                 opcodeToString(opcode));
+const FuncType& Interpreter::tagType(uint32_t tag) const {
+    if (tag >= module_->tags.size()) {
+        throw InterpreterError("Invalid tag index: " + std::to_string(tag));
     }
+    return module_->types[module_->tags[tag]];
 }
 
 void Interpreter::executeNumericConst(Opcode opcode) {
@@ -2030,6 +3051,9 @@ void Interpreter::executeConversion(Opcode opcode) {
                 }
 
                 default:
+                    if (prefixedOpcodeInfo(0xFC, sub_opcode)) {
+                        throw InterpreterError("Instruction not implemented: " + opcodeToString(0xFC, sub_opcode));
+                    }
                     throw InterpreterError("Unknown 0xFC sub-opcode: " +
                                          std::to_string(sub_opcode));
             }
@@ -2045,17 +3069,17 @@ void Interpreter::executeConversion(Opcode opcode) {
 // Variable access
 
 void Interpreter::setLocal(uint32_t index, const TypedValue& value) {
-    if (index >= locals_.size()) {
+    if (index >= locals_.size() - locals_base_) {
         throw InterpreterError("Local index out of bounds");
     }
-    locals_[index] = value;
+    locals_[locals_base_ + index] = value;
 }
 
 TypedValue Interpreter::getLocal(uint32_t index) const {
-    if (index >= locals_.size()) {
+    if (index >= locals_.size() - locals_base_) {
         throw InterpreterError("Local index out of bounds");
     }
-    return locals_[index];
+    return locals_[locals_base_ + index];
 }
 
 void Interpreter::setGlobal(uint32_t index, const TypedValue& value) {
@@ -2063,7 +3087,7 @@ void Interpreter::setGlobal(uint32_t index, const TypedValue& value) {
         throw InterpreterError("Global index out of bounds");
     }
 
-    if (!module_->globals[index].is_mutable) {
+    if (!isGlobalMutable(index)) {
         throw InterpreterError("Attempting to modify immutable global");
     }
 
@@ -2084,7 +3108,8 @@ void Interpreter::pushLabel(size_t target_pc, size_t stack_height, bool is_loop,
 }
 
 void Interpreter::popLabel() {
-    if (!labels_.empty()) {
+    // The function body's END finds no label of this frame
+    if (labels_.size() > labels_base_) {
         labels_.pop_back();
     }
 }
@@ -2093,7 +3118,7 @@ void Interpreter::branch(uint32_t depth) {
     // Branch to label at specified depth
     // depth=0 means innermost label, depth=1 means one level out, etc.
 
-    if (depth >= labels_.size()) {
+    if (depth >= labels_.size() - labels_base_) {
         throw InterpreterError("Branch depth out of range");
     }
 
@@ -2108,20 +3133,159 @@ void Interpreter::branch(uint32_t depth) {
     // Unwind the stack to the label's height + arity
     // In WebAssembly, branches preserve result values but unwind locals
     // The top 'arity' values on the stack are the results to preserve
-    size_t target_height = target_label.stack_height + target_label.arity;
-    while (stack_.size() > target_height) {
-        stack_.pop();
-    }
+    stack_.unwind(target_label.stack_height, target_label.arity);
 
     // Pop all labels up to and including the target
     // Note: For loops we keep the loop label, for blocks we remove them
     if (!target_label.is_loop) {
         // For blocks/if: remove all labels including target
-        labels_.erase(labels_.begin() + label_index, labels_.end());
+        labels_.resize(label_index);
     } else {
         // For loops: remove labels after target but keep the loop label
-        labels_.erase(labels_.begin() + label_index + 1, labels_.end());
+        labels_.resize(label_index + 1);
+    }
+}
+
+// Take a pre-resolved branch (see resolveBranchTables)
+void Interpreter::branchTo(const BranchTarget& target) {
+    if (!target.is_valid) {
+        throw InterpreterError("Branch depth out of range");
+    }
+
+    if (target.is_return) {
+        // Branching to the function body label behaves like return
+        pc_ = code_size_;
+        labels_.resize(labels_base_);
+        return;
+    }
+
+    const Label& target_label = labels_[labels_.size() - 1 - target.depth];
+    stack_.unwind(target_label.stack_height, target.arity);
+    labels_.resize(labels_.size() - target.labels_to_pop);
+    pc_ = target.target_pc;
+}
+
+const Interpreter::BranchTable& Interpreter::branchTable() {
+    if (function_ >= function_branches_.size()) {
+        throw InterpreterError("br_table outside a function body");
+    }
+    std::unique_ptr<FunctionBranches>& branches = function_branches_[function_];
+    if (!branches) {
+        // First br_table executed in this function: resolve all of them
+        branches = resolveBranchTables();
+    }
+
+    // pc_ points at the br_table immediates; the site's ordinal is the
+    // number of sites before it
+    size_t word = pc_ / 64;
+    uint64_t bit = uint64_t(1) << (pc_ % 64);
+    if (word >= branches->site_bits.size() || !(branches->site_bits[word] & bit)) {
+        throw InterpreterError("Malformed br_table");
+    }
+    size_t ordinal = branches->site_ranks[word] +
+                     static_cast<size_t>(__builtin_popcountll(branches->site_bits[word] & (bit - 1)));
+    return branches->tables[ordinal];
+}
+
+// Scan the current function once and build jump tables for every br_table.
+// Block structure is static, so each label depth resolves to a fixed target
+// pc, arity and number of labels to pop; only the stack height at the label
+// is dynamic and is read from the label stack when the branch is taken.
+std::unique_ptr<Interpreter::FunctionBranches> Interpreter::resolveBranchTables() const {
+    struct Construct {
+        size_t start_pc;            // First instruction of the body
+        size_t end_pc;              // Instruction after the matching END
+        size_t arity;
+        bool is_loop;
+    };
+    struct PendingTarget {
+        size_t site;                // Ordinal of the br_table
+        size_t entry;
+        size_t construct;
+    };
+
+    auto branches = std::make_unique<FunctionBranches>();
+    branches->site_bits.assign(code_size_ / 64 + 1, 0);
+    std::vector<Construct> constructs;
+    std::vector<size_t> open;           // Indices into constructs, innermost last
+    std::vector<PendingTarget> pending;
+
+    auto readLabel = [this](size_t& pc) {
+        uint32_t result = 0;
+        int shift = 0;
+        while (pc < code_size_) {
+            uint8_t byte = code_[pc++];
+            result |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+            shift += 7;
+        }
+        return result;
+    };
+
+    size_t pc = 0;
+    while (pc < code_size_) {
+        uint8_t opcode = code_[pc++];
+
+        if (opcode == 0x02 || opcode == 0x03 || opcode == 0x04) {  // block, loop, if
+            BlockSignature signature = blockSignature(pc);
+            bool is_loop = opcode == 0x03;
+            // Loops branch back to their start and carry their parameters
+            size_t arity = is_loop ? signature.params : signature.results;
+            open.push_back(constructs.size());
+            constructs.push_back({pc, 0, arity, is_loop});
+        } else if (opcode == 0x0B) {  // end
+            if (!open.empty()) {
+                constructs[open.back()].end_pc = pc;
+                open.pop_back();
+            }
+        } else if (opcode == 0x0E) {  // br_table
+            branches->site_bits[pc / 64] |= uint64_t(1) << (pc % 64);
+            size_t site = branches->tables.size();
+            branches->tables.emplace_back();
+            BranchTable& table = branches->tables.back();
+            uint32_t label_count = readLabel(pc);
+            table.targets.reserve(std::min<size_t>(static_cast<size_t>(label_count) + 1,
+                                                   code_size_ - pc + 1));
+
+            for (uint32_t i = 0; i <= label_count && pc < code_size_; i++) {
+                uint32_t depth = readLabel(pc);
+
+                BranchTarget target{};
+                target.depth = depth;
+                target.is_valid = depth <= open.size();
+                target.is_return = depth == open.size();
+
+                if (depth < open.size()) {
+                    size_t index = open[open.size() - 1 - depth];
+                    const Construct& construct = constructs[index];
+                    target.arity = construct.arity;
+                    target.labels_to_pop = construct.is_loop ? depth : depth + 1;
+                    pending.push_back({site, table.targets.size(), index});
+                }
+                table.targets.push_back(target);
+            }
+        } else if (!skipImmediates(opcode, code_, code_size_, pc)) {
+            throw InterpreterError("Truncated instruction or unknown sub-opcode in function body");
+        }
+    }
+
+    // Targets of enclosing blocks are only known once their END was seen
+    for (const auto& p : pending) {
+        const Construct& construct = constructs[p.construct];
+        branches->tables[p.site].targets[p.entry].target_pc =
+            construct.is_loop ? construct.start_pc : construct.end_pc;
+    }
+
+    // Running count of sites before each word
+    branches->site_ranks.resize(branches->site_bits.size());
+    uint32_t sites = 0;
+    for (size_t i = 0; i < branches->site_bits.size(); i++) {
+        branches->site_ranks[i] = sites;
+        sites += static_cast<uint32_t>(__builtin_popcountll(branches->site_bits[i]));
     }
+    return branches;
 }
 
 // Helper function to find matching END for a block/loop starting at current PC
@@ -2135,8 +3299,7 @@ size_t Interpreter::findMatchingEnd(size_t start_pc) const {
         // Check for nested blocks/loops/ifs (increase depth)
         if (opcode == 0x02 || opcode == 0x03 || opcode == 0x04) {  // block, loop, if
             depth++;
-            // Skip block type
-            if (pc < code_size_) pc++;
+            blockSignature(pc);
         }
         // Check for END (decrease depth)
         else if (opcode == 0x0B) {  // end
@@ -2146,8 +3309,8 @@ size_t Interpreter::findMatchingEnd(size_t start_pc) const {
             }
         }
         // Skip other instructions with immediates
-        else {
-            skipInstructionOperands(opcode, pc);
+        else if (!skipImmediates(opcode, code_, code_size_, pc)) {
+            throw InterpreterError("Truncated instruction or unknown sub-opcode in function body");
         }
     }
 
@@ -2165,7 +3328,7 @@ size_t Interpreter::findMatchingElseAndEnd(size_t start_pc, size_t& else_pc) con
 
         if (opcode == 0x02 || opcode == 0x03 || opcode == 0x04) {  // block, loop, if
             depth++;
-            if (pc < code_size_) pc++;  // Skip block type
+            blockSignature(pc);
         }
         else if (opcode == 0x05 && depth == 1) {  // else at our level
             else_pc = pc;  // Mark else position
@@ -2176,68 +3339,58 @@ size_t Interpreter::findMatchingElseAndEnd(size_t start_pc, size_t& else_pc) con
                 return pc;  // Found matching END
             }
         }
-        else {
-            skipInstructionOperands(opcode, pc);
+        else if (!skipImmediates(opcode, code_, code_size_, pc)) {
+            throw InterpreterError("Truncated instruction or unknown sub-opcode in function body");
         }
     }
 
     throw InterpreterError("No matching END found for if");
 }
 
-// Helper to skip instruction operands when scanning bytecode
-void Interpreter::skipInstructionOperands(uint8_t opcode, size_t& pc) const {
-    // Skip immediates for various instruction types
-    // This is a simplified version - handles common cases
-
-    // br, br_if, call, local.get/set, global.get/set
-    if (opcode == 0x0C || opcode == 0x0D || opcode == 0x10 ||
-        opcode == 0x20 || opcode == 0x21 || opcode == 0x22 ||
-        opcode == 0x23 || opcode == 0x24) {
-        // Skip LEB128 immediate
-        while (pc < code_size_ && (code_[pc] & 0x80)) pc++;
-        if (pc < code_size_) pc++;
+// Block types are 0x40 (empty), a value type with one result, possibly
+// (ref null? <heaptype>), or a type index giving parameters and results
+Interpreter::BlockSignature Interpreter::blockSignature(size_t& pc) const {
+    if (pc >= code_size_) {
+        return {0, 0};
     }
-    // br_table
-    else if (opcode == 0x0E) {
-        // Skip label count
-        uint32_t count = 0;
-        int shift = 0;
-        while (pc < code_size_ && (code_[pc] & 0x80)) {
-            count |= (code_[pc] & 0x7F) << shift;
-            shift += 7;
-            pc++;
-        }
-        if (pc < code_size_) {
-            count |= (code_[pc] & 0x7F) << shift;
-            pc++;
-        }
-        // Skip count+1 labels
-        for (uint32_t i = 0; i <= count && pc < code_size_; i++) {
-            while (pc < code_size_ && (code_[pc] & 0x80)) pc++;
-            if (pc < code_size_) pc++;
-        }
+    uint8_t byte = code_[pc];
+    if (byte == 0x40) {
+        pc++;
+        return {0, 0};
     }
-    // i32.const, i64.const
-    else if (opcode == 0x41 || opcode == 0x42) {
+    if (byte == 0x63 || byte == 0x64) {
+        pc++;
         while (pc < code_size_ && (code_[pc] & 0x80)) pc++;
         if (pc < code_size_) pc++;
+        return {0, 1};
     }
-    // f32.const
-    else if (opcode == 0x43) {
-        pc += 4;
+    if ((byte & 0xC0) == 0x40) {
+        pc++;   // Single-byte negative s33: a value type
+        return {0, 1};
     }
-    // f64.const
-    else if (opcode == 0x44) {
-        pc += 8;
-    }
-    // Memory operations (memarg: alignment + offset)
-    else if ((opcode >= 0x28 && opcode <= 0x3E) || opcode == 0x3F || opcode == 0x40) {
-        // Skip two LEB128 values (alignment and offset)
-        for (int i = 0; i < 2 && pc < code_size_; i++) {
-            while (pc < code_size_ && (code_[pc] & 0x80)) pc++;
-            if (pc < code_size_) pc++;
+
+    uint64_t index = 0;
+    int shift = 0;
+    while (pc < code_size_) {
+        uint8_t next = code_[pc++];
+        if (shift < 64) {
+            index |= static_cast<uint64_t>(next & 0x7F) << shift;
         }
+        shift += 7;
+        if ((next & 0x80) == 0) break;
+    }
+    if (index >= module_->types.size()) {
+        throw InterpreterError("Invalid block type index: " + std::to_string(index));
+    }
+    const FuncType& type = module_->types[static_cast<size_t>(index)];
+    return {type.params.size(), type.results.size()};
+}
+
+Interpreter::BlockSignature Interpreter::readBlockType() {
+    if (pc_ >= code_size_) {
+        throw InterpreterError("Unexpected end of bytecode");
     }
+    return blockSignature(pc_);
 }
 
 // Memory helpers
@@ -2344,10 +3497,27 @@ double Interpreter::readF64() {
 
 // Validation
 
-void Interpreter::validateFunctionCall(uint32_t func_index) const {
+void Interpreter::validateFunctionCall(uint32_t func_index, const std::vector<TypedValue>& args) const {
     if (func_index >= module_->getTotalFunctionCount()) {
         throw InterpreterError("Function index out of bounds");
     }
+
+    // Mismatched arguments would otherwise fail deep inside the callee
+    const FuncType* func_type = module_->getFunctionType(func_index);
+    if (!func_type) {
+        return;
+    }
+    if (args.size() != func_type->params.size()) {
+        throw InterpreterError(displayName(func_index) + " expects " + std::to_string(func_type->params.size()) +
+                               " arguments, got " + std::to_string(args.size()));
+    }
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i].type != func_type->params[i]) {
+            throw InterpreterError("Argument " + std::to_string(i) + " of " + displayName(func_index) + " must be " +
+                                   valueTypeToString(func_type->params[i]) + ", got " +
+                                   valueTypeToString(args[i].type));
+        }
+    }
 }
 
 void Interpreter::validateMemoryAccess() const {
@@ -2365,12 +3535,280 @@ void Interpreter::checkStackUnderflow(size_t required) const {
 void Interpreter::dumpState() const {
     std::cout << "=== Interpreter State ===" << std::endl;
     std::cout << "PC: " << pc_ << " / " << code_size_ << std::endl;
-    std::cout << "Locals: " << locals_.size() << std::endl;
+    std::cout << "Locals: " << locals_.size() - locals_base_ << std::endl;
     std::cout << "Globals: " << globals_.size() << std::endl;
     stack_.dump();
     std::cout << "=========================" << std::endl;
 }
 
+// Compiled Module Support
+
+void Interpreter::loadNative(const std::string& path) {
+    if (!module_) {
+        throw InterpreterError("No module instantiated");
+    }
+    if (table_owner_) {
+        throw InterpreterError("Compiled code cannot call through an imported table");
+    }
+
+    std::unique_ptr<NativeModule> native = NativeModule::load(path);
+    const wasm_rt_module& descriptor = native->descriptor();
+    if (descriptor.fingerprint != AotCompiler::fingerprint(*module_) ||
+        descriptor.function_count != module_->getTotalFunctionCount()) {
+        throw AotError("Native module was compiled from a different module: " + path);
+    }
+
+    installNative(std::move(native));
+}
+
+void Interpreter::installNative(std::unique_ptr<NativeModule> native) {
+    if (native_modules_.empty()) {
+        native_instance_ = wasm_rt_instance();
+        native_instance_.host = this;
+        native_instance_.trap = &Interpreter::nativeTrap;
+        native_instance_.memory_grow = &Interpreter::nativeMemoryGrow;
+        native_instance_.call_host = &Interpreter::nativeCallHost;
+        native_invokers_.assign(module_->getTotalFunctionCount(), nullptr);
+    }
+
+    for (uint32_t i = 0; i < native_invokers_.size(); i++) {
+        if (wasm_rt_invoke_fn invoke = native->invoker(i)) {
+            native_invokers_[i] = invoke;
+        }
+    }
+    if (perf_enabled_) {
+        registerPerfCode(*native);
+    }
+    native_modules_.push_back(std::move(native));
+}
+
+bool Interpreter::enablePerf(PerfFormat format) {
+    if (!PerfMap::instance().enable(format)) {
+        return false;
+    }
+    if (!perf_enabled_) {
+        perf_enabled_ = true;
+        for (const auto& native : native_modules_) {
+            registerPerfCode(*native);
+        }
+        if (module_) {
+            createPerfTrampolines();
+        }
+    }
+    return true;
+}
+
+std::string Interpreter::displayName(uint32_t func_index) const {
+    std::string name = module_->functionName(func_index);
+    return name.empty() ? "func[" + std::to_string(func_index) + "]" : name;
+}
+
+std::string Interpreter::perfName(uint32_t func_index) const {
+    return "wasm::" + displayName(func_index);
+}
+
+void Interpreter::registerPerfCode(const NativeModule& native) const {
+    for (const NativeCodeRange& range : native.codeRanges()) {
+        PerfMap::instance().addCode(range.start, range.size, perfName(range.func_index));
+    }
+}
+
+void Interpreter::createPerfTrampolines() {
+    auto trampolines = std::make_unique<PerfTrampolines>(module_->getTotalFunctionCount(),
+                                                         &Interpreter::perfEntry);
+    if (!trampolines->available()) {
+        return;
+    }
+    for (uint32_t i = module_->getImportedFunctionCount(); i < module_->getTotalFunctionCount(); i++) {
+        PerfMap::instance().addCode(trampolines->stub(i), PerfTrampolines::STUB_SIZE,
+                                    perfName(i) + " [interp]");
+    }
+    perf_trampolines_ = std::move(trampolines);
+}
+
+void Interpreter::perfEntry(void* context, uint32_t func_index) {
+    // The stub has no unwind info, so exceptions are parked and rethrown
+    // once control is back in C++ frames
+    Interpreter* self = static_cast<Interpreter*>(context);
+    try {
+        self->executeBody(func_index);
+    } catch (...) {
+        self->perf_exception_ = std::current_exception();
+    }
+}
+
+void Interpreter::enableTierUp() {
+    enableTierUp(TierUpOptions());
+}
+
+void Interpreter::enableTierUp(const TierUpOptions& options) {
+    if (!module_) {
+        throw InterpreterError("No module instantiated");
+    }
+    if (table_owner_) {
+        throw InterpreterError("Compiled code cannot call through an imported table");
+    }
+    tier_up_ = std::make_unique<TierUpCompiler>(*module_, options);
+
+    // Functions that are already hot compile right away
+    for (uint32_t i = module_->getImportedFunctionCount(); i < call_counts_.size(); i++) {
+        if (call_counts_[i] >= options.hot_threshold) {
+            tier_up_->request(i);
+        }
+    }
+}
+
+bool Interpreter::waitForTierUp() {
+    if (!tier_up_) {
+        return false;
+    }
+    tier_up_->wait();
+    if (std::unique_ptr<NativeModule> native = tier_up_->takeReady()) {
+        installNative(std::move(native));
+    }
+    return tier_up_->lastError().empty();
+}
+
+void Interpreter::profileCall(uint32_t func_index) {
+    uint64_t count = ++call_counts_[func_index];
+    if (!tier_up_) {
+        return;
+    }
+
+    if (count == tier_up_->hotThreshold() && func_index >= module_->getImportedFunctionCount()) {
+        tier_up_->request(func_index);
+    }
+    // Installing here is safe: replaced modules stay loaded
+    if (tier_up_->hasReady()) {
+        if (std::unique_ptr<NativeModule> native = tier_up_->takeReady()) {
+            installNative(std::move(native));
+        }
+    }
+}
+
+void Interpreter::bindNativeInstance() {
+    // Memory may have been grown since compiled code last ran
+    native_instance_.memory = memory_ ? memory_->data() : nullptr;
+    native_instance_.memory_size = memory_ ? memory_->sizeInBytes() : 0;
+    native_instance_.globals = reinterpret_cast<wasm_rt_value*>(globals_.data());
+    native_instance_.table = table_.data();
+    native_instance_.table_size = static_cast<uint32_t>(table_.size());
+}
+
+void Interpreter::executeNative(uint32_t func_index) {
+    const FuncType* func_type = module_->getFunctionType(func_index);
+    size_t param_count = func_type->params.size();
+    checkStackUnderflow(param_count);
+
+    // Common signatures pass their arguments without touching the heap
+    TypedValue inline_args[8];
+    std::vector<TypedValue> heap_args;
+    TypedValue* args = inline_args;
+    if (param_count > 8) {
+        heap_args.resize(param_count);
+        args = heap_args.data();
+    }
+    for (size_t i = param_count; i > 0; i--) {
+        args[i - 1] = stack_.pop();
+        if (args[i - 1].type != func_type->params[i - 1]) {
+            throw InterpreterError("Argument type mismatch");
+        }
+    }
+
+    bindNativeInstance();
+
+    TypedValue result;
+    native_invokers_[func_index](&native_instance_, reinterpret_cast<const wasm_rt_value*>(args),
+                                 reinterpret_cast<wasm_rt_value*>(&result));
+    if (!func_type->results.empty()) {
+        stack_.push(result);
+    }
+}
+
+void Interpreter::setCounterProfile(std::shared_ptr<CounterProfile> profile) {
+    counter_profile_ = std::move(profile);
+    if (counter_profile_ && module_) {
+        nameCounterProfile();
+    }
+}
+
+void Interpreter::nameCounterProfile() {
+    std::vector<std::string> names(module_->getTotalFunctionCount());
+    for (uint32_t i = 0; i < names.size(); i++) {
+        names[i] = displayName(i);
+    }
+    counter_profile_->setFunctionNames(std::move(names));
+}
+
+void Interpreter::setMemoryProfile(std::shared_ptr<MemoryProfile> profile) {
+    memory_profile_ = std::move(profile);
+    if (memory_) {
+        memory_->setProfile(memory_profile_.get());
+    }
+}
+
+void Interpreter::setTracer(std::shared_ptr<Tracer> tracer) {
+    tracer_ = std::move(tracer);
+    trace_names_.clear();
+    if (tracer_ && module_) {
+        internTraceNames();
+    }
+}
+
+void Interpreter::internTraceNames() {
+    trace_memory_grow_ = tracer_->intern("memory.grow");
+    trace_names_.resize(module_->getTotalFunctionCount());
+    for (uint32_t i = 0; i < trace_names_.size(); i++) {
+        trace_names_[i] = tracer_->intern(displayName(i));
+    }
+}
+
+void Interpreter::traceTrap(const std::exception& error) {
+    tracer_->instant(TraceEventKind::TRAP, tracer_->intern(error.what()), trace_depth_);
+}
+
+int32_t Interpreter::growMemory(uint32_t delta_pages) {
+    TraceScope scope(tracer_.get(), TraceEventKind::MEMORY_GROW, trace_memory_grow_, trace_depth_);
+    return memory_->grow(delta_pages);
+}
+
+void Interpreter::nativeTrap(wasm_rt_instance* /*inst*/, wasm_rt_trap_kind kind, const char* message) {
+    // Report traps with the same exception types as the interpreter
+    if (kind == WASM_RT_TRAP_OUT_OF_BOUNDS) {
+        throw MemoryError(message);
+    }
+    throw Trap(message);
+}
+
+int32_t Interpreter::nativeMemoryGrow(wasm_rt_instance* inst, uint32_t delta_pages) {
+    Interpreter* self = static_cast<Interpreter*>(inst->host);
+    if (!self->memory_) {
+        return -1;
+    }
+    int32_t result = self->growMemory(delta_pages);
+    inst->memory = self->memory_->data();
+    inst->memory_size = self->memory_->sizeInBytes();
+    return result;
+}
+
+void Interpreter::nativeCallHost(wasm_rt_instance* inst, uint32_t func_index,
+                                 const wasm_rt_value* args, wasm_rt_value* results) {
+    Interpreter* self = static_cast<Interpreter*>(inst->host);
+    const FuncType* func_type = self->module_->getFunctionType(func_index);
+
+    for (size_t i = 0; i < func_type->params.size(); i++) {
+        self->stack_.push(reinterpret_cast<const TypedValue*>(args)[i]);
+    }
+    self->execute(func_index);
+    if (!func_type->results.empty()) {
+        reinterpret_cast<TypedValue*>(results)[0] = self->stack_.pop();
+    }
+
+    // Interpreted code may have grown memory
+    inst->memory = self->memory_ ? self->memory_->data() : nullptr;
+    inst->memory_size = self->memory_ ? self->memory_->sizeInBytes() : 0;
+}
+
 // WASI Support
 
 void Interpreter::executeWASIFdWrite() {
@@ -2395,17 +3833,17 @@ void Interpreter::executeWASIFdWrite() {
         uint32_t buf_ptr = memory_->loadU32(iovec_addr);
         uint32_t buf_len = memory_->loadU32(iovec_addr + 4);
 
-        // Read buffer data and write to file descriptor
-        for (uint32_t j = 0; j < buf_len; j++) {
-            char c = static_cast<char>(memory_->loadU8(buf_ptr + j));
-
-            if (fd == 1) {
-                std::cout << c;  // stdout
-            } else if (fd == 2) {
-                std::cerr << c;  // stderr
-            }
-            // Ignore other file descriptors for now
+        // Write the buffer to the file descriptor straight from memory
+        if (static_cast<uint64_t>(buf_ptr) + buf_len > memory_->sizeInBytes()) {
+            throw MemoryError("Memory access out of bounds");
+        }
+        const char* buf = reinterpret_cast<const char*>(memory_->data() + buf_ptr);
+        if (fd == 1) {
+            std::cout.write(buf, buf_len);  // stdout
+        } else if (fd == 2) {
+            std::cerr.write(buf, buf_len);  // stderr
         }
+        // Ignore other file descriptors for now
 
         total_written += buf_len;
     }
@@ -1,22 +1,62 @@
+#include "aot.h"
 #include "decoder.h"
 #include "interpreter.h"
+#include "server.h"
 #include "types.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <numeric>
+#include <sstream>
 #include <string>
 #include <vector>
 #include <exception>
+#include <stdexcept>
 
 namespace {
 
 void printUsage(const char* program_name) {
-    std::cout << "Usage: " << program_name << " <wasm_file> [function_name] [args...]\n";
+    std::cout << "Usage: " << program_name << " [options] <wasm_file> [function_name] [args...]\n";
     std::cout << "\nOptions:\n";
+    std::cout << "  --native <lib>   Run functions from a library built by wasm-aot\n";
+    std::cout << "  --batch <file>   Call \"function arg...\" per line of file (- for stdin),\n";
+    std::cout << "                   printing one line of results per call\n";
+    std::cout << "  --batch-reset    In batch mode, restore the freshly instantiated state\n";
+    std::cout << "                   before each call\n";
+    std::cout << "  --serve <socket> Serve calls to the given modules over a Unix socket\n";
+    std::cout << "                   (see wasm-client); module ids follow argument order\n";
+    std::cout << "  --pool <n>       Instances per module when serving (default: 4)\n";
+    std::cout << "  --repeat <n>     Call the function n times\n";
+    std::cout << "  --time           Report per-call latency percentiles\n";
+    std::cout << "  --perf-map       Name guest functions for perf in /tmp/perf-<pid>.map\n";
+    std::cout << "  --jitdump        Write /tmp/jit-<pid>.dump for perf inject --jit\n";
+    std::cout << "  --trace <file>   Write a timeline of calls, memory growth and traps\n";
+    std::cout << "                   (Chrome trace JSON, or Perfetto protobuf for .pftrace)\n";
+    std::cout << "  --trace-min-us <n>  Only trace calls lasting at least n microseconds\n";
+    std::cout << "  --counters       Report hardware counters per guest function on stderr\n";
+    std::cout << "  --memory-heatmap <file>  Write per-page memory access counts\n";
+    std::cout << "                   (CSV, or a PPM image for .ppm)\n";
+    std::cout << "  --memory-sample <n>  Record only every nth memory access\n";
+    std::cout << "  --memory-backend <heap|lazy|huge>  Linear memory storage (default: "
+              << wasm::memoryBackendName(wasm::defaultMemoryBackend()) << ")\n";
+    std::cout << "  --bounds-check <explicit|masked|guard>  Memory bounds checking (default:\n";
+    std::cout << "                   explicit; masked wraps instead of trapping, guard\n";
+    std::cout << "                   needs the lazy backend)\n";
     std::cout << "  <wasm_file>      Path to the WebAssembly binary file\n";
     std::cout << "  [function_name]  Name of the exported function to call (optional)\n";
-    std::cout << "  [args...]        Arguments to pass to the function (optional)\n";
+    std::cout << "  [args...]        Arguments, parsed to the function's parameter types:\n";
+    std::cout << "                   integers in decimal or 0x hex, floats also as inf,\n";
+    std::cout << "                   nan or nan:0x<payload> (optional)\n";
     std::cout << "\nExamples:\n";
     std::cout << "  " << program_name << " module.wasm\n";
     std::cout << "  " << program_name << " module.wasm add 5 10\n";
+    std::cout << "  " << program_name << " --repeat 1000 --time module.wasm fib 20\n";
+    std::cout << "  printf 'add 1 2\\nadd 3 4\\n' | " << program_name << " --batch - module.wasm\n";
+    std::cout << "  " << program_name << " --serve /tmp/wasm.sock a.wasm b.wasm\n";
     std::cout << "\nIf no function name is provided, the module will be instantiated\n";
     std::cout << "and the start function will be executed if present.\n";
 }
@@ -29,44 +69,215 @@ void printResults(const std::vector<wasm::TypedValue>& results) {
 
     std::cout << "Results:\n";
     for (size_t i = 0; i < results.size(); i++) {
-        const auto& result = results[i];
-        std::cout << "  [" << i << "] " << wasm::valueTypeToString(result.type) << ": ";
+        std::cout << "  [" << i << "] " << wasm::valueTypeToString(results[i].type) << ": "
+                  << wasm::formatValue(results[i]) << "\n";
+    }
+}
 
-        switch (result.type) {
-            case wasm::ValueType::I32:
-                std::cout << result.value.i32;
-                break;
-            case wasm::ValueType::I64:
-                std::cout << result.value.i64;
-                break;
-            case wasm::ValueType::F32:
-                std::cout << result.value.f32;
-                break;
-            case wasm::ValueType::F64:
-                std::cout << result.value.f64;
-                break;
-            default:
-                std::cout << "unknown";
+void printModuleSummary(const wasm::Module& module) {
+    std::cout << "Module loaded successfully\n";
+    std::cout << "  Type section: " << module.types.size() << " entries\n";
+    std::cout << "  Function section: " << module.functions.size() << " functions\n";
+    std::cout << "  Memory section: " << module.memories.size() << " memories\n";
+    std::cout << "  Global section: " << module.globals.size() << " globals\n";
+    std::cout << "  Export section: " << module.exports.size() << " exports\n";
+
+    // List exports
+    if (!module.exports.empty()) {
+        std::cout << "\nExported functions:\n";
+        for (const auto& exp : module.exports) {
+            if (exp.kind == wasm::ExternalKind::FUNCTION) {
+                std::cout << "  - " << exp.name << "\n";
+            }
         }
-        std::cout << "\n";
     }
 }
 
-wasm::TypedValue parseArgument(const std::string& arg, wasm::ValueType type) {
-    switch (type) {
-        case wasm::ValueType::I32:
-            return wasm::TypedValue::makeI32(std::stoi(arg));
-        case wasm::ValueType::I64:
-            return wasm::TypedValue::makeI64(std::stoll(arg));
-        case wasm::ValueType::F32:
-            return wasm::TypedValue::makeF32(std::stof(arg));
-        case wasm::ValueType::F64:
-            return wasm::TypedValue::makeF64(std::stod(arg));
-        default:
-            throw std::runtime_error("Unsupported argument type");
+// Results of one batch call on one line, space separated
+void printCompactResults(const std::vector<wasm::TypedValue>& results) {
+    for (size_t i = 0; i < results.size(); i++) {
+        std::cout << (i > 0 ? " " : "") << wasm::formatValue(results[i]);
+    }
+    std::cout << '\n';
+}
+
+// Parses argument strings to the parameter types of an export
+void parseArguments(const wasm::Interpreter& interpreter, const std::string& function_name,
+                    const std::vector<std::string>& words, std::vector<wasm::TypedValue>& args) {
+    const wasm::FuncType& type = interpreter.exportType(function_name);
+    if (words.size() != type.params.size()) {
+        throw std::invalid_argument(function_name + " takes " + std::to_string(type.params.size()) +
+                                    " arguments, got " + std::to_string(words.size()));
     }
+    args.clear();
+    for (size_t i = 0; i < words.size(); i++) {
+        args.push_back(wasm::parseValue(words[i], type.params[i]));
+    }
+}
+
+std::string formatDuration(double ns) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(ns < 1e3 ? 0 : 2);
+    if (ns < 1e3) {
+        out << ns << " ns";
+    } else if (ns < 1e6) {
+        out << ns / 1e3 << " us";
+    } else if (ns < 1e9) {
+        out << ns / 1e6 << " ms";
+    } else {
+        out << ns / 1e9 << " s";
+    }
+    return out.str();
+}
+
+// Latency distribution of repeated calls (nearest-rank percentiles)
+void printLatency(std::vector<double>& samples) {
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&](double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * samples.size()));
+        return samples[rank > 0 ? rank - 1 : 0];
+    };
+    double total = std::accumulate(samples.begin(), samples.end(), 0.0);
+
+    std::cout << "\nTiming (" << samples.size() << (samples.size() == 1 ? " call" : " calls") << "):\n";
+    std::cout << "  min   " << formatDuration(samples.front()) << "\n";
+    std::cout << "  p50   " << formatDuration(percentile(50)) << "\n";
+    std::cout << "  p90   " << formatDuration(percentile(90)) << "\n";
+    std::cout << "  p99   " << formatDuration(percentile(99)) << "\n";
+    std::cout << "  max   " << formatDuration(samples.back()) << "\n";
+    std::cout << "  mean  " << formatDuration(total / samples.size()) << "\n";
+    std::cout << "  total " << formatDuration(total) << "\n";
 }
 
+// Runs "function arg..." lines against one instance. Blank lines and lines
+// starting with # are skipped. Each call prints one line: its results, or
+// "error: ..." if it failed, so output lines match input calls.
+// @return Number of failed calls
+int runBatch(wasm::Interpreter& interpreter, std::istream& input, bool reset) {
+    if (reset) {
+        interpreter.takeSnapshot();
+    }
+
+    std::vector<std::string> arg_words;
+    std::vector<wasm::TypedValue> args;
+    std::vector<wasm::TypedValue> results;
+    std::string line;
+    bool pristine = true;
+    int failures = 0;
+    while (std::getline(input, line)) {
+        std::istringstream words(line);
+        std::string function_name;
+        if (!(words >> function_name) || function_name[0] == '#') {
+            continue;
+        }
+        if (reset && !pristine) {
+            interpreter.restoreSnapshot();
+        }
+        pristine = false;
+
+        try {
+            arg_words.clear();
+            for (std::string word; words >> word;) {
+                arg_words.push_back(word);
+            }
+            parseArguments(interpreter, function_name, arg_words, args);
+            interpreter.call(function_name, args, results);
+            printCompactResults(results);
+        } catch (const std::exception& e) {
+            std::cout << "error: " << e.what() << '\n';
+            failures++;
+        }
+    }
+    std::cout.flush();
+    return failures;
+}
+
+// Serves every remaining argument as a module until a client sends SHUTDOWN
+int runServer(const std::string& socket_path, size_t pool_size, char* files[], int count) {
+    if (count == 0) {
+        std::cerr << "--serve requires at least one module\n";
+        return 1;
+    }
+    wasm::Server server(pool_size);
+    for (int i = 0; i < count; i++) {
+        uint32_t module_id = server.loadModule(files[i]);
+        std::cout << "Module " << module_id << ": " << files[i] << "\n";
+    }
+    server.listen(socket_path);
+    std::cout << "Serving on " << socket_path << std::endl;
+    server.serve();
+    return 0;
+}
+
+wasm::MemoryBackend parseMemoryBackend(const std::string& name) {
+    for (wasm::MemoryBackend backend : {wasm::MemoryBackend::HEAP, wasm::MemoryBackend::LAZY,
+                                        wasm::MemoryBackend::HUGE_PAGES}) {
+        if (name == wasm::memoryBackendName(backend)) {
+            return backend;
+        }
+    }
+    throw std::invalid_argument("Unknown memory backend: " + name);
+}
+
+wasm::BoundsCheck parseBoundsCheck(const std::string& name) {
+    for (wasm::BoundsCheck bounds : {wasm::BoundsCheck::EXPLICIT, wasm::BoundsCheck::MASKED,
+                                     wasm::BoundsCheck::GUARD}) {
+        if (name == wasm::boundsCheckName(bounds)) {
+            return bounds;
+        }
+    }
+    throw std::invalid_argument("Unknown bounds check: " + name);
+}
+
+// Writes the trace when main returns or unwinds, so traps are included
+struct TraceFileWriter {
+    std::shared_ptr<wasm::Tracer> tracer;
+    std::string path;
+
+    ~TraceFileWriter() {
+        if (!tracer) {
+            return;
+        }
+        bool perfetto = path.size() > 8 && path.compare(path.size() - 8, 8, ".pftrace") == 0;
+        if (tracer->writeFile(path, perfetto ? wasm::TraceFormat::PERFETTO : wasm::TraceFormat::CHROME_JSON)) {
+            std::cerr << "Trace written to " << path << "\n";
+        } else {
+            std::cerr << "Cannot write trace to " << path << "\n";
+        }
+    }
+};
+
+// Reports hardware counters when main returns or unwinds
+struct CounterReport {
+    std::shared_ptr<wasm::CounterProfile> profile;
+
+    ~CounterReport() {
+        if (profile) {
+            std::cerr << "\n";
+            profile->write(std::cerr);
+        }
+    }
+};
+
+// Writes the memory heatmap when main returns or unwinds
+struct HeatmapFileWriter {
+    std::shared_ptr<wasm::MemoryProfile> profile;
+    std::string path;
+
+    ~HeatmapFileWriter() {
+        if (!profile) {
+            return;
+        }
+        bool ppm = path.size() > 4 && path.compare(path.size() - 4, 4, ".ppm") == 0;
+        if (profile->writeFile(path, ppm ? wasm::HeatmapFormat::PPM : wasm::HeatmapFormat::CSV)) {
+            std::cerr << "Memory heatmap written to " << path << " (" << profile->peakTouchedPages() << " of "
+                      << profile->pageCount() << " pages touched)\n";
+        } else {
+            std::cerr << "Cannot write memory heatmap to " << path << "\n";
+        }
+    }
+};
+
 } // anonymous namespace
 
 int main(int argc, char* argv[]) {
@@ -77,7 +288,78 @@ int main(int argc, char* argv[]) {
             return 1;
         }
 
-        std::string wasm_file = argv[1];
+        // Leading options
+        std::string native_library;
+        bool perf = false;
+        wasm::PerfFormat perf_format = wasm::PerfFormat::MAP;
+        TraceFileWriter trace;
+        wasm::TracerOptions trace_options;
+        HeatmapFileWriter heatmap;
+        CounterReport counters;
+        uint32_t heatmap_sample_rate = 1;
+        std::string batch_path;
+        bool batch_reset = false;
+        std::string serve_path;
+        size_t pool_size = 4;
+        unsigned long repeat = 1;
+        wasm::MemoryBackend memory_backend = wasm::defaultMemoryBackend();
+        wasm::BoundsCheck bounds_check = wasm::BoundsCheck::EXPLICIT;
+        bool time_calls = false;
+        int arg_index = 1;
+        while (arg_index < argc - 1) {
+            std::string option = argv[arg_index];
+            if (option == "--native" && arg_index + 2 < argc) {
+                native_library = argv[arg_index + 1];
+                arg_index += 2;
+            } else if (option == "--trace" && arg_index + 2 < argc) {
+                trace.path = argv[arg_index + 1];
+                arg_index += 2;
+            } else if (option == "--trace-min-us" && arg_index + 2 < argc) {
+                trace_options.min_duration_ns = std::stoull(argv[arg_index + 1]) * 1000;
+                arg_index += 2;
+            } else if (option == "--memory-heatmap" && arg_index + 2 < argc) {
+                heatmap.path = argv[arg_index + 1];
+                arg_index += 2;
+            } else if (option == "--memory-sample" && arg_index + 2 < argc) {
+                heatmap_sample_rate = static_cast<uint32_t>(std::stoul(argv[arg_index + 1]));
+                arg_index += 2;
+            } else if (option == "--batch" && arg_index + 2 < argc) {
+                batch_path = argv[arg_index + 1];
+                arg_index += 2;
+            } else if (option == "--batch-reset") {
+                batch_reset = true;
+                arg_index++;
+            } else if (option == "--serve" && arg_index + 2 < argc) {
+                serve_path = argv[arg_index + 1];
+                arg_index += 2;
+            } else if (option == "--pool" && arg_index + 2 < argc) {
+                pool_size = std::stoul(argv[arg_index + 1]);
+                arg_index += 2;
+            } else if (option == "--repeat" && arg_index + 2 < argc) {
+                repeat = std::stoul(argv[arg_index + 1]);
+                arg_index += 2;
+            } else if (option == "--time") {
+                time_calls = true;
+                arg_index++;
+            } else if (option == "--memory-backend" && arg_index + 2 < argc) {
+                memory_backend = parseMemoryBackend(argv[arg_index + 1]);
+                arg_index += 2;
+            } else if (option == "--bounds-check" && arg_index + 2 < argc) {
+                bounds_check = parseBoundsCheck(argv[arg_index + 1]);
+                arg_index += 2;
+            } else if (option == "--counters") {
+                counters.profile = std::make_shared<wasm::CounterProfile>();
+                arg_index++;
+            } else if (option == "--perf-map" || option == "--jitdump") {
+                perf = true;
+                perf_format = option == "--jitdump" ? wasm::PerfFormat::JITDUMP : wasm::PerfFormat::MAP;
+                arg_index++;
+            } else {
+                break;
+            }
+        }
+
+        std::string wasm_file = argv[arg_index];
 
         // Check for help flag
         if (wasm_file == "-h" || wasm_file == "--help") {
@@ -85,62 +367,117 @@ int main(int argc, char* argv[]) {
             return 0;
         }
 
-        std::cout << "Loading WebAssembly module: " << wasm_file << "\n";
+        if (!serve_path.empty()) {
+            return runServer(serve_path, pool_size, argv + arg_index, argc - arg_index);
+        }
+
+        // Batch output is results only
+        bool batch = !batch_path.empty();
+        if (batch_reset && !batch) {
+            std::cerr << "--batch-reset requires --batch\n";
+            return 1;
+        }
+        if ((repeat != 1 || time_calls) && (batch || argc < arg_index + 2)) {
+            std::cerr << "--repeat and --time apply to a single function call\n";
+            return 1;
+        }
+        if (repeat == 0) {
+            std::cerr << "--repeat needs at least one call\n";
+            return 1;
+        }
+        std::ifstream batch_file;
+        if (batch && batch_path != "-") {
+            batch_file.open(batch_path);
+            if (!batch_file) {
+                std::cerr << "Cannot open batch file: " << batch_path << "\n";
+                return 1;
+            }
+        }
+
+        if (!batch) {
+            std::cout << "Loading WebAssembly module: " << wasm_file << "\n";
+        }
 
         // Decode the WASM file
         wasm::Decoder decoder;
         wasm::Module module = decoder.parse(wasm_file);
 
-        std::cout << "Module loaded successfully\n";
-        std::cout << "  Type section: " << module.types.size() << " entries\n";
-        std::cout << "  Function section: " << module.functions.size() << " functions\n";
-        std::cout << "  Memory section: " << module.memories.size() << " memories\n";
-        std::cout << "  Global section: " << module.globals.size() << " globals\n";
-        std::cout << "  Export section: " << module.exports.size() << " exports\n";
-
-        // List exports
-        if (!module.exports.empty()) {
-            std::cout << "\nExported functions:\n";
-            for (const auto& exp : module.exports) {
-                if (exp.kind == wasm::ExternalKind::FUNCTION) {
-                    std::cout << "  - " << exp.name << "\n";
-                }
-            }
-        }
-
         // Instantiate the module
-        std::cout << "\nInstantiating module...\n";
+        if (!batch) {
+            printModuleSummary(module);
+            std::cout << "\nInstantiating module...\n";
+        }
         wasm::Interpreter interpreter;
+        interpreter.setMemoryBackend(memory_backend);
+        interpreter.setBoundsCheck(bounds_check);
+        if (!trace.path.empty()) {
+            trace.tracer = std::make_shared<wasm::Tracer>(trace_options);
+            interpreter.setTracer(trace.tracer);
+        }
+        if (counters.profile) {
+            interpreter.setCounterProfile(counters.profile);
+        }
+        if (!heatmap.path.empty()) {
+            heatmap.profile = std::make_shared<wasm::MemoryProfile>(heatmap_sample_rate);
+            interpreter.setMemoryProfile(heatmap.profile);
+        }
+        if (perf && !interpreter.enablePerf(perf_format)) {
+            std::cerr << "Warning: cannot write perf annotations to /tmp\n";
+        }
         interpreter.instantiate(std::move(module));
-        std::cout << "Module instantiated successfully\n";
+        if (!batch) {
+            std::cout << "Module instantiated successfully\n";
+        }
+
+        if (!native_library.empty()) {
+            interpreter.loadNative(native_library);
+            if (!batch) {
+                std::cout << "Using native module: " << native_library << "\n";
+            }
+        }
+
+        if (batch) {
+            std::istream& input = batch_path == "-" ? std::cin : batch_file;
+            return runBatch(interpreter, input, batch_reset) == 0 ? 0 : 1;
+        }
 
         // If a function name is provided, call it
-        if (argc >= 3) {
-            std::string function_name = argv[2];
+        if (argc >= arg_index + 2) {
+            std::string function_name = argv[arg_index + 1];
             std::cout << "\nCalling function: " << function_name << "\n";
 
-            // Parse arguments if provided
+            // Parse arguments to the function's parameter types
             std::vector<wasm::TypedValue> args;
-            for (int i = 3; i < argc; i++) {
-                // For simplicity, assume all arguments are i32
-                // In a production system, you would infer types from the function signature
-                args.push_back(wasm::TypedValue::makeI32(std::stoi(argv[i])));
-            }
+            parseArguments(interpreter, function_name, std::vector<std::string>(argv + arg_index + 2, argv + argc),
+                           args);
 
             if (!args.empty()) {
                 std::cout << "Arguments:\n";
                 for (size_t i = 0; i < args.size(); i++) {
                     std::cout << "  [" << i << "] " << wasm::valueTypeToString(args[i].type)
-                             << ": " << args[i].value.i32 << "\n";
+                             << ": " << wasm::formatValue(args[i]) << "\n";
                 }
             }
 
-            // Call the function
-            auto results = interpreter.call(function_name, args);
+            // Call the function, repeatedly when timing
+            std::vector<wasm::TypedValue> results;
+            std::vector<double> samples;
+            samples.reserve(time_calls ? repeat : 0);
+            for (unsigned long n = 0; n < repeat; n++) {
+                auto start = std::chrono::steady_clock::now();
+                interpreter.call(function_name, args, results);
+                if (time_calls) {
+                    samples.push_back(std::chrono::duration<double, std::nano>(
+                        std::chrono::steady_clock::now() - start).count());
+                }
+            }
 
             // Print results
             std::cout << "\n";
             printResults(results);
+            if (time_calls) {
+                printLatency(samples);
+            }
         } else {
             std::cout << "\nNo function specified. Module instantiated and start function executed (if present).\n";
             std::cout << "To call an exported function, provide its name as an argument.\n";
@@ -157,6 +494,9 @@ int main(int argc, char* argv[]) {
     } catch (const wasm::Trap& e) {
         std::cerr << "WebAssembly trap: " << e.what() << "\n";
         return 1;
+    } catch (const wasm::AotError& e) {
+        std::cerr << "Native module error: " << e.what() << "\n";
+        return 1;
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << "\n";
         return 1;
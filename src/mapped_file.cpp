@@ -0,0 +1,44 @@
+#include "mapped_file.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define WASM_HAVE_MMAP 1
+#endif
+
+namespace wasm {
+
+std::shared_ptr<const MappedFile> MappedFile::open(const std::string& path) {
+#ifdef WASM_HAVE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return nullptr;
+    }
+    return std::shared_ptr<const MappedFile>(new MappedFile(fd, static_cast<const uint8_t*>(data), size));
+#else
+    (void)path;
+    return nullptr;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef WASM_HAVE_MMAP
+    munmap(const_cast<uint8_t*>(data_), size_);
+    close(fd_);
+#endif
+}
+
+} // namespace wasm
@@ -1,10 +1,153 @@
 #include "memory.h"
 #include <cstring>
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define WASM_HAVE_MMAP 1
+#endif
+
+#if defined(WASM_HAVE_MMAP) && defined(__linux__)
+#include <csignal>
+#define WASM_HAVE_GUARD_PAGES 1
+#endif
 
 namespace wasm {
 
-Memory::Memory(const Limits& limits) : limits_(limits), current_pages_(limits.min) {
+namespace {
+
+// Granularity at which copies of mapped memories skip zero bytes
+constexpr size_t ZERO_SCAN_SIZE = 4096;
+const uint8_t ZERO_PAGE[ZERO_SCAN_SIZE] = {};
+
+// Shortest run of zero pages a reset hands back to the kernel rather than
+// overwriting; below this the madvise call costs more than the memset
+constexpr size_t RELEASE_RUN_PAGES = 16;
+
+bool isZero(const uint8_t* data) {
+    return std::memcmp(data, ZERO_PAGE, ZERO_SCAN_SIZE) == 0;
+}
+
+#ifdef WASM_HAVE_MMAP
+// Zero an accessible mapped range, returning its pages to the kernel where
+// that is guaranteed to read back as zeros
+void zeroMapped(uint8_t* data, size_t size) {
+#ifdef __linux__
+    if (madvise(data, size, MADV_DONTNEED) == 0) {
+        return;
+    }
+#endif
+    std::memset(data, 0, size);
+}
+#endif
+
+#ifdef WASM_HAVE_GUARD_PAGES
+// Covers base + offset + access size for any 32-bit base and offset
+constexpr uint64_t GUARD_RESERVATION = (uint64_t(1) << 33) + Memory::PAGE_SIZE;
+
+// Reservations whose faults are guest out-of-bounds accesses. A fixed table
+// of atomics, so the signal handler can search it without locking
+constexpr size_t MAX_GUARDED = 256;
+std::atomic<uintptr_t> guarded_begin[MAX_GUARDED];
+std::atomic<uintptr_t> guarded_end[MAX_GUARDED];
+struct sigaction previous_segv;
+
+bool isGuarded(uintptr_t address) {
+    for (size_t i = 0; i < MAX_GUARDED; i++) {
+        uintptr_t begin = guarded_begin[i].load(std::memory_order_acquire);
+        if (begin != 0 && address >= begin && address < guarded_end[i].load(std::memory_order_acquire)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void onSegv(int signal, siginfo_t* info, void* context) {
+    if (isGuarded(reinterpret_cast<uintptr_t>(info->si_addr))) {
+        // memory.cpp is built with -fnon-call-exceptions, so this unwinds
+        // out of the faulting access in loadGuarded() or storeGuarded()
+        throw MemoryError("Memory access out of bounds");
+    }
+    // Not a guard page: hand the fault to the previous disposition
+    if (previous_segv.sa_flags & SA_SIGINFO) {
+        previous_segv.sa_sigaction(signal, info, context);
+    } else if (previous_segv.sa_handler == SIG_DFL || previous_segv.sa_handler == SIG_IGN) {
+        sigaction(signal, &previous_segv, nullptr);     // The access faults again
+    } else {
+        previous_segv.sa_handler(signal);
+    }
+}
+
+bool registerGuard(const uint8_t* data, size_t size) {
+    static std::once_flag installed;
+    std::call_once(installed, [] {
+        struct sigaction action = {};
+        action.sa_sigaction = onSegv;
+        // No SA_RESETHAND, and SA_NODEFER because the handler leaves by
+        // throwing, which skips the mask restore of a normal return
+        action.sa_flags = SA_SIGINFO | SA_NODEFER;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGSEGV, &action, &previous_segv);
+    });
+    uintptr_t begin = reinterpret_cast<uintptr_t>(data);
+    for (size_t i = 0; i < MAX_GUARDED; i++) {
+        uintptr_t expected = 0;
+        if (guarded_begin[i].compare_exchange_strong(expected, begin)) {
+            guarded_end[i].store(begin + size, std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+void unregisterGuard(const uint8_t* data) {
+    uintptr_t begin = reinterpret_cast<uintptr_t>(data);
+    for (size_t i = 0; i < MAX_GUARDED; i++) {
+        if (guarded_begin[i].load(std::memory_order_acquire) == begin) {
+            guarded_end[i].store(0, std::memory_order_release);
+            guarded_begin[i].store(0, std::memory_order_release);
+            return;
+        }
+    }
+}
+#endif
+
+} // anonymous namespace
+
+MemoryBackend defaultMemoryBackend() {
+#ifdef WASM_HAVE_MMAP
+    return MemoryBackend::LAZY;
+#else
+    return MemoryBackend::HEAP;
+#endif
+}
+
+const char* memoryBackendName(MemoryBackend backend) {
+    switch (backend) {
+        case MemoryBackend::HEAP: return "heap";
+        case MemoryBackend::LAZY: return "lazy";
+        case MemoryBackend::HUGE_PAGES: return "huge";
+        default: return "?";
+    }
+}
+
+const char* boundsCheckName(BoundsCheck bounds) {
+    switch (bounds) {
+        case BoundsCheck::EXPLICIT: return "explicit";
+        case BoundsCheck::MASKED: return "masked";
+        case BoundsCheck::GUARD: return "guard";
+        default: return "?";
+    }
+}
+
+Memory::Memory(const Limits& limits, MemoryBackend backend, BoundsCheck bounds)
+    : backend_(backend), requested_bounds_(bounds), limits_(limits), current_pages_(limits.min) {
     if (limits.min > MAX_PAGES) {
         throw MemoryError("Initial memory size exceeds maximum");
     }
@@ -17,7 +160,72 @@ Memory::Memory(const Limits& limits) : limits_(limits), current_pages_(limits.mi
         throw MemoryError("Initial size exceeds maximum size");
     }
 
-    data_.resize(current_pages_ * PAGE_SIZE, 0);
+    reserve();
+    if (!commit(static_cast<size_t>(current_pages_) * PAGE_SIZE)) {
+        throw MemoryError("Cannot allocate initial memory");
+    }
+}
+
+Memory::~Memory() {
+#ifdef WASM_HAVE_GUARD_PAGES
+    if (guarded_) {
+        unregisterGuard(data_);
+    }
+#endif
+#ifdef WASM_HAVE_MMAP
+    if (backend_ != MemoryBackend::HEAP) {
+        munmap(data_, reserved_);
+    }
+#endif
+}
+
+Memory::Memory(const Memory& other)
+    : backend_(other.backend_), requested_bounds_(other.requested_bounds_), limits_(other.limits_),
+      current_pages_(other.current_pages_), profile_(other.profile_) {
+    reserve();
+    if (!commit(other.size_)) {
+        throw MemoryError("Cannot allocate memory copy");
+    }
+    copyContents(other);
+}
+
+Memory& Memory::operator=(const Memory& other) {
+    if (this == &other) {
+        return *this;
+    }
+    if (backend_ != other.backend_ || requested_bounds_ != other.requested_bounds_ ||
+        (backend_ != MemoryBackend::HEAP && reserved_ < other.size_)) {
+        Memory copy(other);
+        std::swap(backend_, copy.backend_);
+        std::swap(data_, copy.data_);
+        std::swap(size_, copy.size_);
+        std::swap(heap_, copy.heap_);
+        std::swap(reserved_, copy.reserved_);
+        std::swap(committed_, copy.committed_);
+        std::swap(huge_page_source_, copy.huge_page_source_);
+        std::swap(file_regions_, copy.file_regions_);
+        std::swap(requested_bounds_, copy.requested_bounds_);
+        std::swap(guarded_, copy.guarded_);
+    } else {
+        // Same backend: reuse the buffer or reservation
+        if (!commit(other.size_)) {
+            throw MemoryError("Cannot allocate memory copy");
+        }
+        if (backend_ != MemoryBackend::HEAP) {
+            clear();
+        }
+        copyContents(other);
+    }
+    limits_ = other.limits_;
+    current_pages_ = other.current_pages_;
+    profile_ = other.profile_;
+    updateBoundsCheck();
+    if (track_dirty_) {
+        // Now identical to other, so nothing is dirty relative to it
+        dirty_.assign(dirty_.size(), 0);
+        resizeDirty();
+    }
+    return *this;
 }
 
 // Load operations
@@ -120,28 +328,411 @@ int32_t Memory::grow(uint32_t delta) {
     }
 
     int32_t old_pages = static_cast<int32_t>(current_pages_);
+    if (!commit(static_cast<size_t>(new_pages) * PAGE_SIZE)) {
+        return -1;
+    }
     current_pages_ = new_pages;
-    data_.resize(current_pages_ * PAGE_SIZE, 0);
+    if (profile_) {
+        profile_->resize(current_pages_);
+    }
+    if (track_dirty_) {
+        resizeDirty();
+    }
 
     return old_pages;
 }
 
-void Memory::initialize(uint32_t offset, const std::vector<uint8_t>& data) {
-    if (offset + data.size() > data_.size()) {
+void Memory::initialize(uint32_t offset, const uint8_t* data, size_t size) {
+    if (static_cast<uint64_t>(offset) + size > size_) {
         throw MemoryError("Data segment out of bounds");
     }
 
-    std::memcpy(data_.data() + offset, data.data(), data.size());
+    if (size > 0) {
+        std::memcpy(data_ + offset, data, size);
+        if (track_dirty_) {
+            setDirty(offset, size);
+        }
+    }
+    if (profile_) {
+        profile_->recordBulkWrite(offset, size);
+    }
+}
+
+size_t Memory::initializeMapped(uint32_t offset, std::shared_ptr<const MappedFile> file, size_t file_offset,
+                                size_t size) {
+    if (static_cast<uint64_t>(offset) + size > size_) {
+        throw MemoryError("Data segment out of bounds");
+    }
+    if (!file || file_offset > file->size() || size > file->size() - file_offset) {
+        throw MemoryError("Data segment outside its file");
+    }
+
+    size_t mapped = 0;
+    size_t head = size;
+#ifdef WASM_HAVE_MMAP
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    if (backend_ == MemoryBackend::LAZY && offset % page == file_offset % page) {
+        head = std::min(size, (page - offset % page) % page);
+        FileRegion region{offset + head, (size - head) / page * page, file, file_offset + head};
+        if (region.size > 0 && mapRegion(region)) {
+            mapped = region.size;
+            file_regions_.push_back(std::move(region));
+        }
+    }
+#endif
+    if (mapped == 0) {
+        head = size;
+    }
+
+    // Copy the partial pages around the mapped run
+    const uint8_t* bytes = file->data() + file_offset;
+    if (head > 0) {
+        std::memcpy(data_ + offset, bytes, head);
+    }
+    size_t tail = head + mapped;
+    if (tail < size) {
+        std::memcpy(data_ + offset + tail, bytes + tail, size - tail);
+    }
+    if (track_dirty_ && size > 0) {
+        setDirty(offset, size);
+    }
+    if (profile_) {
+        profile_->recordBulkWrite(offset, size);
+    }
+    return mapped;
 }
 
 void Memory::clear() {
-    std::fill(data_.begin(), data_.end(), 0);
+#ifdef WASM_HAVE_MMAP
+    if (backend_ != MemoryBackend::HEAP) {
+        discard(0, size_);
+        file_regions_.clear();
+        return;
+    }
+#endif
+    std::fill(heap_.begin(), heap_.end(), 0);
+}
+
+void Memory::trackDirtyPages(bool enable) {
+    track_dirty_ = enable;
+    dirty_.clear();
+    if (enable) {
+        resizeDirty();
+    }
+}
+
+void Memory::markDirty(uint32_t offset, size_t size) {
+    if (!track_dirty_ || offset >= size_ || size == 0) {
+        return;
+    }
+    setDirty(offset, std::min(size, size_ - offset));
+}
+
+size_t Memory::dirtyPageCount() const {
+    size_t count = 0;
+    for (uint64_t word : dirty_) {
+        count += static_cast<size_t>(__builtin_popcountll(word));
+    }
+    return count;
+}
+
+size_t Memory::resetTo(const Memory& pristine) {
+    if (this == &pristine) {
+        return 0;
+    }
+    if (!track_dirty_ || backend_ != pristine.backend_ || size_ < pristine.size_) {
+        *this = pristine;
+        return size_ / DIRTY_PAGE_SIZE;
+    }
+
+    // Undo growth; commit() drops the pages past the pristine size
+    if (size_ > pristine.size_) {
+        if (!commit(pristine.size_)) {
+            throw MemoryError("Cannot shrink memory to reset it");
+        }
+        current_pages_ = pristine.current_pages_;
+        if (profile_) {
+            profile_->resize(current_pages_);
+        }
+    }
+
+    // Rewrite each run of dirty pages, skipping clean words whole
+    size_t pages = size_ / DIRTY_PAGE_SIZE;
+    size_t restored = 0;
+    size_t page = 0;
+    while (page < pages) {
+        uint64_t bits = dirty_[page / 64] >> (page % 64);
+        if (bits == 0) {
+            page = (page / 64 + 1) * 64;
+            continue;
+        }
+        page += static_cast<size_t>(__builtin_ctzll(bits));
+        size_t end = page + 1;
+        while (end < pages && (dirty_[end / 64] >> (end % 64) & 1)) {
+            end++;
+        }
+        restorePages(pristine, page, end);
+        restored += end - page;
+        page = end;
+    }
+    dirty_.assign(dirty_.size(), 0);
+    resizeDirty();
+    return restored;
+}
+
+void Memory::setProfile(MemoryProfile* profile) {
+    profile_ = profile;
+    if (profile_) {
+        profile_->resize(current_pages_);
+    }
 }
 
 // Private methods
 
+void Memory::reserve() {
+    if (backend_ == MemoryBackend::HEAP) {
+        return;
+    }
+#ifdef WASM_HAVE_MMAP
+    // Reserve the largest size the memory may reach, so grow() only changes
+    // protection and data_ never moves
+    uint64_t max_bytes = static_cast<uint64_t>(limits_.has_max ? limits_.max : MAX_PAGES) * PAGE_SIZE;
+    auto reserveLazy = [this](uint64_t bytes) {
+        void* base = mmap(nullptr, static_cast<size_t>(bytes), PROT_NONE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (base == MAP_FAILED) {
+            return false;
+        }
+        data_ = static_cast<uint8_t*>(base);
+        reserved_ = static_cast<size_t>(bytes);
+        return true;
+    };
+#ifdef WASM_HAVE_GUARD_PAGES
+    // A guard reservation covers every address a load or store can form, so
+    // an out-of-bounds access always lands on an inaccessible page
+    if (backend_ == MemoryBackend::LAZY && requested_bounds_ == BoundsCheck::GUARD &&
+        GUARD_RESERVATION <= SIZE_MAX && reserveLazy(GUARD_RESERVATION)) {
+        guarded_ = registerGuard(data_, reserved_);
+        return;
+    }
+#endif
+    if (max_bytes > 0 && max_bytes + HUGE_PAGE_SIZE <= SIZE_MAX) {
+        if (backend_ == MemoryBackend::HUGE_PAGES) {
+            if (reserveHugePages(static_cast<size_t>(max_bytes))) {
+                return;
+            }
+        } else if (reserveLazy(max_bytes)) {
+            return;
+        }
+    }
+#endif
+    backend_ = MemoryBackend::HEAP;
+}
+
+bool Memory::reserveHugePages(size_t max_bytes) {
+#ifdef WASM_HAVE_MMAP
+    size_t bytes = (max_bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+#ifdef MAP_HUGETLB
+    // hugetlbfs reserves its pages at mmap time, so later faults cannot
+    // fail; only worth trying for a bounded memory
+    if (limits_.has_max) {
+        void* base = mmap(nullptr, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (base != MAP_FAILED) {
+            data_ = static_cast<uint8_t*>(base);
+            reserved_ = bytes;
+            huge_page_source_ = "hugetlbfs";
+            return true;
+        }
+    }
+#endif
+
+    // Transparent huge pages need 2 MiB alignment: over-reserve, then trim
+    void* raw = mmap(nullptr, bytes + HUGE_PAGE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (raw == MAP_FAILED) {
+        return false;
+    }
+    uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(uintptr_t(HUGE_PAGE_SIZE) - 1);
+    if (aligned > start) {
+        munmap(raw, aligned - start);
+    }
+    if (start + HUGE_PAGE_SIZE > aligned) {
+        munmap(reinterpret_cast<void*>(aligned + bytes), start + HUGE_PAGE_SIZE - aligned);
+    }
+    data_ = reinterpret_cast<uint8_t*>(aligned);
+    reserved_ = bytes;
+    huge_page_source_ = "none";
+#ifdef MADV_HUGEPAGE
+    if (madvise(data_, reserved_, MADV_HUGEPAGE) == 0) {
+        huge_page_source_ = "transparent";
+    }
+#endif
+    return true;
+#else
+    (void)max_bytes;
+    return false;
+#endif
+}
+
+bool Memory::commit(size_t bytes) {
+    if (backend_ == MemoryBackend::HEAP) {
+        try {
+            heap_.resize(bytes, 0);
+        } catch (const std::bad_alloc&) {
+            return false;
+        }
+        data_ = heap_.data();
+        size_ = bytes;
+        updateBoundsCheck();
+        return true;
+    }
+#ifdef WASM_HAVE_MMAP
+    // Huge page memory becomes accessible a whole huge page at a time
+    size_t accessible = bytes;
+    if (backend_ == MemoryBackend::HUGE_PAGES) {
+        accessible = std::min(reserved_, (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE);
+    }
+    if (accessible > committed_) {
+        // New pages read as zero and are populated when first touched
+        if (mprotect(data_ + committed_, accessible - committed_, PROT_READ | PROT_WRITE) != 0) {
+            return false;
+        }
+    } else if (accessible < committed_) {
+        // Only assignment shrinks; give the pages back
+        discard(accessible, committed_ - accessible);
+        mprotect(data_ + accessible, committed_ - accessible, PROT_NONE);
+    }
+    if (bytes < size_ && bytes < accessible) {
+        // The part of a huge page that stays accessible must regrow as zeros
+        discard(bytes, std::min(size_, accessible) - bytes);
+    }
+    committed_ = accessible;
+#endif
+    size_ = bytes;
+    updateBoundsCheck();
+    return true;
+}
+
+void Memory::updateBoundsCheck() {
+    // Masking folds an address into memory only when the size is a power of
+    // two; guard pages only exist when the reservation was registered
+    bounds_ = BoundsCheck::EXPLICIT;
+    if (requested_bounds_ == BoundsCheck::MASKED && size_ > 0 && (size_ & (size_ - 1)) == 0) {
+        bounds_ = BoundsCheck::MASKED;
+        mask_ = size_ - 1;
+    } else if (requested_bounds_ == BoundsCheck::GUARD && guarded_) {
+        bounds_ = BoundsCheck::GUARD;
+    }
+}
+
+void Memory::copyContents(const Memory& other) {
+    if (backend_ == MemoryBackend::HEAP) {
+        if (size_ > 0) {
+            std::memcpy(data_, other.data_, size_);
+        }
+        return;
+    }
+    // The destination is all zeros. Map the file regions other has, so the
+    // copy shares them too, then write only the blocks that still differ;
+    // zero pages stay unpopulated
+    for (const FileRegion& region : other.file_regions_) {
+        if (region.offset + region.size <= size_ && backend_ == MemoryBackend::LAZY && mapRegion(region)) {
+            file_regions_.push_back(region);
+        }
+    }
+    for (size_t offset = 0; offset < size_; offset += ZERO_SCAN_SIZE) {
+        size_t chunk = std::min(ZERO_SCAN_SIZE, size_ - offset);
+        const uint8_t* current = fileBacked(offset, chunk) ? data_ + offset : ZERO_PAGE;
+        if (std::memcmp(other.data_ + offset, current, chunk) != 0) {
+            std::memcpy(data_ + offset, other.data_ + offset, chunk);
+        }
+    }
+}
+
+bool Memory::mapRegion(const FileRegion& region) {
+#ifdef WASM_HAVE_MMAP
+    void* target = data_ + region.offset;
+    return mmap(target, region.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, region.file->fd(),
+                static_cast<off_t>(region.file_offset)) == target;
+#else
+    (void)region;
+    return false;
+#endif
+}
+
+bool Memory::fileBacked(size_t offset, size_t size) const {
+    for (const FileRegion& region : file_regions_) {
+        if (offset < region.offset + region.size && region.offset < offset + size) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Memory::discard(size_t offset, size_t size) {
+#ifdef WASM_HAVE_MMAP
+    if (size == 0) {
+        return;
+    }
+    if (fileBacked(offset, size)) {
+        // MADV_DONTNEED would bring back the file's bytes; put fresh
+        // anonymous pages in their place instead
+        void* target = data_ + offset;
+        if (mmap(target, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1,
+                 0) != target) {
+            std::memset(target, 0, size);
+        }
+        return;
+    }
+    zeroMapped(data_ + offset, size);
+#else
+    std::memset(data_ + offset, 0, size);
+#endif
+}
+
+void Memory::resizeDirty() {
+    size_t pages = (size_ + DIRTY_PAGE_SIZE - 1) / DIRTY_PAGE_SIZE;
+    dirty_.resize((pages + 63) / 64, 0);
+}
+
+void Memory::setDirty(uint32_t offset, size_t size) {
+    size_t first = offset / DIRTY_PAGE_SIZE;
+    size_t last = (offset + size - 1) / DIRTY_PAGE_SIZE;
+    for (size_t page = first; page <= last; page++) {
+        dirty_[page / 64] |= uint64_t(1) << (page % 64);
+    }
+}
+
+void Memory::restorePages(const Memory& pristine, size_t first, size_t last) {
+    size_t begin = first * DIRTY_PAGE_SIZE;
+    size_t end = last * DIRTY_PAGE_SIZE;
+#ifdef WASM_HAVE_MMAP
+    if (backend_ == MemoryBackend::LAZY) {
+        // Long zero runs go back to the kernel so RSS shrinks with them
+        size_t offset = begin;
+        while (offset < end) {
+            size_t zero_end = offset;
+            while (zero_end < end && isZero(pristine.data_ + zero_end)) {
+                zero_end += DIRTY_PAGE_SIZE;
+            }
+            if (zero_end - offset >= RELEASE_RUN_PAGES * DIRTY_PAGE_SIZE) {
+                discard(offset, zero_end - offset);
+                offset = zero_end;
+                continue;
+            }
+            size_t copy_end = std::max(zero_end, offset + DIRTY_PAGE_SIZE);
+            std::memcpy(data_ + offset, pristine.data_ + offset, copy_end - offset);
+            offset = copy_end;
+        }
+        return;
+    }
+#endif
+    std::memcpy(data_ + begin, pristine.data_ + begin, end - begin);
+}
+
 void Memory::checkAddress(uint32_t address, size_t size) const {
-    if (address + size > data_.size() || address + size < address) {
+    if (static_cast<uint64_t>(address) + size > size_) {
         throw MemoryError("Memory access out of bounds");
     }
 }
@@ -149,15 +740,47 @@ void Memory::checkAddress(uint32_t address, size_t size) const {
 template<typename T>
 T Memory::load(uint32_t address) const {
     checkAddress(address, sizeof(T));
+    if (profile_) {
+        profile_->recordRead(address, sizeof(T));
+    }
     T value;
-    std::memcpy(&value, &data_[address], sizeof(T));
+    std::memcpy(&value, data_ + address, sizeof(T));
     return value;
 }
 
 template<typename T>
 void Memory::store(uint32_t address, T value) {
     checkAddress(address, sizeof(T));
-    std::memcpy(&data_[address], &value, sizeof(T));
+    if (profile_) {
+        profile_->recordWrite(address, sizeof(T));
+    }
+    if (track_dirty_) {
+        setDirty(address, sizeof(T));
+    }
+    std::memcpy(data_ + address, &value, sizeof(T));
+}
+
+// Access before bookkeeping: an out-of-bounds address faults on the guard
+// pages here and never reaches the profile
+template<typename T>
+T Memory::loadGuarded(uint64_t address) const {
+    T value;
+    std::memcpy(&value, data_ + address, sizeof(T));
+    if (profile_) {
+        profile_->recordRead(static_cast<uint32_t>(address), sizeof(T));
+    }
+    return value;
+}
+
+template<typename T>
+void Memory::storeGuarded(uint64_t address, T value) {
+    std::memcpy(data_ + address, &value, sizeof(T));
+    if (profile_) {
+        profile_->recordWrite(static_cast<uint32_t>(address), sizeof(T));
+    }
+    if (track_dirty_) {
+        setDirty(static_cast<uint32_t>(address), sizeof(T));
+    }
 }
 
 // Explicit template instantiations
@@ -183,4 +806,14 @@ template void Memory::store<uint64_t>(uint32_t, uint64_t);
 template void Memory::store<float>(uint32_t, float);
 template void Memory::store<double>(uint32_t, double);
 
+#define WASM_INSTANTIATE_GUARDED(T) \
+    template T Memory::loadGuarded<T>(uint64_t) const; \
+    template void Memory::storeGuarded<T>(uint64_t, T);
+WASM_INSTANTIATE_GUARDED(int8_t) WASM_INSTANTIATE_GUARDED(int16_t)
+WASM_INSTANTIATE_GUARDED(int32_t) WASM_INSTANTIATE_GUARDED(int64_t)
+WASM_INSTANTIATE_GUARDED(uint8_t) WASM_INSTANTIATE_GUARDED(uint16_t)
+WASM_INSTANTIATE_GUARDED(uint32_t) WASM_INSTANTIATE_GUARDED(uint64_t)
+WASM_INSTANTIATE_GUARDED(float) WASM_INSTANTIATE_GUARDED(double)
+#undef WASM_INSTANTIATE_GUARDED
+
 } // namespace wasm
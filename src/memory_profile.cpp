@@ -0,0 +1,134 @@
+#include "memory_profile.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace wasm {
+
+namespace {
+
+constexpr uint32_t PPM_PAGES_PER_ROW = 64;
+constexpr uint32_t PPM_CELL_SIZE = 8;     // Pixels per page edge
+
+// Map a count to 0..255 on a log scale relative to the hottest page
+uint8_t intensity(uint64_t value, uint64_t max) {
+    if (value == 0 || max == 0) {
+        return 0;
+    }
+    double scaled = std::log1p(static_cast<double>(value)) / std::log1p(static_cast<double>(max));
+    return static_cast<uint8_t>(55 + 200 * scaled);
+}
+
+} // anonymous namespace
+
+MemoryProfile::MemoryProfile(uint32_t sample_rate)
+    : sample_rate_(sample_rate ? sample_rate : 1), countdown_(sample_rate_),
+      live_touched_(0), peak_touched_(0) {
+}
+
+void MemoryProfile::recordBulkWrite(uint32_t address, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    uint32_t first = address >> PAGE_SHIFT;
+    uint32_t last = static_cast<uint32_t>((address + size - 1) >> PAGE_SHIFT);
+    for (uint32_t page = first; page <= last && page < writes_.size(); page++) {
+        writes_[page]++;
+        touch(page);
+    }
+}
+
+void MemoryProfile::resize(uint32_t pages) {
+    // Memory never shrinks; keep counts for pages seen before
+    if (pages > reads_.size()) {
+        reads_.resize(pages, 0);
+        writes_.resize(pages, 0);
+        touched_.resize(pages, 0);
+    }
+}
+
+uint64_t MemoryProfile::totalReads() const {
+    uint64_t total = 0;
+    for (uint64_t count : reads_) {
+        total += count;
+    }
+    return total;
+}
+
+uint64_t MemoryProfile::totalWrites() const {
+    uint64_t total = 0;
+    for (uint64_t count : writes_) {
+        total += count;
+    }
+    return total;
+}
+
+void MemoryProfile::startWindow() {
+    std::fill(touched_.begin(), touched_.end(), 0);
+    live_touched_ = 0;
+}
+
+void MemoryProfile::reset() {
+    std::fill(reads_.begin(), reads_.end(), 0);
+    std::fill(writes_.begin(), writes_.end(), 0);
+    startWindow();
+    peak_touched_ = 0;
+    countdown_ = sample_rate_;
+}
+
+void MemoryProfile::write(std::ostream& out, HeatmapFormat format) const {
+    if (format == HeatmapFormat::PPM) {
+        writePpm(out);
+    } else {
+        writeCsv(out);
+    }
+}
+
+bool MemoryProfile::writeFile(const std::string& path, HeatmapFormat format) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        return false;
+    }
+    write(out, format);
+    return static_cast<bool>(out);
+}
+
+void MemoryProfile::writeCsv(std::ostream& out) const {
+    out << "# pages=" << pageCount() << " touched=" << touchedPages() << " peak_touched=" << peakTouchedPages()
+        << " sample_rate=" << sample_rate_ << "\n";
+    out << "page,reads,writes\n";
+    for (uint32_t page = 0; page < pageCount(); page++) {
+        out << page << "," << reads_[page] << "," << writes_[page] << "\n";
+    }
+}
+
+void MemoryProfile::writePpm(std::ostream& out) const {
+    uint32_t rows = std::max<uint32_t>(1, (pageCount() + PPM_PAGES_PER_ROW - 1) / PPM_PAGES_PER_ROW);
+    uint32_t width = PPM_PAGES_PER_ROW * PPM_CELL_SIZE;
+    uint32_t height = rows * PPM_CELL_SIZE;
+    uint64_t max_reads = reads_.empty() ? 0 : *std::max_element(reads_.begin(), reads_.end());
+    uint64_t max_writes = writes_.empty() ? 0 : *std::max_element(writes_.begin(), writes_.end());
+
+    out << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<uint8_t> line(width * 3);
+    for (uint32_t row = 0; row < rows; row++) {
+        for (uint32_t column = 0; column < PPM_PAGES_PER_ROW; column++) {
+            uint32_t page = row * PPM_PAGES_PER_ROW + column;
+            // Pages beyond the memory are drawn dark blue to mark the end
+            uint8_t red = page < pageCount() ? intensity(writes_[page], max_writes) : 0;
+            uint8_t green = page < pageCount() ? intensity(reads_[page], max_reads) : 0;
+            uint8_t blue = page < pageCount() ? 0 : 64;
+            for (uint32_t x = 0; x < PPM_CELL_SIZE; x++) {
+                uint8_t* pixel = &line[(column * PPM_CELL_SIZE + x) * 3];
+                pixel[0] = red;
+                pixel[1] = green;
+                pixel[2] = blue;
+            }
+        }
+        for (uint32_t y = 0; y < PPM_CELL_SIZE; y++) {
+            out.write(reinterpret_cast<const char*>(line.data()), static_cast<std::streamsize>(line.size()));
+        }
+    }
+}
+
+} // namespace wasm
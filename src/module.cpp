@@ -2,23 +2,81 @@
 
 namespace wasm {
 
-const FuncType* Module::getFunctionType(uint32_t func_index) const {
-    // Adjust for imports
-    uint32_t import_count = getImportedFunctionCount();
+void FunctionTable::reserve(size_t count) {
+    type_indices_.reserve(count);
+    bodies_.reserve(count);
+    body_sizes_.reserve(count);
+    locals_.reserve(count);
+    local_counts_.reserve(count);
+}
 
-    if (func_index < import_count) {
-        // Handle imported functions
-        // Import type lookup is handled in Interpreter::execute() where imports are routed
-        // WASI and other imported functions have their own type checking mechanisms
-        return nullptr;
+void FunctionTable::add(uint32_t type_index, ArrayView<ValueType> locals, ArrayView<uint8_t> body) {
+    type_indices_.push_back(type_index);
+    bodies_.push_back(body.data());
+    body_sizes_.push_back(static_cast<uint32_t>(body.size()));
+    locals_.push_back(locals.data());
+    local_counts_.push_back(static_cast<uint32_t>(locals.size()));
+}
+
+void Module::buildIndexSpaces() {
+    function_imports_.clear();
+    table_imports_.clear();
+    memory_imports_.clear();
+    global_imports_.clear();
+
+    // Imports occupy the low indices of each index space
+    for (uint32_t i = 0; i < imports.size(); i++) {
+        switch (imports[i].kind) {
+            case ExternalKind::FUNCTION:
+                function_imports_.push_back(i);
+                break;
+            case ExternalKind::TABLE:
+                table_imports_.push_back(i);
+                break;
+            case ExternalKind::MEMORY:
+                memory_imports_.push_back(i);
+                break;
+            case ExternalKind::GLOBAL:
+                global_imports_.push_back(i);
+                break;
+            case ExternalKind::TAG:
+                break;      // Rejected by the decoder
+        }
+    }
+
+    // Function index space: imported function types, then local function types
+    function_type_indices_.clear();
+    function_type_indices_.reserve(function_imports_.size() + function_types.size());
+    for (uint32_t import_index : function_imports_) {
+        function_type_indices_.push_back(imports[import_index].type_index);
+    }
+    function_type_indices_.insert(function_type_indices_.end(),
+                                  function_types.begin(), function_types.end());
+
+    // Export names are unique in a valid module; keep the first on duplicates
+    export_index_.clear();
+    export_index_.reserve(exports.size());
+    for (uint32_t i = 0; i < exports.size(); i++) {
+        export_index_.emplace(exports[i].name, i);
+    }
+
+    // Function names fall back to the first export of each function
+    function_exports_.assign(function_type_indices_.size(), NO_EXPORT);
+    for (uint32_t i = 0; i < exports.size(); i++) {
+        const Export& exp = exports[i];
+        if (exp.kind == ExternalKind::FUNCTION && exp.index < function_exports_.size() &&
+            function_exports_[exp.index] == NO_EXPORT) {
+            function_exports_[exp.index] = i;
+        }
     }
+}
 
-    uint32_t local_index = func_index - import_count;
-    if (local_index >= function_types.size()) {
+const FuncType* Module::getFunctionType(uint32_t func_index) const {
+    if (func_index >= function_type_indices_.size()) {
         return nullptr;
     }
 
-    uint32_t type_index = function_types[local_index];
+    uint32_t type_index = function_type_indices_[func_index];
     if (type_index >= types.size()) {
         return nullptr;
     }
@@ -26,27 +84,47 @@ const FuncType* Module::getFunctionType(uint32_t func_index) const {
     return &types[type_index];
 }
 
-const Export* Module::findExport(const std::string& name) const {
-    for (const auto& exp : exports) {
-        if (exp.name == name) {
-            return &exp;
-        }
+std::string Module::functionName(uint32_t func_index) const {
+    if (func_index < function_names.size() && !function_names[func_index].empty()) {
+        return std::string(function_names[func_index]);
     }
-    return nullptr;
+    if (func_index < function_exports_.size() && function_exports_[func_index] != NO_EXPORT) {
+        return std::string(exports[function_exports_[func_index]].name);
+    }
+    if (const Import* import = getImport(ExternalKind::FUNCTION, func_index)) {
+        return std::string(import->module_name) + "." + std::string(import->field_name);
+    }
+    return std::string();
 }
 
-uint32_t Module::getImportedFunctionCount() const {
-    uint32_t count = 0;
-    for (const auto& import : imports) {
-        if (import.kind == ExternalKind::FUNCTION) {
-            count++;
-        }
+const Export* Module::findExport(std::string_view name) const {
+    auto it = export_index_.find(name);
+    if (it == export_index_.end()) {
+        return nullptr;
+    }
+    return &exports[it->second];
+}
+
+const Import* Module::getImport(ExternalKind kind, uint32_t index) const {
+    const std::vector<uint32_t>& space = importsOfKind(kind);
+    if (index >= space.size()) {
+        return nullptr;
     }
-    return count;
+    return &imports[space[index]];
 }
 
-uint32_t Module::getTotalFunctionCount() const {
-    return getImportedFunctionCount() + static_cast<uint32_t>(functions.size());
+const std::vector<uint32_t>& Module::importsOfKind(ExternalKind kind) const {
+    switch (kind) {
+        case ExternalKind::TABLE:
+            return table_imports_;
+        case ExternalKind::MEMORY:
+            return memory_imports_;
+        case ExternalKind::GLOBAL:
+            return global_imports_;
+        case ExternalKind::FUNCTION:
+        default:
+            return function_imports_;
+    }
 }
 
 } // namespace wasm
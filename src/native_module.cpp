@@ -0,0 +1,93 @@
+#include "aot.h"
+#include <algorithm>
+#include <dlfcn.h>
+#include <link.h>
+
+namespace wasm {
+
+std::unique_ptr<NativeModule> NativeModule::load(const std::string& path) {
+    // dlopen only searches the library path for bare names
+    std::string resolved = path.find('/') == std::string::npos ? "./" + path : path;
+
+    void* handle = dlopen(resolved.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        const char* error = dlerror();
+        throw AotError("Cannot load native module: " + std::string(error ? error : path));
+    }
+
+    auto get_module = reinterpret_cast<wasm_rt_get_module_fn>(dlsym(handle, WASM_RT_MODULE_SYMBOL));
+    if (!get_module) {
+        dlclose(handle);
+        throw AotError("Not a compiled module (missing " WASM_RT_MODULE_SYMBOL "): " + path);
+    }
+
+    const wasm_rt_module* descriptor = get_module();
+    if (!descriptor || descriptor->abi_version != WASM_RT_ABI_VERSION) {
+        dlclose(handle);
+        throw AotError("Native module ABI version mismatch: " + path);
+    }
+
+    return std::unique_ptr<NativeModule>(new NativeModule(handle, descriptor));
+}
+
+namespace {
+
+struct SegmentSearch {
+    uintptr_t address;      // Address inside the wanted segment
+    uintptr_t end;          // End of that segment, 0 until found
+};
+
+int findExecutableSegment(struct dl_phdr_info* info, size_t /*size*/, void* data) {
+    SegmentSearch* search = static_cast<SegmentSearch*>(data);
+    for (ElfW(Half) i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr)& phdr = info->dlpi_phdr[i];
+        if (phdr.p_type != PT_LOAD || !(phdr.p_flags & PF_X)) {
+            continue;
+        }
+        uintptr_t start = info->dlpi_addr + phdr.p_vaddr;
+        if (search->address >= start && search->address < start + phdr.p_memsz) {
+            search->end = start + phdr.p_memsz;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+} // anonymous namespace
+
+std::vector<NativeCodeRange> NativeModule::codeRanges() const {
+    std::vector<NativeCodeRange> ranges;
+    std::vector<uintptr_t> boundaries;
+    for (uint32_t i = 0; i < descriptor_->function_count; i++) {
+        boundaries.push_back(reinterpret_cast<uintptr_t>(descriptor_->functions[i]));
+        if (descriptor_->invokers[i]) {
+            boundaries.push_back(reinterpret_cast<uintptr_t>(descriptor_->invokers[i]));
+        }
+    }
+    if (boundaries.empty()) {
+        return ranges;
+    }
+    std::sort(boundaries.begin(), boundaries.end());
+
+    SegmentSearch search{boundaries.back(), 0};
+    dl_iterate_phdr(&findExecutableSegment, &search);
+    boundaries.push_back(search.end ? search.end : boundaries.back());
+
+    for (uint32_t i = 0; i < descriptor_->function_count; i++) {
+        if (!descriptor_->invokers[i]) {
+            continue;
+        }
+        uintptr_t start = reinterpret_cast<uintptr_t>(descriptor_->functions[i]);
+        uintptr_t end = *std::upper_bound(boundaries.begin(), boundaries.end() - 1, start);
+        ranges.push_back({i, reinterpret_cast<const void*>(start), end - start});
+    }
+    return ranges;
+}
+
+NativeModule::~NativeModule() {
+    if (handle_) {
+        dlclose(handle_);
+    }
+}
+
+} // namespace wasm
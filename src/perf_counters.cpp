@@ -0,0 +1,217 @@
+#include "perf_counters.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace wasm {
+
+namespace {
+
+const FunctionCounters NO_COUNTS{};
+
+#ifdef __linux__
+struct EventConfig {
+    uint32_t type;
+    uint64_t config;
+};
+
+EventConfig eventConfig(Counter counter) {
+    switch (counter) {
+        case Counter::CYCLES: return {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES};
+        case Counter::INSTRUCTIONS: return {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS};
+        case Counter::BRANCH_MISSES: return {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES};
+        case Counter::L1D_MISSES:
+            return {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+        case Counter::LLC_MISSES: return {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES};
+        case Counter::DTLB_MISSES:
+            return {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+        default: return {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK};
+    }
+}
+
+int openCounter(Counter counter) {
+    EventConfig event = eventConfig(counter);
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+#endif
+
+std::string ratio(uint64_t numerator, uint64_t denominator) {
+    if (denominator == 0) {
+        return "-";
+    }
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << static_cast<double>(numerator) / static_cast<double>(denominator);
+    return out.str();
+}
+
+} // anonymous namespace
+
+const char* counterName(Counter counter) {
+    switch (counter) {
+        case Counter::CYCLES: return "cycles";
+        case Counter::INSTRUCTIONS: return "instructions";
+        case Counter::BRANCH_MISSES: return "branch-misses";
+        case Counter::L1D_MISSES: return "L1d-misses";
+        case Counter::LLC_MISSES: return "LLC-misses";
+        case Counter::DTLB_MISSES: return "dTLB-misses";
+        case Counter::TASK_CLOCK: return "task-clock-ns";
+        default: return "?";
+    }
+}
+
+// ===== PerfCounters =====
+
+PerfCounters::PerfCounters() : any_(false) {
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+#ifdef __linux__
+        fds_[i] = openCounter(static_cast<Counter>(i));
+        if (fds_[i] < 0 && error_.empty()) {
+            error_ = std::string(counterName(static_cast<Counter>(i))) + ": " + std::strerror(errno);
+        }
+#else
+        fds_[i] = -1;
+        error_ = "perf_event_open requires Linux";
+#endif
+        any_ = any_ || fds_[i] >= 0;
+    }
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (int fd : fds_) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+bool PerfCounters::available() const {
+    return any_;
+}
+
+CounterValues PerfCounters::read() const {
+    CounterValues result;
+#ifdef __linux__
+    if (!any_) {
+        return result;
+    }
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        if (fds_[i] < 0) {
+            continue;
+        }
+        uint64_t raw[3];    // value, time enabled, time running
+        if (::read(fds_[i], raw, sizeof(raw)) != static_cast<ssize_t>(sizeof(raw))) {
+            continue;
+        }
+        // Scale for the share of time the kernel multiplexed the counter in
+        if (raw[2] != 0 && raw[2] < raw[1]) {
+            raw[0] = static_cast<uint64_t>(static_cast<double>(raw[0]) * raw[1] / raw[2]);
+        }
+        result.values[i] = raw[0];
+    }
+#endif
+    return result;
+}
+
+// ===== CounterProfile =====
+
+void CounterProfile::enter(uint32_t /*func_index*/) {
+    active_.push_back({counters_.read(), CounterValues()});
+}
+
+void CounterProfile::leave(uint32_t func_index) {
+    CounterValues elapsed = counters_.read() - active_.back().start;
+    CounterValues callees = active_.back().callees;
+    active_.pop_back();
+
+    if (func_index >= functions_.size()) {
+        functions_.resize(func_index + 1);
+    }
+    FunctionCounters& function = functions_[func_index];
+    function.calls++;
+    function.inclusive += elapsed;
+    function.self += elapsed - callees;
+
+    if (!active_.empty()) {
+        active_.back().callees += elapsed;
+    } else {
+        last_call_ = elapsed;
+        total_ += elapsed;
+        invocations_++;
+    }
+}
+
+const FunctionCounters& CounterProfile::function(uint32_t func_index) const {
+    return func_index < functions_.size() ? functions_[func_index] : NO_COUNTS;
+}
+
+void CounterProfile::reset() {
+    functions_.clear();
+    active_.clear();
+    last_call_ = CounterValues();
+    total_ = CounterValues();
+    invocations_ = 0;
+}
+
+void CounterProfile::write(std::ostream& out) const {
+    if (!counters_.error().empty()) {
+        out << (counters_.available() ? "Some performance counters unavailable, shown as - ("
+                                      : "Performance counters unavailable (")
+            << counters_.error() << ")\n";
+    }
+
+    Counter key = counters_.available(Counter::CYCLES) ? Counter::CYCLES : Counter::TASK_CLOCK;
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < functions_.size(); i++) {
+        if (functions_[i].calls > 0) {
+            order.push_back(i);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return functions_[a].self[key] > functions_[b].self[key];
+    });
+
+    auto value = [&](const CounterValues& values, Counter counter) {
+        return counters_.available(counter) ? std::to_string(values[counter]) : std::string("-");
+    };
+    auto row = [&](const std::string& name, uint64_t calls, const CounterValues& values) {
+        out << std::left << std::setw(24) << name << std::right << std::setw(10) << calls;
+        for (Counter counter : {Counter::CYCLES, Counter::INSTRUCTIONS, Counter::BRANCH_MISSES,
+                                Counter::L1D_MISSES, Counter::LLC_MISSES, Counter::DTLB_MISSES, Counter::TASK_CLOCK}) {
+            out << std::setw(15) << value(values, counter);
+        }
+        out << std::setw(7) << ratio(values[Counter::INSTRUCTIONS], values[Counter::CYCLES]) << "\n";
+    };
+
+    out << std::left << std::setw(24) << "function (self)" << std::right << std::setw(10) << "calls";
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        out << std::setw(15) << counterName(static_cast<Counter>(i));
+    }
+    out << std::setw(7) << "IPC" << "\n";
+    for (uint32_t index : order) {
+        std::string name = index < names_.size() ? names_[index] : "func[" + std::to_string(index) + "]";
+        row(name, functions_[index].calls, functions_[index].self);
+    }
+    row("total", invocations_, total_);
+}
+
+} // namespace wasm
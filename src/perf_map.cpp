@@ -0,0 +1,195 @@
+#include "perf_map.h"
+#include <cstring>
+#include <ctime>
+#include <elf.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace wasm {
+
+namespace {
+
+// Jitdump format (tools/perf/Documentation/jitdump-specification.txt)
+constexpr uint32_t JITDUMP_MAGIC = 0x4A695444;     // "JiTD"
+constexpr uint32_t JITDUMP_VERSION = 1;
+constexpr uint32_t JIT_CODE_LOAD = 0;
+
+#if defined(__x86_64__)
+constexpr uint32_t JITDUMP_ELF_MACHINE = EM_X86_64;
+#elif defined(__aarch64__)
+constexpr uint32_t JITDUMP_ELF_MACHINE = EM_AARCH64;
+#else
+constexpr uint32_t JITDUMP_ELF_MACHINE = EM_NONE;
+#endif
+
+struct JitDumpHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;
+    uint32_t elf_mach;
+    uint32_t pad1;
+    uint32_t pid;
+    uint64_t timestamp;
+    uint64_t flags;
+};
+
+struct JitCodeLoad {
+    uint32_t id;
+    uint32_t total_size;
+    uint64_t timestamp;
+    uint32_t pid;
+    uint32_t tid;
+    uint64_t vma;
+    uint64_t code_addr;
+    uint64_t code_size;
+    uint64_t code_index;
+    // Followed by the NUL-terminated name and the code bytes
+};
+
+// perf record -k mono stamps samples with CLOCK_MONOTONIC
+uint64_t monotonicNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+} // anonymous namespace
+
+PerfMap& PerfMap::instance() {
+    static PerfMap perf_map;
+    return perf_map;
+}
+
+PerfMap::~PerfMap() {
+    if (dump_marker_) {
+        munmap(dump_marker_, static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+    }
+    if (dump_file_) {
+        std::fclose(dump_file_);
+    }
+    if (map_file_) {
+        std::fclose(map_file_);
+    }
+}
+
+bool PerfMap::enable(PerfFormat format) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (format == PerfFormat::JITDUMP) {
+        return dump_file_ || openJitDump();
+    }
+    if (!map_file_) {
+        // perf looks for exactly this path
+        std::string path = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+        map_file_ = std::fopen(path.c_str(), "a");
+    }
+    return map_file_ != nullptr;
+}
+
+bool PerfMap::openJitDump() {
+    std::string path = "/tmp/jit-" + std::to_string(getpid()) + ".dump";
+    FILE* file = std::fopen(path.c_str(), "w+");
+    if (!file) {
+        return false;
+    }
+
+    // perf record only notices the dump through an executable mapping of it
+    size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    void* marker = mmap(nullptr, page_size, PROT_READ | PROT_EXEC, MAP_PRIVATE, fileno(file), 0);
+    if (marker == MAP_FAILED) {
+        std::fclose(file);
+        return false;
+    }
+
+    JitDumpHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = JITDUMP_MAGIC;
+    header.version = JITDUMP_VERSION;
+    header.total_size = sizeof(header);
+    header.elf_mach = JITDUMP_ELF_MACHINE;
+    header.pid = static_cast<uint32_t>(getpid());
+    header.timestamp = monotonicNanos();
+    std::fwrite(&header, sizeof(header), 1, file);
+    std::fflush(file);
+
+    dump_file_ = file;
+    dump_marker_ = marker;
+    return true;
+}
+
+void PerfMap::addCode(const void* start, size_t size, const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (map_file_) {
+        std::fprintf(map_file_, "%lx %zx %s\n", static_cast<unsigned long>(reinterpret_cast<uintptr_t>(start)),
+                     size, name.c_str());
+        std::fflush(map_file_);
+    }
+    if (dump_file_) {
+        writeJitCodeLoad(start, size, name);
+    }
+}
+
+void PerfMap::writeJitCodeLoad(const void* start, size_t size, const std::string& name) {
+    JitCodeLoad record;
+    record.id = JIT_CODE_LOAD;
+    record.total_size = static_cast<uint32_t>(sizeof(record) + name.size() + 1 + size);
+    record.timestamp = monotonicNanos();
+    record.pid = static_cast<uint32_t>(getpid());
+    record.tid = static_cast<uint32_t>(syscall(SYS_gettid));
+    record.vma = reinterpret_cast<uintptr_t>(start);
+    record.code_addr = record.vma;
+    record.code_size = size;
+    record.code_index = code_index_++;
+
+    std::fwrite(&record, sizeof(record), 1, dump_file_);
+    std::fwrite(name.c_str(), name.size() + 1, 1, dump_file_);
+    std::fwrite(start, size, 1, dump_file_);
+    std::fflush(dump_file_);
+}
+
+PerfTrampolines::PerfTrampolines(uint32_t count, Entry target) {
+#if defined(__x86_64__)
+    size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t size = (static_cast<size_t>(count) * STUB_SIZE + page_size - 1) / page_size * page_size;
+    if (size == 0) {
+        return;
+    }
+    void* code = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        return;
+    }
+
+    // push rbp; mov rbp, rsp; movabs rax, target; call rax; pop rbp; ret
+    // Arguments pass through untouched in rdi/esi; the pushed frame keeps
+    // the stack 16-byte aligned at the call and links into the rbp chain.
+    uint64_t address = reinterpret_cast<uintptr_t>(target);
+    uint8_t stub[STUB_SIZE];
+    std::memset(stub, 0xCC, sizeof(stub));   // int3 padding
+    const uint8_t prologue[] = {0x55, 0x48, 0x89, 0xE5, 0x48, 0xB8};
+    const uint8_t epilogue[] = {0xFF, 0xD0, 0x5D, 0xC3};
+    std::memcpy(stub, prologue, sizeof(prologue));
+    std::memcpy(stub + sizeof(prologue), &address, sizeof(address));
+    std::memcpy(stub + sizeof(prologue) + sizeof(address), epilogue, sizeof(epilogue));
+
+    for (uint32_t i = 0; i < count; i++) {
+        std::memcpy(static_cast<uint8_t*>(code) + i * STUB_SIZE, stub, STUB_SIZE);
+    }
+    if (mprotect(code, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(code, size);
+        return;
+    }
+    code_ = code;
+    mapped_size_ = size;
+#else
+    (void)count;
+    (void)target;
+#endif
+}
+
+PerfTrampolines::~PerfTrampolines() {
+    if (code_) {
+        munmap(code_, mapped_size_);
+    }
+}
+
+} // namespace wasm
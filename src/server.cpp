@@ -0,0 +1,599 @@
+#include "server.h"
+#include "decoder.h"
+#include "memory.h"
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace wasm {
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;    // A vanished peer is an error, not SIGPIPE
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+// ===== Payload encoding =====
+
+void putU8(protocol::Bytes& out, uint8_t value) {
+    out.push_back(value);
+}
+
+void putU32(protocol::Bytes& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void putU64(protocol::Bytes& out, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void putBytes(protocol::Bytes& out, const uint8_t* data, size_t size) {
+    putU32(out, static_cast<uint32_t>(size));
+    out.insert(out.end(), data, data + size);
+}
+
+void putString(protocol::Bytes& out, const std::string& text) {
+    putBytes(out, reinterpret_cast<const uint8_t*>(text.data()), text.size());
+}
+
+void putValues(protocol::Bytes& out, const std::vector<TypedValue>& values) {
+    putU32(out, static_cast<uint32_t>(values.size()));
+    for (const TypedValue& value : values) {
+        uint64_t bits = 0;
+        switch (value.type) {
+            case ValueType::I32: bits = static_cast<uint32_t>(value.value.i32); break;
+            case ValueType::I64: bits = static_cast<uint64_t>(value.value.i64); break;
+            case ValueType::F32: {
+                uint32_t f32_bits;
+                std::memcpy(&f32_bits, &value.value.f32, sizeof(f32_bits));
+                bits = f32_bits;
+                break;
+            }
+            case ValueType::F64: std::memcpy(&bits, &value.value.f64, sizeof(bits)); break;
+            default: throw ServerError("Cannot encode a value of this type");
+        }
+        putU8(out, static_cast<uint8_t>(value.type));
+        putU64(out, bits);
+    }
+}
+
+// Reads a payload front to back; every read is bounds checked
+class PayloadReader {
+public:
+    explicit PayloadReader(const protocol::Bytes& payload) : payload_(payload), position_(0) {}
+
+    uint8_t u8() {
+        need(1);
+        return payload_[position_++];
+    }
+
+    uint32_t u32() {
+        need(4);
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= static_cast<uint32_t>(payload_[position_++]) << (8 * i);
+        }
+        return value;
+    }
+
+    uint64_t u64() {
+        need(8);
+        uint64_t value = 0;
+        for (int i = 0; i < 8; i++) {
+            value |= static_cast<uint64_t>(payload_[position_++]) << (8 * i);
+        }
+        return value;
+    }
+
+    std::vector<uint8_t> bytes() {
+        uint32_t size = u32();
+        need(size);
+        std::vector<uint8_t> out(payload_.begin() + position_, payload_.begin() + position_ + size);
+        position_ += size;
+        return out;
+    }
+
+    std::string string() {
+        std::vector<uint8_t> data = bytes();
+        return std::string(data.begin(), data.end());
+    }
+
+    std::vector<TypedValue> values() {
+        uint32_t count = u32();
+        need(static_cast<size_t>(count) * 9);
+        std::vector<TypedValue> out;
+        out.reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            ValueType type = static_cast<ValueType>(u8());
+            uint64_t bits = u64();
+            switch (type) {
+                case ValueType::I32:
+                    out.push_back(TypedValue::makeI32(static_cast<int32_t>(static_cast<uint32_t>(bits))));
+                    break;
+                case ValueType::I64:
+                    out.push_back(TypedValue::makeI64(static_cast<int64_t>(bits)));
+                    break;
+                case ValueType::F32: {
+                    uint32_t f32_bits = static_cast<uint32_t>(bits);
+                    float value;
+                    std::memcpy(&value, &f32_bits, sizeof(value));
+                    out.push_back(TypedValue::makeF32(value));
+                    break;
+                }
+                case ValueType::F64: {
+                    double value;
+                    std::memcpy(&value, &bits, sizeof(value));
+                    out.push_back(TypedValue::makeF64(value));
+                    break;
+                }
+                default:
+                    throw ServerError("Invalid value type in message");
+            }
+        }
+        return out;
+    }
+
+private:
+    void need(size_t size) const {
+        if (size > payload_.size() - position_) {
+            throw ServerError("Truncated message");
+        }
+    }
+
+    const protocol::Bytes& payload_;
+    size_t position_;
+};
+
+protocol::Bytes errorResponse(const std::string& message) {
+    protocol::Bytes out;
+    putU8(out, static_cast<uint8_t>(protocol::Status::ERROR));
+    putString(out, message);
+    return out;
+}
+
+// Reads exactly size bytes; returns how many arrived before end of stream
+size_t readFully(int fd, uint8_t* data, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::read(fd, data + done, size - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            throw ServerError(std::string("read failed: ") + std::strerror(errno));
+        }
+        if (n == 0) {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return done;
+}
+
+sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw ServerError("Socket path too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+} // anonymous namespace
+
+// ===== Protocol =====
+
+namespace protocol {
+
+Bytes encodeInvoke(const InvokeRequest& request) {
+    Bytes out;
+    putU8(out, static_cast<uint8_t>(RequestKind::INVOKE));
+    putU32(out, request.module_id);
+    putString(out, request.function_name);
+    putValues(out, request.args);
+    putU32(out, request.memory_offset);
+    putBytes(out, request.memory.data(), request.memory.size());
+    putU32(out, request.read_offset);
+    putU32(out, request.read_length);
+    return out;
+}
+
+Bytes encodeLoad(const std::string& path) {
+    Bytes out;
+    putU8(out, static_cast<uint8_t>(RequestKind::LOAD));
+    putString(out, path);
+    return out;
+}
+
+Bytes encodeShutdown() {
+    return Bytes{static_cast<uint8_t>(RequestKind::SHUTDOWN)};
+}
+
+bool readFrame(int fd, Bytes& payload) {
+    uint8_t header[4];
+    size_t got = readFully(fd, header, sizeof(header));
+    if (got == 0) {
+        return false;
+    }
+    if (got < sizeof(header)) {
+        throw ServerError("Truncated frame header");
+    }
+    uint32_t size = static_cast<uint32_t>(header[0]) | static_cast<uint32_t>(header[1]) << 8 |
+                    static_cast<uint32_t>(header[2]) << 16 | static_cast<uint32_t>(header[3]) << 24;
+    if (size > MAX_FRAME_SIZE) {
+        throw ServerError("Frame of " + std::to_string(size) + " bytes exceeds the limit");
+    }
+    payload.resize(size);
+    if (readFully(fd, payload.data(), size) < size) {
+        throw ServerError("Truncated frame");
+    }
+    return true;
+}
+
+void writeFrame(int fd, const Bytes& payload) {
+    if (payload.size() > MAX_FRAME_SIZE) {
+        throw ServerError("Frame of " + std::to_string(payload.size()) + " bytes exceeds the limit");
+    }
+    Bytes frame;
+    frame.reserve(payload.size() + 4);
+    putU32(frame, static_cast<uint32_t>(payload.size()));
+    frame.insert(frame.end(), payload.begin(), payload.end());
+
+    size_t done = 0;
+    while (done < frame.size()) {
+        ssize_t n = ::send(fd, frame.data() + done, frame.size() - done, SEND_FLAGS);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            throw ServerError(std::string("write failed: ") + std::strerror(errno));
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+} // namespace protocol
+
+// ===== InstancePool =====
+
+InstancePool::InstancePool(std::vector<uint8_t> bytes, size_t max_instances)
+    : bytes_(std::move(bytes)), max_instances_(max_instances > 0 ? max_instances : 1) {
+    idle_.push_back(create());
+    created_ = 1;
+}
+
+InstancePool::InstancePool(std::string path, size_t max_instances)
+    : path_(std::move(path)), max_instances_(max_instances > 0 ? max_instances : 1) {
+    idle_.push_back(create());
+    created_ = 1;
+}
+
+std::unique_ptr<Interpreter> InstancePool::create() const {
+    Decoder decoder;
+    auto instance = std::make_unique<Interpreter>();
+    instance->instantiate(path_.empty() ? decoder.parseBytes(bytes_) : decoder.parse(path_));
+    instance->takeSnapshot();
+    return instance;
+}
+
+std::unique_ptr<Interpreter> InstancePool::acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    available_.wait(lock, [this] { return !idle_.empty() || created_ < max_instances_; });
+    if (!idle_.empty()) {
+        std::unique_ptr<Interpreter> instance = std::move(idle_.back());
+        idle_.pop_back();
+        return instance;
+    }
+    created_++;
+    lock.unlock();
+
+    // Decode outside the lock so other requests keep being served
+    try {
+        return create();
+    } catch (...) {
+        lock.lock();
+        created_--;
+        available_.notify_one();
+        throw;
+    }
+}
+
+void InstancePool::release(std::unique_ptr<Interpreter> instance) noexcept {
+    try {
+        instance->restoreSnapshot();
+    } catch (...) {
+        // An instance that cannot be reset is dropped; its slot is freed so
+        // the next acquire() creates a fresh one
+        instance.reset();
+        std::lock_guard<std::mutex> lock(mutex_);
+        created_--;
+        available_.notify_one();
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.push_back(std::move(instance));
+    available_.notify_one();
+}
+
+size_t InstancePool::instances() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return created_;
+}
+
+// ===== Server =====
+
+Server::Server(size_t pool_size) : pool_size_(pool_size) {}
+
+Server::~Server() {
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        unlink(socket_path_.c_str());
+    }
+}
+
+uint32_t Server::addModule(std::vector<uint8_t> bytes) {
+    return addPool(std::make_unique<InstancePool>(std::move(bytes), pool_size_));
+}
+
+uint32_t Server::loadModule(const std::string& path) {
+    return addPool(std::make_unique<InstancePool>(path, pool_size_));
+}
+
+uint32_t Server::addPool(std::unique_ptr<InstancePool> pool) {
+    std::lock_guard<std::mutex> lock(modules_mutex_);
+    modules_.push_back(std::move(pool));
+    return static_cast<uint32_t>(modules_.size() - 1);
+}
+
+InstancePool& Server::pool(uint32_t module_id) {
+    std::lock_guard<std::mutex> lock(modules_mutex_);
+    if (module_id >= modules_.size()) {
+        throw ServerError("Unknown module id " + std::to_string(module_id));
+    }
+    return *modules_[module_id];
+}
+
+void Server::listen(const std::string& socket_path) {
+    sockaddr_un address = socketAddress(socket_path);
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        throw ServerError(std::string("socket failed: ") + std::strerror(errno));
+    }
+    unlink(socket_path.c_str());
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listen_fd_, SOMAXCONN) != 0) {
+        std::string error = std::strerror(errno);
+        close(listen_fd_);
+        listen_fd_ = -1;
+        throw ServerError("Cannot listen on " + socket_path + ": " + error);
+    }
+    socket_path_ = socket_path;
+}
+
+void Server::serve() {
+    if (listen_fd_ < 0) {
+        throw ServerError("serve() called before listen()");
+    }
+
+    while (!stopping_.load()) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (stopping_.load()) {
+                break;
+            }
+            throw ServerError(std::string("accept failed: ") + std::strerror(errno));
+        }
+
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        if (stopping_.load()) {
+            close(fd);
+            break;
+        }
+        connection_fds_.push_back(fd);
+        std::thread(&Server::serveConnection, this, fd).detach();
+    }
+
+    // Wake connection threads blocked in read and wait for them to finish
+    std::unique_lock<std::mutex> lock(connections_mutex_);
+    for (int fd : connection_fds_) {
+        ::shutdown(fd, SHUT_RDWR);
+    }
+    connections_done_.wait(lock, [this] { return connection_fds_.empty(); });
+
+    close(listen_fd_);
+    listen_fd_ = -1;
+    unlink(socket_path_.c_str());
+}
+
+void Server::stop() {
+    stopping_.store(true);
+    // Makes a blocked accept() return
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    if (listen_fd_ >= 0) {
+        ::shutdown(listen_fd_, SHUT_RDWR);
+    }
+}
+
+void Server::serveConnection(int fd) {
+    try {
+        protocol::Bytes request;
+        while (protocol::readFrame(fd, request)) {
+            protocol::writeFrame(fd, handle(request));
+            // Stop only once the client has its answer
+            if (!request.empty() && request[0] == static_cast<uint8_t>(protocol::RequestKind::SHUTDOWN)) {
+                stop();
+            }
+        }
+    } catch (const ServerError&) {
+        // Broken or misbehaving client; drop the connection
+    }
+
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    for (size_t i = 0; i < connection_fds_.size(); i++) {
+        if (connection_fds_[i] == fd) {
+            connection_fds_.erase(connection_fds_.begin() + i);
+            break;
+        }
+    }
+    close(fd);
+    connections_done_.notify_all();
+}
+
+protocol::Bytes Server::handle(const protocol::Bytes& request) {
+    try {
+        PayloadReader reader(request);
+        protocol::Bytes out;
+        switch (static_cast<protocol::RequestKind>(reader.u8())) {
+            case protocol::RequestKind::INVOKE: {
+                protocol::InvokeRequest invoke_request;
+                invoke_request.module_id = reader.u32();
+                invoke_request.function_name = reader.string();
+                invoke_request.args = reader.values();
+                invoke_request.memory_offset = reader.u32();
+                invoke_request.memory = reader.bytes();
+                invoke_request.read_offset = reader.u32();
+                invoke_request.read_length = reader.u32();
+
+                protocol::InvokeResponse response = invoke(invoke_request);
+                putU8(out, static_cast<uint8_t>(protocol::Status::OK));
+                putValues(out, response.results);
+                putBytes(out, response.memory.data(), response.memory.size());
+                return out;
+            }
+            case protocol::RequestKind::LOAD: {
+                uint32_t module_id = loadModule(reader.string());
+                putU8(out, static_cast<uint8_t>(protocol::Status::OK));
+                putU32(out, module_id);
+                return out;
+            }
+            case protocol::RequestKind::SHUTDOWN:
+                putU8(out, static_cast<uint8_t>(protocol::Status::OK));
+                return out;
+            default:
+                return errorResponse("Unknown request kind");
+        }
+    } catch (const std::exception& e) {
+        return errorResponse(e.what());
+    }
+}
+
+protocol::InvokeResponse Server::invoke(const protocol::InvokeRequest& request) {
+    InstancePool& instances = pool(request.module_id);
+
+    // Returns the instance to the pool, reset, however the call ends
+    struct Lease {
+        InstancePool& pool;
+        std::unique_ptr<Interpreter> instance;
+        ~Lease() { pool.release(std::move(instance)); }
+    } lease{instances, instances.acquire()};
+    Interpreter& instance = *lease.instance;
+
+    auto checkRange = [&](uint32_t offset, size_t size) {
+        const Memory* memory = instance.memory();
+        if (size == 0) {
+            return;
+        }
+        if (!memory || static_cast<uint64_t>(offset) + size > memory->sizeInBytes()) {
+            throw ServerError("Memory payload out of bounds");
+        }
+    };
+
+    checkRange(request.memory_offset, request.memory.size());
+    if (!request.memory.empty()) {
+        instance.memory()->initialize(request.memory_offset, request.memory.data(), request.memory.size());
+    }
+
+    protocol::InvokeResponse response;
+    instance.call(request.function_name, request.args, response.results);
+
+    checkRange(request.read_offset, request.read_length);
+    if (request.read_length > 0) {
+        const uint8_t* data = instance.memory()->data() + request.read_offset;
+        response.memory.assign(data, data + request.read_length);
+    }
+    return response;
+}
+
+// ===== Client =====
+
+Client::Client(const std::string& socket_path) {
+    sockaddr_un address = socketAddress(socket_path);
+    fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        throw ServerError(std::string("socket failed: ") + std::strerror(errno));
+    }
+    if (connect(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::string error = std::strerror(errno);
+        close(fd_);
+        throw ServerError("Cannot connect to " + socket_path + ": " + error);
+    }
+}
+
+Client::~Client() {
+    close(fd_);
+}
+
+protocol::Bytes Client::roundTrip(const protocol::Bytes& request) {
+    protocol::writeFrame(fd_, request);
+    protocol::Bytes response;
+    if (!protocol::readFrame(fd_, response)) {
+        throw ServerError("Connection closed by server");
+    }
+    if (response.empty()) {
+        throw ServerError("Empty response");
+    }
+    if (response[0] != static_cast<uint8_t>(protocol::Status::OK)) {
+        PayloadReader reader(response);
+        reader.u8();
+        // The message already carries its own prefix (Trap:, Interpreter error:, ...)
+        throw std::runtime_error(reader.string());
+    }
+    return response;
+}
+
+protocol::InvokeResponse Client::invoke(const protocol::InvokeRequest& request) {
+    protocol::Bytes payload = roundTrip(protocol::encodeInvoke(request));
+    PayloadReader reader(payload);
+    reader.u8();
+    protocol::InvokeResponse response;
+    response.results = reader.values();
+    response.memory = reader.bytes();
+    return response;
+}
+
+std::vector<TypedValue> Client::call(uint32_t module_id, const std::string& function_name,
+                                     const std::vector<TypedValue>& args) {
+    protocol::InvokeRequest request;
+    request.module_id = module_id;
+    request.function_name = function_name;
+    request.args = args;
+    return invoke(request).results;
+}
+
+uint32_t Client::load(const std::string& path) {
+    protocol::Bytes payload = roundTrip(protocol::encodeLoad(path));
+    PayloadReader reader(payload);
+    reader.u8();
+    return reader.u32();
+}
+
+void Client::shutdown() {
+    roundTrip(protocol::encodeShutdown());
+}
+
+} // namespace wasm
@@ -1,6 +1,7 @@
 #include "stack.h"
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 
 namespace wasm {
 
@@ -22,6 +23,10 @@ void Stack::pushF64(double value) {
     stack_.push_back(TypedValue::makeF64(value));
 }
 
+void Stack::pushRef(uint64_t ref) {
+    stack_.push_back(TypedValue::makeRef(ref));
+}
+
 void Stack::push(const TypedValue& value) {
     stack_.push_back(value);
 }
@@ -58,6 +63,14 @@ double Stack::popF64() {
     return val.value.f64;
 }
 
+uint64_t Stack::popRef() {
+    checkNotEmpty();
+    checkType(ValueType::ANYREF);
+    TypedValue val = stack_.back();
+    stack_.pop_back();
+    return val.value.ref;
+}
+
 TypedValue Stack::pop() {
     checkNotEmpty();
     TypedValue val = stack_.back();
@@ -99,6 +112,28 @@ const TypedValue& Stack::peek(size_t depth) const {
     return stack_[stack_.size() - 1 - depth];
 }
 
+void Stack::unwind(size_t height, size_t keep) {
+    size_t target = height + keep;
+    if (stack_.size() <= target) {
+        return;
+    }
+
+    if (keep > 0) {
+        std::copy(stack_.end() - static_cast<std::ptrdiff_t>(keep), stack_.end(),
+                  stack_.begin() + static_cast<std::ptrdiff_t>(height));
+    }
+    stack_.resize(target);
+}
+
+void Stack::transfer(Stack& to, size_t count) {
+    if (count > stack_.size()) {
+        throw StackError("Stack underflow");
+    }
+    auto first = stack_.end() - static_cast<std::ptrdiff_t>(count);
+    to.stack_.insert(to.stack_.end(), first, stack_.end());
+    stack_.erase(first, stack_.end());
+}
+
 void Stack::checkNotEmpty() const {
     if (stack_.empty()) {
         throw StackError("Stack underflow");
@@ -0,0 +1,28 @@
+#include "store.h"
+
+namespace wasm {
+
+Interpreter& Store::instantiate(const std::string& name, Module&& module) {
+    if (names_.count(name) != 0) {
+        throw LinkError("Instance name already in use: " + name);
+    }
+
+    // A failed link or start function leaves nothing registered
+    auto instance = std::make_unique<Interpreter>();
+    instance->instantiate(std::move(module), [this](const Import& import) {
+        auto it = names_.find(std::string(import.module_name));
+        return it == names_.end() ? nullptr : it->second;
+    });
+
+    Interpreter& registered = *instance;
+    instances_.push_back(std::move(instance));
+    names_[name] = &registered;
+    return registered;
+}
+
+Interpreter* Store::instance(const std::string& name) {
+    auto it = names_.find(name);
+    return it == names_.end() ? nullptr : it->second;
+}
+
+} // namespace wasm
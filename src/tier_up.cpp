@@ -0,0 +1,119 @@
+#include "tier_up.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+namespace wasm {
+
+TierUpOptions::TierUpOptions() : hot_threshold(1000) {
+    compiler.optimize = true;
+    const char* tmpdir = std::getenv("TMPDIR");
+    work_dir = (tmpdir && *tmpdir) ? tmpdir : "/tmp";
+}
+
+TierUpCompiler::TierUpCompiler(const Module& module, TierUpOptions options)
+    : module_(module), options_(std::move(options)),
+      hot_(module.getTotalFunctionCount(), false),
+      pending_(false), busy_(false), stop_(false), failed_(false), generation_(0),
+      ready_flag_(false) {
+    worker_ = std::thread(&TierUpCompiler::run, this);
+}
+
+TierUpCompiler::~TierUpCompiler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+}
+
+void TierUpCompiler::request(uint32_t func_index) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (failed_ || func_index >= hot_.size() || hot_[func_index]) {
+            return;
+        }
+        hot_[func_index] = true;
+        pending_ = true;
+    }
+    cv_.notify_all();
+}
+
+std::unique_ptr<NativeModule> TierUpCompiler::takeReady() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ready_flag_.store(false, std::memory_order_release);
+    return std::move(ready_);
+}
+
+void TierUpCompiler::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return failed_ || (!pending_ && !busy_); });
+}
+
+std::string TierUpCompiler::lastError() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+}
+
+void TierUpCompiler::run() {
+    AotCompiler compiler(options_.compiler);
+
+    // Shared objects are built and loaded from a directory only this user
+    // can enter, so nobody else can plant code where they are dlopened
+    std::string build_dir = options_.work_dir + "/wasm-tier-XXXXXX";
+    bool have_dir = mkdtemp(&build_dir[0]) != nullptr;
+    std::string dir_error = have_dir ? "" : "Cannot create build directory in " + options_.work_dir + ": " +
+                                                std::strerror(errno);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return stop_ || pending_; });
+        if (stop_) {
+            if (have_dir) {
+                rmdir(build_dir.c_str());
+            }
+            return;
+        }
+        if (!have_dir) {
+            pending_ = false;
+            failed_ = true;
+            error_ = dir_error;
+            cv_.notify_all();
+            continue;
+        }
+
+        // Requests arriving during the compile are batched into the next one
+        std::vector<bool> selected = hot_;
+        pending_ = false;
+        busy_ = true;
+        std::string path = build_dir + "/" + std::to_string(generation_++) + ".so";
+        lock.unlock();
+
+        std::unique_ptr<NativeModule> native;
+        std::string error;
+        try {
+            compiler.compile(module_, path, selected);
+            native = NativeModule::load(path);
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        // The mapping stays valid after the file is unlinked
+        std::remove(path.c_str());
+
+        lock.lock();
+        busy_ = false;
+        if (native) {
+            ready_ = std::move(native);
+            ready_flag_.store(true, std::memory_order_release);
+        } else {
+            failed_ = true;
+            error_ = error;
+        }
+        cv_.notify_all();
+    }
+}
+
+} // namespace wasm
@@ -0,0 +1,309 @@
+#include "tracer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace wasm {
+
+namespace {
+
+std::atomic<uint64_t> next_tracer_id{1};
+
+const char* categoryName(TraceEventKind kind) {
+    switch (kind) {
+        case TraceEventKind::CALL: return "call";
+        case TraceEventKind::HOST_CALL: return "host";
+        case TraceEventKind::MEMORY_GROW: return "memory";
+        default: return "trap";
+    }
+}
+
+std::string jsonString(const std::string& text) {
+    std::string result = "\"";
+    for (char ch : text) {
+        unsigned char c = static_cast<unsigned char>(ch);
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += ch;
+        } else if (c < 0x20) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            result += buffer;
+        } else {
+            result += ch;
+        }
+    }
+    return result + "\"";
+}
+
+// Microseconds with nanosecond precision, as the trace-event format expects
+std::string micros(uint64_t ns) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%llu.%03llu", static_cast<unsigned long long>(ns / 1000),
+                  static_cast<unsigned long long>(ns % 1000));
+    return buffer;
+}
+
+// ===== Minimal protobuf encoding for Perfetto traces =====
+
+// Field numbers from perfetto/trace/trace_packet.proto and track_event/*.proto
+constexpr uint32_t TRACE_PACKET = 1;
+constexpr uint32_t PACKET_TIMESTAMP = 8;
+constexpr uint32_t PACKET_SEQUENCE_ID = 10;
+constexpr uint32_t PACKET_TRACK_EVENT = 11;
+constexpr uint32_t PACKET_CLOCK_ID = 58;
+constexpr uint32_t PACKET_TRACK_DESCRIPTOR = 60;
+constexpr uint32_t DESCRIPTOR_UUID = 1;
+constexpr uint32_t DESCRIPTOR_THREAD = 4;
+constexpr uint32_t THREAD_PID = 1;
+constexpr uint32_t THREAD_TID = 2;
+constexpr uint32_t EVENT_TYPE = 9;
+constexpr uint32_t EVENT_TRACK_UUID = 11;
+constexpr uint32_t EVENT_CATEGORIES = 22;
+constexpr uint32_t EVENT_NAME = 23;
+constexpr uint64_t TYPE_SLICE_BEGIN = 1;
+constexpr uint64_t TYPE_SLICE_END = 2;
+constexpr uint64_t TYPE_INSTANT = 3;
+constexpr uint64_t CLOCK_MONOTONIC_ID = 3;
+constexpr uint32_t SEQUENCE_ID = 1;
+
+class ProtoWriter {
+public:
+    void varint(uint64_t value) {
+        while (value >= 0x80) {
+            bytes_ += static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        bytes_ += static_cast<char>(value);
+    }
+
+    void field(uint32_t number, uint64_t value) {
+        varint(static_cast<uint64_t>(number) << 3);
+        varint(value);
+    }
+
+    void field(uint32_t number, const std::string& value) {
+        varint((static_cast<uint64_t>(number) << 3) | 2);
+        varint(value.size());
+        bytes_ += value;
+    }
+
+    void field(uint32_t number, const ProtoWriter& message) { field(number, message.bytes_); }
+
+    const std::string& bytes() const { return bytes_; }
+
+private:
+    std::string bytes_;
+};
+
+} // anonymous namespace
+
+Tracer::Tracer(TracerOptions options)
+    : options_(options), id_(next_tracer_id.fetch_add(1)) {
+    if (options_.buffer_capacity == 0) {
+        options_.buffer_capacity = 1;
+    }
+}
+
+Tracer::~Tracer() = default;
+
+uint64_t Tracer::now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint32_t Tracer::intern(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find(names_.begin(), names_.end(), name);
+    if (it != names_.end()) {
+        return static_cast<uint32_t>(it - names_.begin());
+    }
+    names_.push_back(name);
+    return static_cast<uint32_t>(names_.size() - 1);
+}
+
+Tracer::ThreadBuffer& Tracer::threadBuffer() {
+    // Cache the calling thread's buffer; the id guards against a new tracer
+    // reusing a destroyed one's address
+    struct Cache {
+        uint64_t tracer_id = 0;
+        ThreadBuffer* buffer = nullptr;
+    };
+    thread_local Cache cache;
+    if (cache.tracer_id == id_) {
+        return *cache.buffer;
+    }
+
+    uint32_t tid = static_cast<uint32_t>(syscall(SYS_gettid));
+    std::lock_guard<std::mutex> lock(mutex_);
+    ThreadBuffer* buffer = nullptr;
+    for (const auto& existing : buffers_) {
+        if (existing->tid == tid) {
+            buffer = existing.get();
+        }
+    }
+    if (!buffer) {
+        buffers_.push_back(std::make_unique<ThreadBuffer>(tid, options_.buffer_capacity));
+        buffer = buffers_.back().get();
+    }
+    cache.tracer_id = id_;
+    cache.buffer = buffer;
+    return *buffer;
+}
+
+void Tracer::push(const TraceEvent& event) {
+    ThreadBuffer& buffer = threadBuffer();
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    if (head - buffer.tail.load(std::memory_order_acquire) >= buffer.slots.size()) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.slots[head % buffer.slots.size()] = event;
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::complete(TraceEventKind kind, uint32_t name, uint32_t depth, uint64_t start_ns) {
+    uint64_t duration = now() - start_ns;
+    bool is_call = kind == TraceEventKind::CALL || kind == TraceEventKind::HOST_CALL;
+    if (is_call && duration < options_.min_duration_ns) {
+        return;
+    }
+    push(TraceEvent{start_ns, duration, name, depth, kind});
+}
+
+void Tracer::instant(TraceEventKind kind, uint32_t name, uint32_t depth) {
+    push(TraceEvent{now(), 0, name, depth, kind});
+}
+
+uint64_t Tracer::dropped() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t total = 0;
+    for (const auto& buffer : buffers_) {
+        total += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::vector<Tracer::ThreadEvents> Tracer::drain() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<ThreadEvents> threads;
+    for (const auto& buffer : buffers_) {
+        uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        ThreadEvents thread{buffer->tid, {}};
+        thread.events.reserve(static_cast<size_t>(head - tail));
+        for (uint64_t i = tail; i < head; i++) {
+            thread.events.push_back(buffer->slots[i % buffer->slots.size()]);
+        }
+        buffer->tail.store(head, std::memory_order_release);
+        threads.push_back(std::move(thread));
+    }
+    return threads;
+}
+
+void Tracer::write(std::ostream& out, TraceFormat format) {
+    std::vector<ThreadEvents> threads = drain();
+    if (format == TraceFormat::PERFETTO) {
+        writePerfetto(out, threads);
+    } else {
+        writeChromeJson(out, threads);
+    }
+}
+
+bool Tracer::writeFile(const std::string& path, TraceFormat format) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        return false;
+    }
+    write(out, format);
+    return static_cast<bool>(out);
+}
+
+void Tracer::writeChromeJson(std::ostream& out, const std::vector<ThreadEvents>& threads) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string pid = std::to_string(getpid());
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& thread : threads) {
+        for (const auto& event : thread.events) {
+            out << (first ? "\n" : ",\n");
+            first = false;
+            out << "{\"name\":" << jsonString(names_[event.name])
+                << ",\"cat\":\"" << categoryName(event.kind) << "\""
+                << ",\"ts\":" << micros(event.start_ns);
+            if (event.kind == TraceEventKind::TRAP) {
+                out << ",\"ph\":\"i\",\"s\":\"t\"";
+            } else {
+                out << ",\"ph\":\"X\",\"dur\":" << micros(event.duration_ns);
+            }
+            out << ",\"pid\":" << pid << ",\"tid\":" << thread.tid << "}";
+        }
+    }
+    out << "\n]}\n";
+}
+
+void Tracer::writePerfetto(std::ostream& out, const std::vector<ThreadEvents>& threads) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ProtoWriter trace;
+
+    for (const auto& thread : threads) {
+        uint64_t track = thread.tid;
+
+        ProtoWriter thread_descriptor;
+        thread_descriptor.field(THREAD_PID, static_cast<uint64_t>(getpid()));
+        thread_descriptor.field(THREAD_TID, thread.tid);
+        ProtoWriter descriptor;
+        descriptor.field(DESCRIPTOR_UUID, track);
+        descriptor.field(DESCRIPTOR_THREAD, thread_descriptor);
+        ProtoWriter descriptor_packet;
+        descriptor_packet.field(PACKET_TRACK_DESCRIPTOR, descriptor);
+        descriptor_packet.field(PACKET_SEQUENCE_ID, SEQUENCE_ID);
+        trace.field(TRACE_PACKET, descriptor_packet);
+
+        // Spans become begin/end pairs that must be in timestamp order and
+        // properly nested: at equal times, ends (innermost first) precede
+        // begins (outermost first)
+        struct Edge {
+            uint64_t ts;
+            uint64_t type;
+            int64_t order;
+            const TraceEvent* event;
+        };
+        std::vector<Edge> edges;
+        for (const auto& event : thread.events) {
+            if (event.kind == TraceEventKind::TRAP) {
+                edges.push_back({event.start_ns, TYPE_INSTANT, event.depth, &event});
+            } else {
+                edges.push_back({event.start_ns, TYPE_SLICE_BEGIN, event.depth, &event});
+                edges.push_back({event.start_ns + event.duration_ns, TYPE_SLICE_END,
+                                 -static_cast<int64_t>(event.depth) - (INT32_MAX + 1LL), &event});
+            }
+        }
+        std::stable_sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+            return a.ts != b.ts ? a.ts < b.ts : a.order < b.order;
+        });
+
+        for (const auto& edge : edges) {
+            ProtoWriter event;
+            event.field(EVENT_TYPE, edge.type);
+            event.field(EVENT_TRACK_UUID, track);
+            if (edge.type != TYPE_SLICE_END) {
+                event.field(EVENT_CATEGORIES, std::string(categoryName(edge.event->kind)));
+                event.field(EVENT_NAME, names_[edge.event->name]);
+            }
+            ProtoWriter packet;
+            packet.field(PACKET_TIMESTAMP, edge.ts);
+            packet.field(PACKET_CLOCK_ID, CLOCK_MONOTONIC_ID);
+            packet.field(PACKET_TRACK_EVENT, event);
+            packet.field(PACKET_SEQUENCE_ID, SEQUENCE_ID);
+            trace.field(TRACE_PACKET, packet);
+        }
+    }
+
+    out.write(trace.bytes().data(), static_cast<std::streamsize>(trace.bytes().size()));
+}
+
+} // namespace wasm
@@ -1,7 +1,108 @@
 #include "types.h"
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
 
 namespace wasm {
 
+namespace {
+
+[[noreturn]] void invalidValue(const std::string& text, ValueType type) {
+    throw std::invalid_argument("Invalid " + valueTypeToString(type) + " value: " + text);
+}
+
+// Magnitude of an optionally signed decimal or 0x hex integer
+uint64_t parseMagnitude(const std::string& text, size_t start, ValueType type) {
+    int base = 10;
+    if (text.compare(start, 2, "0x") == 0 || text.compare(start, 2, "0X") == 0) {
+        base = 16;
+        start += 2;
+    }
+    if (start >= text.size() || !std::isxdigit(static_cast<unsigned char>(text[start]))) {
+        invalidValue(text, type);
+    }
+    errno = 0;
+    char* end = nullptr;
+    uint64_t magnitude = std::strtoull(text.c_str() + start, &end, base);
+    if (errno == ERANGE || *end != '\0') {
+        invalidValue(text, type);
+    }
+    return magnitude;
+}
+
+// Signed or unsigned integer of bits width, wrapped to its two's complement
+uint64_t parseInteger(const std::string& text, ValueType type, unsigned bits) {
+    bool negative = !text.empty() && text[0] == '-';
+    size_t start = !text.empty() && (text[0] == '-' || text[0] == '+') ? 1 : 0;
+    uint64_t magnitude = parseMagnitude(text, start, type);
+    uint64_t unsigned_max = bits == 64 ? UINT64_MAX : (uint64_t(1) << bits) - 1;
+    uint64_t negative_max = uint64_t(1) << (bits - 1);
+    if (negative ? magnitude > negative_max : magnitude > unsigned_max) {
+        invalidValue(text, type);
+    }
+    return negative ? uint64_t(0) - magnitude : magnitude;
+}
+
+// nan or nan:0x<payload>, with sign; returns false for other text
+template <typename Float, typename Bits>
+bool parseNaN(const std::string& text, ValueType type, Float& out) {
+    constexpr unsigned MANTISSA_BITS = std::numeric_limits<Float>::digits - 1;
+    constexpr Bits MANTISSA_MASK = (Bits(1) << MANTISSA_BITS) - 1;
+    constexpr Bits EXPONENT_MASK = ~MANTISSA_MASK & ~(Bits(1) << (sizeof(Bits) * 8 - 1));
+
+    size_t start = !text.empty() && (text[0] == '-' || text[0] == '+') ? 1 : 0;
+    if (text.compare(start, 3, "nan") != 0) {
+        return false;
+    }
+    Bits payload = Bits(1) << (MANTISSA_BITS - 1);     // Canonical NaN
+    if (text.size() > start + 3) {
+        if (text.compare(start + 3, 3, ":0x") != 0) {
+            invalidValue(text, type);
+        }
+        uint64_t value = parseMagnitude(text, start + 4, type);
+        if (value == 0 || value > MANTISSA_MASK) {
+            invalidValue(text, type);
+        }
+        payload = static_cast<Bits>(value);
+    }
+    Bits bits = EXPONENT_MASK | payload;
+    if (text[0] == '-') {
+        bits |= Bits(1) << (sizeof(Bits) * 8 - 1);
+    }
+    std::memcpy(&out, &bits, sizeof(out));
+    return true;
+}
+
+template <typename Float, typename Bits>
+std::string formatFloat(Float value) {
+    if (std::isnan(value)) {
+        constexpr Bits MANTISSA_MASK = (Bits(1) << (std::numeric_limits<Float>::digits - 1)) - 1;
+        constexpr Bits CANONICAL = (MANTISSA_MASK >> 1) + 1;
+        Bits bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        std::ostringstream out;
+        out << (std::signbit(value) ? "-nan" : "nan");
+        if ((bits & MANTISSA_MASK) != CANONICAL) {
+            out << ":0x" << std::hex << (bits & MANTISSA_MASK);
+        }
+        return out.str();
+    }
+    if (std::isinf(value)) {
+        return value < 0 ? "-inf" : "inf";
+    }
+    std::ostringstream out;
+    out.precision(std::numeric_limits<Float>::max_digits10);
+    out << value;
+    return out.str();
+}
+
+} // anonymous namespace
+
 std::string valueTypeToString(ValueType type) {
     switch (type) {
         case ValueType::I32:
@@ -12,6 +113,12 @@ std::string valueTypeToString(ValueType type) {
             return "f32";
         case ValueType::F64:
             return "f64";
+        case ValueType::ANYREF:
+            return "anyref";
+        case ValueType::FUNCREF:
+            return "funcref";
+        case ValueType::CONTREF:
+            return "contref";
         case ValueType::VOID:
             return "void";
         default:
@@ -26,6 +133,9 @@ size_t getValueTypeSize(ValueType type) {
             return 4;
         case ValueType::I64:
         case ValueType::F64:
+        case ValueType::ANYREF:
+        case ValueType::FUNCREF:
+        case ValueType::CONTREF:
             return 8;
         case ValueType::VOID:
             return 0;
@@ -34,4 +144,74 @@ size_t getValueTypeSize(ValueType type) {
     }
 }
 
+TypedValue parseValue(const std::string& text, ValueType type) {
+    switch (type) {
+        case ValueType::I32:
+            return TypedValue::makeI32(static_cast<int32_t>(static_cast<uint32_t>(parseInteger(text, type, 32))));
+        case ValueType::I64:
+            return TypedValue::makeI64(static_cast<int64_t>(parseInteger(text, type, 64)));
+        case ValueType::F32: {
+            float value;
+            if (!parseNaN<float, uint32_t>(text, type, value)) {
+                char* end = nullptr;
+                errno = 0;
+                value = std::strtof(text.c_str(), &end);
+                if (text.empty() || *end != '\0' || (errno == ERANGE && std::isinf(value))) {
+                    invalidValue(text, type);
+                }
+            }
+            return TypedValue::makeF32(value);
+        }
+        case ValueType::F64: {
+            double value;
+            if (!parseNaN<double, uint64_t>(text, type, value)) {
+                char* end = nullptr;
+                errno = 0;
+                value = std::strtod(text.c_str(), &end);
+                if (text.empty() || *end != '\0' || (errno == ERANGE && std::isinf(value))) {
+                    invalidValue(text, type);
+                }
+            }
+            return TypedValue::makeF64(value);
+        }
+        case ValueType::ANYREF:
+        case ValueType::FUNCREF:
+        case ValueType::CONTREF:
+            if (text != "null") {
+                invalidValue(text, type);
+            }
+            return TypedValue::makeRef(0, type);
+        default:
+            invalidValue(text, type);
+    }
+}
+
+std::string formatValue(const TypedValue& value) {
+    switch (value.type) {
+        case ValueType::I32:
+            return std::to_string(value.value.i32);
+        case ValueType::I64:
+            return std::to_string(value.value.i64);
+        case ValueType::F32:
+            return formatFloat<float, uint32_t>(value.value.f32);
+        case ValueType::F64:
+            return formatFloat<double, uint64_t>(value.value.f64);
+        case ValueType::ANYREF:
+            if (value.value.ref == 0) {
+                return "null";
+            }
+            if (value.value.ref & 1) {
+                // i31 payloads print signed
+                return "i31:" + std::to_string(static_cast<int32_t>(static_cast<uint32_t>(value.value.ref)) >> 1);
+            }
+            return "object";
+        case ValueType::FUNCREF:
+            return value.value.ref == 0 ? "null" : "func:" + std::to_string(value.value.ref - 1);
+        case ValueType::CONTREF:
+            return value.value.ref == 0 ? "null" : "continuation";
+        default:
+            return "?";
+    }
+}
+
 } // namespace wasm
@@ -0,0 +1,39 @@
+#ifndef WASM_TESTS_CHECK_H
+#define WASM_TESTS_CHECK_H
+
+#include <cctype>
+#include <iostream>
+#include <string>
+
+/**
+ * PASS/FAIL reporting shared by the check-style tests. Each test prints
+ * its banner with beginChecks, reports every condition with check and
+ * returns finishChecks from main.
+ */
+
+inline int failures = 0;
+
+inline void check(bool condition, const std::string& what) {
+    std::cout << (condition ? "  PASS " : "  FAIL ") << what << "\n";
+    if (!condition) {
+        failures++;
+    }
+}
+
+// "=== WebAssembly <title> Test ==="
+inline void beginChecks(const std::string& title) {
+    std::cout << "=== WebAssembly " << title << " Test ===\n\n";
+}
+
+/**
+ * Print "All <what> checks passed" or "<What> checks failed".
+ * @return Exit status for main
+ */
+inline int finishChecks(const std::string& what) {
+    std::string capitalized = what;
+    capitalized[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(capitalized[0])));
+    std::cout << "\n" << (failures == 0 ? "All " + what + " checks passed" : capitalized + " checks failed") << "\n";
+    return failures == 0 ? 0 : 1;
+}
+
+#endif // WASM_TESTS_CHECK_H
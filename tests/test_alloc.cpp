@@ -0,0 +1,127 @@
+#include "../include/alloc_counter.h"
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "../benchmarks/kernels.h"
+#include "check.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Host allocation regression test.
+ * Runs the benchmark kernels and a br_table dispatcher in the interpreter
+ * and checks that warm calls make no host heap allocations, including
+ * after a trap has unwound nested frames. Links alloc_counter.cpp to
+ * count operator new.
+ *
+ * Usage: ./test_alloc
+ */
+
+namespace {
+
+// (func (export "classify") (param i32) (result i32)
+//   (block (block (block (br_table 0 1 2 (local.get 0)))
+//     (return (i32.const 10))) (return (i32.const 20))) (i32.const 30))
+// (func (export "nested_trap") (param i32) (result i32)
+//   (if (local.get 0) (then (unreachable))) (call $nested_trap (i32.const 1)))
+WasmBuilder::Bytes buildDispatch() {
+    using B = WasmBuilder;
+    WasmBuilder builder;
+    uint32_t i32_to_i32 = builder.addType({B::I32}, {B::I32});
+
+    Code classify;
+    classify.block().block().block()
+                .localGet(0).brTable({0, 1}, 2)
+            .end().i32Const(10).op(0x0F /* return */)
+            .end().i32Const(20).op(0x0F)
+            .end().i32Const(30);
+    builder.addFunction(i32_to_i32, {}, classify.bytes(), "classify");
+
+    Code nested;
+    nested.localGet(0).ifBlock().op(0x00 /* unreachable */).end()
+          .i32Const(1).call(1);
+    builder.addFunction(i32_to_i32, {}, nested.bytes(), "nested_trap");
+    return builder.build();
+}
+
+// Allocations made by count warm calls
+uint64_t warmAllocations(wasm::Interpreter& interpreter, const std::string& name, int32_t argument,
+                         std::vector<wasm::TypedValue>& results, int count = 10) {
+    std::vector<wasm::TypedValue> args = {wasm::TypedValue::makeI32(argument)};
+    interpreter.call(name, args, results);
+    wasm::AllocationScope scope;
+    for (int i = 0; i < count; i++) {
+        interpreter.call(name, args, results);
+    }
+    return scope.stats().count;
+}
+
+void testCounter() {
+    std::cout << "Counter:\n";
+    wasm::AllocationScope scope;
+    std::vector<int> vector(16);
+    vector.push_back(1);
+    wasm::AllocationStats stats = scope.stats();
+    check(stats.count == 2 && stats.bytes == 48 * sizeof(int), "operator new counted");
+}
+
+void testKernels() {
+    std::cout << "Benchmark kernels:\n";
+    wasm::Decoder decoder;
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(decoder.parseBytes(buildKernels()));
+    std::vector<wasm::TypedValue> results;
+
+    check(warmAllocations(interpreter, "arith_i32", 1000, results) == 0, "arith_i32 allocation free");
+    check(warmAllocations(interpreter, "arith_f64", 1000, results) == 0, "arith_f64 allocation free");
+    check(warmAllocations(interpreter, "mem_sum", 1000, results) == 0, "mem_sum allocation free");
+    check(warmAllocations(interpreter, "fib", 15, results) == 0, "fib (recursive calls) allocation free");
+    check(results.size() == 1 && results[0].value.i32 == 610, "fib result");
+
+    // The by-value API still allocates its result vector, and nothing else
+    std::vector<wasm::TypedValue> args = {wasm::TypedValue::makeI32(15)};
+    wasm::AllocationScope scope;
+    interpreter.call("fib", args);
+    uint64_t count = scope.stats().count;
+    check(count == 1, "returning results allocates only the result vector");
+}
+
+void testDispatch() {
+    std::cout << "Branch tables and traps:\n";
+    wasm::Decoder decoder;
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(decoder.parseBytes(buildDispatch()));
+    std::vector<wasm::TypedValue> results;
+
+    bool classified = true;
+    for (int32_t selector : {0, 1, 2, 7, -1}) {
+        interpreter.call("classify", {wasm::TypedValue::makeI32(selector)}, results);
+        int32_t expected = selector == 0 ? 10 : selector == 1 ? 20 : 30;
+        classified = classified && results[0].value.i32 == expected;
+    }
+    check(classified, "br_table selects its targets");
+    check(warmAllocations(interpreter, "classify", 1, results) == 0, "br_table allocation free");
+
+    bool trapped = false;
+    try {
+        interpreter.call("nested_trap", {wasm::TypedValue::makeI32(0)}, results);
+    } catch (const wasm::Trap&) {
+        trapped = true;
+    }
+    check(trapped, "trap unwinds nested frames");
+    interpreter.call("classify", {wasm::TypedValue::makeI32(1)}, results);
+    check(results[0].value.i32 == 20, "frames restored after a trap");
+    check(warmAllocations(interpreter, "classify", 0, results) == 0, "still allocation free after a trap");
+}
+
+} // anonymous namespace
+
+int main() {
+    beginChecks("Host Allocation");
+
+    testCounter();
+    testKernels();
+    testDispatch();
+
+    return finishChecks("allocation");
+}
@@ -0,0 +1,250 @@
+#include "../include/aot.h"
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "../include/memory.h"
+#include "../include/tier_up.h"
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Ahead-of-time compilation test.
+ * Compiles each test module to a shared object and checks that every
+ * exported nullary function gives the same results, traps and final
+ * memory contents natively as it does interpreted. Runs the baseline
+ * translation, the optimizing tier, and background tier-up of functions
+ * the call profile marks hot. Also checks that builds neither follow a
+ * symlink at the output path nor leave files behind, in a directory
+ * whose name needs quoting.
+ *
+ * Usage: ./test_aot
+ */
+
+namespace {
+
+struct Outcome {
+    bool trapped;
+    std::vector<wasm::TypedValue> results;
+};
+
+Outcome run(wasm::Interpreter& interpreter, const std::string& name) {
+    Outcome outcome{false, {}};
+    try {
+        outcome.results = interpreter.call(name);
+    } catch (const std::exception&) {
+        outcome.trapped = true;
+    }
+    return outcome;
+}
+
+bool sameValue(const wasm::TypedValue& a, const wasm::TypedValue& b) {
+    if (a.type != b.type) {
+        return false;
+    }
+    // Compare bit patterns so NaN payloads and signed zeros must match too
+    size_t size = (a.type == wasm::ValueType::I32 || a.type == wasm::ValueType::F32) ? 4 : 8;
+    return std::memcmp(&a.value, &b.value, size) == 0;
+}
+
+bool sameMemory(const wasm::Interpreter& a, const wasm::Interpreter& b) {
+    const wasm::Memory* ma = a.memory();
+    const wasm::Memory* mb = b.memory();
+    if (!ma || !mb) {
+        return ma == mb;
+    }
+    return ma->sizeInBytes() == mb->sizeInBytes() &&
+           std::memcmp(ma->data(), mb->data(), ma->sizeInBytes()) == 0;
+}
+
+enum class Mode { BASELINE, OPTIMIZED, TIER_UP };
+
+const char* modeName(Mode mode) {
+    switch (mode) {
+        case Mode::BASELINE: return "baseline";
+        case Mode::OPTIMIZED: return "optimized";
+        default: return "tier-up";
+    }
+}
+
+int testModule(const std::string& wasm_file, Mode mode, int& checked) {
+    std::string library = "/tmp/wasm_aot_test_" + std::to_string(getpid()) + ".so";
+    int failures = 0;
+
+    try {
+        wasm::Decoder decoder;
+        wasm::Interpreter interpreted;
+        interpreted.instantiate(decoder.parse(wasm_file));
+
+        wasm::Interpreter native;
+        wasm::Module module = decoder.parse(wasm_file);
+        std::vector<std::string> names;
+        for (const auto& exp : module.exports) {
+            const wasm::FuncType* type = module.getFunctionType(exp.index);
+            if (exp.kind == wasm::ExternalKind::FUNCTION && type && type->params.empty()) {
+                names.emplace_back(exp.name);
+            }
+        }
+
+        if (mode == Mode::TIER_UP) {
+            native.instantiate(std::move(module));
+            wasm::TierUpOptions options;
+            options.hot_threshold = 1;
+            native.enableTierUp(options);
+
+            // First round runs interpreted and marks everything it calls hot
+            for (const auto& name : names) {
+                run(interpreted, name);
+                run(native, name);
+            }
+            if (!native.waitForTierUp()) {
+                throw std::runtime_error("background compilation failed");
+            }
+        } else {
+            wasm::AotOptions options;
+            options.optimize = mode == Mode::OPTIMIZED;
+            wasm::AotCompiler(options).compile(module, library);
+            native.instantiate(std::move(module));
+            native.loadNative(library);
+        }
+
+        for (const auto& name : names) {
+            Outcome expected = run(interpreted, name);
+            Outcome actual = run(native, name);
+            checked++;
+
+            bool same = expected.trapped == actual.trapped &&
+                        expected.results.size() == actual.results.size();
+            for (size_t i = 0; same && i < expected.results.size(); i++) {
+                same = sameValue(expected.results[i], actual.results[i]);
+            }
+            if (same && !sameMemory(interpreted, native)) {
+                same = false;
+            }
+
+            if (!same) {
+                failures++;
+                std::cout << "  FAIL [" << modeName(mode) << "] " << wasm_file << " " << name
+                          << (expected.trapped ? " (interpreter trapped)" : "")
+                          << (actual.trapped ? " (native trapped)" : "") << "\n";
+            }
+        }
+    } catch (const std::exception& e) {
+        failures++;
+        std::cout << "  FAIL [" << modeName(mode) << "] " << wasm_file << ": " << e.what() << "\n";
+    }
+
+    std::remove(library.c_str());
+    return failures;
+}
+
+std::vector<std::string> listDirectory(const std::string& path) {
+    std::vector<std::string> names;
+    if (DIR* dir = opendir(path.c_str())) {
+        while (dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name != "." && name != "..") {
+                names.push_back(name);
+            }
+        }
+        closedir(dir);
+    }
+    return names;
+}
+
+int testBuildFiles(const std::string& wasm_file) {
+    int failures = 0;
+    auto fail = [&](const std::string& what) {
+        failures++;
+        std::cout << "  FAIL [build files] " << what << "\n";
+    };
+
+    std::string dir = "/tmp/wasm aot 'test' $" + std::to_string(getpid());
+    std::string victim = dir + "/victim";
+    std::string library = dir + "/out.so";
+    mkdir(dir.c_str(), 0700);
+    std::ofstream(victim) << "keep";
+    symlink(victim.c_str(), library.c_str());
+
+    try {
+        wasm::Decoder decoder;
+        wasm::Module module = decoder.parse(wasm_file);
+        wasm::AotCompiler().compile(module, library);
+        std::string contents;
+        std::getline(std::ifstream(victim), contents);
+        struct stat info;
+        if (contents != "keep" || lstat(library.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+            fail("compile followed a symlink at the output path");
+        }
+        wasm::Interpreter native;
+        native.instantiate(std::move(module));
+        native.loadNative(library);
+
+        {
+            wasm::Module tiered_module = decoder.parse(wasm_file);
+            std::vector<std::string> names;
+            for (const auto& exp : tiered_module.exports) {
+                const wasm::FuncType* type = tiered_module.getFunctionType(exp.index);
+                if (exp.kind == wasm::ExternalKind::FUNCTION && type && type->params.empty()) {
+                    names.emplace_back(exp.name);
+                }
+            }
+            wasm::Interpreter tiered;
+            tiered.instantiate(std::move(tiered_module));
+            wasm::TierUpOptions options;
+            options.hot_threshold = 1;
+            options.work_dir = dir;
+            tiered.enableTierUp(options);
+            for (const auto& name : names) {
+                run(tiered, name);
+            }
+            if (!tiered.waitForTierUp()) {
+                fail("tier-up in a directory whose name needs quoting");
+            }
+        }
+        if (listDirectory(dir).size() != 2) {
+            fail("build files left in the work directory");
+        }
+    } catch (const std::exception& e) {
+        fail(e.what());
+    }
+
+    std::remove(library.c_str());
+    std::remove(victim.c_str());
+    rmdir(dir.c_str());
+    return failures;
+}
+
+} // anonymous namespace
+
+int main() {
+    std::cout << "=== WebAssembly AOT Compilation Test ===\n\n";
+
+    const std::vector<std::string> modules = {
+        "tests/wat/01_test.wasm",
+        "tests/wat/02_test_prio1.wasm",
+        "tests/wat/03_test_prio2.wasm",
+        "tests/wat/04_test_prio3.wasm",
+        "tests/wat/05_test_complex.wasm",
+        "tests/wat/06_test_fc.wasm",
+        "tests/wat/09_print_hello.wasm",
+    };
+
+    int checked = 0;
+    int failures = 0;
+    for (Mode mode : {Mode::BASELINE, Mode::OPTIMIZED, Mode::TIER_UP}) {
+        for (const auto& wasm_file : modules) {
+            failures += testModule(wasm_file, mode, checked);
+        }
+    }
+    failures += testBuildFiles(modules[0]);
+
+    std::cout << "\nChecked " << checked << " functions, " << failures << " mismatches\n";
+    return failures == 0 ? 0 : 1;
+}
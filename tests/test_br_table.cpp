@@ -0,0 +1,141 @@
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "../benchmarks/wasm_builder.h"
+#include "check.h"
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+/**
+ * br_table test.
+ * Checks case and default arms, including negative and out-of-range
+ * selectors, branches that unwind extra operands while carrying a result,
+ * loop targets, a depth that returns from the function, and functions
+ * with many sites or whose sites run around calls to other functions
+ * with their own tables.
+ *
+ * Usage: ./test_br_table
+ */
+
+namespace {
+
+using B = WasmBuilder;
+
+constexpr int SITES = 40;
+
+wasm::Module buildModule() {
+    WasmBuilder builder;
+    uint32_t unary = builder.addType({B::I32}, {B::I32});
+
+    // select(n): 100 + n for n in 0..2, 103 otherwise
+    Code select;
+    select.block().block().block().block()
+        .localGet(0).brTable({0, 1, 2}, 3)
+        .end().i32Const(100).op(0x0F /* return */)
+        .end().i32Const(101).op(0x0F)
+        .end().i32Const(102).op(0x0F)
+        .end().i32Const(103);
+    uint32_t select_index = builder.addFunction(unary, {}, select.bytes(), "select");
+
+    // carry(n): 5 + 42, plus 1000 if n == 0. The operands under 42 are
+    // dropped by the branch, the 5 under the blocks is kept.
+    Code carry;
+    carry.i32Const(5)
+        .block(B::I32).block(B::I32)
+        .i32Const(7).i32Const(8).i32Const(42)
+        .localGet(0).brTable({0}, 1)
+        .end().i32Const(1000).op(0x6A /* i32.add */)
+        .end().op(0x6A);
+    builder.addFunction(unary, {}, carry.bytes(), "carry");
+
+    // count(n): iterations of a loop continued by the default arm
+    Code count;
+    count.block().loop()
+        .localGet(1).i32Const(1).op(0x6A).localSet(1)
+        .localGet(0).i32Const(1).op(0x6B /* i32.sub */).localTee(0)
+        .brTable({1}, 0)
+        .end().end()
+        .localGet(1);
+    builder.addFunction(unary, {{1, B::I32}}, count.bytes(), "count");
+
+    // leave(n): depth 1 is the function body, so n == 0 returns 77
+    Code leave;
+    leave.block()
+        .i32Const(77).localGet(0).brTable({1}, 0)
+        .end().i32Const(5);
+    builder.addFunction(unary, {}, leave.bytes(), "leave");
+
+    // walk(n): n + walk(n - 1) + select(n & 3), plus 1000 for odd n.
+    // Its second site runs after calls to itself and to select.
+    Code walk;
+    uint32_t walk_index = select_index + 4;     // After carry, count and leave
+    walk.block().block()
+        .localGet(0).brTable({0}, 1)
+        .end().i32Const(0).op(0x0F)
+        .end()
+        .localGet(0)
+        .localGet(0).i32Const(1).op(0x6B).call(walk_index).op(0x6A)
+        .localGet(0).i32Const(3).op(0x71 /* i32.and */).call(select_index).op(0x6A)
+        .block(B::I32).block(B::I32)
+        .localGet(0).i32Const(1).op(0x71).brTable({1}, 0)
+        .end().i32Const(1000).op(0x6A)
+        .end();
+    builder.addFunction(unary, {}, walk.bytes(), "walk");
+
+    // chain(n): 10 * n for n below SITES, from one site per candidate
+    Code chain;
+    for (int k = 0; k < SITES; k++) {
+        chain.block().block()
+            .localGet(0).i32Const(k).op(0x46 /* i32.eq */).brTable({1}, 0)
+            .end().i32Const(10 * k).localSet(1)
+            .end();
+    }
+    chain.localGet(1);
+    builder.addFunction(unary, {{1, B::I32}}, chain.bytes(), "chain");
+
+    wasm::Decoder decoder;
+    return decoder.parseBytes(builder.build());
+}
+
+int32_t walkReference(int32_t n) {
+    if (n == 0) {
+        return 0;
+    }
+    int32_t selected = (n & 3) < 3 ? 100 + (n & 3) : 103;
+    return n + walkReference(n - 1) + selected + (n & 1 ? 1000 : 0);
+}
+
+} // anonymous namespace
+
+int main() {
+    beginChecks("br_table");
+
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(buildModule());
+    auto call = [&](const char* name, int32_t n) {
+        return interpreter.call(name, {wasm::TypedValue::makeI32(n)})[0].value.i32;
+    };
+
+    std::cout << "Arms:\n";
+    check(call("select", 0) == 100 && call("select", 1) == 101 && call("select", 2) == 102, "case arms");
+    check(call("select", 3) == 103, "first index past the cases takes the default");
+    check(call("select", -1) == 103 && call("select", INT32_MIN) == 103, "negative selectors take the default");
+    check(call("select", 1000) == 103 && call("select", INT32_MAX) == 103, "large selectors take the default");
+
+    std::cout << "\nUnwinding:\n";
+    check(call("carry", 0) == 1047, "branch to the inner block carries its result");
+    check(call("carry", 1) == 47 && call("carry", -5) == 47, "branch to the outer block carries its result");
+    check(call("count", 5) == 5 && call("count", 1) == 1, "default arm continues a loop");
+    check(call("leave", 0) == 77 && call("leave", 1) == 5, "function depth returns");
+
+    std::cout << "\nSites:\n";
+    check(call("walk", 0) == 0 && call("walk", 12) == walkReference(12),
+          "sites after calls use the caller's tables");
+    bool all = true;
+    for (int k = 0; k < SITES; k++) {
+        all = all && call("chain", k) == 10 * k;
+    }
+    check(all && call("chain", SITES) == 0, "each of many sites resolves to its own table");
+
+    return finishChecks("br_table");
+}
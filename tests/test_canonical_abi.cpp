@@ -0,0 +1,232 @@
+#include "../include/decoder.h"
+#include "../include/canonical_abi.h"
+#include "../include/interpreter.h"
+#include "../benchmarks/wasm_builder.h"
+#include "check.h"
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+/**
+ * Canonical ABI test.
+ * Checks UTF-8 validation (including every position around the SIMD block
+ * boundaries), that UTF-8 strings and scalar lists lift as views over
+ * linear memory and are rejected when out of bounds, misaligned or
+ * malformed, that lowering calls the guest's cabi_realloc once and the
+ * guest reads what was written, and that UTF-16 and Latin-1+UTF-16 strings
+ * round-trip with surrogate pairs and the Latin-1 tag.
+ *
+ * Usage: ./test_canonical_abi
+ */
+
+namespace {
+
+using B = WasmBuilder;
+
+enum : uint8_t {
+    I32_LOAD = 0x28, I32_LOAD8_U = 0x2D, I32_EQ = 0x46, I32_GE_U = 0x4F,
+    I32_ADD = 0x6A, I32_SUB = 0x6B, I32_AND = 0x71,
+};
+
+constexpr uint32_t TEXT = 64;       // "héllo wörld"
+constexpr uint32_t INVALID = 128;   // A truncated sequence
+constexpr uint32_t UTF16 = 256;     // "h€𝄞" as UTF-16LE
+
+bool valid(const std::string& text) {
+    return wasm::isValidUtf8(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+}
+
+template<typename F>
+bool rejects(F&& f) {
+    try {
+        f();
+    } catch (const wasm::CanonicalAbiError&) {
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Guest with a bump allocator:
+ *   cabi_realloc(old_ptr, old_size, align, new_size)
+ *   count_byte(ptr, len, byte)  occurrences of byte
+ *   sum_u32(ptr, count)         sum of a list<u32>
+ *   realloc_calls()
+ */
+std::vector<uint8_t> buildGuest() {
+    WasmBuilder builder;
+    uint32_t ft_realloc = builder.addType({B::I32, B::I32, B::I32, B::I32}, {B::I32});
+    uint32_t ft_count = builder.addType({B::I32, B::I32, B::I32}, {B::I32});
+    uint32_t ft_sum = builder.addType({B::I32, B::I32}, {B::I32});
+    uint32_t ft_result = builder.addType({}, {B::I32});
+    builder.setMemory(1);
+    uint32_t heap = builder.addGlobal(B::I32, true, 1024);
+    uint32_t calls = builder.addGlobal(B::I32, true, 0);
+
+    Code realloc;
+    realloc.globalGet(calls).i32Const(1).op(I32_ADD).globalSet(calls)
+        .globalGet(heap).localGet(2).op(I32_ADD).i32Const(1).op(I32_SUB)
+        .i32Const(0).localGet(2).op(I32_SUB).op(I32_AND).localTee(4)
+        .localGet(3).op(I32_ADD).globalSet(heap)
+        .localGet(4);
+    builder.addFunction(ft_realloc, {{1, B::I32}}, realloc.bytes(), "cabi_realloc");
+
+    // Local 3 is the index, local 4 the count
+    Code count;
+    count.block().loop()
+            .localGet(3).localGet(1).op(I32_GE_U).brIf(1)
+            .localGet(0).localGet(3).op(I32_ADD).load(I32_LOAD8_U).localGet(2).op(I32_EQ)
+            .localGet(4).op(I32_ADD).localSet(4)
+            .localGet(3).i32Const(1).op(I32_ADD).localSet(3)
+            .br(0)
+        .end().end()
+        .localGet(4);
+    builder.addFunction(ft_count, {{2, B::I32}}, count.bytes(), "count_byte");
+
+    // Local 2 is the index, local 3 the sum
+    Code sum;
+    sum.block().loop()
+            .localGet(2).localGet(1).op(I32_GE_U).brIf(1)
+            .localGet(0).localGet(2).i32Const(4).op(0x6C /* i32.mul */).op(I32_ADD).load(I32_LOAD)
+            .localGet(3).op(I32_ADD).localSet(3)
+            .localGet(2).i32Const(1).op(I32_ADD).localSet(2)
+            .br(0)
+        .end().end()
+        .localGet(3);
+    builder.addFunction(ft_sum, {{2, B::I32}}, sum.bytes(), "sum_u32");
+
+    Code realloc_calls;
+    realloc_calls.globalGet(calls);
+    builder.addFunction(ft_result, {}, realloc_calls.bytes(), "realloc_calls");
+
+    std::string text = "h\xC3\xA9llo w\xC3\xB6rld";
+    builder.addData(TEXT, WasmBuilder::Bytes(text.begin(), text.end()));
+    builder.addData(INVALID, {'o', 'k', 0xE2, 0x82});
+    builder.addData(UTF16, {'h', 0, 0xAC, 0x20, 0x34, 0xD8, 0x1E, 0xDD});
+    return builder.build();
+}
+
+int32_t callI32(wasm::Interpreter& instance, const std::string& name, std::vector<int32_t> args = {}) {
+    std::vector<wasm::TypedValue> values;
+    for (int32_t arg : args) {
+        values.push_back(wasm::TypedValue::makeI32(arg));
+    }
+    return instance.call(name, values)[0].value.i32;
+}
+
+void testValidation() {
+    std::cout << "UTF-8 validation:\n";
+    check(valid("") && valid("plain ascii") && valid("caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80"),
+          "ASCII, 2-, 3- and 4-byte sequences");
+    check(!valid("\xC0\xAF") && !valid("\xE0\x80\xAF") && !valid("\xF0\x80\x80\xAF"), "overlong forms");
+    check(!valid("\xED\xA0\x80") && !valid("\xF4\x90\x80\x80") && !valid("\xF5\x80\x80\x80"),
+          "surrogates and code points above U+10FFFF");
+    check(!valid("\xE2\x82") && !valid("\x80") && !valid("a\xC3") && !valid("\xC3\x28"),
+          "truncated sequences and stray continuation bytes");
+
+    // Every position across the 8-, 16- and 64-byte steps
+    bool ascii = true, stray = true, sequence = true;
+    for (size_t size = 0; size <= 140; size++) {
+        std::string text(size, 'x');
+        ascii = ascii && valid(text);
+        for (size_t at = 0; at < size; at++) {
+            std::string bad = text;
+            bad[at] = '\xFF';
+            stray = stray && !valid(bad);
+            if (at + 1 < size) {
+                std::string good = text;
+                good[at] = '\xC3';
+                good[at + 1] = '\xA9';
+                sequence = sequence && valid(good);
+            }
+        }
+    }
+    check(ascii, "ASCII of every length up to 140");
+    check(stray, "invalid byte found at every position");
+    check(sequence, "valid sequence accepted at every position");
+}
+
+void testLifting(wasm::Interpreter& instance) {
+    std::cout << "\nLifting:\n";
+    wasm::CanonicalAbi abi(instance);
+    const wasm::Memory& memory = *instance.memory();
+    std::string scratch;
+
+    std::string_view text = abi.liftString(TEXT, 13, scratch);
+    check(text == "h\xC3\xA9llo w\xC3\xB6rld", "UTF-8 string lifts");
+    check(reinterpret_cast<const uint8_t*>(text.data()) == memory.data() + TEXT && scratch.empty(),
+          "as a view over linear memory");
+    check(rejects([&] { abi.liftString(INVALID, 4, scratch); }), "malformed UTF-8 rejected");
+    check(rejects([&] { abi.liftString(wasm::Memory::PAGE_SIZE - 4, 8, scratch); }), "out of bounds rejected");
+
+    std::vector<uint32_t> numbers(100);
+    std::iota(numbers.begin(), numbers.end(), 1);
+    wasm::CanonicalAbi::Lowered list = abi.lowerList(numbers.data(), numbers.size());
+    wasm::ArrayView<uint32_t> view = abi.liftList<uint32_t>(list.ptr, list.len);
+    check(view.size() == 100 && std::accumulate(view.begin(), view.end(), 0u) == 5050 &&
+          reinterpret_cast<const uint8_t*>(view.data()) == memory.data() + list.ptr,
+          "list<u32> lifts as a view");
+    check(rejects([&] { abi.liftList<uint32_t>(list.ptr + 1, 4); }), "misaligned list rejected");
+}
+
+void testLowering(wasm::Interpreter& instance) {
+    std::cout << "\nLowering:\n";
+    wasm::CanonicalAbi abi(instance);
+    int32_t calls = callI32(instance, "realloc_calls");
+
+    wasm::CanonicalAbi::Lowered text = abi.lowerString("hello, component model");
+    check(callI32(instance, "realloc_calls") == calls + 1 && abi.reallocCalls() == 1, "one cabi_realloc call");
+    check(text.len == 22 && callI32(instance, "count_byte", {static_cast<int32_t>(text.ptr),
+                                                            static_cast<int32_t>(text.len), 'o'}) == 4,
+          "guest reads the lowered string");
+
+    std::vector<uint32_t> numbers(1000, 3);
+    wasm::CanonicalAbi::Lowered list = abi.lowerList(numbers.data(), numbers.size());
+    check(list.ptr % 4 == 0 && callI32(instance, "sum_u32", {static_cast<int32_t>(list.ptr), 1000}) == 3000,
+          "guest reads the lowered list<u32>");
+    check(rejects([&] { abi.lowerString("bad \xC3"); }) && abi.reallocCalls() == 2,
+          "malformed UTF-8 rejected before allocating");
+}
+
+void testUtf16(wasm::Interpreter& instance) {
+    std::cout << "\nUTF-16 and Latin-1:\n";
+    wasm::CanonicalAbi utf16(instance, wasm::StringEncoding::UTF16);
+    std::string scratch;
+    check(utf16.liftString(UTF16, 4, scratch) == "h\xE2\x82\xAC\xF0\x9D\x84\x9E", "UTF-16 with a surrogate pair");
+
+    wasm::CanonicalAbi::Lowered lowered = utf16.lowerString("a\xE2\x82\xAC\xF0\x9D\x84\x9E");
+    check(lowered.len == 4 && utf16.reallocCalls() == 1, "lowered to 4 code units with one allocation");
+    std::string round_trip(utf16.liftString(lowered.ptr, lowered.len, scratch));
+    check(round_trip == "a\xE2\x82\xAC\xF0\x9D\x84\x9E", "UTF-16 round trip");
+
+    instance.memory()->storeU16(lowered.ptr, 0xDC00);
+    check(rejects([&] { utf16.liftString(lowered.ptr, 1, scratch); }), "unpaired surrogate rejected");
+    check(rejects([&] { utf16.liftString(UTF16 + 1, 1, scratch); }), "misaligned UTF-16 rejected");
+
+    wasm::CanonicalAbi compact(instance, wasm::StringEncoding::LATIN1_UTF16);
+    wasm::CanonicalAbi::Lowered latin1 = compact.lowerString("caf\xC3\xA9");
+    check(latin1.len == 4 && instance.memory()->loadU8(latin1.ptr + 3) == 0xE9, "Latin-1 when it fits");
+    check(compact.liftString(latin1.ptr, latin1.len, scratch) == "caf\xC3\xA9", "Latin-1 round trip");
+    wasm::CanonicalAbi::Lowered wide = compact.lowerString("\xE2\x82\xAC" "1");
+    check(wide.len == (0x80000000u | 2), "UTF-16 with the tag otherwise");
+    check(compact.liftString(wide.ptr, wide.len, scratch) == "\xE2\x82\xAC" "1", "tagged UTF-16 round trip");
+}
+
+} // anonymous namespace
+
+int main() {
+    beginChecks("Canonical ABI");
+
+    wasm::Decoder decoder;
+    wasm::Interpreter instance;
+    instance.instantiate(decoder.parseBytes(buildGuest()));
+
+    testValidation();
+    testLifting(instance);
+    testLowering(instance);
+    testUtf16(instance);
+
+    return finishChecks("canonical ABI");
+}
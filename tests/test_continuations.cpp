@@ -0,0 +1,354 @@
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "../include/types.h"
+#include "../benchmarks/wasm_builder.h"
+#include "check.h"
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Stack switching test.
+ * Checks that continuation types and tags decode, that blocks with
+ * parameters and several results work, that a generator suspended with
+ * cont.new, cont.bind, resume and suspend yields its values, that a
+ * suspend finds a handler through nested resumes, that stale references,
+ * unhandled tags and traps inside a continuation trap in the resumer, and
+ * that many green threads scheduled round-robin by the guest interleave in
+ * order while GC objects they hold survive collections.
+ *
+ * Usage: ./test_continuations
+ */
+
+namespace {
+
+using B = WasmBuilder;
+
+// GC instruction sub-opcodes (after 0xFB)
+enum : uint32_t {
+    STRUCT_NEW = 0x00, STRUCT_GET = 0x02, ARRAY_NEW_DEFAULT = 0x07, ARRAY_GET = 0x0B, ARRAY_SET = 0x0E,
+};
+
+// Abstract heap type of continuations, as a one-byte s33 immediate
+constexpr uint8_t HEAP_CONT = 0x68;
+
+int32_t callI32(wasm::Interpreter& interpreter, const std::string& name, std::vector<wasm::TypedValue> args = {}) {
+    return interpreter.call(name, args)[0].value.i32;
+}
+
+std::string trapOf(wasm::Interpreter& interpreter, const std::string& name) {
+    try {
+        interpreter.call(name);
+    } catch (const wasm::Trap& e) {
+        return e.what();
+    }
+    return "";
+}
+
+/**
+ * One module for every test:
+ *   gen(n)          suspends $yield with 1..n
+ *   answer()        returns 42
+ *   asker()         suspends $ask and returns its answer plus one
+ *   middle()        resumes asker handling $yield only, returns twice its result
+ *   yielder()       suspends $yield once
+ *   boom()          unreachable
+ *   worker(id, steps)  logs its id to memory and suspends $tick, steps times
+ * and the exports below.
+ */
+WasmBuilder::Bytes continuationModule() {
+    WasmBuilder builder;
+    uint32_t ft_unit = builder.addType({}, {});
+    uint32_t ct_unit = builder.addCont(ft_unit);
+    uint32_t ft_gen = builder.addType({B::I32}, {});
+    uint32_t ct_gen = builder.addCont(ft_gen);
+    uint32_t ft_ret = builder.addType({}, {B::I32});
+    uint32_t ct_ret = builder.addCont(ft_ret);
+    uint32_t ft_inc = builder.addType({B::I32}, {B::I32});
+    uint32_t ct_inc = builder.addCont(ft_inc);
+    uint32_t on_yield = builder.addType({}, {B::I32, B::CONTREF});
+    uint32_t on_ask = builder.addType({}, {B::CONTREF});
+    uint32_t ft_worker = builder.addType({B::I32, B::I32}, {});
+    uint32_t ct_worker = builder.addCont(ft_worker);
+    uint32_t box = builder.addStruct({{B::I32, false}});
+    uint32_t queue = builder.addArray(B::CONTREF, true);
+    uint32_t ints = builder.addArray(B::I32, true);
+    uint32_t ft_schedule = builder.addType({B::I32, B::I32}, {B::I32});
+    uint32_t ft_pair = builder.addType({B::I32, B::I32}, {B::I32});
+
+    uint32_t yield = builder.addTag(ft_gen);     // (param i32)
+    uint32_t ask = builder.addTag(ft_ret);       // (result i32)
+    uint32_t tick = builder.addTag(ft_unit);
+    builder.setMemory(1);
+
+    const uint32_t gen = 0, answer = 1, asker = 2, middle = 3, yielder = 4, boom = 5, worker = 6;
+
+    // Locals: 1 i
+    Code gen_body;
+    gen_body.loop()
+                .localGet(1).i32Const(1).op(0x6A /* i32.add */).localTee(1).suspend(yield)
+                .localGet(1).localGet(0).op(0x48 /* i32.lt_s */).brIf(0)
+            .end();
+    builder.addFunction(ft_gen, {{1, B::I32}}, gen_body.bytes());
+
+    Code answer_body;
+    answer_body.i32Const(42);
+    builder.addFunction(ft_ret, {}, answer_body.bytes());
+
+    Code asker_body;
+    asker_body.suspend(ask).i32Const(1).op(0x6A);
+    builder.addFunction(ft_ret, {}, asker_body.bytes());
+
+    Code middle_body;
+    middle_body.typedBlock(on_yield)
+                   .refFunc(asker).contNew(ct_ret).resume(ct_ret, {{yield, 0}})
+                   .i32Const(2).op(0x6C /* i32.mul */).op(0x0F /* return */)
+               .end()
+               .op(0x1A /* drop */).op(0x1A).i32Const(-1);
+    builder.addFunction(ft_ret, {}, middle_body.bytes());
+
+    Code yielder_body;
+    yielder_body.i32Const(7).suspend(yield);
+    builder.addFunction(ft_unit, {}, yielder_body.bytes());
+
+    Code boom_body;
+    boom_body.op(0x00 /* unreachable */);
+    builder.addFunction(ft_unit, {}, boom_body.bytes());
+
+    // Locals: 2 j, 3 box holding the id. Memory: [0] log length in bytes,
+    // log entries from 4. Each step drops an array so the heap collects.
+    Code worker_body;
+    worker_body.localGet(0).gc(STRUCT_NEW).u32(box).localSet(3)
+               .loop()
+                   .i32Const(0).load(0x28 /* i32.load */)
+                   .localGet(3).gc(STRUCT_GET).u32(box).u32(0)
+                   .store(0x36 /* i32.store */, 4)
+                   .i32Const(0).i32Const(0).load(0x28).i32Const(4).op(0x6A).store(0x36)
+                   .i32Const(64).gc(ARRAY_NEW_DEFAULT).u32(ints).op(0x1A)
+                   .suspend(tick)
+                   .localGet(2).i32Const(1).op(0x6A).localTee(2).localGet(1).op(0x48).brIf(0)
+               .end();
+    builder.addFunction(ft_worker, {{1, B::I32}, {1, B::ANYREF}}, worker_body.bytes());
+
+    // (func (export "sum") (param $n i32) (result i32)
+    //   sum what gen yields; the continuation is bound to $n up front)
+    // Locals: 1 k, 2 sum
+    Code sum_body;
+    sum_body.localGet(0).refFunc(gen).contNew(ct_gen).contBind(ct_gen, ct_unit).localSet(1)
+            .block().loop()
+                .typedBlock(on_yield)
+                    .localGet(1).resume(ct_unit, {{yield, 0}})
+                    .br(2)
+                .end()
+                .localSet(1).localGet(2).op(0x6A).localSet(2)
+                .br(0)
+            .end().end()
+            .localGet(2);
+    builder.addFunction(ft_inc, {{1, B::CONTREF}, {1, B::I32}}, sum_body.bytes(), "sum");
+
+    // First value of gen($n), resumed with its argument; the rest is dropped
+    Code first_body;
+    first_body.typedBlock(on_yield)
+                  .localGet(0).refFunc(gen).contNew(ct_gen).resume(ct_gen, {{yield, 0}})
+                  .i32Const(-1).op(0x0F)
+              .end()
+              .op(0x1A);
+    builder.addFunction(ft_inc, {}, first_body.bytes(), "first");
+
+    Code ret_body;
+    ret_body.refFunc(answer).contNew(ct_ret).resume(ct_ret);
+    builder.addFunction(ft_ret, {}, ret_body.bytes(), "ret");
+
+    // $ask is handled two resumes out: answer 20, middle doubles asker's 21
+    // Locals: 0 k
+    Code nested_body;
+    nested_body.typedBlock(on_ask)
+                   .refFunc(middle).contNew(ct_ret).resume(ct_ret, {{ask, 0}})
+                   .op(0x0F)
+               .end()
+               .localSet(0).i32Const(20).localGet(0).resume(ct_inc);
+    builder.addFunction(ft_ret, {{1, B::CONTREF}}, nested_body.bytes(), "nested");
+
+    // Resume the same reference twice
+    // Locals: 0 k
+    Code stale_body;
+    stale_body.refFunc(answer).contNew(ct_ret).localTee(0).resume(ct_ret).op(0x1A)
+              .localGet(0).resume(ct_ret);
+    builder.addFunction(ft_ret, {{1, B::CONTREF}}, stale_body.bytes(), "stale");
+
+    Code unhandled_body;
+    unhandled_body.refFunc(yielder).contNew(ct_unit).resume(ct_unit);
+    builder.addFunction(ft_unit, {}, unhandled_body.bytes(), "unhandled");
+
+    Code outside_body;
+    outside_body.i32Const(1).suspend(yield);
+    builder.addFunction(ft_unit, {}, outside_body.bytes(), "outside");
+
+    Code trap_body;
+    trap_body.refFunc(boom).contNew(ct_unit).resume(ct_unit);
+    builder.addFunction(ft_unit, {}, trap_body.bytes(), "trap");
+
+    Code null_body;
+    null_body.refNull(HEAP_CONT).resume(ct_unit);
+    builder.addFunction(ft_unit, {}, null_body.bytes(), "null");
+
+    // (func (export "schedule") (param $n i32) (param $steps i32) (result i32)
+    //   start $n workers, resume each in turn until all have finished and
+    //   return the number of log entries)
+    // Locals: 2 queue, 3 i, 4 live, 5 k
+    Code schedule_body;
+    schedule_body.localGet(0).gc(ARRAY_NEW_DEFAULT).u32(queue).localSet(2)
+                 .block().loop()
+                     .localGet(3).localGet(0).op(0x4E /* i32.ge_s */).brIf(1)
+                     .localGet(2).localGet(3)
+                         .localGet(3).localGet(1).refFunc(worker).contNew(ct_worker).contBind(ct_worker, ct_unit)
+                     .gc(ARRAY_SET).u32(queue)
+                     .localGet(3).i32Const(1).op(0x6A).localSet(3)
+                     .br(0)
+                 .end().end()
+                 .localGet(0).localSet(4)
+                 .block().loop()
+                     .localGet(4).op(0x45 /* i32.eqz */).brIf(1)
+                     .i32Const(0).localSet(3)
+                     .block().loop()
+                         .localGet(3).localGet(0).op(0x4E).brIf(1)
+                         .localGet(2).localGet(3).gc(ARRAY_GET).u32(queue).localSet(5)
+                         .localGet(5).op(0xD1 /* ref.is_null */).op(0x45).ifBlock()
+                             .typedBlock(on_ask)
+                                 .localGet(5).resume(ct_unit, {{tick, 0}})
+                                 // Finished: clear its slot
+                                 .localGet(2).localGet(3).refNull(HEAP_CONT).gc(ARRAY_SET).u32(queue)
+                                 .localGet(4).i32Const(1).op(0x6B /* i32.sub */).localSet(4)
+                                 .br(1)
+                             .end()
+                             .localSet(5).localGet(2).localGet(3).localGet(5).gc(ARRAY_SET).u32(queue)
+                         .end()
+                         .localGet(3).i32Const(1).op(0x6A).localSet(3)
+                         .br(0)
+                     .end().end()
+                     .br(0)
+                 .end().end()
+                 .i32Const(0).load(0x28).i32Const(4).op(0x6E /* i32.div_u */);
+    builder.addFunction(ft_schedule, {{1, B::ANYREF}, {2, B::I32}, {1, B::CONTREF}}, schedule_body.bytes(),
+                        "schedule");
+
+    // Blocks, loops and ifs with parameters: 11 + 5 + 6 + 9
+    // Locals: 0 counter
+    Code blocks_body;
+    blocks_body.i32Const(5).i32Const(6).typedBlock(ft_pair).op(0x6A).end()
+               .i32Const(0).loop(static_cast<uint8_t>(ft_inc))
+                   .i32Const(1).op(0x6A).localTee(0).localGet(0).i32Const(5).op(0x48).brIf(0)
+               .end().op(0x6A)
+               .i32Const(3).i32Const(1).ifBlock(static_cast<uint8_t>(ft_inc))
+                   .i32Const(2).op(0x6C)
+               .elseBlock()
+                   .i32Const(100)
+               .end().op(0x6A)
+               .typedBlock(on_yield).i32Const(9).refNull(HEAP_CONT).br(0).end()
+               .op(0x1A).op(0x6A);
+    builder.addFunction(ft_ret, {{1, B::I32}}, blocks_body.bytes(), "blocks");
+    return builder.build();
+}
+
+wasm::Module decodeModule() {
+    wasm::Decoder decoder;
+    return decoder.parseBytes(continuationModule());
+}
+
+void testDecode() {
+    std::cout << "Types and tags:\n";
+    wasm::Module module = decodeModule();
+    using Kind = wasm::CompositeType::Kind;
+    const auto& types = module.composite_types;
+    check(types[1].kind == Kind::CONT && types[1].func_type == 0 && types[3].func_type == 2,
+          "continuation types name their function types");
+    check(module.tags.size() == 3 && module.tags[0] == 2 && module.tags[1] == 4 && module.tags[2] == 0,
+          "tag section");
+    check(module.types[8].results.size() == 2 && module.types[8].results[1] == wasm::ValueType::CONTREF,
+          "contref in a function type");
+    check(types[13].kind == Kind::ARRAY && types[13].fields[0].type == wasm::ValueType::CONTREF,
+          "contref array elements");
+
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(std::move(module));
+    check(callI32(interpreter, "blocks") == 31, "blocks with parameters and results");
+}
+
+void testGenerators() {
+    std::cout << "Generators:\n";
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(decodeModule());
+    check(callI32(interpreter, "sum", {wasm::TypedValue::makeI32(10)}) == 55, "bound generator yields 1..10");
+    check(interpreter.liveContinuations() == 0, "finished generator released");
+    check(callI32(interpreter, "sum", {wasm::TypedValue::makeI32(1000)}) == 500500, "1000 suspensions");
+    check(callI32(interpreter, "ret") == 42, "result passed back by resume");
+    check(callI32(interpreter, "first", {wasm::TypedValue::makeI32(10)}) == 1, "argument passed by resume");
+    check(interpreter.liveContinuations() == 1, "dropped suspended continuation stays allocated");
+    check(callI32(interpreter, "nested") == 42, "suspend handled through nested resumes");
+    check(interpreter.liveContinuations() == 1, "nested continuations released");
+
+    interpreter.instantiate(decodeModule());
+    check(interpreter.liveContinuations() == 0, "instantiate drops suspended continuations");
+}
+
+void testTraps() {
+    std::cout << "Traps:\n";
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(decodeModule());
+    check(trapOf(interpreter, "stale").find("already resumed") != std::string::npos, "stale reference");
+    check(trapOf(interpreter, "unhandled").find("Unhandled tag 0") != std::string::npos, "unhandled tag");
+    check(trapOf(interpreter, "outside").find("Unhandled tag") != std::string::npos, "suspend outside a continuation");
+    check(trapOf(interpreter, "trap").find("Unreachable") != std::string::npos, "trap crosses into the resumer");
+    check(trapOf(interpreter, "null").find("Null continuation") != std::string::npos, "null continuation");
+    check(callI32(interpreter, "sum", {wasm::TypedValue::makeI32(3)}) == 6, "runs after traps");
+}
+
+void testGreenThreads() {
+    std::cout << "Green threads:\n";
+    wasm::GcOptions options;
+    options.nursery_bytes = 4096;
+    wasm::Interpreter interpreter;
+    interpreter.setGcOptions(options);
+    interpreter.setContinuationStackSize(256 << 10);
+    interpreter.instantiate(decodeModule());
+    interpreter.takeSnapshot();
+
+    const int32_t threads = 4, steps = 50;
+    check(callI32(interpreter, "schedule", {wasm::TypedValue::makeI32(threads), wasm::TypedValue::makeI32(steps)}) ==
+          threads * steps, "every step logged");
+    bool in_order = true;
+    const uint8_t* log = interpreter.memory()->data() + 4;
+    for (int32_t i = 0; i < threads * steps; i++) {
+        int32_t id;
+        std::memcpy(&id, log + 4 * i, 4);
+        in_order = in_order && id == i % threads;
+    }
+    check(in_order, "threads interleave round-robin");
+    check(interpreter.gcHeap()->stats().minor_collections > 10, "collections while threads were suspended");
+    check(interpreter.liveContinuations() == 0, "all threads finished");
+
+    interpreter.restoreSnapshot();
+    const int32_t many = 1000;
+    check(callI32(interpreter, "schedule", {wasm::TypedValue::makeI32(many), wasm::TypedValue::makeI32(3)}) ==
+          many * 3, "1000 threads");
+    check(interpreter.liveContinuations() == 0, "stacks returned for reuse");
+}
+
+} // anonymous namespace
+
+int main() {
+    beginChecks("Stack Switching");
+
+    if (!wasm::Fiber::supported()) {
+        std::cout << "Fibers are not supported on this platform; skipping\n";
+        return 0;
+    }
+
+    testDecode();
+    testGenerators();
+    testTraps();
+    testGreenThreads();
+
+    return finishChecks("stack switching");
+}
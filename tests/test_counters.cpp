@@ -0,0 +1,120 @@
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "../include/perf_counters.h"
+#include "../benchmarks/kernels.h"
+#include "check.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Performance counter test.
+ * Collects counters per guest function while running the benchmark
+ * kernels and checks call counts, self/inclusive attribution, traps and
+ * the report. Hardware counters are often missing in VMs and containers;
+ * value checks then run on whatever is available (usually the task
+ * clock), and the fallback is checked instead.
+ *
+ * Usage: ./test_counters
+ */
+
+namespace {
+
+// Function indices in the kernel module
+constexpr uint32_t ARITH_I32 = 0;
+constexpr uint32_t MEM_SUM = 2;
+constexpr uint32_t FIB = 3;
+
+void testAvailability() {
+    std::cout << "Availability:\n";
+    wasm::PerfCounters counters;
+    std::cout << "    counters:";
+    for (size_t i = 0; i < wasm::COUNTER_COUNT; i++) {
+        wasm::Counter counter = static_cast<wasm::Counter>(i);
+        std::cout << " " << wasm::counterName(counter) << (counters.available(counter) ? "=yes" : "=no");
+    }
+    std::cout << "\n";
+
+    bool all = true;
+    for (size_t i = 0; i < wasm::COUNTER_COUNT; i++) {
+        all = all && counters.available(static_cast<wasm::Counter>(i));
+    }
+    check(all == counters.error().empty(), "missing counters explain why");
+
+    wasm::CounterValues first = counters.read();
+    volatile uint64_t sink = 0;
+    for (int i = 0; i < 1000000; i++) {
+        sink = sink + i;
+    }
+    wasm::CounterValues second = counters.read();
+    bool monotonic = true;
+    for (size_t i = 0; i < wasm::COUNTER_COUNT; i++) {
+        monotonic = monotonic && second.values[i] >= first.values[i];
+    }
+    check(monotonic, "counts never go backwards");
+    if (counters.available(wasm::Counter::INSTRUCTIONS)) {
+        check(second[wasm::Counter::INSTRUCTIONS] - first[wasm::Counter::INSTRUCTIONS] > 1000000,
+              "instructions counted");
+    }
+}
+
+void testAttribution() {
+    std::cout << "Attribution:\n";
+    wasm::Decoder decoder;
+    wasm::Interpreter interpreter;
+    auto profile = std::make_shared<wasm::CounterProfile>();
+    interpreter.setCounterProfile(profile);
+    interpreter.instantiate(decoder.parseBytes(buildKernels()));
+
+    interpreter.call("fib", {wasm::TypedValue::makeI32(10)});
+    check(profile->function(FIB).calls == 177, "every guest call counted");
+    check(profile->function(ARITH_I32).calls == 0, "uncalled functions empty");
+    check(profile->invocations() == 1, "one call from the embedder");
+
+    bool self_sums_to_total = true;
+    bool inclusive_covers_self = true;
+    for (size_t i = 0; i < wasm::COUNTER_COUNT; i++) {
+        const wasm::FunctionCounters& fib = profile->function(FIB);
+        self_sums_to_total = self_sums_to_total && fib.self.values[i] == profile->total().values[i];
+        inclusive_covers_self = inclusive_covers_self && fib.inclusive.values[i] >= fib.self.values[i];
+    }
+    check(self_sums_to_total, "self counts add up to the call total");
+    check(inclusive_covers_self, "inclusive counts cover self counts");
+    if (profile->counters().available(wasm::Counter::TASK_CLOCK)) {
+        check(profile->lastCall()[wasm::Counter::TASK_CLOCK] > 0, "task clock measured");
+    }
+
+    bool trapped = false;
+    try {
+        interpreter.call("mem_sum", {wasm::TypedValue::makeI32(300000)});
+    } catch (const std::exception&) {
+        trapped = true;
+    }
+    check(trapped && profile->function(MEM_SUM).calls == 1 && profile->invocations() == 2,
+          "trapping call still recorded");
+    interpreter.call("arith_i32", {wasm::TypedValue::makeI32(1000)});
+    check(profile->invocations() == 3 && profile->function(ARITH_I32).calls == 1, "profile usable after a trap");
+
+    std::ostringstream report;
+    profile->write(report);
+    std::string text = report.str();
+    check(text.find("fib ") != std::string::npos && text.find("total") != std::string::npos,
+          "report names functions");
+    check(profile->counters().error().empty() || text.find(profile->counters().error()) != std::string::npos,
+          "report explains missing counters");
+
+    profile->reset();
+    check(profile->invocations() == 0 && profile->function(FIB).calls == 0, "reset clears counts");
+}
+
+} // anonymous namespace
+
+int main() {
+    beginChecks("Performance Counter");
+
+    testAvailability();
+    testAttribution();
+
+    return finishChecks("counter");
+}
@@ -0,0 +1,333 @@
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "../include/types.h"
+#include "../benchmarks/wasm_builder.h"
+#include "check.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * GC proposal test.
+ * Checks that struct, array and subtype declarations decode, that struct
+ * and array instructions (packed fields included), i31 and casts compute
+ * the right values and trap on null, bad indices and failed casts, and
+ * that objects survive minor and major collections of a small heap,
+ * including old objects pointing at young ones.
+ *
+ * Usage: ./test_gc
+ */
+
+namespace {
+
+using B = WasmBuilder;
+
+// GC instruction sub-opcodes (after 0xFB)
+enum : uint32_t {
+    STRUCT_NEW = 0x00, STRUCT_NEW_DEFAULT = 0x01, STRUCT_GET = 0x02, STRUCT_GET_S = 0x03,
+    STRUCT_GET_U = 0x04, STRUCT_SET = 0x05, ARRAY_NEW = 0x06, ARRAY_NEW_FIXED = 0x08,
+    ARRAY_GET = 0x0B, ARRAY_GET_S = 0x0C, ARRAY_GET_U = 0x0D, ARRAY_LEN = 0x0F,
+    ARRAY_FILL = 0x10, ARRAY_COPY = 0x11, REF_TEST = 0x14, REF_TEST_NULL = 0x15,
+    REF_CAST = 0x16, REF_I31 = 0x1C, I31_GET_S = 0x1D, I31_GET_U = 0x1E,
+};
+
+// Abstract heap types as one-byte s33 immediates
+constexpr uint8_t HEAP_I31 = 0x6C;
+constexpr uint8_t HEAP_STRUCT = 0x6B;
+
+int32_t callI32(wasm::Interpreter& interpreter, const std::string& name, std::vector<wasm::TypedValue> args = {}) {
+    return interpreter.call(name, args)[0].value.i32;
+}
+
+std::string trapOf(wasm::Interpreter& interpreter, const std::string& name) {
+    try {
+        interpreter.call(name);
+    } catch (const wasm::Trap& e) {
+        return e.what();
+    }
+    return "";
+}
+
+/**
+ * Types shared by the tests:
+ *   0 node    struct { i32 value, anyref next }   (mutable)
+ *   1 packed  struct { i8, i16 }
+ *   2 derived struct { i32, anyref, i32 } <: node
+ *   3 bytes   array i8
+ *   4 ints    array i32
+ *   5 junk    struct { i64, i64, i64 }
+ */
+struct Types {
+    uint32_t node, packed, derived, bytes, ints, junk;
+};
+
+Types addTypes(WasmBuilder& builder) {
+    Types t;
+    t.node = builder.addStruct({{B::I32, true}, {B::ANYREF, true}});
+    t.packed = builder.addStruct({{B::I8, true}, {B::I16, true}});
+    t.derived = builder.addStruct({{B::I32, true}, {B::ANYREF, true}, {B::I32, true}}, t.node);
+    t.bytes = builder.addArray(B::I8, true);
+    t.ints = builder.addArray(B::I32, true);
+    t.junk = builder.addStruct({{B::I64, false}, {B::I64, false}, {B::I64, false}});
+    return t;
+}
+
+void testDecode() {
+    std::cout << "Type section:\n";
+    WasmBuilder builder;
+    Types t = addTypes(builder);
+    uint32_t func = builder.addType({}, {B::ANYREF});
+    Code body;
+    body.refNull();
+    builder.addFunction(func, {}, body.bytes(), "null");
+
+    wasm::Decoder decoder;
+    wasm::Module module = decoder.parseBytes(builder.build());
+    using Kind = wasm::CompositeType::Kind;
+    const auto& types = module.composite_types;
+    check(types.size() == module.types.size() && types.size() == 7, "composite types parallel func types");
+    check(types[t.node].kind == Kind::STRUCT && types[t.node].fields.size() == 2 &&
+          types[t.node].fields[1].type == wasm::ValueType::ANYREF && types[t.node].fields[1].is_mutable,
+          "struct fields");
+    check(types[t.packed].fields[0].packed_size == 1 && types[t.packed].fields[1].packed_size == 2 &&
+          types[t.packed].fields[0].type == wasm::ValueType::I32, "packed fields");
+    check(types[t.derived].supertype == t.node && types[t.node].supertype == wasm::CompositeType::NO_SUPERTYPE,
+          "supertype");
+    check(types[t.bytes].kind == Kind::ARRAY && types[t.bytes].fields[0].packed_size == 1, "array element");
+    check(types[func].kind == Kind::FUNC && module.types[func].results[0] == wasm::ValueType::ANYREF,
+          "anyref result");
+
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(std::move(module));
+    auto results = interpreter.call("null");
+    check(results.size() == 1 && results[0].type == wasm::ValueType::ANYREF && results[0].value.ref == 0 &&
+          wasm::formatValue(results[0]) == "null", "null returned to the host");
+}
+
+void testStructsAndArrays() {
+    std::cout << "Structs and arrays:\n";
+    WasmBuilder builder;
+    Types t = addTypes(builder);
+    uint32_t to_i32 = builder.addType({}, {B::I32});
+
+    // Packed fields store the low bits; get_s and get_u extend them
+    Code packed;
+    packed.i32Const(0x1FF).i32Const(0x18000).gc(STRUCT_NEW).u32(t.packed).localSet(0)
+          .localGet(0).gc(STRUCT_GET_S).u32(t.packed).u32(0)            // -1
+          .localGet(0).gc(STRUCT_GET_U).u32(t.packed).u32(1).op(0x6A)   // + 0x8000
+          .localGet(0).gc(STRUCT_GET_S).u32(t.packed).u32(1).op(0x6A);  // + -0x8000
+    builder.addFunction(to_i32, {{1, B::ANYREF}}, packed.bytes(), "packed");
+
+    // struct.set then struct.get through a nested object
+    Code nested;
+    nested.gc(STRUCT_NEW_DEFAULT).u32(t.node).localTee(0)
+          .i32Const(40).refNull().gc(STRUCT_NEW).u32(t.node).gc(STRUCT_SET).u32(t.node).u32(1)
+          .localGet(0).i32Const(2).gc(STRUCT_SET).u32(t.node).u32(0)
+          .localGet(0).gc(STRUCT_GET).u32(t.node).u32(1).gc(STRUCT_GET).u32(t.node).u32(0)
+          .localGet(0).gc(STRUCT_GET).u32(t.node).u32(0).op(0x6A);
+    builder.addFunction(to_i32, {{1, B::ANYREF}}, nested.bytes(), "nested");
+
+    // Ten 3s; fill [2, 5) with 9; copy [0, 5) over [5, 10), overlapping
+    // nothing; return a[7] * 100 + len
+    Code arrays;
+    arrays.i32Const(3).i32Const(10).gc(ARRAY_NEW).u32(t.ints).localSet(0)
+          .localGet(0).i32Const(2).i32Const(9).i32Const(3).gc(ARRAY_FILL).u32(t.ints)
+          .localGet(0).i32Const(5).localGet(0).i32Const(0).i32Const(5).gc(ARRAY_COPY).u32(t.ints).u32(t.ints)
+          .localGet(0).i32Const(7).gc(ARRAY_GET).u32(t.ints).i32Const(100).op(0x6C)
+          .localGet(0).gc(ARRAY_LEN).op(0x6A);
+    builder.addFunction(to_i32, {{1, B::ANYREF}}, arrays.bytes(), "arrays");
+
+    // Overlapping copy [0, 4) -> [1, 5) of 1 2 3 4 5 gives 1 1 2 3 4
+    Code overlap;
+    overlap.i32Const(1).i32Const(2).i32Const(3).i32Const(4).i32Const(5)
+           .gc(ARRAY_NEW_FIXED).u32(t.ints).u32(5).localTee(0)
+           .i32Const(1).localGet(0).i32Const(0).i32Const(4).gc(ARRAY_COPY).u32(t.ints).u32(t.ints)
+           .localGet(0).i32Const(4).gc(ARRAY_GET).u32(t.ints).i32Const(10).op(0x6C)
+           .localGet(0).i32Const(1).gc(ARRAY_GET).u32(t.ints).op(0x6A);
+    builder.addFunction(to_i32, {{1, B::ANYREF}}, overlap.bytes(), "overlap");
+
+    Code bytes;
+    bytes.i32Const(-1).i32Const(2).gc(ARRAY_NEW_FIXED).u32(t.bytes).u32(2).localTee(0)
+         .i32Const(0).gc(ARRAY_GET_S).u32(t.bytes)
+         .localGet(0).i32Const(0).gc(ARRAY_GET_U).u32(t.bytes).op(0x6A);
+    builder.addFunction(to_i32, {{1, B::ANYREF}}, bytes.bytes(), "bytes");
+
+    Code null_get;
+    null_get.refNull().gc(STRUCT_GET).u32(t.node).u32(0);
+    builder.addFunction(to_i32, {}, null_get.bytes(), "null_get");
+
+    Code out_of_bounds;
+    out_of_bounds.i32Const(0).i32Const(4).gc(ARRAY_NEW).u32(t.ints).i32Const(4).gc(ARRAY_GET).u32(t.ints);
+    builder.addFunction(to_i32, {}, out_of_bounds.bytes(), "out_of_bounds");
+
+    wasm::Decoder decoder;
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(decoder.parseBytes(builder.build()));
+    check(interpreter.gcHeap() != nullptr, "module with struct types gets a heap");
+    check(callI32(interpreter, "packed") == -1, "packed fields truncate and extend");
+    check(callI32(interpreter, "nested") == 42, "struct.set and nested struct.get");
+    check(callI32(interpreter, "arrays") == 910, "array.new, fill, copy, get and len");
+    check(callI32(interpreter, "overlap") == 41, "overlapping array.copy");
+    check(callI32(interpreter, "bytes") == 254, "i8 array get_s and get_u");
+    check(trapOf(interpreter, "null_get").find("Null reference") != std::string::npos, "null struct.get traps");
+    check(trapOf(interpreter, "out_of_bounds").find("Array index out of bounds") != std::string::npos,
+          "array index traps");
+}
+
+void testI31AndCasts() {
+    std::cout << "i31 and casts:\n";
+    WasmBuilder builder;
+    Types t = addTypes(builder);
+    uint32_t to_i32 = builder.addType({}, {B::I32});
+    uint32_t to_ref = builder.addType({}, {B::ANYREF});
+
+    Code i31_s;
+    i31_s.i32Const(-5).gc(REF_I31).gc(I31_GET_S);
+    builder.addFunction(to_i32, {}, i31_s.bytes(), "i31_s");
+    Code i31_u;
+    i31_u.i32Const(-5).gc(REF_I31).gc(I31_GET_U);
+    builder.addFunction(to_i32, {}, i31_u.bytes(), "i31_u");
+    Code i31_ref;
+    i31_ref.i32Const(-5).gc(REF_I31);
+    builder.addFunction(to_ref, {}, i31_ref.bytes(), "i31_ref");
+
+    // Bit k set when test k holds; expected 1 + 4 + 16 = 21
+    Code tests;
+    tests.gc(STRUCT_NEW_DEFAULT).u32(t.derived).gc(REF_TEST).u32(t.node)                            // 1
+         .gc(STRUCT_NEW_DEFAULT).u32(t.node).gc(REF_TEST).u32(t.derived).i32Const(2).op(0x6C).op(0x6A)
+         .i32Const(5).gc(REF_I31).gc(REF_TEST).op(HEAP_I31).i32Const(4).op(0x6C).op(0x6A)       // 4
+         .i32Const(5).gc(REF_I31).gc(REF_TEST).op(HEAP_STRUCT).i32Const(8).op(0x6C).op(0x6A)
+         .refNull().gc(REF_TEST_NULL).u32(t.node).i32Const(16).op(0x6C).op(0x6A)                 // 16
+         .refNull().gc(REF_TEST).u32(t.node).i32Const(32).op(0x6C).op(0x6A);
+    builder.addFunction(to_i32, {}, tests.bytes(), "tests");
+
+    Code bad_cast;
+    bad_cast.gc(STRUCT_NEW_DEFAULT).u32(t.node).gc(REF_CAST).u32(t.derived).op(0x1A /* drop */).i32Const(0);
+    builder.addFunction(to_i32, {}, bad_cast.bytes(), "bad_cast");
+
+    wasm::Decoder decoder;
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(decoder.parseBytes(builder.build()));
+    check(callI32(interpreter, "i31_s") == -5, "i31.get_s");
+    check(callI32(interpreter, "i31_u") == 0x7FFFFFFB, "i31.get_u");
+    check(wasm::formatValue(interpreter.call("i31_ref")[0]) == "i31:-5", "i31 formatted for the host");
+    check(callI32(interpreter, "tests") == 21, "ref.test on subtypes, i31, struct and null");
+    check(trapOf(interpreter, "bad_cast").find("Cast failure") != std::string::npos, "failed ref.cast traps");
+}
+
+// (func $list (param $n i32) (result i32)
+//   build n nodes, each cons'ed in front, with a junk struct per node,
+//   then walk the list and sum the values)
+Code listBody(const Types& t) {
+    Code c;
+    c.block().loop()
+        .localGet(1).localGet(0).op(0x4E /* i32.ge_s */).brIf(1)
+        .localGet(1).localGet(2).gc(STRUCT_NEW).u32(t.node).localSet(2)
+        .gc(STRUCT_NEW_DEFAULT).u32(t.junk).op(0x1A /* drop */)
+        .localGet(1).i32Const(1).op(0x6A).localSet(1)
+        .br(0)
+     .end().end()
+     .block().loop()
+        .localGet(2).op(0xD1 /* ref.is_null */).brIf(1)
+        .localGet(3).localGet(2).gc(STRUCT_GET).u32(t.node).u32(0).op(0x6A).localSet(3)
+        .localGet(2).gc(STRUCT_GET).u32(t.node).u32(1).localSet(2)
+        .br(0)
+     .end().end()
+     .localGet(3);
+    return c;
+}
+
+// n junk structs, counting in local 1
+void junkLoop(Code& c, const Types& t) {
+    c.i32Const(0).localSet(1)
+     .block().loop()
+        .localGet(1).localGet(0).op(0x4E /* i32.ge_s */).brIf(1)
+        .gc(STRUCT_NEW_DEFAULT).u32(t.junk).op(0x1A /* drop */)
+        .localGet(1).i32Const(1).op(0x6A).localSet(1)
+        .br(0)
+     .end().end();
+}
+
+// (func $barrier (param $n i32) (result i32)
+//   allocate a holder and n junk structs, so the holder is promoted;
+//   store a fresh node with value 42 in it, allocate n more junk structs
+//   and return the node's value)
+Code barrierBody(const Types& t) {
+    Code c;
+    c.gc(STRUCT_NEW_DEFAULT).u32(t.node).localSet(2);
+    junkLoop(c, t);
+    c.localGet(2).i32Const(42).refNull().gc(STRUCT_NEW).u32(t.node).gc(STRUCT_SET).u32(t.node).u32(1);
+    junkLoop(c, t);
+    c.localGet(2).gc(STRUCT_GET).u32(t.node).u32(1).gc(STRUCT_GET).u32(t.node).u32(0);
+    return c;
+}
+
+wasm::Module collectorModule() {
+    WasmBuilder builder;
+    Types t = addTypes(builder);
+    uint32_t type = builder.addType({B::I32}, {B::I32});
+    builder.addFunction(type, {{1, B::I32}, {1, B::ANYREF}, {1, B::I32}}, listBody(t).bytes(), "list");
+    builder.addFunction(type, {{1, B::I32}, {1, B::ANYREF}}, barrierBody(t).bytes(), "barrier");
+    wasm::Decoder decoder;
+    return decoder.parseBytes(builder.build());
+}
+
+void testCollections() {
+    std::cout << "Collections:\n";
+    const int32_t n = 5000;
+    const int32_t sum = n * (n - 1) / 2;
+
+    wasm::GcOptions options;
+    options.nursery_bytes = 4096;
+    wasm::Interpreter interpreter;
+    interpreter.setGcOptions(options);
+    interpreter.instantiate(collectorModule());
+
+    check(callI32(interpreter, "list", {wasm::TypedValue::makeI32(n)}) == sum, "list survives minor collections");
+    wasm::GcStats stats = interpreter.gcHeap()->stats();
+    check(stats.allocations == 2 * n && stats.minor_collections > 10, "nursery collected");
+    check(stats.promoted_bytes >= static_cast<uint64_t>(n) * 16 && stats.promoted_bytes < stats.allocated_bytes / 2,
+          "live nodes promoted, junk left behind");
+    check(stats.major_collections == 0, "no major collection under the threshold");
+
+    check(callI32(interpreter, "barrier", {wasm::TypedValue::makeI32(2000)}) == 42,
+          "old holder keeps its young node alive");
+
+    options.major_threshold = 64 << 10;
+    interpreter.setGcOptions(options);
+    interpreter.instantiate(collectorModule());
+    check(callI32(interpreter, "list", {wasm::TypedValue::makeI32(n)}) == sum, "list survives major collections");
+    check(callI32(interpreter, "barrier", {wasm::TypedValue::makeI32(2000)}) == 42,
+          "barrier with major collections");
+    stats = interpreter.gcHeap()->stats();
+    check(stats.major_collections > 0 && stats.max_pause_ns > 0 && stats.total_pause_ns >= stats.max_pause_ns,
+          "major collections and pauses recorded");
+
+    interpreter.gcHeap()->collect();
+    check(interpreter.gcHeap()->stats().old_bytes == 0, "nothing live once the calls return");
+}
+
+void testSnapshot() {
+    std::cout << "Snapshot:\n";
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(collectorModule());
+    interpreter.takeSnapshot();
+    check(callI32(interpreter, "list", {wasm::TypedValue::makeI32(100)}) == 4950, "runs before restore");
+    interpreter.restoreSnapshot();
+    check(interpreter.gcHeap()->stats().old_bytes == 0, "restore drops every object");
+    check(callI32(interpreter, "list", {wasm::TypedValue::makeI32(100)}) == 4950, "runs after restore");
+}
+
+} // anonymous namespace
+
+int main() {
+    beginChecks("GC");
+
+    testDecode();
+    testStructsAndArrays();
+    testI31AndCasts();
+    testCollections();
+    testSnapshot();
+
+    return finishChecks("GC");
+}
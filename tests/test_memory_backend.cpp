@@ -0,0 +1,362 @@
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "../include/memory.h"
+#include "../benchmarks/kernels.h"
+#include "check.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+/**
+ * Linear memory backend test.
+ * Runs the same accesses, growth and copies on every backend, and checks
+ * that LAZY memory keeps data() stable across growth and only populates
+ * the pages that are touched or hold data, and that HUGE_PAGES memory is
+ * 2 MiB aligned and falls back when huge pages are not available. Also
+ * checks that a dirty-page reset restores exactly the pristine contents,
+ * and that data segments of a module file are mapped from it on LAZY
+ * memory without changing what the guest sees. Checks each bounds check
+ * policy: explicit and guard-page checks trap, masking wraps.
+ *
+ * Usage: ./test_memory_backend
+ */
+
+namespace {
+
+const wasm::MemoryBackend BACKENDS[] = {wasm::MemoryBackend::HEAP, wasm::MemoryBackend::LAZY,
+                                        wasm::MemoryBackend::HUGE_PAGES};
+
+// Resident set size from /proc, or 0 where it is not available
+size_t residentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t total = 0, resident = 0;
+    if (!(statm >> total >> resident)) {
+        return 0;
+    }
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+void testSemantics(wasm::MemoryBackend backend) {
+    std::cout << "Semantics (" << wasm::memoryBackendName(backend) << "):\n";
+    wasm::Memory memory(wasm::Limits(1, 4), backend);
+    check(memory.backend() == backend, "backend selected");
+
+    bool zero = true;
+    for (uint32_t address = 0; address < memory.sizeInBytes(); address += 4096) {
+        zero = zero && memory.loadU32(address) == 0;
+    }
+    check(zero, "initial memory reads as zero");
+
+    memory.storeI64(65528, -2);
+    check(memory.loadI64(65528) == -2, "store then load at the end");
+    bool trapped = false;
+    try {
+        memory.loadI32(65534);
+    } catch (const wasm::MemoryError&) {
+        trapped = true;
+    }
+    check(trapped, "access across the end traps");
+
+    check(memory.grow(2) == 1 && memory.size() == 3, "grow returns the old size");
+    check(memory.loadU64(65536 * 2 + 8) == 0 && memory.loadI64(65528) == -2, "grown pages zero, old data kept");
+    check(memory.grow(2) == -1 && memory.size() == 3, "grow past the maximum fails");
+
+    wasm::Memory copy(memory);
+    copy.storeU8(5, 9);
+    check(copy.size() == 3 && copy.loadI64(65528) == -2 && memory.loadU8(5) == 0, "copies are independent");
+
+    wasm::Memory smaller(wasm::Limits(1, 4), backend);
+    smaller.storeU8(100, 1);
+    copy = smaller;
+    check(copy.size() == 1 && copy.loadU8(100) == 1 && copy.loadU8(5) == 0, "assignment replaces size and contents");
+
+    wasm::Memory other(wasm::Limits(2), backend == BACKENDS[0] ? BACKENDS[1] : BACKENDS[0]);
+    other = memory;
+    check(other.backend() == memory.backend() && other.loadI64(65528) == -2, "assignment across backends");
+}
+
+void testDirtyReset(wasm::MemoryBackend backend) {
+    std::cout << "Dirty-page reset (" << wasm::memoryBackendName(backend) << "):\n";
+    wasm::Memory memory(wasm::Limits(2, 8), backend);
+    const uint8_t segment[] = {1, 2, 3, 4};
+    memory.initialize(70000, segment, sizeof(segment));
+    wasm::Memory pristine(memory);
+    memory.trackDirtyPages(true);
+    check(memory.dirtyPageCount() == 0 && !pristine.tracksDirtyPages(), "tracking starts clean, copies untracked");
+
+    memory.storeU32(70000, 0xDEADBEEF);             // page 17, over data
+    memory.storeU64(8190, 0);                       // straddles pages 1 and 2
+    memory.initialize(100, segment, sizeof(segment));
+    check(memory.dirtyPageCount() == 4, "stores and initialize mark pages");
+    memory.grow(3);
+    memory.storeU8(4 * wasm::Memory::PAGE_SIZE, 5);
+
+    size_t restored = memory.resetTo(pristine);
+    check(restored == 4 && memory.size() == 2 && memory.dirtyPageCount() == 0, "reset rewrites dirty pages only");
+    check(memory.loadU32(70000) == 0x04030201 && memory.loadU8(100) == 0 && memory.loadU64(8190) == 0,
+          "pristine contents back");
+    check(memory.grow(3) == 2 && memory.loadU8(4 * wasm::Memory::PAGE_SIZE) == 0, "growth undone, regrows zeroed");
+
+    // A zero run long enough to go back to the kernel
+    for (uint32_t offset = 0; offset < 2 * wasm::Memory::PAGE_SIZE; offset += 4096) {
+        memory.storeU8(offset, 0xFF);
+    }
+    memory.resetTo(pristine);
+    bool clean = memory.loadU32(70000) == 0x04030201;
+    for (uint32_t offset = 0; offset < 2 * wasm::Memory::PAGE_SIZE; offset += 4096) {
+        clean = clean && memory.loadU8(offset) == 0;
+    }
+    check(clean, "long zero runs reset");
+
+    memory.markDirty(0, 1u << 30);
+    check(memory.dirtyPageCount() == 32, "markDirty clamps to the memory");
+    memory.trackDirtyPages(false);
+    memory.storeU8(5, 1);
+    check(memory.resetTo(pristine) == 32 && memory.loadU8(5) == 0, "untracked reset copies everything");
+}
+
+void testLazy() {
+    std::cout << "Lazy population:\n";
+    size_t before = residentBytes();
+    wasm::Memory memory(wasm::Limits(16384), wasm::MemoryBackend::LAZY);    // 1 GiB
+    size_t created = residentBytes();
+    const uint8_t* base = memory.data();
+
+    for (uint32_t page = 0; page < 64; page++) {
+        memory.storeU8(page * wasm::Memory::PAGE_SIZE, 1);
+    }
+    size_t touched = residentBytes();
+
+    wasm::Memory copy(memory);
+    size_t copied = residentBytes();
+
+    check(memory.grow(16) == 16384 && memory.data() == base, "data() stable across grow");
+    check(copy.loadU8(63 * wasm::Memory::PAGE_SIZE) == 1 && copy.loadU8(1) == 0, "copy has the touched bytes");
+
+    if (before == 0) {
+        std::cout << "  SKIP resident set checks (/proc not available)\n";
+        return;
+    }
+    std::cout << "    RSS: +" << (created - before) / 1024 << " KiB for 1 GiB, +" << (touched - created) / 1024
+              << " KiB after touching 64 pages, +" << (copied - touched) / 1024 << " KiB for the copy\n";
+    check(created - before < (16u << 20), "untouched memory is not resident");
+    check(touched - created < (16u << 20), "touching a page populates about one OS page");
+    check(copied - touched < (16u << 20), "copy skips zero pages");
+}
+
+void testHugePages() {
+    std::cout << "Huge pages:\n";
+    wasm::Memory bounded(wasm::Limits(1, 64), wasm::MemoryBackend::HUGE_PAGES);
+    wasm::Memory unbounded(wasm::Limits(1), wasm::MemoryBackend::HUGE_PAGES);
+    if (bounded.backend() != wasm::MemoryBackend::HUGE_PAGES) {
+        std::cout << "  SKIP huge page checks (no mmap)\n";
+        return;
+    }
+    std::string source = bounded.hugePageSource();
+    std::cout << "    bounded memory uses " << source << ", unbounded uses " << unbounded.hugePageSource() << "\n";
+    check(source == "hugetlbfs" || source == "transparent" || source == "none", "huge page source reported");
+    check(std::string(unbounded.hugePageSource()) != "hugetlbfs", "unbounded memory never pins hugetlbfs pages");
+
+    const uint8_t* base = bounded.data();
+    check(reinterpret_cast<uintptr_t>(base) % wasm::Memory::HUGE_PAGE_SIZE == 0 &&
+          reinterpret_cast<uintptr_t>(unbounded.data()) % wasm::Memory::HUGE_PAGE_SIZE == 0, "2 MiB aligned");
+
+    bounded.storeU32(65532, 7);
+    check(bounded.grow(40) == 1 && bounded.data() == base && bounded.loadU32(65532) == 7,
+          "growth keeps data() and contents");
+    bool trapped = false;
+    try {
+        bounded.loadU8(41 * wasm::Memory::PAGE_SIZE);
+    } catch (const wasm::MemoryError&) {
+        trapped = true;
+    }
+    check(trapped, "bounds follow wasm pages, not the huge page");
+    check(unbounded.grow(100) == 1 && unbounded.loadU64(100 * wasm::Memory::PAGE_SIZE) == 0, "unbounded memory grows");
+    check(std::string(wasm::Memory(wasm::Limits(1), wasm::MemoryBackend::LAZY).hugePageSource()).empty(),
+          "other backends report no huge pages");
+}
+
+// (memory 64) (data (i32.const offset) payload)
+// (func (export "load") (param i32) (result i32) (i32.load (local.get 0)))
+WasmBuilder::Bytes buildDataModule(uint32_t offset, const WasmBuilder::Bytes& payload) {
+    using B = WasmBuilder;
+    WasmBuilder builder;
+    uint32_t type = builder.addType({B::I32}, {B::I32});
+    Code load;
+    load.localGet(0).load(0x28 /* i32.load */);
+    builder.addFunction(type, {}, load.bytes(), "load");
+    builder.setMemory(64);
+    builder.addData(offset, payload);
+    return builder.build();
+}
+
+void testMappedData() {
+    std::cout << "Mapped data segments:\n";
+    // 1 MiB payload, placed so its file and memory offsets share a page
+    // offset; 2^17 + 4095 still encodes in the same three LEB bytes
+    WasmBuilder::Bytes payload(1 << 20);
+    for (size_t i = 0; i < payload.size(); i++) {
+        payload[i] = static_cast<uint8_t>(i * 7 + 1);
+    }
+    WasmBuilder::Bytes bytes = buildDataModule(1 << 17, payload);
+    size_t position = static_cast<size_t>(
+        std::search(bytes.begin(), bytes.end(), payload.begin(), payload.begin() + 64) - bytes.begin());
+    uint32_t offset = (1u << 17) + static_cast<uint32_t>(position % 4096);
+    bytes = buildDataModule(offset, payload);
+
+    std::string path = "/tmp/wasm-test-mapped-" + std::to_string(getpid()) + ".wasm";
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(bytes.data()),
+                                                 static_cast<std::streamsize>(bytes.size()));
+
+    wasm::Decoder decoder;
+    wasm::Module module = decoder.parse(path);
+    const wasm::DataSegment& segment = module.data_segments[0];
+    check(module.source && module.source->contains(segment.data.data(), segment.data.size()),
+          "segment left in the file mapping");
+
+    wasm::Memory memory(wasm::Limits(64), wasm::MemoryBackend::LAZY);
+    size_t mapped = memory.initializeMapped(offset, module.source, position, payload.size());
+    check(mapped >= payload.size() - 8192 && std::equal(payload.begin(), payload.end(), memory.data() + offset),
+          "aligned pages mapped, contents exact");
+    wasm::Memory heap(wasm::Limits(64), wasm::MemoryBackend::HEAP);
+    check(heap.initializeMapped(offset, module.source, position, payload.size()) == 0 &&
+          std::equal(payload.begin(), payload.end(), heap.data() + offset), "heap memory copies");
+
+    wasm::Memory copy(memory);
+    memory.storeU32(offset + 8192, 0);
+    check(copy.loadU32(offset + 8192) != 0 && module.source->data()[position + 8192] == payload[8192],
+          "writes stay private to the instance");
+    memory.trackDirtyPages(true);
+    memory.storeU32(offset + 8192, 0);
+    memory.resetTo(copy);
+    check(memory.loadU32(offset + 8192) == copy.loadU32(offset + 8192), "reset restores file data");
+    memory.clear();
+    check(memory.loadU32(offset + 4096 * 10) == 0 && memory.loadU8(offset) == 0, "clear zeroes mapped pages");
+
+    int32_t loaded[2];
+    for (int i = 0; i < 2; i++) {
+        wasm::Interpreter interpreter;
+        interpreter.setMemoryBackend(BACKENDS[i]);
+        interpreter.instantiate(decoder.parse(path));
+        loaded[i] = interpreter.call("load", {wasm::TypedValue::makeI32(static_cast<int32_t>(offset + 500000))})[0]
+                        .value.i32;
+    }
+    int32_t expected;
+    std::memcpy(&expected, payload.data() + 500000, sizeof(expected));
+    check(loaded[0] == expected && loaded[1] == expected, "instances see the segment");
+    std::remove(path.c_str());
+}
+
+template<typename F>
+bool throwsMemoryError(F access) {
+    try {
+        access();
+    } catch (const wasm::MemoryError&) {
+        return true;
+    }
+    return false;
+}
+
+void testBoundsCheck() {
+    std::cout << "Bounds checks:\n";
+    using wasm::BoundsCheck;
+    wasm::Memory explicit_memory(wasm::Limits(1), wasm::MemoryBackend::LAZY, BoundsCheck::EXPLICIT);
+    check(throwsMemoryError([&] { explicit_memory.loadAt<BoundsCheck::EXPLICIT, int32_t>(65534, 0); }) &&
+          throwsMemoryError([&] { explicit_memory.storeAt<BoundsCheck::EXPLICIT, uint8_t>(65535, 1, 1); }),
+          "explicit: out of bounds throws");
+
+    wasm::Memory masked(wasm::Limits(1), wasm::MemoryBackend::LAZY, BoundsCheck::MASKED);
+    check(masked.boundsCheck() == BoundsCheck::MASKED, "masked: power-of-two size uses the mask");
+    masked.storeAt<BoundsCheck::MASKED, int32_t>(65536, 8, 7);
+    check(masked.loadAt<BoundsCheck::MASKED, int32_t>(8, 0) == 7, "masked: out of bounds wraps");
+    masked.loadAt<BoundsCheck::MASKED, int64_t>(UINT32_MAX, UINT32_MAX);
+    check(masked.loadU8(65535) == 0, "masked: largest effective address stays inside");
+    wasm::Memory odd(wasm::Limits(3), wasm::MemoryBackend::LAZY, BoundsCheck::MASKED);
+    check(odd.boundsCheck() == BoundsCheck::EXPLICIT, "masked: other sizes fall back to explicit");
+    odd.grow(1);
+    check(odd.boundsCheck() == BoundsCheck::MASKED, "masked: used once grown to a power of two");
+
+    wasm::Memory heap(wasm::Limits(1), wasm::MemoryBackend::HEAP, BoundsCheck::GUARD);
+    check(heap.boundsCheck() == BoundsCheck::EXPLICIT, "guard: heap memory falls back to explicit");
+#ifdef __linux__
+    wasm::Memory guarded(wasm::Limits(1), wasm::MemoryBackend::LAZY, BoundsCheck::GUARD);
+    check(guarded.boundsCheck() == BoundsCheck::GUARD, "guard: lazy memory uses guard pages");
+    guarded.storeAt<BoundsCheck::GUARD, int32_t>(65532, 0, 42);
+    check(guarded.loadAt<BoundsCheck::GUARD, int32_t>(65530, 2) == 42, "guard: in bounds access");
+    int traps = 0;
+    for (int i = 0; i < 3; i++) {
+        traps += throwsMemoryError([&] { guarded.loadAt<BoundsCheck::GUARD, int32_t>(65534, 0); });
+        traps += throwsMemoryError([&] { guarded.storeAt<BoundsCheck::GUARD, int64_t>(UINT32_MAX, UINT32_MAX, 1); });
+    }
+    check(traps == 6, "guard: faults past the end throw, repeatedly");
+    guarded.grow(1);
+    guarded.storeAt<BoundsCheck::GUARD, int32_t>(65536, 0, 9);
+    wasm::Memory copy(guarded);
+    check(copy.boundsCheck() == BoundsCheck::GUARD && copy.loadAt<BoundsCheck::GUARD, int32_t>(65536, 0) == 9 &&
+          throwsMemoryError([&] { copy.loadAt<BoundsCheck::GUARD, uint8_t>(131072, 0); }),
+          "guard: growth and copies stay guarded");
+#endif
+
+    // A load past the end of 64 pages: trap, or the word at 0 when masked
+    wasm::Decoder decoder;
+    for (BoundsCheck bounds : {BoundsCheck::EXPLICIT, BoundsCheck::MASKED, BoundsCheck::GUARD}) {
+        wasm::Interpreter interpreter;
+        interpreter.setMemoryBackend(wasm::MemoryBackend::LAZY);
+        interpreter.setBoundsCheck(bounds);
+        interpreter.instantiate(decoder.parseBytes(buildDataModule(0, {1, 0, 0, 0})));
+        bool trapped = false;
+        int32_t loaded = 0;
+        try {
+            loaded = interpreter.call("load", {wasm::TypedValue::makeI32(64 * 65536)})[0].value.i32;
+        } catch (const std::exception&) {
+            trapped = true;
+        }
+        bool expected = bounds == BoundsCheck::MASKED ? !trapped && loaded == 1 : trapped;
+        int32_t first = interpreter.call("load", {wasm::TypedValue::makeI32(0)})[0].value.i32;
+        check(expected && first == 1, std::string("interpreter: ") + wasm::boundsCheckName(bounds));
+    }
+}
+
+void testInterpreter() {
+    std::cout << "Interpreter:\n";
+    wasm::Decoder decoder;
+    int32_t sums[3];
+    for (int i = 0; i < 3; i++) {
+        wasm::Interpreter interpreter;
+        interpreter.setMemoryBackend(BACKENDS[i]);
+        interpreter.instantiate(decoder.parseBytes(buildKernels()));
+        sums[i] = interpreter.call("mem_sum", {wasm::TypedValue::makeI32(100000)})[0].value.i32;
+        check(interpreter.memory()->backend() == BACKENDS[i],
+              std::string("instance uses ") + wasm::memoryBackendName(BACKENDS[i]));
+    }
+    check(sums[0] == sums[1] && sums[0] == sums[2], "kernels agree across backends");
+
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(decoder.parse("tests/wat/03_test_prio2.wasm"));
+    check(interpreter.memory()->backend() == wasm::defaultMemoryBackend(), "default backend used");
+}
+
+} // anonymous namespace
+
+int main() {
+    beginChecks("Memory Backend");
+
+    for (wasm::MemoryBackend backend : BACKENDS) {
+        testSemantics(backend);
+    }
+    for (wasm::MemoryBackend backend : BACKENDS) {
+        testDirtyReset(backend);
+    }
+    testLazy();
+    testHugePages();
+    testMappedData();
+    testBoundsCheck();
+    testInterpreter();
+
+    return finishChecks("memory backend");
+}
@@ -0,0 +1,173 @@
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "../include/memory_profile.h"
+#include "../benchmarks/wasm_builder.h"
+#include "check.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Memory access heatmap test.
+ * Counts loads, stores and data segment writes per page through the
+ * interpreter, and checks sampling, page-crossing accesses, touched-page
+ * windows, growth and the CSV and PPM output.
+ *
+ * Usage: ./test_memory_profile
+ */
+
+namespace {
+
+using B = WasmBuilder;
+
+// (memory 2)
+// (func (export "store") (param i32 i32) (i32.store (local.get 0) (local.get 1)))
+// (func (export "load") (param i32) (result i32) (i32.load (local.get 0)))
+// (func (export "grow") (result i32) (memory.grow (i32.const 1)))
+// (data (i32.const 65536) "\01\02\03\04")
+WasmBuilder::Bytes buildModule() {
+    WasmBuilder builder;
+    uint32_t ft_store = builder.addType({B::I32, B::I32}, {});
+    uint32_t ft_load = builder.addType({B::I32}, {B::I32});
+    uint32_t ft_result = builder.addType({}, {B::I32});
+    builder.setMemory(2);
+
+    Code store;
+    store.localGet(0).localGet(1).store(0x36 /* i32.store */);
+    builder.addFunction(ft_store, {}, store.bytes(), "store");
+
+    Code load;
+    load.localGet(0).load(0x28 /* i32.load */);
+    builder.addFunction(ft_load, {}, load.bytes(), "load");
+
+    Code grow;
+    grow.i32Const(1).op(0x40 /* memory.grow */).op(0x00);
+    builder.addFunction(ft_result, {}, grow.bytes(), "grow");
+
+    builder.addData(65536, {0x01, 0x02, 0x03, 0x04});
+    return builder.build();
+}
+
+void instantiate(wasm::Interpreter& interpreter, const std::shared_ptr<wasm::MemoryProfile>& profile) {
+    wasm::Decoder decoder;
+    interpreter.setMemoryProfile(profile);
+    interpreter.instantiate(decoder.parseBytes(buildModule()));
+}
+
+void store(wasm::Interpreter& interpreter, int32_t address) {
+    interpreter.call("store", {wasm::TypedValue::makeI32(address), wasm::TypedValue::makeI32(7)});
+}
+
+void load(wasm::Interpreter& interpreter, int32_t address) {
+    interpreter.call("load", {wasm::TypedValue::makeI32(address)});
+}
+
+void testCounts() {
+    std::cout << "Counts:\n";
+    auto profile = std::make_shared<wasm::MemoryProfile>();
+    wasm::Interpreter interpreter;
+    instantiate(interpreter, profile);
+
+    check(profile->pageCount() == 2, "profile sized to the memory");
+    check(profile->writes(1) == 1 && profile->touchedPages() == 1, "data segment counted as one bulk write");
+
+    store(interpreter, 0);
+    store(interpreter, 100);
+    for (int i = 0; i < 3; i++) {
+        load(interpreter, 70000);
+    }
+    check(profile->writes(0) == 2 && profile->reads(0) == 0, "stores counted on their page");
+    check(profile->reads(1) == 3 && profile->writes(1) == 1, "loads counted on their page");
+
+    load(interpreter, 65534);
+    check(profile->reads(0) == 1 && profile->reads(1) == 4, "page-crossing access counts both pages");
+
+    bool trapped = false;
+    try {
+        load(interpreter, 2 * 65536);
+    } catch (const wasm::MemoryError&) {
+        trapped = true;
+    }
+    check(trapped && profile->totalReads() == 5, "out-of-bounds access not counted");
+}
+
+void testWindows() {
+    std::cout << "Touched pages:\n";
+    auto profile = std::make_shared<wasm::MemoryProfile>();
+    wasm::Interpreter interpreter;
+    instantiate(interpreter, profile);
+
+    store(interpreter, 0);
+    check(profile->touchedPages() == 2 && profile->peakTouchedPages() == 2, "both pages touched");
+    profile->startWindow();
+    check(profile->touchedPages() == 0, "new window starts empty");
+    load(interpreter, 70000);
+    load(interpreter, 70004);
+    check(profile->touchedPages() == 1 && profile->peakTouchedPages() == 2, "peak kept across windows");
+    check(profile->reads(1) == 2, "counts kept across windows");
+
+    interpreter.call("grow");
+    check(profile->pageCount() == 3, "grow extends the profile");
+    store(interpreter, 2 * 65536);
+    check(profile->writes(2) == 1 && profile->touchedPages() == 2, "grown page recorded");
+
+    profile->reset();
+    check(profile->totalReads() == 0 && profile->totalWrites() == 0 && profile->peakTouchedPages() == 0,
+          "reset clears counts and peak");
+}
+
+void testSampling() {
+    std::cout << "Sampling:\n";
+    auto profile = std::make_shared<wasm::MemoryProfile>(4);
+    wasm::Interpreter interpreter;
+    instantiate(interpreter, profile);
+
+    for (int i = 0; i < 8; i++) {
+        load(interpreter, 0);
+    }
+    check(profile->reads(0) == 8, "sampled counts scaled by the rate");
+    for (int i = 0; i < 3; i++) {
+        load(interpreter, 0);
+    }
+    check(profile->reads(0) == 8, "accesses between samples skipped");
+    check(profile->writes(1) == 1, "bulk writes not sampled");
+}
+
+void testOutput() {
+    std::cout << "Output:\n";
+    wasm::MemoryProfile profile;
+    profile.resize(3);
+    profile.recordRead(0, 4);
+    profile.recordWrite(65536, 8);
+    profile.recordBulkWrite(65000, 70000);
+
+    std::ostringstream csv;
+    profile.write(csv, wasm::HeatmapFormat::CSV);
+    check(csv.str() == "# pages=3 touched=3 peak_touched=3 sample_rate=1\n"
+                       "page,reads,writes\n0,1,1\n1,0,2\n2,0,1\n",
+          "CSV has one row per page");
+
+    std::ostringstream ppm;
+    profile.write(ppm, wasm::HeatmapFormat::PPM);
+    std::string header = "P6\n512 8\n255\n";
+    std::string image = ppm.str();
+    check(image.compare(0, header.size(), header) == 0, "PPM header");
+    check(image.size() == header.size() + 512 * 8 * 3, "PPM has one cell per page");
+    const uint8_t* pixels = reinterpret_cast<const uint8_t*>(image.data() + header.size());
+    check(pixels[0] > 0 && pixels[1] > 0 && pixels[2] == 0, "accessed page drawn in red and green");
+    check(pixels[3 * 8 * 3] == 0 && pixels[3 * 8 * 3 + 2] > 0, "pages past the end drawn in blue");
+}
+
+} // anonymous namespace
+
+int main() {
+    beginChecks("Memory Heatmap");
+
+    testCounts();
+    testWindows();
+    testSampling();
+    testOutput();
+
+    return finishChecks("memory profile");
+}
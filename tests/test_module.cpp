@@ -0,0 +1,281 @@
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "../benchmarks/wasm_builder.h"
+#include "check.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Module test.
+ * Checks that function bodies cannot overrun the code section they are
+ * copied from, that init expressions end at their END rather than at an
+ * immediate byte equal to 0x0B, and the limit on locals per function.
+ * Also checks the precomputed index spaces and export index, and that
+ * element segments fill table 0 at instantiation and are bounds checked,
+ * and that files decode alike whether mapped or read into a buffer.
+ *
+ * Usage: ./test_module
+ */
+
+namespace {
+
+using B = WasmBuilder;
+
+bool rejects(const WasmBuilder::Bytes& bytes) {
+    try {
+        wasm::Decoder decoder;
+        decoder.parseBytes(bytes);
+    } catch (const wasm::DecoderError&) {
+        return true;
+    }
+    return false;
+}
+
+// Rewrite the size of section id, whose size must fit one LEB128 byte
+WasmBuilder::Bytes withSectionSize(WasmBuilder::Bytes bytes, uint8_t id, uint8_t size) {
+    size_t pos = 8;
+    while (pos < bytes.size()) {
+        uint8_t section = bytes[pos];
+        uint32_t length = 0;
+        int shift = 0;
+        size_t size_pos = pos + 1;
+        uint8_t byte;
+        do {
+            byte = bytes[++pos];
+            length |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        if (section == id) {
+            bytes[size_pos] = size;
+            return bytes;
+        }
+        pos += 1 + length;
+    }
+    return bytes;
+}
+
+void testCodeSection() {
+    std::cout << "Code section:\n";
+    // A 20-byte body with an i64 local; copying it whole into a block the
+    // size of the declared section would overrun the arena
+    WasmBuilder builder;
+    uint32_t type = builder.addType({}, {B::I64});
+    Code body;
+    body.i64Const(0x123456789ABCDEF).localSet(0).localGet(0).op(0x01 /* nop */).op(0x01).op(0x01);
+    builder.addFunction(type, {{1, B::I64}}, body.bytes(), "run");
+    WasmBuilder::Bytes bytes = builder.build();
+
+    wasm::Decoder decoder;
+    wasm::Module module = decoder.parseBytes(bytes);
+    check(module.functions.size() == 1 && module.functions[0].locals.size() == 1 &&
+          module.functions[0].locals[0] == wasm::ValueType::I64, "well-formed body decodes");
+    check(rejects(withSectionSize(bytes, 10, 3)), "body longer than the declared section rejected");
+    check(rejects(withSectionSize(bytes, 10, 1)), "body size past the declared section rejected");
+}
+
+void testInitExpressions() {
+    std::cout << "\nInit expressions:\n";
+    WasmBuilder builder;
+    uint32_t type = builder.addType({}, {B::I32});
+    builder.addGlobal(B::I32, false, 11);    // i32.const 11 is 0x41 0x0B
+    builder.addGlobal(B::I32, false, 42);
+    Code first;
+    first.globalGet(0);
+    builder.addFunction(type, {}, first.bytes(), "first");
+    Code second;
+    second.globalGet(1);
+    builder.addFunction(type, {}, second.bytes(), "second");
+    wasm::Decoder decoder;
+    wasm::Module module = decoder.parseBytes(builder.build());
+    check(module.globals.size() == 2 && module.globals[0].init_expr.size() == 3,
+          "immediate 0x0B is not taken as END");
+
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(std::move(module));
+    check(interpreter.call("first", {})[0].value.i32 == 11 && interpreter.call("second", {})[0].value.i32 == 42,
+          "globals after it keep their values");
+}
+
+void testLocalsLimit() {
+    std::cout << "\nLocals:\n";
+    auto withLocals = [](uint32_t count) {
+        WasmBuilder builder;
+        uint32_t type = builder.addType({}, {});
+        builder.addFunction(type, {{count / 2, B::I32}, {count - count / 2, B::F64}}, {});
+        return builder.build();
+    };
+    wasm::Decoder decoder;
+    check(decoder.parseBytes(withLocals(50000)).functions[0].locals.size() == 50000, "50000 locals accepted");
+    check(rejects(withLocals(50001)), "50001 locals rejected");
+    check(rejects(withLocals(0xFFFFFFFF)), "locals count near 2^32 rejected before expanding");
+}
+
+// Imports interleaved across kinds, so each index space must pick its own
+void testIndexSpaces() {
+    std::cout << "\nIndex spaces:\n";
+    WasmBuilder builder;
+    uint32_t unary = builder.addType({B::I32}, {B::I32});
+    uint32_t nullary = builder.addType({}, {});
+    builder.importFunction("env", "f0", unary);
+    builder.importMemory("env", "memory", 1);
+    builder.importFunction("env", "f1", nullary);
+    builder.importGlobal("env", "g0", B::I64);
+    builder.addGlobal(B::I32, false, 0);
+    Code body;
+    body.localGet(0);
+    for (int i = 0; i < 1000; i++) {
+        builder.addFunction(unary, {}, body.bytes(), "e" + std::to_string(i));
+    }
+
+    wasm::Decoder decoder;
+    wasm::Module module = decoder.parseBytes(builder.build());
+    check(module.getImportedFunctionCount() == 2 && module.getTotalFunctionCount() == 1002 &&
+          module.getImportedMemoryCount() == 1 && module.getTotalMemoryCount() == 1 &&
+          module.getImportedGlobalCount() == 1 && module.getTotalGlobalCount() == 2 &&
+          module.getImportedTableCount() == 0, "counts per index space");
+    check(module.getFunctionType(0)->params.size() == 1 && module.getFunctionType(1)->params.empty() &&
+          module.getFunctionType(1001)->params.size() == 1 && module.getFunctionType(1002) == nullptr,
+          "function types: imports first, then definitions");
+
+    const wasm::Import* f1 = module.getImport(wasm::ExternalKind::FUNCTION, 1);
+    const wasm::Import* memory = module.getImport(wasm::ExternalKind::MEMORY, 0);
+    const wasm::Import* global = module.getImport(wasm::ExternalKind::GLOBAL, 0);
+    check(f1 && f1->field_name == "f1" && memory && memory->field_name == "memory" &&
+          global && global->field_name == "g0", "imports found by kind and index");
+    check(!module.getImport(wasm::ExternalKind::FUNCTION, 2) && !module.getImport(wasm::ExternalKind::GLOBAL, 1) &&
+          !module.getImport(wasm::ExternalKind::TABLE, 0), "definitions and missing entries are not imports");
+
+    const wasm::Export* last = module.findExport("e999");
+    check(last && last->kind == wasm::ExternalKind::FUNCTION && last->index == 1001, "export found by name");
+    check(!module.findExport("e1000") && !module.findExport(""), "missing export not found");
+    check(module.functionName(2) == "e0" && module.functionName(1001) == "e999" &&
+          module.functionName(0) == "env.f0" && module.functionName(1002).empty(),
+          "function names from exports and imports");
+}
+
+void testElements() {
+    std::cout << "\nElement segments:\n";
+    auto build = [](uint32_t table_size, uint32_t second_offset) {
+        WasmBuilder builder;
+        uint32_t nullary = builder.addType({}, {B::I32});
+        uint32_t unary = builder.addType({B::I32}, {B::I32});
+        builder.setTable(table_size);
+        std::vector<uint32_t> functions;
+        for (int32_t value : {10, 20, 30}) {
+            Code constant;
+            constant.i32Const(value);
+            functions.push_back(builder.addFunction(nullary, {}, constant.bytes()));
+        }
+        Code dispatch;
+        dispatch.localGet(0).callIndirect(nullary);
+        builder.addFunction(unary, {}, dispatch.bytes(), "dispatch");
+        builder.addElements(0, {functions[0], functions[1]});
+        builder.addElements(second_offset, {functions[2]});
+        return builder.build();
+    };
+
+    wasm::Decoder decoder;
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(decoder.parseBytes(build(5, 3)));
+    auto dispatch = [&](int32_t index) {
+        return interpreter.call("dispatch", {wasm::TypedValue::makeI32(index)})[0].value.i32;
+    };
+    auto traps = [&](int32_t index) {
+        try {
+            dispatch(index);
+        } catch (const wasm::Trap&) {
+            return true;
+        }
+        return false;
+    };
+    check(dispatch(0) == 10 && dispatch(1) == 20 && dispatch(3) == 30, "segments placed at their offsets");
+    check(traps(2) && traps(4), "entries no segment wrote are null");
+    check(traps(5) && traps(-1), "index past the table traps");
+
+    bool rejected = false;
+    try {
+        wasm::Interpreter overflowing;
+        overflowing.instantiate(decoder.parseBytes(build(4, 4)));
+    } catch (const wasm::InterpreterError& e) {
+        rejected = std::string(e.what()).find("Element segment out of bounds") != std::string::npos;
+    }
+    check(rejected, "segment past the end of the table fails instantiation");
+}
+
+// A module whose "run" export returns value, padded with functions so
+// its size depends on padding
+WasmBuilder::Bytes fileModule(int32_t value, int padding) {
+    WasmBuilder builder;
+    uint32_t type = builder.addType({}, {B::I32});
+    Code body;
+    body.i32Const(value);
+    builder.addFunction(type, {}, body.bytes(), "run");
+    for (int i = 0; i < padding; i++) {
+        builder.addFunction(type, {}, body.bytes());
+    }
+    return builder.build();
+}
+
+void writeFile(const std::string& path, const WasmBuilder::Bytes& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+// Parse path with decoder and call its "run" export; -1 if it is rejected
+int32_t runFile(wasm::Decoder& decoder, const std::string& path) {
+    try {
+        wasm::Interpreter interpreter;
+        interpreter.instantiate(decoder.parse(path));
+        return interpreter.call("run", {})[0].value.i32;
+    } catch (const wasm::DecoderError&) {
+        return -1;
+    }
+}
+
+void testFiles() {
+    std::cout << "\nFiles:\n";
+    std::string prefix = "/tmp/test_module_" + std::to_string(getpid());
+    std::string large = prefix + "_large.wasm";
+    std::string small = prefix + "_small.wasm";
+    std::string empty = prefix + "_empty.wasm";
+    writeFile(large, fileModule(7, 200));
+    writeFile(small, fileModule(9, 0));
+    writeFile(empty, {});
+
+    wasm::Decoder mapped;
+    check(runFile(mapped, large) == 7 && runFile(mapped, small) == 9 && runFile(mapped, large) == 7,
+          "mapped files decode, reusing the decoder");
+
+    // The read path must take each file's own size, not the previous one's
+    wasm::Decoder read;
+    read.setMapFiles(false);
+    check(runFile(read, large) == 7 && runFile(read, small) == 9 && runFile(read, large) == 7,
+          "read files decode, reusing the decoder across sizes");
+
+    // Empty files cannot be mapped and fall back to reading
+    check(runFile(mapped, large) == 7 && runFile(mapped, empty) == -1 && runFile(mapped, small) == 9,
+          "empty file rejected after a larger one");
+
+    std::remove(large.c_str());
+    std::remove(small.c_str());
+    std::remove(empty.c_str());
+}
+
+} // anonymous namespace
+
+int main() {
+    beginChecks("Module");
+
+    testCodeSection();
+    testInitExpressions();
+    testLocalsLimit();
+    testIndexSpaces();
+    testElements();
+    testFiles();
+
+    return finishChecks("module");
+}
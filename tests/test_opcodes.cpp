@@ -0,0 +1,212 @@
+#include "../include/decoder.h"
+#include "../include/instructions.h"
+#include "../include/interpreter.h"
+#include "../include/leb128.h"
+#include "../benchmarks/wasm_builder.h"
+#include "check.h"
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Opcode table test.
+ * Checks that the constexpr opcode table agrees with the Opcode enum and
+ * names every assigned opcode, that immediates are skipped correctly for
+ * the encodings the old hand-written scanner got wrong (call_indirect,
+ * memory.size and 0xFC instructions), that truncated immediates and
+ * unknown prefixed sub-opcodes are reported, that word-at-a-time LEB128
+ * decoding matches the byte loop for every length and for padded
+ * encodings, and that blocks containing those instructions find their END
+ * when run by the interpreter.
+ *
+ * Usage: ./test_opcodes
+ */
+
+namespace {
+
+using B = WasmBuilder;
+
+const wasm::OpcodeInfo& info(wasm::Opcode opcode) {
+    return wasm::OPCODE_TABLE[static_cast<uint8_t>(opcode)];
+}
+
+bool named(wasm::Opcode opcode, const char* name) {
+    return info(opcode).name && std::strcmp(info(opcode).name, name) == 0;
+}
+
+// Bytes consumed by the immediates of code[0], or -1 if truncated
+long skipped(const std::vector<uint8_t>& code) {
+    size_t pc = 1;
+    if (!wasm::skipImmediates(code[0], code.data(), code.size(), pc)) {
+        return -1;
+    }
+    return static_cast<long>(pc) - 1;
+}
+
+void testTable() {
+    std::cout << "Table:\n";
+    check(named(wasm::Opcode::CALL_INDIRECT, "call_indirect") && named(wasm::Opcode::I64_LOAD32_U, "i64.load32_u") &&
+          named(wasm::Opcode::F64_REINTERPRET_I64, "f64.reinterpret_i64") &&
+          named(wasm::Opcode::BR_ON_NON_NULL, "br_on_non_null") && named(wasm::Opcode::SWITCH, "switch"),
+          "names agree with the Opcode enum");
+    check(wasm::opcodeToString(wasm::Opcode::I32_SHR_U) == "i32.shr_u" &&
+          wasm::opcodeToString(static_cast<wasm::Opcode>(0x06)) == "unknown", "opcodeToString");
+    check(wasm::opcodeToString(0xFC, 10) == "memory.copy" && wasm::opcodeToString(0xFB, 0x1C) == "ref.i31" &&
+          wasm::opcodeToString(0xFB, 0x40) == "unknown", "prefixed names");
+
+    size_t assigned = 0;
+    bool consistent = true;
+    for (const wasm::OpcodeInfo& entry : wasm::OPCODE_TABLE) {
+        if (entry.name) {
+            assigned++;
+            consistent = consistent && entry.pops >= wasm::VARIABLE_ARITY && entry.pushes >= wasm::VARIABLE_ARITY;
+        }
+    }
+    check(assigned == 199 && consistent, "199 assigned opcodes with stack effects");
+    check(info(wasm::Opcode::I32_ADD).pops == 2 && info(wasm::Opcode::I32_ADD).pushes == 1 &&
+          info(wasm::Opcode::I32_STORE).pops == 2 && info(wasm::Opcode::I32_STORE).pushes == 0 &&
+          info(wasm::Opcode::CALL).pops == wasm::VARIABLE_ARITY, "stack effects");
+    check(wasm::isControlFlowInstruction(wasm::Opcode::CALL_INDIRECT) &&
+          wasm::isMemoryInstruction(wasm::Opcode::MEMORY_GROW) &&
+          wasm::isNumericInstruction(wasm::Opcode::I32_CONST) &&
+          wasm::isNumericInstruction(wasm::Opcode::I32_WRAP_I64) &&
+          !wasm::isNumericInstruction(static_cast<wasm::Opcode>(0xFC)) &&
+          !wasm::isControlFlowInstruction(static_cast<wasm::Opcode>(0x06)), "category helpers");
+}
+
+void testSkipping() {
+    std::cout << "\nImmediates:\n";
+    check(skipped({0x11, 0x8B, 0x01, 0x00}) == 3, "call_indirect skips type and table");
+    check(skipped({0x3F, 0x00, 0x0B}) == 1 && skipped({0x40, 0x00, 0x0B}) == 1,
+          "memory.size and memory.grow skip one byte");
+    check(skipped({0xFC, 0x00, 0x0B}) == 1 && skipped({0xFC, 0x0A, 0x00, 0x00, 0x0B}) == 3 &&
+          skipped({0xFC, 0x0B, 0x00, 0x0B}) == 2, "0xFC sub-opcodes and their immediates");
+    check(skipped({0xFB, 0x02, 0x81, 0x01, 0x03}) == 4 && skipped({0xFB, 0x18, 0x03, 0x00, 0x6E, 0x6C}) == 5,
+          "GC struct.get and br_on_cast");
+    check(skipped({0x0E, 0x02, 0x00, 0x01, 0x02, 0x0B}) == 4 && skipped({0x1C, 0x01, 0x64, 0x6E}) == 3,
+          "br_table and typed select");
+    check(skipped({0x02, 0x63, 0x6E}) == 2 && skipped({0x02, 0x40}) == 1 && skipped({0x02, 0x85, 0x01}) == 2,
+          "block types");
+    check(skipped({0xE3, 0x00, 0x02, 0x00, 0x00, 0x01, 0x01, 0x00}) == 7, "resume handler clauses");
+    check(skipped({0x44, 0, 0, 0, 0, 0, 0, 0, 0xF0}) == 8 && skipped({0x43, 0x00, 0x00, 0x80}) == -1,
+          "f64.const, and truncated f32.const");
+    check(skipped({0x41, 0x80}) == -1 && skipped({0x11, 0x01}) == -1 && skipped({0x0E, 0x05, 0x00}) == -1,
+          "truncated LEB128 immediates");
+    check(skipped({0xFC, 0x7F, 0x00, 0x0B}) == -1 && skipped({0xFB, 0x40, 0x0B}) == -1,
+          "unknown prefixed sub-opcodes");
+}
+
+// Reference byte-at-a-time decoding: value and length
+std::pair<uint64_t, unsigned> decodeBytewise(const uint8_t* data) {
+    uint64_t value = 0;
+    unsigned length = 0;
+    uint8_t byte;
+    do {
+        byte = data[length];
+        value |= static_cast<uint64_t>(byte & 0x7F) << (7 * length);
+        length++;
+    } while (byte & 0x80);
+    return {value, length};
+}
+
+bool matchesBytewise(const std::vector<uint8_t>& encoded) {
+    std::vector<uint8_t> padded = encoded;
+    padded.resize(wasm::LEB128_WORD, 0xAA);
+    uint64_t word = wasm::loadLeb128Word(padded.data());
+    unsigned length = wasm::leb128Length(word);
+    auto expected = decodeBytewise(padded.data());
+    return length == expected.second && wasm::leb128Payload(word, length) == expected.first;
+}
+
+void testLeb128() {
+    std::cout << "\nLEB128:\n";
+    bool all = true;
+    for (unsigned bits = 0; bits <= 56; bits++) {
+        uint64_t value = bits == 0 ? 0 : (uint64_t(1) << bits) - 1;
+        std::vector<uint8_t> encoded;
+        do {
+            uint8_t byte = value & 0x7F;
+            value >>= 7;
+            encoded.push_back(value ? byte | 0x80 : byte);
+        } while (value);
+        all = all && matchesBytewise(encoded);
+    }
+    check(all, "every length from 1 to 8 bytes");
+    check(matchesBytewise({0x80, 0x80, 0x80, 0x80, 0x00}) && matchesBytewise({0xFF, 0x80, 0x80, 0x00}),
+          "padded encodings");
+    check(wasm::leb128Length(0x8080808080808080ull) == 0, "longer than a word");
+    check(wasm::leb128Signed(0x7F, 1) == -1 && wasm::leb128Signed(0x3F, 1) == 63 &&
+          wasm::leb128Signed(0x3F80, 2) == -128, "sign extension");
+}
+
+// Each function puts a scanned instruction inside a block whose END
+// follows an immediate byte that looks like an opcode
+std::vector<uint8_t> buildModule() {
+    WasmBuilder builder;
+    uint32_t ft_result = builder.addType({}, {B::I32});
+    for (int i = 0; i < 10; i++) {
+        builder.addType({B::F64}, {});
+    }
+    uint32_t ft_eleven = builder.addType({}, {B::I32});    // Type index 0x0B
+    builder.setMemory(2);
+    builder.setTable(1);
+
+    Code eleven;
+    eleven.i32Const(11);
+    uint32_t callee = builder.addFunction(ft_eleven, {}, eleven.bytes());
+    builder.addElements(0, {callee});
+
+    Code indirect;
+    indirect.block(B::I32).i32Const(0).callIndirect(ft_eleven).end();
+    builder.addFunction(ft_result, {}, indirect.bytes(), "call_indirect");
+
+    Code size;
+    size.block(B::I32).op(0x3F).op(0x00).end()
+        .block(B::I32).i32Const(0).op(0x40).op(0x00).end()
+        .op(0x6A /* i32.add */);
+    builder.addFunction(ft_result, {}, size.bytes(), "memory_size");
+
+    Code saturate;
+    saturate.block(B::I32).f64Const(1e10).op(0xFC).op(0x02).end();
+    builder.addFunction(ft_result, {}, saturate.bytes(), "trunc_sat");
+
+    // Never executed: the block scan stops at the unknown sub-opcode
+    Code unknown;
+    unknown.i32Const(0).ifBlock().op(0xFC).u32(0x7F).end().i32Const(1);
+    builder.addFunction(ft_result, {}, unknown.bytes(), "unknown_sub_opcode");
+    return builder.build();
+}
+
+void testScanning() {
+    std::cout << "\nInterpreter scanning:\n";
+    wasm::Decoder decoder;
+    wasm::Interpreter instance;
+    instance.instantiate(decoder.parseBytes(buildModule()));
+
+    auto result = [&](const std::string& name) { return instance.call(name, {})[0].value.i32; };
+    check(result("call_indirect") == 11, "block around call_indirect with type index 0x0B");
+    check(result("memory_size") == 4, "blocks around memory.size and memory.grow");
+    check(result("trunc_sat") == 2147483647, "block around i32.trunc_sat_f64_s");
+
+    bool rejected = false;
+    try {
+        instance.call("unknown_sub_opcode", {});
+    } catch (const wasm::InterpreterError& e) {
+        rejected = std::string(e.what()).find("unknown sub-opcode") != std::string::npos;
+    }
+    check(rejected, "block around an unknown 0xFC sub-opcode is rejected");
+}
+
+} // anonymous namespace
+
+int main() {
+    beginChecks("Opcode Table");
+
+    testTable();
+    testSkipping();
+    testLeb128();
+    testScanning();
+
+    return finishChecks("opcode table");
+}
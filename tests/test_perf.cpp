@@ -0,0 +1,213 @@
+#include "../include/aot.h"
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "../include/perf_map.h"
+#include "../benchmarks/wasm_builder.h"
+#include "check.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+/**
+ * Linux perf integration test.
+ * Checks that name section entries reach the perf map for interpreted
+ * trampolines and compiled code, that the AOT symbols carry guest names,
+ * and that running through trampolines gives the same results and traps
+ * as plain interpretation.
+ *
+ * Usage: ./test_perf
+ */
+
+namespace {
+
+using B = WasmBuilder;
+
+// (func $fib (export "run_fib") (param i32) (result i32) ...)
+// (func $divide_by_zero (export "div0") (result i32) (i32.div_s (i32.const 1) (i32.const 0)))
+// A name section with name_payload is appended unless it is empty.
+WasmBuilder::Bytes buildModule(const WasmBuilder::Bytes& name_payload) {
+    WasmBuilder builder;
+    uint32_t ft_fib = builder.addType({B::I32}, {B::I32});
+    uint32_t ft_result = builder.addType({}, {B::I32});
+
+    Code fib;
+    fib.localGet(0).i32Const(2).op(0x48 /* i32.lt_s */).ifBlock(B::I32)
+        .localGet(0)
+        .elseBlock()
+        .localGet(0).i32Const(1).op(0x6B /* i32.sub */).call(0)
+        .localGet(0).i32Const(2).op(0x6B /* i32.sub */).call(0)
+        .op(0x6A /* i32.add */)
+        .end();
+    builder.addFunction(ft_fib, {}, fib.bytes(), "run_fib");
+
+    Code div0;
+    div0.i32Const(1).i32Const(0).op(0x6D /* i32.div_s */);
+    builder.addFunction(ft_result, {}, div0.bytes(), "div0");
+
+    if (!name_payload.empty()) {
+        builder.addCustomSection("name", name_payload);
+    }
+    return builder.build();
+}
+
+// Function names subsection
+WasmBuilder::Bytes nameSection() {
+    WasmBuilder::Bytes functions{0x02,
+                                 0x00, 0x03, 'f', 'i', 'b',
+                                 0x01, 0x0E, 'd', 'i', 'v', 'i', 'd', 'e', '_', 'b', 'y', '_', 'z', 'e', 'r', 'o'};
+    WasmBuilder::Bytes payload{0x01, static_cast<uint8_t>(functions.size())};
+    payload.insert(payload.end(), functions.begin(), functions.end());
+    return payload;
+}
+
+std::string readPerfMap() {
+    std::ifstream file("/tmp/perf-" + std::to_string(getpid()) + ".map");
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+bool traps(wasm::Interpreter& interpreter, const std::string& name) {
+    try {
+        interpreter.call(name);
+    } catch (const wasm::Trap&) {
+        return true;
+    }
+    return false;
+}
+
+void testNameSection() {
+    std::cout << "Name section:\n";
+    wasm::Decoder decoder;
+    wasm::Module named = decoder.parseBytes(buildModule(nameSection()));
+    check(named.functionName(0) == "fib", "name section entry wins over export name");
+    check(named.functionName(1) == "divide_by_zero", "second function named");
+
+    wasm::Module unnamed = decoder.parseBytes(buildModule({}));
+    check(unnamed.functionName(0) == "run_fib", "export name used without a name section");
+
+    // Subsection claims more bytes than the section holds
+    WasmBuilder::Bytes broken{0x01, 0x40, 0x01, 0x00};
+    wasm::Module malformed = decoder.parseBytes(buildModule(broken));
+    check(malformed.functionName(0) == "run_fib", "malformed name section ignored");
+    check(malformed.functions.size() == 2, "module after malformed name section still decodes");
+}
+
+void testTrampolines() {
+    std::cout << "Interpreter trampolines:\n";
+    wasm::Decoder decoder;
+    wasm::Interpreter interpreter;
+    check(interpreter.enablePerf(), "perf map opened");
+    interpreter.instantiate(decoder.parseBytes(buildModule(nameSection())));
+
+    std::vector<wasm::TypedValue> results = interpreter.call("run_fib", {wasm::TypedValue::makeI32(15)});
+    check(results.size() == 1 && results[0].value.i32 == 610, "recursive calls through trampolines");
+    check(traps(interpreter, "div0"), "trap propagates across trampoline frames");
+    results = interpreter.call("run_fib", {wasm::TypedValue::makeI32(10)});
+    check(results.size() == 1 && results[0].value.i32 == 55, "calls work after a trap");
+
+    std::string map = readPerfMap();
+    check(map.find(" wasm::fib [interp]\n") != std::string::npos, "trampoline named in perf map");
+    check(map.find(" wasm::divide_by_zero [interp]\n") != std::string::npos, "every function has a trampoline");
+}
+
+void testCompiledCode() {
+    std::cout << "Compiled code:\n";
+    std::string library = "/tmp/wasm_perf_test_" + std::to_string(getpid()) + ".so";
+    wasm::Decoder decoder;
+    wasm::Module module = decoder.parseBytes(buildModule(nameSection()));
+
+    std::string source = wasm::AotCompiler().translate(module);
+    check(source.find("w2c_f0_fib(") != std::string::npos, "C symbol carries the guest name");
+
+    wasm::AotCompiler().compile(module, library);
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(std::move(module));
+    interpreter.loadNative(library);
+    interpreter.enablePerf();
+
+    std::vector<wasm::TypedValue> results = interpreter.call("run_fib", {wasm::TypedValue::makeI32(20)});
+    check(results.size() == 1 && results[0].value.i32 == 6765, "native result");
+
+    // Compiled entries are "<start> <size> wasm::fib" with a non-zero size
+    std::istringstream lines(readPerfMap());
+    std::string line;
+    bool found = false;
+    while (std::getline(lines, line)) {
+        std::istringstream fields(line);
+        std::string start, size, name;
+        fields >> start >> size >> name;
+        if (name == "wasm::fib" && fields.eof() && std::stoul(size, nullptr, 16) > 0) {
+            found = true;
+        }
+    }
+    check(found, "compiled function named in perf map");
+    std::remove(library.c_str());
+}
+
+// Bit pattern of a result; 32-bit values leave the upper half unset
+std::string bits(const wasm::TypedValue& value) {
+    bool narrow = value.type == wasm::ValueType::I32 || value.type == wasm::ValueType::F32;
+    return std::to_string(narrow ? static_cast<uint64_t>(static_cast<uint32_t>(value.value.i32))
+                                 : static_cast<uint64_t>(value.value.i64));
+}
+
+int testModuleEquivalence(const std::string& wasm_file) {
+    wasm::Decoder decoder;
+    wasm::Interpreter plain;
+    wasm::Interpreter traced;
+    traced.enablePerf();
+    plain.instantiate(decoder.parse(wasm_file));
+    traced.instantiate(decoder.parse(wasm_file));
+
+    int mismatches = 0;
+    wasm::Module module = decoder.parse(wasm_file);
+    for (const auto& exp : module.exports) {
+        const wasm::FuncType* type = module.getFunctionType(exp.index);
+        if (exp.kind != wasm::ExternalKind::FUNCTION || !type || !type->params.empty()) {
+            continue;
+        }
+        std::string name(exp.name);
+        std::string expected, actual;
+        try {
+            for (const auto& value : plain.call(name)) {
+                expected += bits(value) + " ";
+            }
+        } catch (const std::exception& e) {
+            expected = e.what();
+        }
+        try {
+            for (const auto& value : traced.call(name)) {
+                actual += bits(value) + " ";
+            }
+        } catch (const std::exception& e) {
+            actual = e.what();
+        }
+        mismatches += expected == actual ? 0 : 1;
+    }
+    return mismatches;
+}
+
+} // anonymous namespace
+
+int main() {
+    beginChecks("Perf Integration");
+
+    std::remove(("/tmp/perf-" + std::to_string(getpid()) + ".map").c_str());
+    testNameSection();
+    testTrampolines();
+    testCompiledCode();
+
+    std::cout << "Trampolines vs plain interpretation:\n";
+    for (const char* wasm_file : {"tests/wat/01_test.wasm", "tests/wat/02_test_prio1.wasm",
+                                  "tests/wat/03_test_prio2.wasm", "tests/wat/05_test_complex.wasm"}) {
+        check(testModuleEquivalence(wasm_file) == 0, wasm_file);
+    }
+    std::remove(("/tmp/perf-" + std::to_string(getpid()) + ".map").c_str());
+
+    return finishChecks("perf");
+}
@@ -0,0 +1,201 @@
+#include "../include/decoder.h"
+#include "../include/server.h"
+#include "../benchmarks/kernels.h"
+#include "check.h"
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+/**
+ * Invocation daemon test.
+ * Runs a Server on a temporary Unix socket and checks calls, errors,
+ * memory payloads, per-request reset, concurrent clients, loading
+ * modules at run time, shutdown through the client, and that an instance
+ * whose reset fails is dropped from its pool.
+ *
+ * Usage: ./test_server
+ */
+
+namespace {
+
+// (func (export "load0") (result i32) (i32.load (i32.const 0)))
+// (func (export "store0") (param i32) (i32.store (i32.const 0) (local.get 0)))
+WasmBuilder::Bytes buildCell() {
+    using B = WasmBuilder;
+    WasmBuilder builder;
+    uint32_t to_i32 = builder.addType({}, {B::I32});
+    uint32_t from_i32 = builder.addType({B::I32}, {});
+
+    Code load;
+    load.i32Const(0).load(0x28 /* i32.load */);
+    builder.addFunction(to_i32, {}, load.bytes(), "load0");
+
+    Code store;
+    store.i32Const(0).localGet(0).store(0x36 /* i32.store */);
+    builder.addFunction(from_i32, {}, store.bytes(), "store0");
+
+    builder.setMemory(1);
+    return builder.build();
+}
+
+constexpr uint32_t KERNELS = 0;
+constexpr uint32_t CELL = 1;
+
+void testCalls(const std::string& socket_path) {
+    std::cout << "Calls:\n";
+    wasm::Client client(socket_path);
+    auto results = client.call(KERNELS, "fib", {wasm::TypedValue::makeI32(10)});
+    check(results.size() == 1 && results[0].value.i32 == 55, "result returned");
+
+    results = client.call(KERNELS, "arith_f64", {wasm::TypedValue::makeI32(10)});
+    check(results.size() == 1 && results[0].type == wasm::ValueType::F64, "typed result returned");
+
+    std::string error;
+    try {
+        client.call(KERNELS, "missing", {});
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    check(error.find("Export not found") != std::string::npos, "unknown export reported");
+
+    error.clear();
+    try {
+        client.call(KERNELS, "mem_sum", {wasm::TypedValue::makeI32(300000)});
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    check(!error.empty(), "trap reported");
+
+    error.clear();
+    try {
+        client.call(7, "fib", {wasm::TypedValue::makeI32(1)});
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    check(error.find("Unknown module id 7") != std::string::npos, "unknown module reported");
+
+    results = client.call(KERNELS, "fib", {wasm::TypedValue::makeI32(15)});
+    check(results.size() == 1 && results[0].value.i32 == 610, "connection usable after errors");
+}
+
+void testMemory(const std::string& socket_path) {
+    std::cout << "Memory payloads:\n";
+    wasm::Client client(socket_path);
+
+    wasm::protocol::InvokeRequest request;
+    request.module_id = CELL;
+    request.function_name = "load0";
+    request.memory = {7, 1, 0, 0};
+    check(client.invoke(request).results[0].value.i32 == 0x107, "payload written before the call");
+
+    request.function_name = "store0";
+    request.args = {wasm::TypedValue::makeI32(0x2A)};
+    request.memory.clear();
+    request.read_offset = 0;
+    request.read_length = 4;
+    wasm::protocol::InvokeResponse response = client.invoke(request);
+    check(response.results.empty() && response.memory == std::vector<uint8_t>({0x2A, 0, 0, 0}),
+          "memory read back after the call");
+
+    check(client.call(CELL, "load0", {})[0].value.i32 == 0, "each request starts from a fresh instance");
+
+    request.read_offset = 65534;
+    bool rejected = false;
+    try {
+        client.invoke(request);
+    } catch (const std::exception&) {
+        rejected = true;
+    }
+    check(rejected, "out of bounds read rejected");
+}
+
+void testConcurrentClients(const std::string& socket_path) {
+    std::cout << "Concurrent clients:\n";
+    std::atomic<int> correct{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&] {
+            wasm::Client client(socket_path);
+            for (int i = 0; i < 25; i++) {
+                auto results = client.call(KERNELS, "fib", {wasm::TypedValue::makeI32(12)});
+                correct += results.size() == 1 && results[0].value.i32 == 144;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    check(correct == 200, "every call answered correctly");
+}
+
+void testLoadAndShutdown(const std::string& socket_path, std::thread& serving) {
+    std::cout << "Load and shutdown:\n";
+    wasm::Client client(socket_path);
+    uint32_t module_id = client.load("tests/wat/05_test_complex.wasm");
+    check(module_id == 2, "loaded module gets the next id");
+
+    bool rejected = false;
+    try {
+        client.load("tests/wat/no_such_file.wasm");
+    } catch (const std::exception&) {
+        rejected = true;
+    }
+    check(rejected, "missing file reported");
+
+    client.shutdown();
+    serving.join();
+    check(access(socket_path.c_str(), F_OK) != 0, "socket removed on shutdown");
+
+    bool refused = false;
+    try {
+        wasm::Client late(socket_path);
+    } catch (const wasm::ServerError&) {
+        refused = true;
+    }
+    check(refused, "no connections after shutdown");
+}
+
+// A reset that throws must free the slot rather than escape release()
+void testFailedReset() {
+    std::cout << "Failed reset:\n";
+    wasm::InstancePool pool(buildCell(), 1);
+    std::unique_ptr<wasm::Interpreter> leased = pool.acquire();
+    leased.reset();
+
+    // No snapshot was taken, so restoreSnapshot() throws
+    auto unresettable = std::make_unique<wasm::Interpreter>();
+    wasm::Decoder decoder;
+    unresettable->instantiate(decoder.parseBytes(buildCell()));
+    pool.release(std::move(unresettable));
+    check(pool.instances() == 0, "instance dropped and its slot freed");
+
+    std::unique_ptr<wasm::Interpreter> fresh = pool.acquire();
+    check(fresh && pool.instances() == 1 && fresh->call("load0", {})[0].value.i32 == 0,
+          "next acquire creates a fresh instance");
+    pool.release(std::move(fresh));
+    check(pool.instances() == 1, "reset instance returned to the pool");
+}
+
+} // anonymous namespace
+
+int main() {
+    beginChecks("Invocation Server");
+
+    std::string socket_path = "/tmp/wasm-test-server-" + std::to_string(getpid()) + ".sock";
+    wasm::Server server(2);
+    server.addModule(buildKernels());
+    server.addModule(buildCell());
+    server.listen(socket_path);
+    std::thread serving([&] { server.serve(); });
+
+    testCalls(socket_path);
+    testMemory(socket_path);
+    testConcurrentClients(socket_path);
+    testLoadAndShutdown(socket_path, serving);
+    testFailedReset();
+
+    return finishChecks("server");
+}
@@ -0,0 +1,90 @@
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "../benchmarks/kernels.h"
+#include "check.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Instance snapshot test.
+ * Takes a snapshot after instantiation, changes globals and memory through
+ * guest calls, and checks that restoring returns the instance to its
+ * freshly instantiated state, as used by the CLI's --batch-reset.
+ *
+ * Usage: ./test_snapshot
+ */
+
+namespace {
+
+// Increments the mutable global and stores it at address 0
+const char* INCREMENT = "_test_global_increment";
+
+int32_t counterInMemory(const wasm::Interpreter& interpreter) {
+    return interpreter.memory()->loadI32(0);
+}
+
+void testRestore() {
+    std::cout << "Restore:\n";
+    wasm::Decoder decoder;
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(decoder.parse("tests/wat/01_test.wasm"));
+
+    bool rejected = false;
+    try {
+        interpreter.restoreSnapshot();
+    } catch (const wasm::InterpreterError&) {
+        rejected = true;
+    }
+    check(rejected && !interpreter.hasSnapshot(), "restore without a snapshot rejected");
+
+    interpreter.takeSnapshot();
+    interpreter.call(INCREMENT, {});
+    interpreter.call(INCREMENT, {});
+    check(counterInMemory(interpreter) == 2, "calls share one instance");
+    check(interpreter.memory()->dirtyPageCount() == 1, "only the written page is dirty");
+
+    interpreter.restoreSnapshot();
+    check(counterInMemory(interpreter) == 0 && interpreter.memory()->dirtyPageCount() == 0, "memory restored");
+    interpreter.call(INCREMENT, {});
+    check(counterInMemory(interpreter) == 1, "globals restored");
+
+    interpreter.restoreSnapshot();
+    interpreter.restoreSnapshot();
+    check(counterInMemory(interpreter) == 0 && interpreter.hasSnapshot(), "snapshot reusable");
+
+    interpreter.instantiate(decoder.parse("tests/wat/01_test.wasm"));
+    check(!interpreter.hasSnapshot(), "instantiate discards the snapshot");
+}
+
+void testAfterTrap() {
+    std::cout << "After a trap:\n";
+    wasm::Decoder decoder;
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(decoder.parseBytes(buildKernels()));
+    interpreter.takeSnapshot();
+
+    bool trapped = false;
+    try {
+        interpreter.call("mem_sum", {wasm::TypedValue::makeI32(300000)});
+    } catch (const wasm::MemoryError&) {
+        trapped = true;
+    }
+    check(trapped, "out of bounds access traps");
+
+    interpreter.restoreSnapshot();
+    std::vector<wasm::TypedValue> results;
+    interpreter.call("fib", {wasm::TypedValue::makeI32(10)}, results);
+    check(results.size() == 1 && results[0].value.i32 == 55, "restored instance runs cleanly");
+}
+
+} // anonymous namespace
+
+int main() {
+    beginChecks("Instance Snapshot");
+
+    testRestore();
+    testAfterTrap();
+
+    return finishChecks("snapshot");
+}
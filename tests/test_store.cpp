@@ -0,0 +1,310 @@
+#include "../include/decoder.h"
+#include "../include/store.h"
+#include "../include/types.h"
+#include "../benchmarks/wasm_builder.h"
+#include "check.h"
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Store test.
+ * Checks that a module's function, memory, table and global imports link
+ * to the exports of instances in a Store: cross-instance calls leave the
+ * caller's operands intact, memory and its growth are shared, call_indirect
+ * through an imported table reaches the exporter's functions, imported
+ * globals shift the importer's own globals, re-exported functions link to
+ * the defining instance, and traps unwind through both instances. Missing
+ * and mismatched imports must fail with a LinkError and leave nothing
+ * registered.
+ *
+ * Usage: ./test_store
+ */
+
+namespace {
+
+using B = WasmBuilder;
+
+enum : uint8_t {
+    I32_LOAD = 0x28, I32_STORE = 0x36, MEMORY_SIZE = 0x3F, MEMORY_GROW = 0x40,
+    I32_SUB = 0x6B, I32_ADD = 0x6A, I32_MUL = 0x6C,
+};
+
+int32_t callI32(wasm::Interpreter& instance, const std::string& name, std::vector<int32_t> args = {}) {
+    std::vector<wasm::TypedValue> values;
+    for (int32_t arg : args) {
+        values.push_back(wasm::TypedValue::makeI32(arg));
+    }
+    return instance.call(name, values)[0].value.i32;
+}
+
+wasm::Module decode(const WasmBuilder& builder) {
+    wasm::Decoder decoder;
+    return decoder.parseBytes(builder.build());
+}
+
+/**
+ * The exporting module "lib":
+ *   add(a, b), poke(addr, value), peek(addr), grow() and fail()
+ *   memory (1 page), table [double, negate], immutable global base = 100,
+ *   mutable global counter
+ */
+WasmBuilder buildLib() {
+    WasmBuilder builder;
+    uint32_t ft_binary = builder.addType({B::I32, B::I32}, {B::I32});
+    uint32_t ft_unary = builder.addType({B::I32}, {B::I32});
+    uint32_t ft_store = builder.addType({B::I32, B::I32}, {});
+    uint32_t ft_result = builder.addType({}, {B::I32});
+    uint32_t ft_unit = builder.addType({}, {});
+    builder.setMemory(1);
+    builder.setTable(2);
+
+    Code add;
+    add.localGet(0).localGet(1).op(I32_ADD);
+    builder.addFunction(ft_binary, {}, add.bytes(), "add");
+
+    Code poke;
+    poke.localGet(0).localGet(1).store(I32_STORE);
+    builder.addFunction(ft_store, {}, poke.bytes(), "poke");
+
+    Code peek;
+    peek.localGet(0).load(I32_LOAD);
+    builder.addFunction(ft_unary, {}, peek.bytes(), "peek");
+
+    Code grow;
+    grow.i32Const(1).op(MEMORY_GROW).op(0x00);
+    builder.addFunction(ft_result, {}, grow.bytes(), "grow");
+
+    Code fail;
+    fail.op(0x00 /* unreachable */);
+    builder.addFunction(ft_unit, {}, fail.bytes(), "fail");
+
+    Code twice;
+    twice.localGet(0).i32Const(2).op(I32_MUL);
+    uint32_t double_index = builder.addFunction(ft_unary, {}, twice.bytes());
+    Code negate;
+    negate.i32Const(0).localGet(0).op(I32_SUB);
+    uint32_t negate_index = builder.addFunction(ft_unary, {}, negate.bytes());
+    builder.addElements(0, {double_index, negate_index});
+
+    builder.addExport("memory", B::EXTERN_MEMORY, 0);
+    builder.addExport("table", B::EXTERN_TABLE, 0);
+    builder.addExport("base", B::EXTERN_GLOBAL, builder.addGlobal(B::I32, false, 100));
+    builder.addExport("counter", B::EXTERN_GLOBAL, builder.addGlobal(B::I32, true, 0));
+    return builder;
+}
+
+/**
+ * The importing module "app":
+ *   sum3(a, b, c)      add(add(a, b), c), with 1000 under the operands
+ *   count(n)           n calls of add(acc, 1)
+ *   write(addr, value) poke through lib, then load locally
+ *   size()             memory.size of the shared memory
+ *   indirect(x, i)     call_indirect of lib's table[i] on x
+ *   hit()              increments its own global, returns it plus base
+ *   fail()             traps inside lib with an operand pending here
+ */
+WasmBuilder buildApp() {
+    WasmBuilder builder;
+    uint32_t ft_binary = builder.addType({B::I32, B::I32}, {B::I32});
+    uint32_t ft_unary = builder.addType({B::I32}, {B::I32});
+    uint32_t ft_store = builder.addType({B::I32, B::I32}, {});
+    uint32_t ft_result = builder.addType({}, {B::I32});
+    uint32_t ft_unit = builder.addType({}, {});
+    uint32_t ft_ternary = builder.addType({B::I32, B::I32, B::I32}, {B::I32});
+
+    uint32_t add = builder.importFunction("lib", "add", ft_binary);
+    uint32_t poke = builder.importFunction("lib", "poke", ft_store);
+    uint32_t fail = builder.importFunction("lib", "fail", ft_unit);
+    builder.importMemory("lib", "memory", 1);
+    builder.importTable("lib", "table", 2);
+    uint32_t base = builder.importGlobal("lib", "base", B::I32);
+    uint32_t hits = builder.addGlobal(B::I32, true, 0);
+
+    Code sum3;
+    sum3.i32Const(1000)
+        .localGet(0).localGet(1).call(add).localGet(2).call(add)
+        .op(I32_ADD).i32Const(1000).op(I32_SUB);
+    builder.addFunction(ft_ternary, {}, sum3.bytes(), "sum3");
+
+    Code count;
+    count.block().loop()
+            .localGet(1).localGet(0).op(0x4E /* i32.ge_s */).brIf(1)
+            .localGet(1).i32Const(1).call(add).localSet(1)
+            .br(0)
+        .end().end()
+        .localGet(1);
+    builder.addFunction(ft_unary, {{1, B::I32}}, count.bytes(), "count");
+
+    Code write;
+    write.localGet(0).localGet(1).call(poke).localGet(0).load(I32_LOAD);
+    builder.addFunction(ft_binary, {}, write.bytes(), "write");
+
+    Code size;
+    size.op(MEMORY_SIZE).op(0x00);
+    builder.addFunction(ft_result, {}, size.bytes(), "size");
+
+    Code indirect;
+    indirect.localGet(0).localGet(1).callIndirect(ft_unary);
+    builder.addFunction(ft_binary, {}, indirect.bytes(), "indirect");
+
+    Code hit;
+    hit.globalGet(hits).i32Const(1).op(I32_ADD).globalSet(hits)
+       .globalGet(base).globalGet(hits).op(I32_ADD);
+    builder.addFunction(ft_result, {}, hit.bytes(), "hit");
+
+    Code trap;
+    trap.i32Const(7).call(fail);
+    builder.addFunction(ft_result, {}, trap.bytes(), "fail");
+    return builder;
+}
+
+void testCalls(wasm::Store& store) {
+    std::cout << "Cross-instance calls:\n";
+    wasm::Interpreter& app = *store.instance("app");
+    check(callI32(app, "sum3", {1, 2, 3}) == 6, "nested calls keep the caller's operands");
+    check(callI32(app, "count", {10000}) == 10000, "10000 calls in a loop");
+    check(callI32(*store.instance("lib"), "add", {20, 22}) == 42, "exporter still callable on its own");
+
+    // A callee defined by lib, imported through relay
+    WasmBuilder relay;
+    uint32_t ft_binary = relay.addType({B::I32, B::I32}, {B::I32});
+    relay.addExport("plus", B::EXTERN_FUNC, relay.importFunction("lib", "add", ft_binary));
+    store.instantiate("relay", decode(relay));
+
+    WasmBuilder user;
+    ft_binary = user.addType({B::I32, B::I32}, {B::I32});
+    uint32_t plus = user.importFunction("relay", "plus", ft_binary);
+    Code call;
+    call.localGet(0).localGet(1).call(plus);
+    user.addFunction(ft_binary, {}, call.bytes(), "plus");
+    wasm::Interpreter& user_instance = store.instantiate("user", decode(user));
+    check(callI32(user_instance, "plus", {40, 2}) == 42, "re-exported import calls the defining instance");
+    check(callI32(*store.instance("relay"), "plus", {1, 1}) == 2, "re-exporting instance calls through");
+}
+
+void testMemory(wasm::Store& store) {
+    std::cout << "\nShared memory:\n";
+    wasm::Interpreter& app = *store.instance("app");
+    wasm::Interpreter& lib = *store.instance("lib");
+    check(app.memory() == lib.memory(), "importer shares the exporter's memory");
+    check(callI32(app, "write", {64, 1234}) == 1234, "store in lib is visible to app");
+    check(callI32(lib, "peek", {64}) == 1234, "and to lib");
+    check(callI32(lib, "grow") == 1 && callI32(app, "size") == 2, "growth is visible to app");
+}
+
+void testTablesAndGlobals(wasm::Store& store) {
+    std::cout << "\nTables and globals:\n";
+    wasm::Interpreter& app = *store.instance("app");
+    check(callI32(app, "indirect", {21, 0}) == 42, "call_indirect through imported table");
+    check(callI32(app, "indirect", {5, 1}) == -5, "second table entry");
+    bool trapped = false;
+    try {
+        callI32(app, "indirect", {5, 2});
+    } catch (const wasm::Trap&) {
+        trapped = true;
+    }
+    check(trapped, "out-of-range entry traps");
+    check(callI32(app, "hit") == 101 && callI32(app, "hit") == 102, "own global follows the imported one");
+}
+
+void testTraps(wasm::Store& store) {
+    std::cout << "\nTraps:\n";
+    wasm::Interpreter& app = *store.instance("app");
+    std::string message;
+    try {
+        app.call("fail");
+    } catch (const wasm::Trap& e) {
+        message = e.what();
+    }
+    check(message.find("nreachable") != std::string::npos, "trap in lib reaches app's caller: " + message);
+    check(callI32(app, "sum3", {1, 2, 3}) == 6, "app usable after the trap");
+    check(callI32(*store.instance("lib"), "add", {1, 2}) == 3, "lib usable after the trap");
+}
+
+// Expects instantiating builder as "bad" to fail with a LinkError
+void checkLinkError(wasm::Store& store, const WasmBuilder& builder, const std::string& what) {
+    size_t size = store.size();
+    std::string message;
+    try {
+        store.instantiate("bad", decode(builder));
+    } catch (const wasm::LinkError& e) {
+        message = e.what();
+    }
+    check(!message.empty() && store.size() == size && !store.instance("bad"), what + ": " + message);
+}
+
+void testLinkErrors(wasm::Store& store) {
+    std::cout << "\nLink errors:\n";
+    auto importing = [](const std::function<void(WasmBuilder&)>& add_imports) {
+        WasmBuilder builder;
+        builder.addType({B::I32, B::I32}, {B::I32});
+        builder.addType({B::I32}, {B::I32});
+        add_imports(builder);
+        return builder;
+    };
+
+    checkLinkError(store, importing([](WasmBuilder& b) { b.importFunction("nowhere", "add", 0); }),
+                   "unknown instance");
+    checkLinkError(store, importing([](WasmBuilder& b) { b.importFunction("lib", "sub", 0); }),
+                   "unknown export");
+    checkLinkError(store, importing([](WasmBuilder& b) { b.importFunction("lib", "add", 1); }),
+                   "signature mismatch");
+    checkLinkError(store, importing([](WasmBuilder& b) { b.importGlobal("lib", "add", B::I32); }),
+                   "kind mismatch");
+    checkLinkError(store, importing([](WasmBuilder& b) { b.importGlobal("lib", "base", B::I64); }),
+                   "global type mismatch");
+    checkLinkError(store, importing([](WasmBuilder& b) { b.importGlobal("lib", "counter", B::I32); }),
+                   "immutable import of a mutable global");
+    checkLinkError(store, importing([](WasmBuilder& b) { b.importGlobal("lib", "counter", B::I32, true); }),
+                   "mutable global import");
+    checkLinkError(store, importing([](WasmBuilder& b) { b.importMemory("lib", "memory", 4); }),
+                   "memory smaller than the import's minimum");
+    checkLinkError(store, importing([](WasmBuilder& b) {
+                       b.importTable("lib", "table", 2);
+                       Code body;
+                       body.localGet(0);
+                       b.addElements(0, {b.addFunction(1, {}, body.bytes())});
+                   }),
+                   "element segment into an imported table");
+
+    size_t size = store.size();
+    bool rejected = false;
+    try {
+        store.instantiate("lib", decode(buildLib()));
+    } catch (const wasm::LinkError&) {
+        rejected = true;
+    }
+    check(rejected && store.size() == size, "instance name in use");
+
+    // Without a store, imports stay unresolved until called
+    wasm::Interpreter standalone;
+    standalone.instantiate(decode(buildApp()));
+    std::string message;
+    try {
+        standalone.call("sum3", {wasm::TypedValue::makeI32(1), wasm::TypedValue::makeI32(2),
+                                 wasm::TypedValue::makeI32(3)});
+    } catch (const wasm::InterpreterError& e) {
+        message = e.what();
+    }
+    check(message.find("imported function") != std::string::npos, "unlinked instance fails at the call");
+}
+
+} // anonymous namespace
+
+int main() {
+    beginChecks("Store");
+
+    wasm::Store store;
+    store.instantiate("lib", decode(buildLib()));
+    store.instantiate("app", decode(buildApp()));
+
+    testCalls(store);
+    testMemory(store);
+    testTablesAndGlobals(store);
+    testTraps(store);
+    testLinkErrors(store);
+
+    return finishChecks("store");
+}
@@ -0,0 +1,180 @@
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "../include/tracer.h"
+#include "../benchmarks/wasm_builder.h"
+#include "check.h"
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Timeline tracer test.
+ * Records guest calls, memory growth and traps, and checks the Chrome
+ * trace JSON and Perfetto output, the duration threshold, ring buffer
+ * overflow and recording from several threads into one tracer.
+ *
+ * Usage: ./test_trace
+ */
+
+namespace {
+
+using B = WasmBuilder;
+
+// (memory 1)
+// (func $fib (export "fib") (param i32) (result i32) ...)     ;; recursive
+// (func (export "div0") (result i32) (i32.div_s (i32.const 1) (i32.const 0)))
+// (func (export "grow") (result i32) (memory.grow (i32.const 1)))
+WasmBuilder::Bytes buildModule() {
+    WasmBuilder builder;
+    uint32_t ft_fib = builder.addType({B::I32}, {B::I32});
+    uint32_t ft_result = builder.addType({}, {B::I32});
+    builder.setMemory(1);
+
+    Code fib;
+    fib.localGet(0).i32Const(2).op(0x48 /* i32.lt_s */).ifBlock(B::I32)
+        .localGet(0)
+        .elseBlock()
+        .localGet(0).i32Const(1).op(0x6B /* i32.sub */).call(0)
+        .localGet(0).i32Const(2).op(0x6B /* i32.sub */).call(0)
+        .op(0x6A /* i32.add */)
+        .end();
+    builder.addFunction(ft_fib, {}, fib.bytes(), "fib");
+
+    Code div0;
+    div0.i32Const(1).i32Const(0).op(0x6D /* i32.div_s */);
+    builder.addFunction(ft_result, {}, div0.bytes(), "div0");
+
+    Code grow;
+    grow.i32Const(1).op(0x40 /* memory.grow */).op(0x00);
+    builder.addFunction(ft_result, {}, grow.bytes(), "grow");
+    return builder.build();
+}
+
+size_t count(const std::string& text, const std::string& pattern) {
+    size_t occurrences = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1)) {
+        occurrences++;
+    }
+    return occurrences;
+}
+
+std::string chromeJson(wasm::Tracer& tracer) {
+    std::ostringstream out;
+    tracer.write(out, wasm::TraceFormat::CHROME_JSON);
+    return out.str();
+}
+
+void instantiate(wasm::Interpreter& interpreter, const std::shared_ptr<wasm::Tracer>& tracer) {
+    wasm::Decoder decoder;
+    interpreter.setTracer(tracer);
+    interpreter.instantiate(decoder.parseBytes(buildModule()));
+}
+
+void testEvents() {
+    std::cout << "Events:\n";
+    auto tracer = std::make_shared<wasm::Tracer>();
+    wasm::Interpreter interpreter;
+    instantiate(interpreter, tracer);
+
+    interpreter.call("fib", {wasm::TypedValue::makeI32(10)});
+    bool trapped = false;
+    try {
+        interpreter.call("div0");
+    } catch (const wasm::Trap&) {
+        trapped = true;
+    }
+    interpreter.call("grow");
+
+    std::string json = chromeJson(*tracer);
+    check(count(json, "\"name\":\"fib\"") == 177, "every fib call recorded");
+    check(trapped && count(json, "\"ph\":\"i\"") == 1, "trap recorded as an instant event");
+    check(count(json, "\"cat\":\"memory\"") == 1, "memory.grow recorded");
+    check(json.find("\"ph\":\"X\",\"dur\":") != std::string::npos, "spans are complete events");
+    check(tracer->dropped() == 0, "nothing dropped");
+    check(count(chromeJson(*tracer), "\"name\"") == 0, "writing drains the buffers");
+}
+
+void testThreshold() {
+    std::cout << "Threshold:\n";
+    wasm::TracerOptions options;
+    options.min_duration_ns = 60ull * 1000 * 1000 * 1000;
+    auto tracer = std::make_shared<wasm::Tracer>(options);
+    wasm::Interpreter interpreter;
+    instantiate(interpreter, tracer);
+
+    interpreter.call("fib", {wasm::TypedValue::makeI32(10)});
+    interpreter.call("grow");
+    std::string json = chromeJson(*tracer);
+    check(count(json, "\"cat\":\"call\"") == 0, "short calls filtered");
+    check(count(json, "\"cat\":\"memory\"") == 1, "memory.grow kept regardless of threshold");
+}
+
+void testOverflow() {
+    std::cout << "Ring buffer:\n";
+    wasm::TracerOptions options;
+    options.buffer_capacity = 16;
+    auto tracer = std::make_shared<wasm::Tracer>(options);
+    wasm::Interpreter interpreter;
+    instantiate(interpreter, tracer);
+
+    interpreter.call("fib", {wasm::TypedValue::makeI32(10)});
+    check(tracer->dropped() == 177 - 16, "events beyond capacity dropped");
+    check(count(chromeJson(*tracer), "\"name\":\"fib\"") == 16, "buffer keeps the first events");
+    interpreter.call("fib", {wasm::TypedValue::makeI32(3)});
+    check(count(chromeJson(*tracer), "\"name\":\"fib\"") == 5, "space reclaimed after a flush");
+}
+
+void testThreads() {
+    std::cout << "Threads:\n";
+    auto tracer = std::make_shared<wasm::Tracer>();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < 4; i++) {
+        workers.emplace_back([tracer] {
+            wasm::Interpreter interpreter;
+            instantiate(interpreter, tracer);
+            interpreter.call("fib", {wasm::TypedValue::makeI32(12)});
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    std::string json = chromeJson(*tracer);
+    std::set<std::string> tids;
+    for (size_t pos = json.find("\"tid\":"); pos != std::string::npos; pos = json.find("\"tid\":", pos + 1)) {
+        tids.insert(json.substr(pos, json.find('}', pos) - pos));
+    }
+    check(tids.size() == 4, "one track per thread");
+    check(count(json, "\"name\":\"fib\"") == 4 * 465, "no events lost across threads");
+}
+
+void testPerfetto() {
+    std::cout << "Perfetto:\n";
+    auto tracer = std::make_shared<wasm::Tracer>();
+    wasm::Interpreter interpreter;
+    instantiate(interpreter, tracer);
+    interpreter.call("fib", {wasm::TypedValue::makeI32(5)});
+
+    std::ostringstream out;
+    tracer->write(out, wasm::TraceFormat::PERFETTO);
+    std::string trace = out.str();
+    check(!trace.empty() && static_cast<uint8_t>(trace[0]) == 0x0A, "trace starts with a packet");
+    check(count(trace, "fib") == 15, "one named begin per call");
+}
+
+} // anonymous namespace
+
+int main() {
+    beginChecks("Tracer");
+
+    testEvents();
+    testThreshold();
+    testOverflow();
+    testThreads();
+    testPerfetto();
+
+    return finishChecks("trace");
+}
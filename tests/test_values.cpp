@@ -0,0 +1,166 @@
+#include "../include/decoder.h"
+#include "../include/interpreter.h"
+#include "../include/types.h"
+#include "../benchmarks/wasm_builder.h"
+#include "check.h"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+/**
+ * Typed value parsing and formatting test.
+ * Checks parseValue() for each value type (hex, unsigned range, NaN
+ * payloads, bad input), that formatValue() round-trips bit for bit, and
+ * that calls with the wrong arguments are rejected at the host boundary.
+ *
+ * Usage: ./test_values
+ */
+
+namespace {
+
+bool rejects(const std::string& text, wasm::ValueType type) {
+    try {
+        wasm::parseValue(text, type);
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+uint32_t bitsF32(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+uint64_t bitsF64(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+void testIntegers() {
+    std::cout << "Integers:\n";
+    using wasm::ValueType;
+    check(wasm::parseValue("42", ValueType::I32).value.i32 == 42, "decimal");
+    check(wasm::parseValue("-7", ValueType::I32).value.i32 == -7, "negative");
+    check(wasm::parseValue("0x7fffffff", ValueType::I32).value.i32 == INT32_MAX, "hex");
+    check(wasm::parseValue("0xFFFFFFFF", ValueType::I32).value.i32 == -1, "unsigned range wraps");
+    check(wasm::parseValue("-0x80000000", ValueType::I32).value.i32 == INT32_MIN, "negative hex");
+    check(wasm::parseValue("010", ValueType::I32).value.i32 == 10, "leading zero is decimal");
+    check(wasm::parseValue("-9223372036854775808", ValueType::I64).value.i64 == INT64_MIN, "i64 minimum");
+    check(wasm::parseValue("0xffffffffffffffff", ValueType::I64).value.i64 == -1, "i64 unsigned range");
+    check(wasm::parseValue("5", ValueType::I64).type == ValueType::I64, "typed as i64");
+
+    check(rejects("4294967296", ValueType::I32) && rejects("-2147483649", ValueType::I32), "i32 overflow rejected");
+    check(rejects("18446744073709551616", ValueType::I64), "i64 overflow rejected");
+    check(rejects("", ValueType::I32) && rejects("12abc", ValueType::I32) && rejects("0x", ValueType::I32) &&
+          rejects("1.5", ValueType::I32) && rejects("--1", ValueType::I32), "malformed integers rejected");
+}
+
+void testFloats() {
+    std::cout << "Floats:\n";
+    using wasm::ValueType;
+    check(wasm::parseValue("1.5", ValueType::F64).value.f64 == 1.5, "decimal");
+    check(wasm::parseValue("0x1.8p3", ValueType::F64).value.f64 == 12.0, "hex float");
+    check(wasm::parseValue("0.1", ValueType::F32).value.f32 == 0.1f, "f32 rounded once");
+    check(std::isinf(wasm::parseValue("-inf", ValueType::F32).value.f32), "infinity");
+
+    check(bitsF32(wasm::parseValue("nan", ValueType::F32).value.f32) == 0x7FC00000, "canonical f32 NaN");
+    check(bitsF32(wasm::parseValue("-nan:0x1", ValueType::F32).value.f32) == 0xFF800001, "f32 NaN payload");
+    check(bitsF64(wasm::parseValue("nan:0x4000000000000", ValueType::F64).value.f64) == 0x7FF4000000000000ull,
+          "f64 NaN payload");
+
+    check(rejects("nan:0x0", ValueType::F32) && rejects("nan:0x800000", ValueType::F32), "invalid payload rejected");
+    check(rejects("1e40", ValueType::F32) && rejects("abc", ValueType::F64) && rejects("nan(1)", ValueType::F64),
+          "malformed floats rejected");
+}
+
+void testRoundTrip() {
+    std::cout << "Formatting:\n";
+    using wasm::TypedValue;
+    std::vector<TypedValue> values = {
+        TypedValue::makeI32(-1), TypedValue::makeI64(INT64_MIN),
+        TypedValue::makeF32(0.1f), TypedValue::makeF64(0.1), TypedValue::makeF64(-0.0),
+        TypedValue::makeF64(std::numeric_limits<double>::denorm_min()),
+        wasm::parseValue("-nan:0x123", wasm::ValueType::F64), wasm::parseValue("nan", wasm::ValueType::F32),
+        TypedValue::makeF32(-std::numeric_limits<float>::infinity()),
+    };
+    bool round_trip = true;
+    for (const TypedValue& value : values) {
+        TypedValue parsed = wasm::parseValue(wasm::formatValue(value), value.type);
+        round_trip = round_trip && std::memcmp(&parsed.value, &value.value, wasm::getValueTypeSize(value.type)) == 0;
+    }
+    check(round_trip, "formatted values parse back bit for bit");
+    check(wasm::formatValue(TypedValue::makeF64(0.1)) == "0.10000000000000001", "round-trip precision");
+    check(wasm::formatValue(wasm::parseValue("nan", wasm::ValueType::F64)) == "nan", "canonical NaN plain");
+    check(wasm::formatValue(wasm::parseValue("-nan:0x5", wasm::ValueType::F32)) == "-nan:0x5", "NaN payload shown");
+}
+
+// (func (export "scale") (param i64 f64) (result f64)
+//   (f64.mul (f64.convert_i64_s (local.get 0)) (local.get 1)))
+void testSignatures() {
+    std::cout << "Signatures:\n";
+    using B = WasmBuilder;
+    WasmBuilder builder;
+    uint32_t type = builder.addType({B::I64, B::F64}, {B::F64});
+    Code scale;
+    scale.localGet(0).op(0xB9 /* f64.convert_i64_s */).localGet(1).op(0xA2 /* f64.mul */);
+    builder.addFunction(type, {}, scale.bytes(), "scale");
+    builder.addExport("dangling", B::EXTERN_FUNC, 7);
+
+    wasm::Decoder decoder;
+    wasm::Interpreter interpreter;
+    interpreter.instantiate(decoder.parseBytes(builder.build()));
+
+    const wasm::FuncType& signature = interpreter.exportType("scale");
+    check(signature.params.size() == 2 && signature.params[0] == wasm::ValueType::I64 &&
+          signature.results.size() == 1, "export signature looked up");
+
+    auto results = interpreter.call("scale", {wasm::parseValue("0x10", signature.params[0]),
+                                              wasm::parseValue("0.5", signature.params[1])});
+    check(results.size() == 1 && results[0].value.f64 == 8.0, "typed arguments accepted");
+
+    std::string error;
+    try {
+        interpreter.call("scale", {wasm::TypedValue::makeI32(1), wasm::TypedValue::makeF64(1.0)});
+    } catch (const wasm::InterpreterError& e) {
+        error = e.what();
+    }
+    check(error.find("Argument 0 of scale must be i64, got i32") != std::string::npos, "wrong type rejected");
+
+    error.clear();
+    try {
+        interpreter.call("scale", {wasm::TypedValue::makeI64(1)});
+    } catch (const wasm::InterpreterError& e) {
+        error = e.what();
+    }
+    check(error.find("expects 2 arguments, got 1") != std::string::npos, "wrong count rejected");
+
+    auto rejected = [&](const std::string& name) {
+        try {
+            interpreter.exportType(name);
+        } catch (const wasm::InterpreterError&) {
+            return true;
+        }
+        return false;
+    };
+    check(rejected("nope"), "unknown export rejected");
+    check(rejected("dangling"), "export with an out-of-range function index rejected");
+}
+
+} // anonymous namespace
+
+int main() {
+    beginChecks("Typed Value");
+
+    testIntegers();
+    testFloats();
+    testRoundTrip();
+    testSignatures();
+
+    return finishChecks("value");
+}
@@ -0,0 +1,90 @@
+#include "aot.h"
+#include "decoder.h"
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace {
+
+void printUsage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " <wasm_file> -o <output.so> [options]\n";
+    std::cout << "\nOptions:\n";
+    std::cout << "  -o <file>        Shared object to produce\n";
+    std::cout << "  --emit-c <file>  Write the generated C source and do not compile\n";
+    std::cout << "  --cc <compiler>  C compiler driver (default: $CC or cc)\n";
+    std::cout << "  -O<level>        Optimization level passed to the compiler (default: -O2)\n";
+    std::cout << "  --optimize       Optimizing tier: cached memory bounds, static check elimination\n";
+    std::cout << "  --keep-c         Keep the generated <output.so>.c\n";
+    std::cout << "\nExamples:\n";
+    std::cout << "  " << program_name << " module.wasm -o module.so\n";
+    std::cout << "  wasm-interpreter --native module.so module.wasm add 5 10\n";
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    std::string wasm_file;
+    std::string output_file;
+    std::string c_file;
+    wasm::AotOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "-o" && i + 1 < argc) {
+            output_file = argv[++i];
+        } else if (arg == "--emit-c" && i + 1 < argc) {
+            c_file = argv[++i];
+        } else if (arg == "--cc" && i + 1 < argc) {
+            options.compiler = argv[++i];
+        } else if (arg.size() > 2 && arg.compare(0, 2, "-O") == 0) {
+            options.optimization = arg;
+        } else if (arg == "--optimize") {
+            options.optimize = true;
+        } else if (arg == "--keep-c") {
+            options.keep_source = true;
+        } else if (wasm_file.empty() && arg[0] != '-') {
+            wasm_file = arg;
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (wasm_file.empty() || (output_file.empty() && c_file.empty())) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try {
+        wasm::Decoder decoder;
+        wasm::Module module = decoder.parse(wasm_file);
+        wasm::AotCompiler compiler(options);
+
+        if (!c_file.empty()) {
+            std::ofstream out(c_file, std::ios::binary);
+            out << compiler.translate(module);
+            if (!out) {
+                std::cerr << "Cannot write " << c_file << "\n";
+                return 1;
+            }
+            std::cout << "Wrote " << c_file << "\n";
+        }
+
+        if (!output_file.empty()) {
+            compiler.compile(module, output_file);
+            std::cout << "Compiled " << wasm_file << " -> " << output_file << "\n";
+        }
+        return 0;
+
+    } catch (const wasm::DecoderError& e) {
+        std::cerr << "Decoder error: " << e.what() << "\n";
+        return 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,123 @@
+#include "server.h"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+void printUsage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " <socket> [options] <function_name> [args...]\n";
+    std::cout << "       " << program_name << " <socket> --load <wasm_file>\n";
+    std::cout << "       " << program_name << " <socket> --shutdown\n";
+    std::cout << "\nCalls a function on a server started with wasm-interpreter --serve.\n";
+    std::cout << "Arguments are i32 unless typed, as in i64:5 or f64:0.5.\n";
+    std::cout << "\nOptions:\n";
+    std::cout << "  --module <id>    Module to call (default: 0)\n";
+    std::cout << "  --write <offset> <file>  Copy a file into memory before the call\n";
+    std::cout << "  --read <offset> <length> Print memory after the call as hex\n";
+    std::cout << "  --repeat <n>     Make the call n times over one connection\n";
+    std::cout << "  --load <file>    Load a module on the server and print its id\n";
+    std::cout << "  --shutdown       Stop the server\n";
+    std::cout << "\nExamples:\n";
+    std::cout << "  wasm-interpreter --serve /tmp/wasm.sock module.wasm &\n";
+    std::cout << "  " << program_name << " /tmp/wasm.sock add 5 10\n";
+}
+
+void printResults(const std::vector<wasm::TypedValue>& results) {
+    for (size_t i = 0; i < results.size(); i++) {
+        std::cout << (i > 0 ? " " : "") << wasm::formatValue(results[i]);
+    }
+    std::cout << '\n';
+}
+
+// "i64:5" or "f64:nan:0x1"; untyped arguments are i32
+wasm::TypedValue parseTypedArgument(const std::string& arg) {
+    static const std::pair<const char*, wasm::ValueType> TYPES[] = {
+        {"i32:", wasm::ValueType::I32}, {"i64:", wasm::ValueType::I64},
+        {"f32:", wasm::ValueType::F32}, {"f64:", wasm::ValueType::F64}};
+    for (const auto& type : TYPES) {
+        if (arg.compare(0, 4, type.first) == 0) {
+            return wasm::parseValue(arg.substr(4), type.second);
+        }
+    }
+    return wasm::parseValue(arg, wasm::ValueType::I32);
+}
+
+void printHex(const std::vector<uint8_t>& bytes) {
+    std::cout << std::hex << std::setfill('0');
+    for (size_t i = 0; i < bytes.size(); i++) {
+        std::cout << std::setw(2) << static_cast<int>(bytes[i]) << (i + 1 == bytes.size() || i % 16 == 15 ? "\n" : " ");
+    }
+    std::cout << std::dec << std::setfill(' ');
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return argc == 2 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help") ? 0 : 1;
+    }
+
+    try {
+        wasm::Client client(argv[1]);
+        wasm::protocol::InvokeRequest request;
+        unsigned long repeat = 1;
+
+        int i = 2;
+        for (; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--shutdown") {
+                client.shutdown();
+                return 0;
+            } else if (arg == "--load" && i + 1 < argc) {
+                std::cout << client.load(argv[i + 1]) << "\n";
+                return 0;
+            } else if (arg == "--module" && i + 1 < argc) {
+                request.module_id = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--write" && i + 2 < argc) {
+                request.memory_offset = static_cast<uint32_t>(std::stoul(argv[++i]));
+                std::ifstream file(argv[++i], std::ios::binary);
+                if (!file.is_open()) {
+                    std::cerr << "Cannot open " << argv[i] << "\n";
+                    return 1;
+                }
+                request.memory.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            } else if (arg == "--read" && i + 2 < argc) {
+                request.read_offset = static_cast<uint32_t>(std::stoul(argv[++i]));
+                request.read_length = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--repeat" && i + 1 < argc) {
+                repeat = std::stoul(argv[++i]);
+            } else {
+                break;
+            }
+        }
+        if (i >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        request.function_name = argv[i];
+        for (int j = i + 1; j < argc; j++) {
+            request.args.push_back(parseTypedArgument(argv[j]));
+        }
+
+        wasm::protocol::InvokeResponse response;
+        for (unsigned long n = 0; n < repeat; n++) {
+            response = client.invoke(request);
+        }
+        printResults(response.results);
+        if (request.read_length > 0) {
+            printHex(response.memory);
+        }
+        return 0;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}
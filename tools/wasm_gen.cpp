@@ -0,0 +1,114 @@
+#include "../benchmarks/module_generator.h"
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+void printUsage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " -o <output.wasm> [options]\n";
+    std::cout << "\nWrites a synthetic module that validates and instantiates, for measuring\n";
+    std::cout << "how decoding and instantiation scale with module size.\n";
+    std::cout << "\nOptions:\n";
+    std::cout << "  -o <file>            Module to write\n";
+    std::cout << "  --functions <n>      Defined functions (default: 1000)\n";
+    std::cout << "  --body <min>:<max>   Statements per body, log-uniform (default: 4:64)\n";
+    std::cout << "  --imports <n>        Imported functions (default: 0)\n";
+    std::cout << "  --exports <n>        Exported functions (default: 0)\n";
+    std::cout << "  --data <size>        Bytes of active data, with K, M or G suffix (default: 0)\n";
+    std::cout << "  --table <n>          Table elements (default: none)\n";
+    std::cout << "  --seed <n>           Random seed (default: 1)\n";
+    std::cout << "\nExamples:\n";
+    std::cout << "  " << program_name << " -o big.wasm --functions 100000 --exports 1000\n";
+    std::cout << "  " << program_name << " -o data.wasm --functions 10 --data 1G\n";
+}
+
+// "64", "64K", "16M", "1G"
+uint64_t parseSize(const std::string& text) {
+    size_t end = 0;
+    uint64_t value = std::stoull(text, &end);
+    std::string suffix = text.substr(end);
+    if (suffix == "K" || suffix == "k") return value << 10;
+    if (suffix == "M" || suffix == "m") return value << 20;
+    if (suffix == "G" || suffix == "g") return value << 30;
+    if (!suffix.empty()) {
+        throw std::invalid_argument("Unknown size suffix: " + suffix);
+    }
+    return value;
+}
+
+uint32_t parseCount(const std::string& text) {
+    return static_cast<uint32_t>(std::stoul(text));
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    std::string output_file;
+    ModuleShape shape;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "-h" || arg == "--help") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (arg == "-o" && i + 1 < argc) {
+                output_file = argv[++i];
+            } else if (arg == "--functions" && i + 1 < argc) {
+                shape.functions = parseCount(argv[++i]);
+            } else if (arg == "--body" && i + 1 < argc) {
+                std::string range = argv[++i];
+                size_t colon = range.find(':');
+                if (colon == std::string::npos) {
+                    throw std::invalid_argument("--body takes <min>:<max>");
+                }
+                shape.min_statements = parseCount(range.substr(0, colon));
+                shape.max_statements = parseCount(range.substr(colon + 1));
+            } else if (arg == "--imports" && i + 1 < argc) {
+                shape.imports = parseCount(argv[++i]);
+            } else if (arg == "--exports" && i + 1 < argc) {
+                shape.exports = parseCount(argv[++i]);
+            } else if (arg == "--data" && i + 1 < argc) {
+                shape.data_bytes = parseSize(argv[++i]);
+            } else if (arg == "--table" && i + 1 < argc) {
+                shape.table_size = parseCount(argv[++i]);
+            } else if (arg == "--seed" && i + 1 < argc) {
+                shape.seed = parseCount(argv[++i]);
+            } else {
+                std::cerr << "Unknown option: " << arg << "\n";
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    if (output_file.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    // Linear memory is at most 4 GiB, and segment offsets are i32.const
+    if (shape.data_bytes > (uint64_t(2) << 30)) {
+        std::cerr << "Error: --data is limited to 2G\n";
+        return 1;
+    }
+
+    std::ofstream out(output_file, std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << "Cannot open " << output_file << "\n";
+        return 1;
+    }
+    uint64_t bytes = writeModule(shape, out);
+    out.close();
+    if (!out) {
+        std::cerr << "Error writing " << output_file << "\n";
+        return 1;
+    }
+    std::cout << output_file << ": " << bytes << " bytes, " << shape.functions << " functions, "
+              << shape.imports << " imports, " << shape.exports << " exports\n";
+    return 0;
+}